@@ -0,0 +1,74 @@
+// Decoder for the packed device table - shared by NetworkService and the
+// device table benchmark (tests/bench/bench_device_table.js), so there is
+// one reader of the format
+import type { DeviceInfo } from './types';
+
+// Packed device table constants - must match src/native/network/device_table.h
+const DEVICE_TABLE_MAGIC = 0x5444534E;
+const DEVICE_TABLE_VERSION = 1;
+const NO_STRING = 0xFFFFFFFF;
+const DEVICE_FLAG_ONLINE = 0x01;
+const DEVICE_FLAG_NAME_IS_IP = 0x02;
+const DEVICE_FLAG_BLOCKED = 0x04;
+const DEVICE_FLAG_TRAFFIC_CONTROL = 0x08;
+
+/**
+ * Decode the packed device table produced by the native module.
+ * Layout is defined in src/native/network/device_table.h:
+ * 32-byte header, 48-byte records, then a deduplicated string table.
+ * @param buffer ArrayBuffer returned by scanDevicesPacked/getDeviceTablePacked
+ * @returns DeviceInfo[] Decoded devices
+ */
+export function decodeDeviceTable(buffer: ArrayBuffer): DeviceInfo[] {
+  const view = new DataView(buffer);
+  if (buffer.byteLength < 32 || view.getUint32(0, true) !== DEVICE_TABLE_MAGIC) {
+    throw new Error('Invalid packed device table');
+  }
+  if (view.getUint16(4, true) !== DEVICE_TABLE_VERSION) {
+    throw new Error(`Unsupported device table version ${view.getUint16(4, true)}`);
+  }
+
+  const recordSize = view.getUint16(6, true);
+  const recordCount = view.getUint32(8, true);
+  const stringCount = view.getUint32(12, true);
+  const recordsOffset = view.getUint32(16, true);
+  const stringsOffset = view.getUint32(20, true);
+
+  // Decode every distinct string exactly once
+  const bytes = new Uint8Array(buffer);
+  const decoder = new TextDecoder();
+  const stringData = stringsOffset + (stringCount + 1) * 4;
+  const strings: string[] = new Array(stringCount);
+  for (let i = 0; i < stringCount; i++) {
+    const start = view.getUint32(stringsOffset + i * 4, true);
+    const end = view.getUint32(stringsOffset + (i + 1) * 4, true);
+    strings[i] = decoder.decode(bytes.subarray(stringData + start, stringData + end));
+  }
+
+  const hex = (b: number) => (b < 16 ? '0' : '') + b.toString(16);
+  const devices: DeviceInfo[] = new Array(recordCount);
+  for (let i = 0; i < recordCount; i++) {
+    const o = recordsOffset + i * recordSize;
+    const ip = `${bytes[o]}.${bytes[o + 1]}.${bytes[o + 2]}.${bytes[o + 3]}`;
+    const mac = `${hex(bytes[o + 4])}:${hex(bytes[o + 5])}:${hex(bytes[o + 6])}:` +
+                `${hex(bytes[o + 7])}:${hex(bytes[o + 8])}:${hex(bytes[o + 9])}`;
+    const flags = bytes[o + 10];
+    const nameIndex = view.getUint32(o + 12, true);
+    const vendorIndex = view.getUint32(o + 16, true);
+
+    devices[i] = {
+      ip,
+      mac,
+      name: (flags & DEVICE_FLAG_NAME_IS_IP) ? ip : (nameIndex === NO_STRING ? '' : strings[nameIndex]),
+      vendor: vendorIndex === NO_STRING ? '' : strings[vendorIndex],
+      isOnline: (flags & DEVICE_FLAG_ONLINE) !== 0,
+      lastSeen: view.getFloat64(o + 24, true),
+      downloadLimit: view.getFloat64(o + 32, true),
+      uploadLimit: view.getFloat64(o + 40, true),
+      isBlocked: (flags & DEVICE_FLAG_BLOCKED) !== 0,
+      hasTrafficControl: (flags & DEVICE_FLAG_TRAFFIC_CONTROL) !== 0
+    };
+  }
+
+  return devices;
+}
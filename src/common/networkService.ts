@@ -1,6 +1,7 @@
 // Network service for renderer process - handles IPC communication with main process
 import { ipcRenderer } from 'electron';
 import { DeviceInfo, TrafficControl } from './types';
+import { decodeDeviceTable } from './deviceTable';
 
 /**
  * NetworkService provides a clean interface for the renderer process to interact
@@ -21,6 +22,44 @@ export class NetworkService {
     }
   }
 
+  /**
+   * Scan for devices and receive the result as a packed device table
+   * @returns Promise<DeviceInfo[]> Array of discovered devices
+   */
+  static async scanDevicesPacked(): Promise<DeviceInfo[]> {
+    try {
+      const buffer: ArrayBuffer | null = await ipcRenderer.invoke('network:scanDevicesPacked');
+      return buffer ? NetworkService.decodeDeviceTable(buffer) : [];
+    } catch (error) {
+      console.error('Error in NetworkService.scanDevicesPacked:', error);
+      return [];
+    }
+  }
+
+  /**
+   * Decode the packed device table produced by the native module (see ./deviceTable)
+   * @param buffer ArrayBuffer returned by scanDevicesPacked/getDeviceTablePacked
+   * @returns DeviceInfo[] Decoded devices
+   */
+  static decodeDeviceTable(buffer: ArrayBuffer): DeviceInfo[] {
+    return decodeDeviceTable(buffer);
+  }
+
+  /**
+   * Get every device remembered from previous sessions (names included),
+   * marked offline until a scan sees them again
+   * @returns Promise<DeviceInfo[]> Known devices
+   */
+  static async getKnownDevices(): Promise<DeviceInfo[]> {
+    try {
+      const buffer: ArrayBuffer | null = await ipcRenderer.invoke('network:getKnownDevices');
+      return buffer ? NetworkService.decodeDeviceTable(buffer) : [];
+    } catch (error) {
+      console.error('Error in NetworkService.getKnownDevices:', error);
+      return [];
+    }
+  }
+
   /**
    * Get detailed information about a specific device
    * @param mac MAC address of the device
@@ -25,6 +25,17 @@ export interface NetworkTopology {
   isValid: boolean;
 }
 
+// Latency percentiles from a native histogram (milliseconds)
+export interface LatencySummary {
+  count: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  p999Ms: number;
+  maxMs: number;
+}
+
 // ARP performance statistics
 export interface ArpPerformanceStats {
   packetsSent: number;
@@ -33,8 +44,23 @@ export interface ArpPerformanceStats {
   receiveErrors: number;
   avgSendTimeMs: number;
   avgReceiveTimeMs: number;
+  sendLatency: LatencySummary;
+  receiveLatency: LatencySummary;
+  // Per-stage data path latency (capture, classify, shape, forward)
+  stageLatency: Record<string, LatencySummary>;
+  // Capture handle: profile, kernel buffer and the kernel's counters
+  captureProfile: string;
+  captureBufferBytes: number;
+  captureReceived: number;
+  captureDropped: number;           // capture buffer overflowed
+  captureInterfaceDropped: number;  // lost by the driver/NIC
 }
 
+// How initializeArp opens the capture handle: 'low-latency' relays full
+// frames as they arrive (default), 'throughput' keeps headers only with a
+// large buffer for accounting, 'arp-only' captures nothing but ARP
+export type CaptureProfile = 'low-latency' | 'throughput' | 'arp-only';
+
 export interface DeviceInfo {
   ip: string;
   mac: string;
@@ -47,6 +73,13 @@ export interface DeviceInfo {
   uploadLimit?: number;
   isBlocked?: boolean;
   hasTrafficControl?: boolean;
+  // Traffic counters (from getDeviceDetails)
+  bytesDown?: number;
+  bytesUp?: number;
+  packetsDown?: number;
+  packetsUp?: number;
+  dropsDown?: number;
+  dropsUp?: number;
   // ARP poisoning state
   isPoisoned?: boolean;
 }
@@ -57,6 +90,78 @@ export interface TrafficControl {
   uploadLimit: number;   // Mbps
   isBlocked: boolean;
   isActive: boolean;
+  // Traffic seen since control was enabled
+  bytesDown?: number;
+  bytesUp?: number;
+  packetsDown?: number;
+  packetsUp?: number;
+  dropsDown?: number;
+  dropsUp?: number;
+}
+
+// Native name resolver pool/cache statistics
+export interface ResolverStats {
+  requests: number;
+  cacheHits: number;
+  coalesced: number;
+  lookups: number;
+  lookupsFailed: number;
+  cacheSize: number;
+  queued: number;
+  inFlight: number;
+}
+
+// Simulated LAN backend used for load tests (times in milliseconds)
+export interface SimulatedNetworkOptions {
+  deviceCount?: number;
+  seed?: number;
+  responseRate?: number;       // fraction of devices answering ARP
+  trafficMbps?: number;        // per device and direction
+  arpCacheTimeoutMs?: number;
+  dhcpIntervalMs?: number;
+  mdnsIntervalMs?: number;
+}
+
+export interface SimulatedDevice {
+  ip: string;
+  mac: string;
+  respondsToArp: boolean;
+}
+
+export interface SimulatedNetworkStats {
+  devices: number;
+  poisonedDevices: number;
+  restoredDevices: number;
+  arpRequests: number;
+  arpReplies: number;
+  poisonUpdates: number;
+  restoreUpdates: number;
+  cacheExpiries: number;
+  poisonLapses: number;
+  chatterFrames: number;
+  trafficGenerated: number;
+  trafficIntercepted: number;
+  framesDelivered: number;
+  framesUnroutable: number;
+  rxDropped: number;
+}
+
+// Name learned from mDNS/NBNS/LLMNR discovery
+export interface DiscoveredName {
+  ip: string;
+  name: string;
+  source: 'mdns' | 'nbns' | 'llmnr';
+  applied: boolean;   // the name replaced a placeholder; names already known are kept
+}
+
+// Result of benchmarkDeviceTableTransfer (object-per-device vs packed ArrayBuffer)
+export interface DeviceTableBenchmark {
+  count: number;
+  iterations: number;
+  objectPathMs: number;
+  packedPathMs: number;
+  packedBytes: number;
+  packed: ArrayBuffer;
 }
 
 // Network module interface - this represents our C++ native module
@@ -64,8 +169,16 @@ export interface NetworkModule {
   // Device discovery functions
   scanDevices(): DeviceInfo[];
   scanDevicesFast(): DeviceInfo[];
+  scanDevicesPacked(): ArrayBuffer;
+  getDeviceTablePacked(): ArrayBuffer;
+  benchmarkDeviceTableTransfer(count: number, iterations?: number): DeviceTableBenchmark;
+  openDeviceInventory(path: string): boolean;
+  getDeviceInventoryPacked(): ArrayBuffer | null;
   getDeviceDetails(mac: string): DeviceInfo;
   resolveSingleDeviceName(ip: string): string;
+  resolveDeviceNames(ips: string[], callback: (ip: string, name: string, remaining: number) => void): number;
+  getResolverStats(): ResolverStats;
+  discoverDeviceNames(windowMs?: number): Promise<DiscoveredName[]>;
   
   // Traffic control functions
   setBandwidthLimit(mac: string, downloadLimit: number, uploadLimit: number): boolean;
@@ -75,7 +188,7 @@ export interface NetworkModule {
   
   // ARP functionality
   enumerateNetworkAdapters(): NetworkAdapter[];
-  initializeArp(adapterName: string): boolean;
+  initializeArp(adapterName: string, profile?: CaptureProfile): boolean;
   getNetworkTopology(): NetworkTopology;
   sendArpRequest(targetIp: string): boolean;
   getArpPerformanceStats(): ArpPerformanceStats;
@@ -84,6 +197,37 @@ export interface NetworkModule {
   // ARP Poisoning functionality
   startArpPoisoning(targetIp: string, targetMac: string): boolean;
   stopArpPoisoning(targetIp: string): boolean;
+  
+  // Simulated LAN backend (replaces the adapter until the next initializeArp)
+  initializeSimulatedNetwork(options?: SimulatedNetworkOptions): boolean;
+  getSimulatedDevices(): SimulatedDevice[];
+  getSimulatedNetworkStats(): SimulatedNetworkStats | null;
+}
+
+// NetworkModule functions netshaperd serves over its control endpoint: the
+// engine state that has to outlive the UI (ARP session, poisoning, traffic
+// controls). Scanning and name resolution stay in the in-process module.
+export type DaemonCommand =
+  | 'setBandwidthLimit' | 'setDeviceBlocked' | 'removeTrafficControl' | 'getActiveControls'
+  | 'enumerateNetworkAdapters' | 'initializeArp' | 'getNetworkTopology' | 'sendArpRequest'
+  | 'getArpPerformanceStats' | 'cleanupArp' | 'startArpPoisoning' | 'stopArpPoisoning';
+
+// Engine calls answered either in-process (NetworkModule) or by netshaperd (async)
+export type EngineApi = {
+  [K in DaemonCommand]: (...args: Parameters<NetworkModule[K]>) =>
+    ReturnType<NetworkModule[K]> | Promise<ReturnType<NetworkModule[K]>>;
+};
+
+// netshaperd "status" reply
+export interface DaemonStatus {
+  version: string;
+  pid: number;
+  arpEngine: boolean;        // built with the ARP engine
+  arpInitialized: boolean;
+  uptimeSeconds: number;
+  activeControls: number;
+  requestsHandled: number;
+  logDropped: number;
 }
 
 // Application settings interface
@@ -0,0 +1,168 @@
+import * as net from 'net';
+import {
+  ArpPerformanceStats, CaptureProfile, DaemonStatus, EngineApi, NetworkAdapter, NetworkTopology, TrafficControl
+} from '../common/types';
+
+// Default netshaperd endpoints (see src/native/network/control_server.h)
+export const DEFAULT_DAEMON_ENDPOINT = process.platform === 'win32'
+  ? '\\\\.\\pipe\\netshaperd'
+  : '/run/netshaperd.sock';
+
+const REQUEST_TIMEOUT_MS = 10000;
+
+interface PendingRequest {
+  resolve: (result: any) => void;
+  reject: (error: Error) => void;
+  timer: NodeJS.Timeout;
+}
+
+// Client for the netshaperd control endpoint (Unix socket or named pipe).
+// Sends "<id> <command> [arg ...]" lines and matches the JSON reply lines
+// by id. Implements the engine calls of NetworkModule as promises, so the
+// main process can use the daemon in place of the in-process module.
+export class DaemonClient implements EngineApi {
+  private socket: net.Socket | null = null;
+  private buffer = '';
+  private nextId = 1;
+  private pending = new Map<number, PendingRequest>();
+
+  constructor(public readonly endpoint: string = DEFAULT_DAEMON_ENDPOINT) {}
+
+  connect(timeoutMs: number = 2000): Promise<void> {
+    return new Promise((resolve, reject) => {
+      const socket = net.connect(this.endpoint);
+      const timer = setTimeout(() => {
+        socket.destroy();
+        reject(new Error(`Timed out connecting to netshaperd at ${this.endpoint}`));
+      }, timeoutMs);
+
+      socket.setEncoding('utf8');
+      socket.once('connect', () => {
+        clearTimeout(timer);
+        this.socket = socket;
+        resolve();
+      });
+      socket.once('error', error => {
+        clearTimeout(timer);
+        if (this.socket !== socket) {
+          reject(error);
+        }
+      });
+      socket.on('data', (chunk: string) => this.onData(chunk));
+      socket.on('close', () => this.onClose(socket));
+    });
+  }
+
+  isConnected(): boolean {
+    return this.socket !== null;
+  }
+
+  close(): void {
+    this.socket?.end();
+  }
+
+  request<T = unknown>(command: string, ...args: Array<string | number | boolean>): Promise<T> {
+    if (!this.socket) {
+      return Promise.reject(new Error('Not connected to netshaperd'));
+    }
+    for (const arg of args) {
+      if (/\s/.test(String(arg)) || String(arg) === '') {
+        return Promise.reject(new Error(`netshaperd arguments cannot be empty or contain whitespace: '${arg}'`));
+      }
+    }
+
+    const id = this.nextId++;
+    const line = [id, command, ...args].join(' ') + '\n';
+    return new Promise<T>((resolve, reject) => {
+      const timer = setTimeout(() => {
+        this.pending.delete(id);
+        reject(new Error(`netshaperd did not answer ${command} within ${REQUEST_TIMEOUT_MS} ms`));
+      }, REQUEST_TIMEOUT_MS);
+      this.pending.set(id, { resolve, reject, timer });
+      this.socket!.write(line);
+    });
+  }
+
+  private onData(chunk: string): void {
+    this.buffer += chunk;
+    let newline: number;
+    while ((newline = this.buffer.indexOf('\n')) >= 0) {
+      const line = this.buffer.slice(0, newline);
+      this.buffer = this.buffer.slice(newline + 1);
+      if (line.length === 0) continue;
+
+      let reply: { id: number; ok: boolean; result?: unknown; error?: string };
+      try {
+        reply = JSON.parse(line);
+      } catch (error) {
+        console.error('Malformed reply from netshaperd:', line);
+        continue;
+      }
+
+      const pending = this.pending.get(reply.id);
+      if (!pending) continue;
+      this.pending.delete(reply.id);
+      clearTimeout(pending.timer);
+      if (reply.ok) {
+        pending.resolve(reply.result);
+      } else {
+        pending.reject(new Error(reply.error || 'netshaperd request failed'));
+      }
+    }
+  }
+
+  private onClose(socket: net.Socket): void {
+    if (this.socket !== socket) return;
+    this.socket = null;
+    this.buffer = '';
+    for (const pending of this.pending.values()) {
+      clearTimeout(pending.timer);
+      pending.reject(new Error('Connection to netshaperd closed'));
+    }
+    this.pending.clear();
+  }
+
+  // Daemon management
+  ping(): Promise<string> { return this.request('ping'); }
+  status(): Promise<DaemonStatus> { return this.request('status'); }
+
+  // Traffic control
+  setBandwidthLimit(mac: string, downloadLimit: number, uploadLimit: number): Promise<boolean> {
+    return this.request('setBandwidthLimit', mac, downloadLimit, uploadLimit);
+  }
+  setDeviceBlocked(mac: string, blocked: boolean): Promise<boolean> {
+    return this.request('setDeviceBlocked', mac, blocked);
+  }
+  removeTrafficControl(mac: string): Promise<boolean> {
+    return this.request('removeTrafficControl', mac);
+  }
+  getActiveControls(): Promise<TrafficControl[]> {
+    return this.request('getActiveControls');
+  }
+
+  // ARP and poisoning
+  enumerateNetworkAdapters(): Promise<NetworkAdapter[]> {
+    return this.request('enumerateNetworkAdapters');
+  }
+  initializeArp(adapterName: string, profile?: CaptureProfile): Promise<boolean> {
+    return profile ? this.request('initializeArp', adapterName, profile) : this.request('initializeArp', adapterName);
+  }
+  getNetworkTopology(): Promise<NetworkTopology> {
+    return this.request('getNetworkTopology');
+  }
+  sendArpRequest(targetIp: string): Promise<boolean> {
+    return this.request('sendArpRequest', targetIp);
+  }
+  getArpPerformanceStats(): Promise<ArpPerformanceStats> {
+    return this.request('getArpPerformanceStats');
+  }
+  async cleanupArp(): Promise<void> {
+    await this.request('cleanupArp');
+  }
+  startArpPoisoning(targetIp: string, targetMac: string): Promise<boolean> {
+    return this.request('startArpPoisoning', targetIp, targetMac);
+  }
+  stopArpPoisoning(targetIp: string): Promise<boolean> {
+    return this.request('stopArpPoisoning', targetIp);
+  }
+}
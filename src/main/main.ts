@@ -1,8 +1,7 @@
 import { app, BrowserWindow, Menu, dialog, ipcMain } from 'electron';
 import * as path from 'path';
-import * as dns from 'dns';
-import { promisify } from 'util';
-import { NetworkModule, DeviceInfo, TrafficControl } from '../common/types';
+import { NetworkModule, DeviceInfo, TrafficControl, EngineApi, CaptureProfile } from '../common/types';
+import { DaemonClient, DEFAULT_DAEMON_ENDPOINT } from './daemonClient';
 
 let mainWindow: BrowserWindow | null = null;
 
@@ -127,7 +126,9 @@ function createMenu() {
 
 // This method will be called when Electron has finished
 // initialization and is ready to create browser windows.
-app.whenReady().then(() => {
+app.whenReady().then(async () => {
+  openDeviceInventory();
+  await connectDaemon();
   createWindow();
 
   app.on('activate', () => {
@@ -185,6 +186,54 @@ try {
   console.error('Fatal error loading network module:', error);
 }
 
+// Open the persistent device inventory so known devices (and their names)
+// are available before the first scan completes
+function openDeviceInventory() {
+  if (!networkModule) {
+    return;
+  }
+  
+  try {
+    const inventoryPath = path.join(app.getPath('userData'), 'devices.inv');
+    if (!networkModule.openDeviceInventory(inventoryPath)) {
+      console.error('Failed to open device inventory at', inventoryPath);
+    }
+  } catch (error) {
+    console.error('Error opening device inventory:', error);
+  }
+}
+
+// Optional netshaperd connection. With NETSHAPER_DAEMON set (to an endpoint,
+// or to 1 for the default one) the engine calls go to the daemon, which keeps
+// limits and poisoning running when the app closes or crashes.
+let daemonClient: DaemonClient | null = null;
+
+async function connectDaemon() {
+  const setting = process.env.NETSHAPER_DAEMON;
+  if (!setting || setting === '0') {
+    return;
+  }
+  
+  const endpoint = setting === '1' ? DEFAULT_DAEMON_ENDPOINT : setting;
+  const client = new DaemonClient(endpoint);
+  try {
+    await client.connect();
+    const status = await client.status();
+    console.log(`Connected to netshaperd ${status.version} (pid ${status.pid}) at ${endpoint}`);
+    daemonClient = client;
+  } catch (error) {
+    console.error('Could not connect to netshaperd, using the in-process engine:', error);
+  }
+}
+
+// Engine calls go to netshaperd when connected, otherwise to the native module
+function getEngine(): EngineApi | null {
+  if (daemonClient && daemonClient.isConnected()) {
+    return daemonClient;
+  }
+  return networkModule;
+}
+
 // Handle IPC messages from renderer process
 ipcMain.handle('network:scanDevices', async (): Promise<DeviceInfo[]> => {
   if (!networkModule) {
@@ -200,36 +249,98 @@ ipcMain.handle('network:scanDevices', async (): Promise<DeviceInfo[]> => {
   }
 });
 
-// Background DNS resolution function
-async function resolveDeviceNames(devices: any[]) {
-  console.log('Starting background DNS resolution for', devices.length, 'devices');
+// Packed scan - returns the device table as one ArrayBuffer (decoded by NetworkService.decodeDeviceTable)
+ipcMain.handle('network:scanDevicesPacked', async (): Promise<ArrayBuffer | null> => {
+  if (!networkModule) {
+    console.error('Network module not loaded');
+    return null;
+  }
   
+  try {
+    return networkModule.scanDevicesPacked();
+  } catch (error) {
+    console.error('Error scanning devices (packed):', error);
+    return null;
+  }
+});
+
+// Background name resolution using the native resolver pool (cached, coalesced,
+// bounded concurrency). Streams device:updated as names arrive and signals
+// async-dns:complete once every IP in the batch has an answer.
+function resolveDeviceNames(devices: Array<{ip: string, mac: string}>): boolean {
+  if (!networkModule || devices.length === 0) {
+    return false;
+  }
+  
+  // Several MACs can share an IP between scans; update all of them
+  const macsByIp = new Map<string, string[]>();
   for (const device of devices) {
-    try {
-      // Use the individual DNS resolution function (much faster)
-      const resolvedName = networkModule?.resolveSingleDeviceName(device.ip);
-      
-      if (resolvedName && resolvedName !== device.name && resolvedName !== device.ip) {
-        console.log('Resolved name for', device.ip, ':', resolvedName);
-        // Send updated device info if name was resolved
-        if (mainWindow) {
-          mainWindow.webContents.send('device:updated', {
-            ...device,
-            name: resolvedName
-          });
-        }
+    const macs = macsByIp.get(device.ip) || [];
+    macs.push(device.mac);
+    macsByIp.set(device.ip, macs);
+  }
+  
+  console.log('Starting native name resolution for', macsByIp.size, 'addresses');
+  
+  networkModule.resolveDeviceNames(Array.from(macsByIp.keys()), (ip, name, remaining) => {
+    if (name && name !== ip && mainWindow) {
+      for (const mac of macsByIp.get(ip) || []) {
+        mainWindow.webContents.send('device:updated', { ip, mac, name });
       }
-    } catch (error) {
-      console.log('Failed to resolve name for device:', device.mac, error);
     }
     
-    // Small delay between DNS lookups to prevent overwhelming the network
-    await new Promise(resolve => setTimeout(resolve, 300));
+    if (remaining === 0) {
+      console.log('Name resolution completed');
+      if (mainWindow) {
+        mainWindow.webContents.send('async-dns:complete');
+      }
+    }
+  });
+  
+  return true;
+}
+
+// One-round mDNS/NBNS/LLMNR discovery for devices reverse DNS doesn't know.
+// Names arrive as device:updated events, same as resolver results; only
+// names the native side applied are sent, so a resolved name is never
+// replaced in the UI while the inventory keeps it.
+function discoverLocalNames(devices: Array<{ip: string, mac: string}>) {
+  if (!networkModule) {
+    return;
   }
   
-  console.log('Background DNS resolution completed');
+  networkModule.discoverDeviceNames().then(results => {
+    console.log('Local name discovery found', results.length, 'names');
+    for (const found of results) {
+      if (!found.applied) {
+        continue;
+      }
+      for (const device of devices) {
+        if (device.ip === found.ip && mainWindow) {
+          mainWindow.webContents.send('device:updated', { ip: device.ip, mac: device.mac, name: found.name });
+        }
+      }
+    }
+  }).catch(error => {
+    console.log('Local name discovery failed:', error instanceof Error ? error.message : String(error));
+  });
 }
 
+// Known devices from the persistent inventory, packed (all offline until a scan sees them)
+ipcMain.handle('network:getKnownDevices', async (): Promise<ArrayBuffer | null> => {
+  if (!networkModule) {
+    console.error('Network module not loaded');
+    return null;
+  }
+  
+  try {
+    return networkModule.getDeviceInventoryPacked();
+  } catch (error) {
+    console.error('Error reading device inventory:', error);
+    return null;
+  }
+});
+
 // New streaming scan method with automatic DNS resolution
 ipcMain.handle('network:startStreamingScan', async (): Promise<boolean> => {
   if (!networkModule) {
@@ -275,68 +386,12 @@ ipcMain.handle('network:startStreamingScan', async (): Promise<boolean> => {
       mainWindow.webContents.send('scan:complete');
     }
     
-    // Automatically start DNS resolution after scan
+    // Automatically start name resolution after scan (only new or expired
+    // cache entries cause real lookups)
     if (deviceList.length > 0) {
-      console.log('Automatically starting DNS resolution for', deviceList.length, 'devices');
-      
-      // Start async DNS resolution using Node.js async DNS
-      const reverseAsync = promisify(dns.reverse);
-      
-      // Process each device asynchronously without blocking
-      const resolveDevice = async (device: any) => {
-        try {
-          console.log('Resolving DNS for:', device.ip);
-          const hostnames = await reverseAsync(device.ip);
-          
-          if (hostnames && hostnames.length > 0) {
-            let name = hostnames[0];
-            // Remove domain suffix if present
-            const dotPos = name.indexOf('.');
-            if (dotPos !== -1) {
-              name = name.substring(0, dotPos);
-            }
-            
-            console.log('DNS resolved:', device.ip, '→', name);
-            
-            // Send result to renderer with MAC address for matching
-            if (mainWindow) {
-              mainWindow.webContents.send('device:updated', {
-                ip: device.ip,
-                mac: device.mac,
-                name: name
-              });
-            }
-          }
-        } catch (error) {
-          console.log('DNS resolution failed for', device.ip, ':', error instanceof Error ? error.message : String(error));
-        }
-      };
-      
-      // Start DNS resolution for all devices with staggered delays
-      const startAutoResolution = async () => {
-        for (let i = 0; i < deviceList.length; i++) {
-          const device = deviceList[i];
-          
-          // Don't await - let them run concurrently
-          resolveDevice(device);
-          
-          // Small delay between starting each resolution
-          if (i < deviceList.length - 1) {
-            await new Promise(resolve => setTimeout(resolve, 100));
-          }
-        }
-        
-        // Wait a bit then signal completion
-        setTimeout(() => {
-          console.log('Automatic DNS resolution completed');
-          if (mainWindow) {
-            mainWindow.webContents.send('async-dns:complete');
-          }
-        }, deviceList.length * 200 + 2000); // Estimate completion time
-      };
-      
-      // Start the resolution process (non-blocking)
-      startAutoResolution();
+      console.log('Automatically starting name resolution for', deviceList.length, 'devices');
+      resolveDeviceNames(deviceList);
+      discoverLocalNames(deviceList);
     }
     
     return true;
@@ -346,7 +401,7 @@ ipcMain.handle('network:startStreamingScan', async (): Promise<boolean> => {
   }
 });
 
-// Async DNS resolution using Node.js async DNS (completely non-blocking)
+// Async name resolution through the native resolver pool (completely non-blocking)
 ipcMain.handle('network:startAsyncDnsResolution', async (event, deviceData: Array<{ip: string, mac: string}>): Promise<boolean> => {
   if (!deviceData || deviceData.length === 0) {
     return false;
@@ -355,70 +410,7 @@ ipcMain.handle('network:startAsyncDnsResolution', async (event, deviceData: Arra
   try {
     console.log('Starting async DNS resolution for', deviceData.length, 'devices');
     
-    // Use Node.js async DNS resolution
-    const reverseAsync = promisify(dns.reverse);
-    
-    // Process each device asynchronously without blocking
-    const resolveDevice = async (device: {ip: string, mac: string}) => {
-      try {
-        console.log('Resolving DNS for:', device.ip);
-        const hostnames = await reverseAsync(device.ip);
-        
-        if (hostnames && hostnames.length > 0) {
-          let name = hostnames[0];
-          // Remove domain suffix if present
-          const dotPos = name.indexOf('.');
-          if (dotPos !== -1) {
-            name = name.substring(0, dotPos);
-          }
-          
-          console.log('DNS resolved:', device.ip, '→', name);
-          
-          // Send result to renderer with MAC address for matching
-          if (mainWindow) {
-            mainWindow.webContents.send('device:updated', {
-              ip: device.ip,
-              mac: device.mac,
-              name: name
-            });
-          }
-          
-          return { ip: device.ip, mac: device.mac, name, success: true };
-        }
-      } catch (error) {
-        console.log('DNS resolution failed for', device.ip, ':', error instanceof Error ? error.message : String(error));
-      }
-      
-      return { ip: device.ip, mac: device.mac, name: device.ip, success: false };
-    };
-    
-    // Start all DNS resolutions concurrently but with delays
-    const resolveWithDelay = async () => {
-      for (let i = 0; i < deviceData.length; i++) {
-        const device = deviceData[i];
-        
-        // Don't await - let them run concurrently
-        resolveDevice(device);
-        
-        // Small delay between starting each resolution
-        if (i < deviceData.length - 1) {
-          await new Promise(resolve => setTimeout(resolve, 100));
-        }
-      }
-      
-      // Wait a bit then signal completion
-      setTimeout(() => {
-        console.log('Async DNS resolution completed');
-        if (mainWindow) {
-          mainWindow.webContents.send('async-dns:complete');
-        }
-      }, deviceData.length * 200 + 2000); // Estimate completion time
-    };
-    
-    // Start the resolution process (non-blocking)
-    resolveWithDelay();
-    
-    return true;
+    return resolveDeviceNames(deviceData);
   } catch (error) {
     console.error('Error starting async DNS resolution:', error);
     return false;
@@ -457,13 +449,14 @@ ipcMain.handle('network:getDeviceDetails', async (event, mac: string): Promise<D
 });
 
 ipcMain.handle('network:setBandwidthLimit', async (event, mac: string, downloadLimit: number, uploadLimit: number): Promise<boolean> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
-    return networkModule.setBandwidthLimit(mac, downloadLimit, uploadLimit);
+    return await engine.setBandwidthLimit(mac, downloadLimit, uploadLimit);
   } catch (error) {
     console.error('Error setting bandwidth limit:', error);
     return false;
@@ -471,13 +464,14 @@ ipcMain.handle('network:setBandwidthLimit', async (event, mac: string, downloadL
 });
 
 ipcMain.handle('network:setDeviceBlocked', async (event, mac: string, blocked: boolean): Promise<boolean> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
-    return networkModule.setDeviceBlocked(mac, blocked);
+    return await engine.setDeviceBlocked(mac, blocked);
   } catch (error) {
     console.error('Error setting device blocked:', error);
     return false;
@@ -485,13 +479,14 @@ ipcMain.handle('network:setDeviceBlocked', async (event, mac: string, blocked: b
 });
 
 ipcMain.handle('network:removeTrafficControl', async (event, mac: string): Promise<boolean> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
-    return networkModule.removeTrafficControl(mac);
+    return await engine.removeTrafficControl(mac);
   } catch (error) {
     console.error('Error removing traffic control:', error);
     return false;
@@ -499,13 +494,14 @@ ipcMain.handle('network:removeTrafficControl', async (event, mac: string): Promi
 });
 
 ipcMain.handle('network:getActiveControls', async (): Promise<TrafficControl[]> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return [];
   }
   
   try {
-    return networkModule.getActiveControls();
+    return await engine.getActiveControls();
   } catch (error) {
     console.error('Error getting active controls:', error);
     return [];
@@ -514,27 +510,29 @@ ipcMain.handle('network:getActiveControls', async (): Promise<TrafficControl[]>
 
 // ARP functionality IPC handlers
 ipcMain.handle('network:getNetworkAdapters', async () => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return [];
   }
   
   try {
-    return networkModule.enumerateNetworkAdapters();
+    return await engine.enumerateNetworkAdapters();
   } catch (error) {
     console.error('Error enumerating network adapters:', error);
     return [];
   }
 });
 
-ipcMain.handle('network:initializeArp', async (event, adapterName: string): Promise<boolean> => {
-  if (!networkModule) {
+ipcMain.handle('network:initializeArp', async (event, adapterName: string, profile?: CaptureProfile): Promise<boolean> => {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
-    return networkModule.initializeArp(adapterName);
+    return await engine.initializeArp(adapterName, profile);
   } catch (error) {
     console.error('Error initializing ARP:', error);
     return false;
@@ -542,13 +540,14 @@ ipcMain.handle('network:initializeArp', async (event, adapterName: string): Prom
 });
 
 ipcMain.handle('network:getNetworkTopology', async () => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return { isValid: false };
   }
   
   try {
-    return networkModule.getNetworkTopology();
+    return await engine.getNetworkTopology();
   } catch (error) {
     console.error('Error getting network topology:', error);
     return { isValid: false };
@@ -556,13 +555,14 @@ ipcMain.handle('network:getNetworkTopology', async () => {
 });
 
 ipcMain.handle('network:sendArpRequest', async (event, targetIp: string): Promise<boolean> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
-    return networkModule.sendArpRequest(targetIp);
+    return await engine.sendArpRequest(targetIp);
   } catch (error) {
     console.error('Error sending ARP request:', error);
     return false;
@@ -570,13 +570,14 @@ ipcMain.handle('network:sendArpRequest', async (event, targetIp: string): Promis
 });
 
 ipcMain.handle('network:getArpPerformanceStats', async () => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return { packetsSent: 0, packetsReceived: 0, sendErrors: 0, receiveErrors: 0, avgSendTimeMs: 0, avgReceiveTimeMs: 0 };
   }
   
   try {
-    return networkModule.getArpPerformanceStats();
+    return await engine.getArpPerformanceStats();
   } catch (error) {
     console.error('Error getting ARP performance stats:', error);
     return { packetsSent: 0, packetsReceived: 0, sendErrors: 0, receiveErrors: 0, avgSendTimeMs: 0, avgReceiveTimeMs: 0 };
@@ -584,13 +585,14 @@ ipcMain.handle('network:getArpPerformanceStats', async () => {
 });
 
 ipcMain.handle('network:cleanupArp', async (): Promise<void> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return;
   }
   
   try {
-    networkModule.cleanupArp();
+    await engine.cleanupArp();
   } catch (error) {
     console.error('Error cleaning up ARP:', error);
   }
@@ -598,14 +600,15 @@ ipcMain.handle('network:cleanupArp', async (): Promise<void> => {
 
 // ARP Poisoning IPC handlers
 ipcMain.handle('network:startArpPoisoning', async (event, targetIp: string, targetMac: string): Promise<boolean> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
     console.log(`Starting ARP poisoning for ${targetIp} (${targetMac})`);
-    return networkModule.startArpPoisoning(targetIp, targetMac);
+    return await engine.startArpPoisoning(targetIp, targetMac);
   } catch (error) {
     console.error('Error starting ARP poisoning:', error);
     return false;
@@ -613,24 +616,28 @@ ipcMain.handle('network:startArpPoisoning', async (event, targetIp: string, targ
 });
 
 ipcMain.handle('network:stopArpPoisoning', async (event, targetIp: string): Promise<boolean> => {
-  if (!networkModule) {
+  const engine = getEngine();
+  if (!engine) {
     console.error('Network module not loaded');
     return false;
   }
   
   try {
     console.log(`Stopping ARP poisoning for ${targetIp}`);
-    return networkModule.stopArpPoisoning(targetIp);
+    return await engine.stopArpPoisoning(targetIp);
   } catch (error) {
     console.error('Error stopping ARP poisoning:', error);
     return false;
   }
 });
 
-// Cleanup ARP on app exit
+// Cleanup ARP on app exit. With a daemon connected the engine keeps running
+// and only the connection is closed.
 app.on('before-quit', () => {
   try {
-    if (networkModule) {
+    if (daemonClient) {
+      daemonClient.close();
+    } else if (networkModule) {
       networkModule.cleanupArp();
     }
   } catch (error) {
@@ -1,6 +1,7 @@
 // Preload script - exposes safe IPC methods to renderer process
 import { contextBridge, ipcRenderer } from 'electron';
-import { DeviceInfo, TrafficControl, NetworkAdapter, NetworkTopology, ArpPerformanceStats } from '../common/types';
+import { DeviceInfo, TrafficControl, NetworkAdapter, NetworkTopology, ArpPerformanceStats, CaptureProfile } from '../common/types';
+import { NetworkService } from '../common/networkService';
 
 // Debug logging to help diagnose issues
 console.log('Preload script loading...');
@@ -9,6 +10,8 @@ console.log('Preload script loading...');
 const electronAPI = {
   // Network operations
   scanDevices: (): Promise<DeviceInfo[]> => ipcRenderer.invoke('network:scanDevices'),
+  scanDevicesPacked: (): Promise<ArrayBuffer | null> => ipcRenderer.invoke('network:scanDevicesPacked'),
+  getKnownDevices: (): Promise<DeviceInfo[]> => NetworkService.getKnownDevices(),
   startStreamingScan: (): Promise<boolean> => ipcRenderer.invoke('network:startStreamingScan'),
   resolveDeviceName: (ip: string): Promise<string> => ipcRenderer.invoke('network:resolveDeviceName', ip),
   startAsyncDnsResolution: (devices: Array<{ip: string, mac: string}>): Promise<boolean> => ipcRenderer.invoke('network:startAsyncDnsResolution', devices),
@@ -37,7 +40,8 @@ const electronAPI = {
   
   // ARP functionality
   getNetworkAdapters: (): Promise<NetworkAdapter[]> => ipcRenderer.invoke('network:getNetworkAdapters'),
-  initializeArp: (adapterName: string): Promise<boolean> => ipcRenderer.invoke('network:initializeArp', adapterName),
+  initializeArp: (adapterName: string, profile?: CaptureProfile): Promise<boolean> =>
+    ipcRenderer.invoke('network:initializeArp', adapterName, profile),
   getNetworkTopology: (): Promise<NetworkTopology> => ipcRenderer.invoke('network:getNetworkTopology'),
   sendArpRequest: (targetIp: string): Promise<boolean> => ipcRenderer.invoke('network:sendArpRequest', targetIp),
   getArpPerformanceStats: (): Promise<ArpPerformanceStats> => ipcRenderer.invoke('network:getArpPerformanceStats'),
@@ -61,6 +65,8 @@ declare global {
   interface Window {
     electronAPI: {
       scanDevices: () => Promise<DeviceInfo[]>;
+      scanDevicesPacked: () => Promise<ArrayBuffer | null>;
+      getKnownDevices: () => Promise<DeviceInfo[]>;
       startStreamingScan: () => Promise<boolean>;
       resolveDeviceName: (ip: string) => Promise<string>;
       startAsyncDnsResolution: (devices: Array<{ip: string, mac: string}>) => Promise<boolean>;
@@ -76,7 +82,7 @@ declare global {
       
       // ARP functionality
       getNetworkAdapters: () => Promise<NetworkAdapter[]>;
-      initializeArp: (adapterName: string) => Promise<boolean>;
+      initializeArp: (adapterName: string, profile?: CaptureProfile) => Promise<boolean>;
       getNetworkTopology: () => Promise<NetworkTopology>;
       sendArpRequest: (targetIp: string) => Promise<boolean>;
       getArpPerformanceStats: () => Promise<ArpPerformanceStats>;
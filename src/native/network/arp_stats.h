@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "latency_histogram.h"
+#include "thread_shards.h"
+
+// ARP send/receive statistics
+//
+// The poisoning worker and the JS thread both send frames, so every writer
+// thread records into its own block (see ThreadShards) and snapshot() merges
+// the blocks. Counters are updated with owner-only relaxed load/store pairs
+// and never share a cache line with another writer.
+//
+// reset() does not touch other threads' blocks. It advances a global epoch;
+// a block stamped with an older epoch is ignored by snapshot() and cleared
+// by its owner on that thread's next update. Every snapshot therefore
+// reflects exactly the samples recorded since the last reset.
+class ArpStats {
+public:
+    struct Snapshot {
+        uint64_t packets_sent;
+        uint64_t packets_received;
+        uint64_t send_errors;
+        uint64_t receive_errors;
+        LatencySummary send_latency;
+        LatencySummary receive_latency;
+    };
+
+    ArpStats() = default;
+    ArpStats(const ArpStats&) = delete;
+    ArpStats& operator=(const ArpStats&) = delete;
+
+    void recordSend(uint64_t time_ns, bool success);
+    // success = false: the wait for a reply timed out or failed, which only
+    // counts as a receive error
+    void recordReceive(uint64_t time_ns, bool success);
+
+    Snapshot snapshot() const;
+    void reset();
+
+private:
+    struct alignas(64) Block {
+        std::atomic<uint64_t> epoch;
+        std::atomic<uint64_t> packets_sent;
+        std::atomic<uint64_t> packets_received;
+        std::atomic<uint64_t> send_errors;
+        std::atomic<uint64_t> receive_errors;
+        LatencyHistogram send_latency;
+        LatencyHistogram receive_latency;
+    };
+
+    ThreadShards<Block> blocks_;
+    std::atomic<uint64_t> epoch_{1};
+
+    Block& localBlock();
+};
+
+// Shared statistics for all ArpManager instances (outlives writer threads)
+ArpStats& GetArpStats();
@@ -0,0 +1,1815 @@
+// Native core microbenchmarks
+//
+// Usage: netshaper_bench [--quick] [--filter <substring>] [--out <file.json>]
+//
+// Each benchmark is timed in batches until a minimum duration is reached,
+// repeated for several samples, and reported as median and best ns/op. The
+// JSON report is printed to stdout (or written to --out) so runs from two
+// commits can be compared with tools/compare_bench.py.
+#include "arp.h"
+#include "arp_frame.h"
+#include "capture_filter.h"
+#include "capture_profile.h"
+#include "data_plane.h"
+#include "device_inventory.h"
+#include "device_table.h"
+#include "flow_table.h"
+#include "frame_classifier.h"
+#include "lpm_table.h"
+#include "name_discovery.h"
+#include "name_resolver.h"
+#include "packet_io.h"
+#include "priority_mark.h"
+#include "rule_classifier.h"
+#include "tcp_window.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+template <typename T>
+static inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;     // ops per sample
+    double ns_per_op;        // median over samples
+    double min_ns_per_op;
+    uint64_t items_per_op;   // e.g. targets per poisoning cycle
+};
+
+struct BenchOptions {
+    bool quick = false;
+    std::string filter;
+    std::string out_path;
+};
+
+static double TimeBatch(const std::function<void(uint64_t)>& body, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// body(n) runs the operation n times
+static BenchResult Run(const BenchOptions& options, const std::string& name, uint64_t items_per_op,
+                       const std::function<void(uint64_t)>& body) {
+    const double min_sample_ns = options.quick ? 2e6 : 100e6;
+    const int samples = options.quick ? 3 : 7;
+
+    // Calibrate the batch size to the minimum sample duration
+    uint64_t iterations = 1;
+    for (;;) {
+        double elapsed = TimeBatch(body, iterations);
+        if (elapsed >= min_sample_ns || iterations >= (1ull << 34)) break;
+        double scale = elapsed > 0 ? (min_sample_ns / elapsed) * 1.2 : 10.0;
+        iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 1.5), 10.0)) + 1;
+    }
+
+    std::vector<double> per_op;
+    for (int i = 0; i < samples; ++i) {
+        per_op.push_back(TimeBatch(body, iterations) / static_cast<double>(iterations));
+    }
+    std::sort(per_op.begin(), per_op.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = per_op[per_op.size() / 2];
+    result.min_ns_per_op = per_op.front();
+    result.items_per_op = items_per_op;
+    fprintf(stderr, "%-32s %12.1f ns/op  (min %.1f, %llu ops/sample)\n", name.c_str(),
+            result.ns_per_op, result.min_ns_per_op, static_cast<unsigned long long>(iterations));
+    return result;
+}
+
+static std::string MakeIp(uint32_t index) {
+    // 10.x.y.z, avoiding .0 and .255 in the last octet
+    uint32_t host = index % 254 + 1;
+    uint32_t rest = index / 254;
+    return "10." + std::to_string((rest >> 8) & 0xFF) + "." + std::to_string(rest & 0xFF) + "." +
+           std::to_string(host);
+}
+
+static std::string MakeMac(uint32_t index) {
+    uint8_t mac[6] = { 0x02, 0x00,
+                       static_cast<uint8_t>(index >> 24), static_cast<uint8_t>(index >> 16),
+                       static_cast<uint8_t>(index >> 8), static_cast<uint8_t>(index) };
+    return ArpManager::macToString(mac);
+}
+
+static std::vector<DeviceInfo> MakeDevices(uint32_t count) {
+    static const char* kVendors[] = { "Apple, Inc.", "Samsung Electronics Co.,Ltd", "Intel Corporate",
+                                      "TP-LINK TECHNOLOGIES CO.,LTD.", "Unknown" };
+    std::vector<DeviceInfo> devices(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        DeviceInfo& device = devices[i];
+        device.ip = MakeIp(i);
+        device.mac = MakeMac(i);
+        device.name = (i % 3 == 0) ? device.ip : "device-" + std::to_string(i) + ".local";
+        device.vendor = kVendors[i % 5];
+        device.isOnline = (i % 7) != 0;
+        device.lastSeen = 1700000000000ull + i;
+    }
+    return devices;
+}
+
+// Known-good frames; a mismatch fails the run (and the ctest smoke test)
+static bool VerifyFrames() {
+    uint8_t our_mac[6], gateway_mac[6], victim_mac[6], our_ip[4], gateway_ip[4], victim_ip[4];
+    ArpManager::stringToMac("02:11:22:33:44:55", our_mac);
+    ArpManager::stringToMac("02:aa:bb:cc:dd:ee", gateway_mac);
+    ArpManager::stringToMac("02:66:77:88:99:00", victim_mac);
+    ArpManager::stringToIp("192.168.1.10", our_ip);
+    ArpManager::stringToIp("192.168.1.1", gateway_ip);
+    ArpManager::stringToIp("192.168.1.20", victim_ip);
+
+    static const uint8_t kRequest[42] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 0x08, 0x06,
+        0x00, 0x01, 0x08, 0x00, 0x06, 0x04, 0x00, 0x01,
+        0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 192, 168, 1, 10,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 192, 168, 1, 1 };
+    static const uint8_t kSpoofToVictim[42] = {
+        0x02, 0x66, 0x77, 0x88, 0x99, 0x00, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 0x08, 0x06,
+        0x00, 0x01, 0x08, 0x00, 0x06, 0x04, 0x00, 0x02,
+        0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 192, 168, 1, 1,
+        0x02, 0x66, 0x77, 0x88, 0x99, 0x00, 192, 168, 1, 20 };
+    static const uint8_t kSpoofToGateway[42] = {
+        0x02, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 0x08, 0x06,
+        0x00, 0x01, 0x08, 0x00, 0x06, 0x04, 0x00, 0x02,
+        0x02, 0x11, 0x22, 0x33, 0x44, 0x55, 192, 168, 1, 20,
+        0x02, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 192, 168, 1, 1 };
+
+    ArpFrame frame;
+    BuildArpRequest(frame, our_mac, our_ip, gateway_ip);
+    if (memcmp(&frame, kRequest, sizeof(kRequest)) != 0) {
+        fprintf(stderr, "VerifyFrames: ARP request mismatch\n");
+        return false;
+    }
+
+    NullPacketIO io(true);
+    SpoofEndpoints local;
+    memcpy(local.our_mac, our_mac, 6);
+    memcpy(local.gateway_ip, gateway_ip, 4);
+    memcpy(local.gateway_mac, gateway_mac, 6);
+    if (!SendSpoofPair(io, frame, local, victim_ip, victim_mac)) return false;
+
+    auto frames = io.takeFrames();
+    if (frames.size() != 2 || frames[0].size() != 42 || frames[1].size() != 42 ||
+        memcmp(frames[0].data(), kSpoofToVictim, 42) != 0 ||
+        memcmp(frames[1].data(), kSpoofToGateway, 42) != 0) {
+        fprintf(stderr, "VerifyFrames: spoofed reply mismatch\n");
+        return false;
+    }
+
+    uint8_t mac[6];
+    if (ArpManager::macToString(our_mac) != "02:11:22:33:44:55" ||
+        ArpManager::ipToString(victim_ip) != "192.168.1.20" ||
+        ArpManager::stringToMac("02:11:22:33:44", mac) || ArpManager::stringToIp("192.168.1.256", mac)) {
+        fprintf(stderr, "VerifyFrames: string conversion mismatch\n");
+        return false;
+    }
+    return true;
+}
+
+// Synthetic flow n: distinct 5-tuples spread over many hosts and ports
+static FlowKey MakeFlow(uint32_t n) {
+    uint32_t host = 0x0A000000u | ((n * 2654435761u) & 0x00FFFFFFu);
+    return MakeFlowKey(host, 0xC0A80001u + (n & 0xFF), static_cast<uint16_t>(1024 + (n >> 8)),
+                       static_cast<uint16_t>(443 + (n & 3)), (n & 1) ? 6 : 17);
+}
+
+// Flow table invariants: fill to capacity, find everything, age out
+// everything through the timer wheel, and handshake RTT
+static bool VerifyFlowTable() {
+    const uint32_t kCapacity = 50000;
+    const uint64_t kSecond = 1000000000ULL;
+    FlowTable table(kCapacity, 10 * kSecond);
+
+    for (uint32_t i = 0; i < kCapacity; ++i) {
+        if (!table.track(MakeFlow(i), kSecond + i)) {
+            fprintf(stderr, "VerifyFlowTable: insert %u failed at %zu flows\n", i, table.size());
+            return false;
+        }
+    }
+    if (table.track(MakeFlow(kCapacity), kSecond) || table.size() != kCapacity) {
+        fprintf(stderr, "VerifyFlowTable: insert beyond capacity accepted\n");
+        return false;
+    }
+    for (uint32_t i = 0; i < kCapacity; ++i) {
+        const FlowEntry* entry = table.find(MakeFlow(i));
+        if (!entry || !(entry->key == MakeFlow(i))) {
+            fprintf(stderr, "VerifyFlowTable: flow %u lost\n", i);
+            return false;
+        }
+    }
+
+    // Half the flows stay active, the rest go idle and must expire
+    for (uint64_t t = 2; t <= 30; ++t) {
+        for (uint32_t i = 0; i < kCapacity; i += 2) table.track(MakeFlow(i), t * kSecond);
+        table.expire(t * kSecond);
+    }
+    if (table.size() != kCapacity / 2 || table.stats().expired != kCapacity / 2 || table.find(MakeFlow(1))) {
+        fprintf(stderr, "VerifyFlowTable: %zu flows left after aging, expected %u\n", table.size(), kCapacity / 2);
+        return false;
+    }
+    table.expire(60 * kSecond);
+    if (table.size() != 0) {
+        fprintf(stderr, "VerifyFlowTable: %zu flows left after idle timeout\n", table.size());
+        return false;
+    }
+
+    // Client SYN, server SYN/ACK 3 ms later, client ACK 1 ms after that
+    FlowKey key = MakeFlowKey(0x0A000002u, 0x08080808u, 50000, 443, 6);
+    FlowEntry* entry = table.track(key, 100 * kSecond);
+    FlowTable::count(*entry, kTrafficUp, 60, kTcpSyn, true, 100 * kSecond);
+    FlowTable::count(*entry, kTrafficDown, 60, kTcpSyn | kTcpAck, true, 100 * kSecond + 3000000);
+    FlowTable::count(*entry, kTrafficUp, 54, kTcpAck, true, 100 * kSecond + 4000000);
+    if (entry->rtt_ns != 4000000 || entry->packets[kTrafficUp] != 2 || entry->bytes[kTrafficDown] != 60) {
+        fprintf(stderr, "VerifyFlowTable: handshake RTT %llu ns, expected 4000000\n",
+                static_cast<unsigned long long>(entry->rtt_ns));
+        return false;
+    }
+    return true;
+}
+
+// Dead hosts must not hold up live ones, even on a first scan when nothing
+// is cached: with two workers and a fake lookup that blocks for 10.0.9.x,
+// four dead hosts queued first go slow (three replaced, the limit; the
+// fourth keeps its worker) and the two live hosts behind them still resolve
+static bool VerifyNameResolver() {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    size_t answered = 0;
+    size_t live_answered = 0;
+
+    NameResolver::Config config;
+    config.worker_count = 2;
+    config.slow_lookup = std::chrono::milliseconds(20);
+    config.max_slow_lookups = 3;
+    config.lookup = [&](const std::string& ip) -> std::string {
+        if (ip.compare(0, 7, "10.0.9.") != 0) return "host-" + ip.substr(7);
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return release; });
+        return "";
+    };
+    NameResolver resolver(config);
+
+    auto callback = [&](const std::string& ip, const std::string& name, bool found) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++answered;
+        if (found && name == "host-" + ip.substr(7)) ++live_answered;
+        cv.notify_all();
+    };
+    for (const char* ip : { "10.0.9.1", "10.0.9.2", "10.0.9.3", "10.0.9.4", "10.0.0.1", "10.0.0.2" }) {
+        resolver.resolveAsync(ip, callback);
+    }
+
+    bool live_done;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        live_done = cv.wait_for(lock, std::chrono::seconds(5), [&] { return live_answered == 2; });
+    }
+    NameResolver::Stats blocked = resolver.getStats();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        cv.notify_all();
+    }
+    bool all_done;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done = cv.wait_for(lock, std::chrono::seconds(5), [&] { return answered == 6; });
+    }
+    // Workers update the counters before running callbacks
+    NameResolver::Stats after = resolver.getStats();
+    resolver.shutdown();
+
+    if (!live_done || !all_done || blocked.slow_lookups != 3 || after.slow_lookups != 0 || after.lookups != 6) {
+        fprintf(stderr, "VerifyNameResolver: live hosts %s, all %s, %zu slow while blocked (expected 3), "
+                "%zu slow and %llu lookups after\n", live_done ? "resolved" : "held up", all_done ? "done" : "stuck",
+                blocked.slow_lookups, after.slow_lookups, static_cast<unsigned long long>(after.lookups));
+        return false;
+    }
+    return true;
+}
+
+// NBNS and LLMNR messages byte for byte: the wildcard NBSTAT query, the
+// NBSTAT answer (group names skipped, truncation rejected), the LLMNR
+// reverse query, and its PTR answer through parseDnsResponse
+static bool VerifyNameDiscovery() {
+    std::vector<uint8_t> nbstat = NameDiscovery::buildNbstatQuery(0x1234);
+    std::vector<uint8_t> expected_nbstat = { 0x12, 0x34, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0x20, 'C', 'K' };
+    expected_nbstat.insert(expected_nbstat.end(), 30, 'A');
+    expected_nbstat.insert(expected_nbstat.end(), { 0, 0, 0x21, 0, 1 });
+    if (nbstat != expected_nbstat) {
+        fprintf(stderr, "VerifyNameDiscovery: NBSTAT query of %zu bytes differs\n", nbstat.size());
+        return false;
+    }
+
+    // Response: the query's name, then two <00> names, the first a group
+    std::vector<uint8_t> response = { 0x12, 0x34, 0x84, 0x00, 0, 0, 0, 1, 0, 0, 0, 0 };
+    response.insert(response.end(), nbstat.begin() + 12, nbstat.begin() + 46);
+    response.insert(response.end(), { 0, 0x21, 0, 1, 0, 0, 0, 0, 0, 37, 2 });
+    for (const char* name : { "WORKGROUP      ", "DESKTOP-42     " }) {
+        response.insert(response.end(), name, name + 15);
+        response.push_back(0x00);
+        response.push_back(name[0] == 'W' ? 0x84 : 0x04);
+        response.push_back(0x00);
+    }
+    DiscoveredName nbns;
+    DiscoveredName truncated;
+    if (!NameDiscovery::parseNbstatResponse(response.data(), response.size(), "192.168.1.9", nbns) ||
+        nbns.ip != "192.168.1.9" || nbns.name != "DESKTOP-42" || nbns.source != "nbns" ||
+        NameDiscovery::parseNbstatResponse(response.data(), response.size() - 1, "192.168.1.9", truncated)) {
+        fprintf(stderr, "VerifyNameDiscovery: NBSTAT response parsed as \"%s\" from %s\n", nbns.name.c_str(),
+                nbns.ip.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> llmnr = NameDiscovery::buildLlmnrPtrQuery("192.168.1.7", 0xBEEF);
+    std::vector<uint8_t> expected_llmnr = { 0xBE, 0xEF, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0,
+                                            1, '7', 1, '1', 3, '1', '6', '8', 3, '1', '9', '2',
+                                            7, 'i', 'n', '-', 'a', 'd', 'd', 'r', 4, 'a', 'r', 'p', 'a', 0,
+                                            0, 12, 0, 1 };
+    if (llmnr != expected_llmnr || !NameDiscovery::buildLlmnrPtrQuery("192.168.1", 1).empty()) {
+        fprintf(stderr, "VerifyNameDiscovery: LLMNR query of %zu bytes differs\n", llmnr.size());
+        return false;
+    }
+
+    // Answer: the question echoed, then a PTR to printer.local pointing back
+    // at the question's name
+    std::vector<uint8_t> answer(llmnr);
+    answer[2] = 0x80;
+    answer[7] = 1;
+    answer.insert(answer.end(), { 0xC0, 12, 0, 12, 0, 1, 0, 0, 0, 30, 0, 15,
+                                  7, 'p', 'r', 'i', 'n', 't', 'e', 'r', 5, 'l', 'o', 'c', 'a', 'l', 0 });
+    std::vector<DiscoveredName> names;
+    NameDiscovery::parseDnsResponse(answer.data(), answer.size(), "llmnr", names);
+    NameDiscovery::parseDnsResponse(llmnr.data(), llmnr.size(), "llmnr", names);   // a query, ignored
+    if (names.size() != 1 || names[0].ip != "192.168.1.7" || names[0].name != "printer" ||
+        names[0].source != "llmnr") {
+        fprintf(stderr, "VerifyNameDiscovery: LLMNR answer gave %zu names\n", names.size());
+        return false;
+    }
+    return true;
+}
+
+// Deterministic xorshift so rule sets are the same on every run
+static uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void RandomPortRange(uint32_t& state, uint16_t& lo, uint16_t& hi) {
+    switch (NextRandom(state) % 4) {
+        case 0: lo = 0; hi = 0xFFFF; break;
+        case 1: lo = hi = static_cast<uint16_t>(NextRandom(state) % 2048); break;
+        default:
+            lo = static_cast<uint16_t>(NextRandom(state) % 60000);
+            hi = static_cast<uint16_t>(lo + NextRandom(state) % 200);
+            break;
+    }
+}
+
+// count rules over 16 devices; the rule id is its position in the list
+static std::vector<ShapingRule> MakeRules(uint32_t count, uint32_t seed) {
+    std::vector<ShapingRule> rules(count);
+    uint32_t state = seed;
+    for (uint32_t i = 0; i < count; ++i) {
+        ShapingRule& rule = rules[i];
+        InitShapingRule(rule);
+        rule.id = i;
+        rule.priority = static_cast<int32_t>(NextRandom(state) % 8);
+        rule.match_mac = NextRandom(state) % 4 != 0;
+        memcpy(rule.mac, "\x02\x10\x00\x00\x00", 5);
+        rule.mac[5] = static_cast<uint8_t>(NextRandom(state) % 16);
+        static const uint8_t kProtocols[] = { 0, 6, 17, 17 };
+        rule.protocol = kProtocols[NextRandom(state) % 4];
+        RandomPortRange(state, rule.local_port_min, rule.local_port_max);
+        RandomPortRange(state, rule.remote_port_min, rule.remote_port_max);
+        rule.action = static_cast<RuleAction>(NextRandom(state) % 2);
+    }
+    return rules;
+}
+
+static RuleMatchFields MakeRulePacket(uint32_t& state) {
+    uint8_t mac[6] = { 0x02, 0x10, 0x00, 0x00, 0x00, static_cast<uint8_t>(NextRandom(state) % 16) };
+    RuleMatchFields fields;
+    fields.mac = MacKey(mac);
+    fields.protocol = NextRandom(state) % 2 ? 6 : 17;
+    fields.local_port = static_cast<uint16_t>(NextRandom(state) % 2 ? NextRandom(state) % 2048 : NextRandom(state));
+    fields.remote_port = static_cast<uint16_t>(NextRandom(state) % 2 ? NextRandom(state) % 2048 : NextRandom(state));
+    return fields;
+}
+
+// Tuple-space classification must agree with a linear scan
+static bool VerifyRules() {
+    for (uint32_t count : { 1u, 50u, 2000u }) {
+        std::vector<ShapingRule> rules = MakeRules(count, 0x1234567u + count);
+        RuleClassifier classifier;
+        if (!classifier.compile(rules)) {
+            fprintf(stderr, "VerifyRules: %s\n", classifier.lastError().c_str());
+            return false;
+        }
+        uint32_t state = 0xBADC0DEu;
+        for (int i = 0; i < 20000; ++i) {
+            RuleMatchFields fields = MakeRulePacket(state);
+            uint32_t expected = RuleClassifier::kNoRule;
+            for (const ShapingRule& rule : rules) {
+                bool match = (!rule.match_mac || MacKey(rule.mac) == fields.mac) &&
+                             (!rule.protocol || rule.protocol == fields.protocol) &&
+                             fields.local_port >= rule.local_port_min && fields.local_port <= rule.local_port_max &&
+                             fields.remote_port >= rule.remote_port_min && fields.remote_port <= rule.remote_port_max;
+                if (match && (expected == RuleClassifier::kNoRule || rule.priority > rules[expected].priority)) {
+                    expected = rule.id;
+                }
+            }
+            uint32_t index = classifier.classify(fields);
+            uint32_t actual = index == RuleClassifier::kNoRule ? index : classifier.rules()[index].id;
+            if (actual != expected) {
+                fprintf(stderr, "VerifyRules: %u rules, packet %d matched rule %u, expected %u\n", count, i,
+                        actual, expected);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// count prefixes with a BGP-like length mix: mostly /24, some /16-/23,
+// a few /8-/15 and a tail of /25-/32
+static std::vector<Ipv4Prefix> MakePrefixes(uint32_t count, uint32_t seed) {
+    std::vector<Ipv4Prefix> prefixes(count);
+    uint32_t state = seed;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t pick = NextRandom(state) % 100;
+        uint8_t length = pick < 55 ? 24 : pick < 90 ? static_cast<uint8_t>(16 + NextRandom(state) % 8)
+                       : pick < 95 ? static_cast<uint8_t>(8 + NextRandom(state) % 8)
+                                   : static_cast<uint8_t>(25 + NextRandom(state) % 8);
+        uint32_t mask = 0xFFFFFFFFu << (32 - length);
+        prefixes[i] = { NextRandom(state) & mask, length, static_cast<uint16_t>(1 + i % LpmTable::kMaxValue) };
+    }
+    return prefixes;
+}
+
+// Reference: the longest matching prefix, last one on ties
+static uint16_t LinearLpm(const std::vector<Ipv4Prefix>& prefixes, uint32_t address) {
+    uint16_t value = LpmTable::kNoMatch;
+    int best = -1;
+    for (const Ipv4Prefix& prefix : prefixes) {
+        uint32_t mask = prefix.length ? 0xFFFFFFFFu << (32 - prefix.length) : 0;
+        if ((address & mask) == prefix.address && prefix.length >= best) {
+            best = prefix.length;
+            value = prefix.value;
+        }
+    }
+    return value;
+}
+
+// Addresses inside random prefixes, so most lookups match something
+static std::vector<uint32_t> MakeLookupAddresses(const std::vector<Ipv4Prefix>& prefixes, uint32_t count) {
+    std::vector<uint32_t> addresses(count);
+    uint32_t state = 0x5EEDu;
+    for (uint32_t& address : addresses) {
+        const Ipv4Prefix& prefix = prefixes[NextRandom(state) % prefixes.size()];
+        uint32_t host = prefix.length == 32 ? 0 : NextRandom(state) & (0xFFFFFFFFu >> prefix.length);
+        address = NextRandom(state) % 8 ? prefix.address | host : NextRandom(state);
+    }
+    return addresses;
+}
+
+// DIR-24-8 must agree with a linear scan, including /0 and /32
+static bool VerifyLpm() {
+    std::vector<Ipv4Prefix> prefixes = MakePrefixes(3000, 0xABCDEFu);
+    prefixes.push_back({ 0, 0, 7 });
+    prefixes.push_back({ prefixes[10].address | 0x1F, 32, 9 });
+    LpmTable table;
+    if (!table.build(prefixes)) {
+        fprintf(stderr, "VerifyLpm: %s\n", table.lastError().c_str());
+        return false;
+    }
+    for (uint32_t address : MakeLookupAddresses(prefixes, 50000)) {
+        uint16_t expected = LinearLpm(prefixes, address);
+        if (table.lookup(address) != expected) {
+            fprintf(stderr, "VerifyLpm: %08x -> %u, expected %u\n", address, table.lookup(address), expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Capture filter: ARP always, IPv4 and 802.1Q only from listed MACs,
+// truncated frames rejected; on Linux the kernel must accept the program
+static bool VerifyCaptureFilter() {
+    for (uint32_t count : { 0u, 1u, 40u, static_cast<uint32_t>(kMaxFilterMacs), 1000u }) {
+        std::vector<uint64_t> macs;
+        for (uint32_t i = 0; i < count; ++i) macs.push_back(0x021000000000ULL + i * 0x10001ULL);
+        std::vector<BpfInstruction> program = BuildCaptureFilter(macs, 1500);
+
+        uint8_t frame[64] = {};
+        for (uint32_t i = 0; i < count + 2; ++i) {
+            uint64_t mac = 0x021000000000ULL + i * 0x10001ULL;
+            for (int b = 0; b < 6; ++b) frame[6 + b] = static_cast<uint8_t>(mac >> (40 - 8 * b));
+            bool listed = i < count || count > kMaxFilterMacs;
+            static const uint16_t kTypes[] = { 0x0800, 0x8100, 0x0806, 0x86DD };
+            for (uint16_t type : kTypes) {
+                frame[12] = static_cast<uint8_t>(type >> 8);
+                frame[13] = static_cast<uint8_t>(type);
+                bool expected = type == 0x0806 || (type != 0x86DD && listed);
+                if ((RunCaptureFilter(program, frame, sizeof(frame)) != 0) != expected) {
+                    fprintf(stderr, "VerifyCaptureFilter: %u MACs, MAC %u type %04x %s\n", count, i, type,
+                            expected ? "rejected" : "accepted");
+                    return false;
+                }
+            }
+            if (RunCaptureFilter(program, frame, 10) != 0) {
+                fprintf(stderr, "VerifyCaptureFilter: truncated frame accepted\n");
+                return false;
+            }
+        }
+
+#ifdef __linux__
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sock_fprog fprog;
+        fprog.len = static_cast<unsigned short>(program.size());
+        fprog.filter = reinterpret_cast<struct sock_filter*>(program.data());
+        bool attached = fd >= 0 && setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) == 0;
+        if (fd >= 0) close(fd);
+        if (!attached) {
+            fprintf(stderr, "VerifyCaptureFilter: kernel rejected the %zu-instruction program\n", program.size());
+            return false;
+        }
+#endif
+    }
+    return true;
+}
+
+static bool VerifyCaptureProfile() {
+    for (CapturePreset preset : { kCaptureLowLatency, kCaptureThroughput, kCaptureArpOnly }) {
+        CapturePreset parsed;
+        CaptureProfile profile = GetCaptureProfile(preset);
+        if (!ParseCapturePreset(CapturePresetName(preset), parsed) || parsed != preset || profile.preset != preset) {
+            fprintf(stderr, "VerifyCaptureProfile: %s does not round-trip\n", CapturePresetName(preset));
+            return false;
+        }
+        // Buffer grows with the link rate, within the preset's floor and the ceiling
+        size_t slow = CaptureBufferBytes(profile, 10000000ULL);
+        size_t fast = CaptureBufferBytes(profile, 100000000000ULL);
+        if (slow == 0 || fast < slow || fast > (256u << 20)) {
+            fprintf(stderr, "VerifyCaptureProfile: %s buffer %zu..%zu bytes\n", CapturePresetName(preset), slow, fast);
+            return false;
+        }
+    }
+
+    // The arp-only snaplen keeps a whole (802.1Q tagged) ARP frame
+    CaptureProfile arp_only = GetCaptureProfile(kCaptureArpOnly);
+    std::vector<BpfInstruction> program = BuildCaptureFilter(std::vector<uint64_t>(), arp_only.snaplen);
+    uint8_t frame[128] = {};
+    frame[12] = 0x08;
+    frame[13] = 0x06;
+    if (RunCaptureFilter(program, frame, 60) != 60 || RunCaptureFilter(program, frame, sizeof(frame)) != arp_only.snaplen) {
+        fprintf(stderr, "VerifyCaptureProfile: arp-only filter truncates ARP\n");
+        return false;
+    }
+    frame[13] = 0x00;
+    if (RunCaptureFilter(program, frame, sizeof(frame)) != 0) {
+        fprintf(stderr, "VerifyCaptureProfile: arp-only filter accepts IPv4\n");
+        return false;
+    }
+    return true;
+}
+
+// Frames for the burst classifier: up and downstream IPv4 of managed and
+// unmanaged MACs, our own and ARP frames, 802.1Q tags (one truncated) and
+// runts. Frame i is 128 bytes at frames[i * 128]; lengths[i] is its length.
+static const uint64_t kClassifyOurKey = 0x020000000001ULL;
+static const uint64_t kClassifyGatewayKey = 0x0200000000FEULL;
+
+static void WriteMac(uint8_t* out, uint64_t key) {
+    for (int b = 0; b < 6; ++b) out[b] = static_cast<uint8_t>(key >> (40 - 8 * b));
+}
+
+static uint64_t ClassifyDeviceKey(uint32_t index) {
+    return 0x021000000000ULL + index * 0x10001ULL;
+}
+
+static void MakeClassifyFrames(uint32_t count, uint32_t devices, uint32_t seed, std::vector<uint8_t>& frames,
+                               std::vector<size_t>& lengths) {
+    frames.assign(static_cast<size_t>(count) * 128, 0);
+    lengths.assign(count, 128);
+    uint32_t state = seed;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t* frame = &frames[static_cast<size_t>(i) * 128];
+        uint32_t pick = NextRandom(state);
+        // Three in four from managed devices; an index past devices is unmanaged
+        uint64_t device = ClassifyDeviceKey(pick % 4 ? NextRandom(state) % devices : devices + NextRandom(state) % 64);
+        uint16_t type = 0x0800;
+        switch (pick % 16) {
+            case 0: WriteMac(frame, kClassifyOurKey); WriteMac(frame + 6, kClassifyGatewayKey); break;
+            case 1: WriteMac(frame, kClassifyGatewayKey); WriteMac(frame + 6, kClassifyOurKey); break;
+            case 2: type = 0x0806; WriteMac(frame, ~0ULL); WriteMac(frame + 6, device); break;
+            case 3: type = 0x86DD; WriteMac(frame, kClassifyGatewayKey); WriteMac(frame + 6, device); break;
+            case 4: lengths[i] = 10; WriteMac(frame, device); break;
+            case 5: lengths[i] = 16; type = 0x8100; WriteMac(frame, kClassifyGatewayKey); WriteMac(frame + 6, device); break;
+            case 6:
+                type = 0x8100;
+                frame[16] = 0x08;
+                WriteMac(frame, kClassifyGatewayKey);
+                WriteMac(frame + 6, device);
+                break;
+            default:
+                if (pick & 0x100) {
+                    WriteMac(frame, device);
+                    WriteMac(frame + 6, kClassifyGatewayKey);
+                } else {
+                    WriteMac(frame, kClassifyGatewayKey);
+                    WriteMac(frame + 6, device);
+                }
+                break;
+        }
+        frame[12] = static_cast<uint8_t>(type >> 8);
+        frame[13] = static_cast<uint8_t>(type);
+        frame[14] = 0x45;
+    }
+}
+
+// What every kernel must produce, computed the obvious way
+static FrameClass ReferenceClass(const uint8_t* frame, size_t length,
+                                 const std::unordered_map<uint64_t, uint32_t>& managed) {
+    FrameClass expected = {};
+    if (length < 14) {
+        expected.flags = kFrameShort;
+        return expected;
+    }
+    expected.ethertype = static_cast<uint16_t>((frame[12] << 8) | frame[13]);
+    if (expected.ethertype == 0x8100 && length >= 18) {
+        expected.ethertype = static_cast<uint16_t>((frame[16] << 8) | frame[17]);
+        expected.flags |= kFrameVlan;
+    }
+    if (expected.ethertype == 0x0800) expected.flags |= kFrameIpv4;
+    if (expected.ethertype == 0x0806) expected.flags |= kFrameArp;
+    uint64_t dst = MacKey(frame), src = MacKey(frame + 6);
+    if (dst == kClassifyOurKey) expected.flags |= kFrameToUs;
+    if (src == kClassifyOurKey) expected.flags |= kFrameFromUs;
+    if (src == kClassifyGatewayKey) expected.flags |= kFrameFromGateway;
+    if (src == kClassifyOurKey || src == kClassifyGatewayKey) src = ~0ULL;
+    if (dst == kClassifyOurKey || dst == kClassifyGatewayKey) dst = ~0ULL;
+    auto it = managed.find(src);
+    if (it != managed.end()) {
+        expected.flags |= kFrameSrcManaged;
+        expected.src_value = it->second;
+    }
+    it = managed.find(dst);
+    if (it != managed.end()) {
+        expected.flags |= kFrameDstManaged;
+        expected.dst_value = it->second;
+    }
+    return expected;
+}
+
+// Every kernel the CPU has against the reference, bursts crossing the
+// 64-frame batch; the set across growth and removal; and processBurst
+// against process() frame by frame
+static bool VerifyFrameClassifier() {
+    uint8_t our_mac[6], gateway_mac[6];
+    WriteMac(our_mac, kClassifyOurKey);
+    WriteMac(gateway_mac, kClassifyGatewayKey);
+
+    for (uint32_t devices : { 1u, 50u, 20000u }) {
+        FrameClassifier classifier;
+        classifier.setAddresses(our_mac, gateway_mac);
+        std::unordered_map<uint64_t, uint32_t> managed;
+        for (uint32_t i = 0; i < devices; ++i) {
+            classifier.managed().insert(ClassifyDeviceKey(i), i * 3);
+            managed[ClassifyDeviceKey(i)] = i * 3;
+        }
+        // Remove every fifth and update every seventh
+        for (uint32_t i = 0; i < devices; i += 5) {
+            classifier.managed().erase(ClassifyDeviceKey(i));
+            managed.erase(ClassifyDeviceKey(i));
+        }
+        for (uint32_t i = 1; i < devices; i += 7) {
+            classifier.managed().insert(ClassifyDeviceKey(i), i);
+            managed[ClassifyDeviceKey(i)] = i;
+        }
+        if (classifier.managed().size() != managed.size()) {
+            fprintf(stderr, "VerifyFrameClassifier: set holds %zu keys, expected %zu\n", classifier.managed().size(),
+                    managed.size());
+            return false;
+        }
+
+        std::vector<uint8_t> storage;
+        std::vector<size_t> lengths;
+        MakeClassifyFrames(1000, devices, 0xC1A55u + devices, storage, lengths);
+        std::vector<ReceivedFrame> frames(lengths.size());
+        for (size_t i = 0; i < frames.size(); ++i) {
+            frames[i].data = &storage[i * 128];
+            frames[i].capacity = i % 97 == 0 ? 15 : 128;   // some too small for a vector load
+            frames[i].length = lengths[i];
+            frames[i].timestamp_ns = 0;
+        }
+
+        int best = FrameClassifier::BestIsa();
+        for (int isa = FrameClassifier::kIsaScalar; isa <= best; ++isa) {
+            classifier.setIsa(static_cast<FrameClassifier::Isa>(isa));
+            for (size_t count : { static_cast<size_t>(1), static_cast<size_t>(7), static_cast<size_t>(64), frames.size() }) {
+                std::vector<FrameClass> out(count);
+                classifier.classify(frames.data(), count, out.data());
+                for (size_t i = 0; i < count; ++i) {
+                    FrameClass expected = ReferenceClass(frames[i].data, frames[i].length, managed);
+                    if (memcmp(&expected, &out[i], sizeof(expected)) != 0) {
+                        fprintf(stderr,
+                                "VerifyFrameClassifier: %s, %u devices, frame %zu: type %04x flags %03x (%u, %u), "
+                                "expected %04x %03x (%u, %u)\n",
+                                FrameClassifier::IsaName(classifier.isa()), devices, i, out[i].ethertype, out[i].flags,
+                                out[i].src_value, out[i].dst_value, expected.ethertype, expected.flags,
+                                expected.src_value, expected.dst_value);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    // processBurst and process() must agree frame for frame
+    const uint32_t kDevices = 300;
+    VirtualClock clock;
+    DataPlane::Config config;
+    memcpy(config.our_mac, our_mac, 6);
+    memcpy(config.gateway_mac, gateway_mac, 6);
+    DataPlane single(config, nullptr, clock), burst(config, nullptr, clock);
+    for (uint32_t i = 0; i < kDevices; ++i) {
+        DevicePolicy policy = {};
+        policy.counter_slot = TrafficCounters::kInvalidSlot;
+        WriteMac(policy.mac, ClassifyDeviceKey(i));
+        policy.ip[0] = 10;
+        policy.ip[2] = static_cast<uint8_t>(i >> 8);
+        policy.ip[3] = static_cast<uint8_t>(i);
+        policy.blocked = i % 11 == 0;
+        single.setDevice(policy);
+        burst.setDevice(policy);
+    }
+    for (uint32_t i = 0; i < kDevices; i += 9) {
+        uint8_t mac[6];
+        WriteMac(mac, ClassifyDeviceKey(i));
+        single.removeDevice(mac);
+        burst.removeDevice(mac);
+    }
+    std::vector<uint8_t> storage;
+    std::vector<size_t> lengths;
+    MakeClassifyFrames(500, kDevices, 0xB0257u, storage, lengths);
+    std::vector<uint8_t> copy(storage);
+    std::vector<ReceivedFrame> frames(lengths.size());
+    std::vector<DropReason> results(lengths.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].data = &copy[i * 128];
+        frames[i].capacity = 128;
+        frames[i].length = lengths[i];
+        frames[i].timestamp_ns = 0;
+    }
+    burst.processBurst(frames.data(), frames.size(), results.data());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        DropReason expected = single.process(&storage[i * 128], lengths[i]);
+        if (results[i] != expected) {
+            fprintf(stderr, "VerifyFrameClassifier: frame %zu %s in a burst, %s alone\n", i,
+                    DropReasonName(results[i]), DropReasonName(expected));
+            return false;
+        }
+    }
+    if (storage != copy || memcmp(&single.stats(), &burst.stats(), sizeof(DataPlane::Stats)) != 0) {
+        fprintf(stderr, "VerifyFrameClassifier: processBurst and process() disagree on frames or stats\n");
+        return false;
+    }
+    return true;
+}
+
+// Full ones' complement checksum of an IPv4 header, the reference for the
+// incremental update
+static uint16_t Ipv4HeaderChecksum(const uint8_t* header, size_t length) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < length; i += 2) {
+        if (i != 10) sum += static_cast<uint32_t>((header[i] << 8) | header[i + 1]);
+    }
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+// Frames of kMarkFrameSize bytes: Ethernet, a random IPv4 header with a
+// valid checksum, UDP
+static const size_t kMarkFrameSize = 128;
+
+static void MakeMarkFrames(uint32_t count, uint32_t seed, std::vector<uint8_t>& frames) {
+    frames.assign(static_cast<size_t>(count) * kMarkFrameSize, 0);
+    uint32_t state = seed;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t* frame = &frames[static_cast<size_t>(i) * kMarkFrameSize];
+        WriteMac(frame, kClassifyGatewayKey);
+        WriteMac(frame + 6, ClassifyDeviceKey(i % 16));
+        frame[12] = 0x08;
+        uint8_t* ip = frame + 14;
+        for (size_t b = 0; b < 20; ++b) ip[b] = static_cast<uint8_t>(NextRandom(state));
+        ip[0] = 0x45;
+        ip[9] = 17;
+        uint16_t checksum = Ipv4HeaderChecksum(ip, 20);
+        ip[10] = static_cast<uint8_t>(checksum >> 8);
+        ip[11] = static_cast<uint8_t>(checksum);
+    }
+}
+
+static bool VerifyPriorityMark() {
+    const uint32_t kFrames = 1000;
+    std::vector<uint8_t> frames, burst_frames;
+    MakeMarkFrames(kFrames, 0xD5C9u, frames);
+    burst_frames = frames;
+    std::vector<uint8_t*> headers(kFrames);
+    std::vector<uint8_t> dscp(kFrames);
+    uint32_t state = 0x1624u;
+    size_t expected_changed = 0;
+    for (uint32_t i = 0; i < kFrames; ++i) {
+        uint8_t* ip = &frames[static_cast<size_t>(i) * kMarkFrameSize + 14];
+        uint8_t ecn = ip[1] & 0x03;
+        dscp[i] = static_cast<uint8_t>(i % 7 == 0 ? ip[1] >> 2 : NextRandom(state) % 64);
+        headers[i] = &burst_frames[static_cast<size_t>(i) * kMarkFrameSize + 14];
+        if (MarkIpv4Dscp(ip, dscp[i])) ++expected_changed;
+        uint16_t checksum = static_cast<uint16_t>((ip[10] << 8) | ip[11]);
+        if ((ip[1] >> 2) != dscp[i] || (ip[1] & 0x03) != ecn || checksum != Ipv4HeaderChecksum(ip, 20)) {
+            fprintf(stderr, "VerifyPriorityMark: header %u: DSCP %u, checksum %04x, expected %04x\n", i, ip[1] >> 2,
+                    checksum, Ipv4HeaderChecksum(ip, 20));
+            return false;
+        }
+    }
+    // Every group size the batch splits into, plus a remainder
+    size_t changed = 0;
+    for (uint32_t done = 0; done < kFrames;) {
+        uint32_t count = std::min<uint32_t>(kFrames - done, 1 + done % 70);
+        size_t group_changed = 0;
+        MarkIpv4DscpBurst(&headers[done], &dscp[done], count, &group_changed);
+        changed += group_changed;
+        done += count;
+    }
+    if (burst_frames != frames || changed != expected_changed) {
+        fprintf(stderr, "VerifyPriorityMark: batch marked %zu headers, %zu one at a time, or results differ\n",
+                changed, expected_changed);
+        return false;
+    }
+
+    ShapingRule rule;
+    std::string error;
+    if (!ParseShapingRule("proto=udp,dscp=46,pcp=5,vlan=10", rule, error) || rule.mark.flags != 3 ||
+        rule.mark.dscp != 46 || rule.mark.pcp != 5 || rule.mark.vlan_id != 10 ||
+        ParseShapingRule("dscp=64", rule, error) || ParseShapingRule("pcp=8", rule, error)) {
+        fprintf(stderr, "VerifyPriorityMark: rule marks misparsed\n");
+        return false;
+    }
+
+    // Upstream frames get the device's mark, or their rule's; downstream
+    // frames are left alone
+    VirtualClock clock;
+    DataPlane::Config config;
+    WriteMac(config.our_mac, kClassifyOurKey);
+    WriteMac(config.gateway_mac, kClassifyGatewayKey);
+    NullPacketIO io(true);
+    DataPlane plane(config, &io, clock);
+    DevicePolicy policy = {};
+    policy.counter_slot = TrafficCounters::kInvalidSlot;
+    WriteMac(policy.mac, ClassifyDeviceKey(1));
+    policy.ip[0] = 10;
+    policy.ip[3] = 1;
+    policy.mark.flags = kMarkDscp | kMarkVlanPriority;
+    policy.mark.dscp = 46;
+    policy.mark.pcp = 5;
+    policy.mark.vlan_id = 7;
+    plane.setDevice(policy);
+    ShapingRule bulk;
+    InitShapingRule(bulk);
+    bulk.id = 1;
+    bulk.protocol = 6;
+    bulk.mark.flags = kMarkDscp;
+    bulk.mark.dscp = 8;
+    plane.setRules({ bulk });
+    policy.mark.dscp = 64;
+    if (plane.setDevice(policy)) {
+        fprintf(stderr, "VerifyPriorityMark: invalid device mark accepted\n");
+        return false;
+    }
+
+    uint8_t up[kMarkFrameSize], tcp[kMarkFrameSize], down[kMarkFrameSize];
+    memcpy(up, &frames[kMarkFrameSize], kMarkFrameSize);
+    WriteMac(up, kClassifyOurKey);
+    memcpy(tcp, up, kMarkFrameSize);
+    tcp[14 + 9] = 6;
+    uint16_t checksum = Ipv4HeaderChecksum(tcp + 14, 20);
+    tcp[24] = static_cast<uint8_t>(checksum >> 8);
+    tcp[25] = static_cast<uint8_t>(checksum);
+    memcpy(down, up, kMarkFrameSize);
+    WriteMac(down, ClassifyDeviceKey(1));
+    WriteMac(down + 6, kClassifyGatewayKey);
+    uint8_t down_tos = down[15];
+    if (plane.process(up, kMarkFrameSize) != kDropNone || plane.process(tcp, kMarkFrameSize) != kDropNone ||
+        plane.process(down, kMarkFrameSize) != kDropNone) {
+        fprintf(stderr, "VerifyPriorityMark: marked frames dropped\n");
+        return false;
+    }
+    std::vector<std::vector<uint8_t>> sent = io.takeFrames();
+    bool ok = sent.size() == 3 && sent[0].size() == kMarkFrameSize + 4 && sent[0][12] == 0x81 &&
+              sent[0][13] == 0x00 && sent[0][14] == (5 << 5) && sent[0][15] == 7 && sent[0][16] == 0x08 &&
+              (sent[0][19] >> 2) == 46 && memcmp(&sent[0][18], up + 14, kMarkFrameSize - 14) == 0 &&
+              sent[1].size() == kMarkFrameSize + 4 && (sent[1][19] >> 2) == 8 && sent[1][14] == (5 << 5) &&
+              sent[2].size() == kMarkFrameSize && sent[2][15] == down_tos;
+    for (size_t i = 0; ok && i < 2; ++i) {
+        ok = static_cast<uint16_t>((sent[i][28] << 8) | sent[i][29]) == Ipv4HeaderChecksum(&sent[i][18], 20);
+    }
+    if (!ok || plane.stats().marked != 2) {
+        fprintf(stderr, "VerifyPriorityMark: forwarded frames carry the wrong marks\n");
+        return false;
+    }
+    return true;
+}
+
+// TCP checksum over the pseudo-header and segment of the IPv4 packet at ip
+static uint16_t TcpChecksum(const uint8_t* ip, size_t tcp_length) {
+    uint32_t sum = 6 + static_cast<uint32_t>(tcp_length);
+    for (size_t i = 12; i < 20; i += 2) sum += static_cast<uint32_t>((ip[i] << 8) | ip[i + 1]);
+    const uint8_t* tcp = ip + 20;
+    for (size_t i = 0; i < tcp_length; i += 2) {
+        if (i == 16) continue;
+        sum += static_cast<uint32_t>((tcp[i] << 8) | (i + 1 < tcp_length ? tcp[i + 1] : 0));
+    }
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+// Ethernet + IPv4 + TCP with the given options (a multiple of 4 bytes) and
+// valid checksums; returns the frame length
+static size_t MakeTcpFrame(uint8_t* frame, uint64_t dst_mac, uint64_t src_mac, const uint8_t* src_ip,
+                           const uint8_t* dst_ip, uint16_t src_port, uint16_t dst_port, uint8_t flags,
+                           uint16_t window, const uint8_t* options, size_t options_length) {
+    size_t tcp_length = 20 + options_length;
+    memset(frame, 0, 14 + 20 + tcp_length);
+    WriteMac(frame, dst_mac);
+    WriteMac(frame + 6, src_mac);
+    frame[12] = 0x08;
+    uint8_t* ip = frame + 14;
+    ip[0] = 0x45;
+    ip[2] = static_cast<uint8_t>((20 + tcp_length) >> 8);
+    ip[3] = static_cast<uint8_t>(20 + tcp_length);
+    ip[8] = 64;
+    ip[9] = 6;
+    memcpy(ip + 12, src_ip, 4);
+    memcpy(ip + 16, dst_ip, 4);
+    uint16_t checksum = Ipv4HeaderChecksum(ip, 20);
+    ip[10] = static_cast<uint8_t>(checksum >> 8);
+    ip[11] = static_cast<uint8_t>(checksum);
+    uint8_t* tcp = ip + 20;
+    tcp[0] = static_cast<uint8_t>(src_port >> 8);
+    tcp[1] = static_cast<uint8_t>(src_port);
+    tcp[2] = static_cast<uint8_t>(dst_port >> 8);
+    tcp[3] = static_cast<uint8_t>(dst_port);
+    tcp[12] = static_cast<uint8_t>((tcp_length / 4) << 4);
+    tcp[13] = flags;
+    tcp[14] = static_cast<uint8_t>(window >> 8);
+    tcp[15] = static_cast<uint8_t>(window);
+    if (options_length) memcpy(tcp + 20, options, options_length);
+    checksum = TcpChecksum(ip, tcp_length);
+    tcp[16] = static_cast<uint8_t>(checksum >> 8);
+    tcp[17] = static_cast<uint8_t>(checksum);
+    return 14 + 20 + tcp_length;
+}
+
+static bool VerifyWindowShaping() {
+    VirtualClock clock;
+    DataPlane::Config config;
+    WriteMac(config.our_mac, kClassifyOurKey);
+    WriteMac(config.gateway_mac, kClassifyGatewayKey);
+    NullPacketIO io(true);
+    DataPlane plane(config, &io, clock);
+    plane.setFlowTracking(1024);
+    DevicePolicy policy = {};
+    policy.counter_slot = TrafficCounters::kInvalidSlot;
+    WriteMac(policy.mac, ClassifyDeviceKey(1));
+    const uint8_t device_ip[4] = { 10, 0, 0, 1 };
+    const uint8_t remote_ip[4] = { 10, 9, 0, 1 };
+    memcpy(policy.ip, device_ip, 4);
+    policy.download_mbps = 8;
+    policy.upload_mbps = 4;
+    policy.window_shaping = true;
+    policy.clamp_mss = 1200;
+    plane.setDevice(policy);
+
+    // The device's SYN has its MSS at an odd offset, the SYN/ACK's is aligned
+    const uint8_t syn_options[8] = { 1, 2, 4, 0x05, 0xB4, 3, 3, 7 };
+    const uint8_t syn_ack_options[8] = { 2, 4, 0x05, 0xB4, 1, 3, 3, 8 };
+    const uint64_t device = ClassifyDeviceKey(1);
+    uint8_t frame[128];
+    struct Step {
+        uint64_t at_ms;
+        bool up;
+        uint8_t flags;
+        const uint8_t* options;
+    };
+    const Step steps[] = {
+        { 0, true, kTcpSyn, syn_options },
+        { 10, false, kTcpSyn | kTcpAck, syn_ack_options },
+        { 20, true, kTcpAck, nullptr },     // completes the handshake: RTT 20 ms
+        { 21, true, kTcpAck, nullptr },     // download: 1 MB/s * 20 ms = 20000 bytes, scale 7
+        { 22, false, kTcpAck, nullptr },    // upload: 10000 bytes, scale 8
+    };
+    for (const Step& step : steps) {
+        clock.set((1000 + step.at_ms) * 1000000);
+        size_t length = step.up
+            ? MakeTcpFrame(frame, kClassifyOurKey, device, device_ip, remote_ip, 40000, 443, step.flags, 0xFFFF,
+                           step.options, step.options ? 8 : 0)
+            : MakeTcpFrame(frame, device, kClassifyGatewayKey, remote_ip, device_ip, 443, 40000, step.flags, 0xFFFF,
+                           step.options, step.options ? 8 : 0);
+        if (plane.process(frame, length) != kDropNone) {
+            fprintf(stderr, "VerifyWindowShaping: segment at %llu ms dropped\n",
+                    static_cast<unsigned long long>(step.at_ms));
+            return false;
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> sent = io.takeFrames();
+    const uint16_t expected_mss[2] = { 1200, 1200 };
+    const size_t mss_offset[2] = { 14 + 20 + 23, 14 + 20 + 22 };
+    const uint16_t expected_window[5] = { 0xFFFF, 0xFFFF, 0xFFFF, 157, 40 };
+    bool ok = sent.size() == 5;
+    for (size_t i = 0; ok && i < sent.size(); ++i) {
+        const uint8_t* ip = &sent[i][14];
+        size_t tcp_length = sent[i].size() - 34;
+        uint16_t checksum = static_cast<uint16_t>((ip[36] << 8) | ip[37]);
+        uint16_t window = static_cast<uint16_t>((ip[34] << 8) | ip[35]);
+        ok = checksum == TcpChecksum(ip, tcp_length) && window == expected_window[i];
+        if (ok && i < 2) ok = ((sent[i][mss_offset[i]] << 8) | sent[i][mss_offset[i] + 1]) == expected_mss[i];
+        if (!ok) {
+            fprintf(stderr, "VerifyWindowShaping: segment %zu: window %u, checksum %04x, expected %u, %04x\n", i,
+                    window, checksum, expected_window[i], TcpChecksum(ip, tcp_length));
+        }
+    }
+    if (!ok || plane.stats().mss_clamped != 2 || plane.stats().windows_clamped != 2) {
+        fprintf(stderr, "VerifyWindowShaping: %llu MSS and %llu windows clamped, expected 2 and 2\n",
+                static_cast<unsigned long long>(plane.stats().mss_clamped),
+                static_cast<unsigned long long>(plane.stats().windows_clamped));
+        return false;
+    }
+    return true;
+}
+
+// Downstream frames addressed to our MAC find their device by IP. After
+// 10.0.0.1 moves from device 1 to device 2, updating device 1 (to
+// 10.0.0.3) must leave the address with device 2.
+static bool VerifyDeviceIpMove() {
+    VirtualClock clock;
+    DataPlane::Config config;
+    WriteMac(config.our_mac, kClassifyOurKey);
+    WriteMac(config.gateway_mac, kClassifyGatewayKey);
+    DataPlane plane(config, nullptr, clock);
+    const uint8_t ips[3][4] = { { 10, 0, 0, 1 }, { 10, 0, 0, 2 }, { 10, 0, 0, 3 } };
+    DevicePolicy first = {};
+    first.counter_slot = TrafficCounters::kInvalidSlot;
+    DevicePolicy second = {};
+    second.counter_slot = TrafficCounters::kInvalidSlot;
+    WriteMac(first.mac, ClassifyDeviceKey(1));
+    WriteMac(second.mac, ClassifyDeviceKey(2));
+    memcpy(first.ip, ips[0], 4);
+    memcpy(second.ip, ips[1], 4);
+    plane.setDevice(first);
+    plane.setDevice(second);
+    memcpy(second.ip, ips[0], 4);
+    plane.setDevice(second);
+    memcpy(first.ip, ips[2], 4);
+    plane.setDevice(first);
+
+    const uint8_t remote_ip[4] = { 10, 9, 0, 1 };
+    uint8_t frame[128];
+    size_t length = MakeTcpFrame(frame, kClassifyOurKey, kClassifyGatewayKey, remote_ip, ips[0], 443, 40000, kTcpAck,
+                                 0xFFFF, nullptr, 0);
+    DropReason reason = plane.process(frame, length);
+    DataPlane::DeviceStats stats;
+    if (reason != kDropNone || !plane.deviceStats(second.mac, stats) || stats.forwarded_packets[kTrafficDown] != 1) {
+        fprintf(stderr, "VerifyDeviceIpMove: frame for the moved IP %s\n", DropReasonName(reason));
+        return false;
+    }
+    return true;
+}
+
+// The data plane counts into the slot named by the policy (the device's
+// TrafficControl slot, which every reader uses) and leaves acquiring and
+// releasing it to that owner
+static bool VerifyCounterSlot() {
+    VirtualClock clock;
+    DataPlane::Config config;
+    WriteMac(config.our_mac, kClassifyOurKey);
+    WriteMac(config.gateway_mac, kClassifyGatewayKey);
+    DataPlane plane(config, nullptr, clock);
+    const uint8_t device_ip[4] = { 10, 0, 0, 1 };
+    const uint8_t remote_ip[4] = { 10, 9, 0, 1 };
+    uint32_t slot = GetTrafficCounters().acquireSlot();
+    DevicePolicy policy = {};
+    WriteMac(policy.mac, ClassifyDeviceKey(1));
+    memcpy(policy.ip, device_ip, 4);
+    policy.counter_slot = slot;
+    plane.setDevice(policy);
+
+    uint8_t frame[128];
+    size_t length = MakeTcpFrame(frame, kClassifyOurKey, ClassifyDeviceKey(1), device_ip, remote_ip, 40000, 443,
+                                 kTcpAck, 0xFFFF, nullptr, 0);
+    DropReason reason = plane.process(frame, length);
+    plane.removeDevice(policy.mac);
+    TrafficCounters::Totals totals = GetTrafficCounters().read(slot);
+    uint32_t next = GetTrafficCounters().acquireSlot();   // slots are reused last in, first out
+    GetTrafficCounters().releaseSlot(next);
+    GetTrafficCounters().releaseSlot(slot);
+    if (reason != kDropNone || totals.packets[kTrafficUp] != 1 || totals.bytes[kTrafficUp] != length ||
+        next == slot) {
+        fprintf(stderr, "VerifyCounterSlot: %s, %llu packets in the policy's slot%s\n", DropReasonName(reason),
+                static_cast<unsigned long long>(totals.packets[kTrafficUp]),
+                next == slot ? ", slot released by the data plane" : "");
+        return false;
+    }
+    return true;
+}
+
+// An unreadable inventory file is renamed aside and reported, not deleted
+// (mapping may have zero-padded it to a header); a file that was never
+// written is just initialized
+static bool VerifyInventoryRecovery() {
+    const std::string path = "verify_inventory.inv";
+    const std::string garbage = "not a device inventory";
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    fwrite(garbage.data(), 1, garbage.size(), file);
+    fclose(file);
+
+    DeviceInventory inventory;
+    bool opened = inventory.open(path);
+    std::string error = inventory.getLastError();
+    inventory.close();
+    std::string aside;
+    size_t start = error.find(" moved it to ");
+    size_t end = error.find(" and starting fresh");
+    if (start != std::string::npos && end != std::string::npos && end > start) {
+        aside = error.substr(start + 13, end - start - 13);
+    }
+    std::string kept;
+    if (FILE* moved = aside.empty() ? nullptr : fopen(aside.c_str(), "rb")) {
+        char buffer[64];
+        kept.assign(buffer, fread(buffer, 1, sizeof(buffer), moved));
+        fclose(moved);
+        remove(aside.c_str());
+    }
+    remove(path.c_str());
+
+    DeviceInventory fresh;
+    bool created = fresh.open(path);
+    std::string fresh_error = fresh.getLastError();
+    fresh.close();
+    remove(path.c_str());
+    if (!opened || kept.compare(0, garbage.size(), garbage) != 0 || !created || !fresh_error.empty()) {
+        fprintf(stderr, "VerifyInventoryRecovery: opened %d, error \"%s\", kept %zu bytes, new file error \"%s\"\n",
+                opened, error.c_str(), kept.size(), fresh_error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// A receive that timed out is an error, not a received packet
+static bool VerifyArpStats() {
+    ArpStats stats;
+    stats.recordReceive(500000000, false);
+    stats.recordReceive(2000000, true);
+    ArpStats::Snapshot snapshot = stats.snapshot();
+    if (snapshot.packets_received != 1 || snapshot.receive_errors != 1 || snapshot.receive_latency.count != 1) {
+        fprintf(stderr, "VerifyArpStats: %llu received, %llu errors, %llu latency samples\n",
+                static_cast<unsigned long long>(snapshot.packets_received),
+                static_cast<unsigned long long>(snapshot.receive_errors),
+                static_cast<unsigned long long>(snapshot.receive_latency.count));
+        return false;
+    }
+    return true;
+}
+
+// Ethernet + IPv4 + TCP ACK from the device (upstream) with ack_number and
+// payload_length zero bytes of data; returns the frame length
+static size_t MakeAckFrame(uint8_t* frame, const uint8_t* device_ip, const uint8_t* remote_ip, uint16_t port,
+                           uint32_t ack_number, const uint8_t* options, size_t options_length,
+                           size_t payload_length) {
+    uint8_t padding[1500] = {};
+    size_t length = MakeTcpFrame(frame, kClassifyOurKey, ClassifyDeviceKey(1), device_ip, remote_ip, port, 443,
+                                 kTcpAck, 0xFFFF, payload_length ? padding : options,
+                                 payload_length ? payload_length : options_length);
+    uint8_t* ip = frame + 14;
+    uint8_t* tcp = ip + 20;
+    tcp[12] = static_cast<uint8_t>(((20 + (payload_length ? 0 : options_length)) / 4) << 4);
+    for (int i = 0; i < 4; ++i) tcp[8 + i] = static_cast<uint8_t>(ack_number >> (24 - 8 * i));
+    uint16_t checksum = TcpChecksum(ip, length - 34);
+    tcp[16] = static_cast<uint8_t>(checksum >> 8);
+    tcp[17] = static_cast<uint8_t>(checksum);
+    return length;
+}
+
+// ACK handling on a 1 Mbit/s upload (6250-byte bucket, five 1250-byte
+// bulk segments): the empty bucket drops bulk but lets a prioritized ACK
+// through, a policed ACK is dropped, and bulk waits for the ACK's debt. In a
+// burst, a plain ACK followed by a higher one of its flow is filtered,
+// while ACKs carrying SACK and ACKs of other flows are not.
+static bool VerifyAckHandling() {
+    VirtualClock clock;
+    clock.set(1000000000ULL);
+    DataPlane::Config config;
+    WriteMac(config.our_mac, kClassifyOurKey);
+    WriteMac(config.gateway_mac, kClassifyGatewayKey);
+    DataPlane plane(config, nullptr, clock);
+    DevicePolicy policy = {};
+    policy.counter_slot = TrafficCounters::kInvalidSlot;
+    WriteMac(policy.mac, ClassifyDeviceKey(1));
+    const uint8_t device_ip[4] = { 10, 0, 0, 1 };
+    const uint8_t remote_ip[4] = { 10, 9, 0, 1 };
+    memcpy(policy.ip, device_ip, 4);
+    policy.upload_mbps = 1;
+    plane.setDevice(policy);
+
+    std::vector<uint8_t> frame(2048);
+    size_t bulk = 0;
+    while (bulk < 16 && plane.process(frame.data(), MakeAckFrame(frame.data(), device_ip, remote_ip, 40000, 1,
+                                                                 nullptr, 0, 1196)) == kDropNone) {
+        ++bulk;
+    }
+    DropReason ack = plane.process(frame.data(), MakeAckFrame(frame.data(), device_ip, remote_ip, 40000, 2,
+                                                              nullptr, 0, 0));
+    policy.ack_handling = kAckPolice;
+    plane.setDevice(policy);
+    DropReason policed = plane.process(frame.data(), MakeAckFrame(frame.data(), device_ip, remote_ip, 40000, 3,
+                                                                  nullptr, 0, 0));
+    clock.set(1000000000ULL + 10000000);   // 1250 bytes of tokens, 54 of them owed
+    DropReason after = plane.process(frame.data(), MakeAckFrame(frame.data(), device_ip, remote_ip, 40000, 3,
+                                                                nullptr, 0, 1196));
+    if (bulk != 5 || ack != kDropNone || policed != kDropRateLimited || after != kDropRateLimited ||
+        plane.stats().acks_prioritized != 1) {
+        fprintf(stderr, "VerifyAckHandling: %zu bulk segments passed, ACK %s, policed ACK %s, then bulk %s, "
+                "%llu prioritized\n", bulk, DropReasonName(ack), DropReasonName(policed), DropReasonName(after),
+                static_cast<unsigned long long>(plane.stats().acks_prioritized));
+        return false;
+    }
+
+    policy.ack_handling = kAckFilter;
+    plane.setDevice(policy);
+    const uint8_t sack[12] = { 1, 1, 5, 10, 0, 0, 0x10, 0, 0, 0, 0x20, 0 };
+    const uint8_t timestamps[12] = { 1, 1, 8, 10, 0, 0, 0, 1, 0, 0, 0, 2 };
+    struct Ack {
+        uint16_t port;
+        uint32_t ack_number;
+        const uint8_t* options;
+        DropReason expected;
+    };
+    const Ack acks[] = {
+        { 40000, 1000, timestamps, kDropAckFiltered },   // superseded by 2000
+        { 40001, 500, nullptr, kDropNone },              // other flow
+        { 40000, 2000, sack, kDropNone },                // carries SACK
+        { 40000, 3000, nullptr, kDropNone },             // followed by a duplicate
+        { 40000, 3000, nullptr, kDropAckFiltered },      // superseded by 4000
+        { 40000, 4000, nullptr, kDropNone },
+    };
+    const size_t count = sizeof(acks) / sizeof(acks[0]);
+    std::vector<uint8_t> storage(count * 128);
+    ReceivedFrame frames[count];
+    for (size_t i = 0; i < count; ++i) {
+        frames[i].data = &storage[i * 128];
+        frames[i].capacity = 128;
+        frames[i].length = MakeAckFrame(frames[i].data, device_ip, remote_ip, acks[i].port, acks[i].ack_number,
+                                        acks[i].options, acks[i].options ? 12 : 0, 0);
+        frames[i].timestamp_ns = 0;
+    }
+    DropReason results[count];
+    plane.processBurst(frames, count, results);
+    bool ok = plane.stats().drops[kDropAckFiltered] == 2;
+    for (size_t i = 0; i < count; ++i) {
+        if (results[i] == acks[i].expected) continue;
+        fprintf(stderr, "VerifyAckHandling: burst ACK %zu %s, expected %s\n", i, DropReasonName(results[i]),
+                DropReasonName(acks[i].expected));
+        ok = false;
+    }
+    return ok;
+}
+
+static void BenchFrames(const BenchOptions& options, std::vector<BenchResult>& results) {
+    uint8_t mac_a[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+    uint8_t mac_b[6] = { 0x02, 0x66, 0x77, 0x88, 0x99, 0x00 };
+    uint8_t ip_a[4] = { 192, 168, 1, 1 };
+    uint8_t ip_b[4] = { 192, 168, 1, 20 };
+    ArpFrame frame;
+
+    results.push_back(Run(options, "frame/build_request", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            ip_b[3] = static_cast<uint8_t>(i);
+            BuildArpRequest(frame, mac_a, ip_a, ip_b);
+            DoNotOptimize(frame);
+        }
+    }));
+    results.push_back(Run(options, "frame/build_reply", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            ip_b[3] = static_cast<uint8_t>(i);
+            BuildArpReply(frame, mac_a, ip_a, mac_b, ip_b);
+            DoNotOptimize(frame);
+        }
+    }));
+}
+
+static void BenchStrings(const BenchOptions& options, std::vector<BenchResult>& results) {
+    std::vector<std::string> macs, ips;
+    for (uint32_t i = 0; i < 256; ++i) {
+        macs.push_back(MakeMac(i * 2654435761u));
+        ips.push_back(MakeIp(i * 97));
+    }
+    uint8_t mac[6];
+    uint8_t ip[4];
+
+    results.push_back(Run(options, "string/string_to_mac", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(ArpManager::stringToMac(macs[i & 255], mac));
+            DoNotOptimize(mac);
+        }
+    }));
+    results.push_back(Run(options, "string/mac_to_string", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            mac[5] = static_cast<uint8_t>(i);
+            std::string text = ArpManager::macToString(mac);
+            DoNotOptimize(text);
+        }
+    }));
+    results.push_back(Run(options, "string/string_to_ip", 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(ArpManager::stringToIp(ips[i & 255], ip));
+            DoNotOptimize(ip);
+        }
+    }));
+}
+
+// One refresh of the poisoning worker: two spoofed replies per target,
+// each timed into ArpStats, sent to a null backend
+static void BenchPoisonCycle(const BenchOptions& options, std::vector<BenchResult>& results) {
+    SpoofEndpoints local;
+    ArpManager::stringToMac("02:11:22:33:44:55", local.our_mac);
+    ArpManager::stringToIp("10.0.0.1", local.gateway_ip);
+    ArpManager::stringToMac("02:aa:bb:cc:dd:ee", local.gateway_mac);
+
+    for (uint32_t count : { 10u, 1000u, 10000u }) {
+        struct Target { uint8_t ip[4]; uint8_t mac[6]; };
+        std::vector<Target> targets(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            ArpManager::stringToIp(MakeIp(i + 2), targets[i].ip);
+            ArpManager::stringToMac(MakeMac(i + 2), targets[i].mac);
+        }
+
+        NullPacketIO io;
+        ArpFrame frame;
+        results.push_back(Run(options, "poison_cycle/" + std::to_string(count), count, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto& target : targets) {
+                    SendSpoofPair(io, frame, local, target.ip, target.mac);
+                }
+            }
+            DoNotOptimize(io.framesSent());
+        }));
+    }
+}
+
+// Rescan with ~1% churn: a few devices leave, join or change IP
+static void BenchArpDiff(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (uint32_t count : { 256u, 4096u }) {
+        std::vector<DeviceInfo> devices = MakeDevices(count);
+        std::map<std::string, DeviceInfo> previous;
+        for (const auto& device : devices) previous[device.mac] = device;
+
+        std::vector<DeviceInfo> current = devices;
+        uint32_t churn = std::max(1u, count / 100);
+        current.resize(count - churn);
+        std::vector<DeviceInfo> joined = MakeDevices(count + churn);
+        current.insert(current.end(), joined.end() - churn, joined.end());
+        for (uint32_t i = 0; i < churn; ++i) current[i * 7].ip = MakeIp(count * 2 + i);
+
+        results.push_back(Run(options, "arp_table_diff/" + std::to_string(count), count, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                DeviceTableDiff diff = DiffDeviceTables(previous, current);
+                DoNotOptimize(diff.changed.size());
+            }
+        }));
+    }
+}
+
+static void BenchDeviceTable(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (uint32_t count : { 256u, 4096u }) {
+        std::vector<DeviceInfo> devices = MakeDevices(count);
+        std::vector<DeviceControlInfo> controls(count, DeviceControlInfo{ 0, 0, false, false });
+        for (uint32_t i = 0; i < count; i += 10) controls[i] = DeviceControlInfo{ 10.0, 2.5, false, true };
+
+        results.push_back(Run(options, "device_table_pack/" + std::to_string(count), count, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::vector<uint8_t> packed = PackDeviceTable(devices, &controls);
+                DoNotOptimize(packed.data());
+            }
+        }));
+    }
+}
+
+// Lookup of established flows and insert/remove churn, at 1k and 1M flows
+static void BenchFlowTable(const BenchOptions& options, std::vector<BenchResult>& results) {
+    for (uint32_t count : { 1000u, 1000000u }) {
+        FlowTable table(count + count / 8, 120ULL * 1000000000ULL);
+        std::vector<FlowKey> keys(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            keys[i] = MakeFlow(i);
+            table.track(keys[i], 0);
+        }
+        // Visit keys in a scattered order so large tables miss in cache
+        std::vector<uint32_t> order(count);
+        for (uint32_t i = 0; i < count; ++i) order[i] = static_cast<uint32_t>((i * 2654435761ull) % count);
+
+        std::string suffix = "/" + std::to_string(count);
+        uint32_t cursor = 0;
+        results.push_back(Run(options, "flow_table/lookup" + suffix, 1, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                DoNotOptimize(table.track(keys[order[cursor]], 0));
+                if (++cursor == count) cursor = 0;
+            }
+        }));
+
+        uint32_t next = count;
+        results.push_back(Run(options, "flow_table/insert_remove" + suffix, 1, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                FlowKey key = MakeFlow(next);
+                DoNotOptimize(table.track(key, 0));
+                table.remove(MakeFlow(next - count));
+                ++next;
+            }
+        }));
+    }
+}
+
+// Rule lookup cost against rule count: the classifier alone, and the data
+// plane with and without the verdict cached in the flow table
+static void BenchRules(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const uint8_t our_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    const uint8_t gateway_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0xFE };
+    const uint8_t device_mac[6] = { 0x02, 0x10, 0x00, 0x00, 0x00, 0x03 };
+    const uint8_t device_ip[4] = { 192, 168, 1, 3 };
+    const uint32_t kFlows = 256;
+
+    // Upstream UDP frames of kFlows flows
+    std::vector<std::vector<uint8_t>> frames(kFlows, std::vector<uint8_t>(128, 0));
+    uint32_t state = 0xF00Du;
+    for (uint32_t i = 0; i < kFlows; ++i) {
+        uint8_t* frame = frames[i].data();
+        frame[12] = 0x08;
+        uint8_t* ip = frame + 14;
+        ip[0] = 0x45;
+        ip[9] = 17;
+        memcpy(ip + 12, device_ip, 4);
+        ip[16] = 93;
+        ip[19] = static_cast<uint8_t>(i);
+        RuleMatchFields fields = MakeRulePacket(state);
+        ip[20] = static_cast<uint8_t>(fields.local_port >> 8);
+        ip[21] = static_cast<uint8_t>(fields.local_port);
+        ip[22] = static_cast<uint8_t>(fields.remote_port >> 8);
+        ip[23] = static_cast<uint8_t>(fields.remote_port);
+    }
+
+    for (uint32_t count : { 10u, 100u, 1000u, 5000u }) {
+        std::vector<ShapingRule> rules = MakeRules(count, 0xC0FFEEu);
+        for (ShapingRule& rule : rules) rule.action = kRulePrioritize;   // nothing is dropped
+        std::string suffix = "/" + std::to_string(count);
+
+        RuleClassifier classifier;
+        classifier.compile(rules);
+        std::vector<RuleMatchFields> packets(1024);
+        for (RuleMatchFields& fields : packets) fields = MakeRulePacket(state);
+        results.push_back(Run(options, "rules/classify" + suffix, 1, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) DoNotOptimize(classifier.classify(packets[i & 1023]));
+        }));
+
+        for (bool cached : { false, true }) {
+            VirtualClock clock;
+            DataPlane::Config config;
+            memcpy(config.our_mac, our_mac, 6);
+            memcpy(config.gateway_mac, gateway_mac, 6);
+            DataPlane plane(config, nullptr, clock);
+            DevicePolicy policy = {};
+            memcpy(policy.mac, device_mac, 6);
+            memcpy(policy.ip, device_ip, 4);
+            policy.counter_slot = 0;   // nothing reads the counters here
+            plane.setDevice(policy);
+            if (cached) plane.setFlowTracking(kFlows * 4);
+            plane.setRules(rules);
+
+            results.push_back(Run(options, std::string("rules/data_plane_") + (cached ? "cached" : "uncached") + suffix,
+                                  1, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    uint8_t* frame = frames[i % kFlows].data();
+                    memcpy(frame + 6, device_mac, 6);   // forwarding rewrote the source
+                    DoNotOptimize(plane.process(frame, 128));
+                }
+            }));
+        }
+    }
+}
+
+// Destination lookup at 100k prefixes: DIR-24-8 against a linear scan
+static void BenchLpm(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const uint32_t kPrefixes = 100000;
+    std::vector<Ipv4Prefix> prefixes = MakePrefixes(kPrefixes, 0x600DF00Du);
+    std::vector<uint32_t> addresses = MakeLookupAddresses(prefixes, 1 << 16);
+    std::string suffix = "/" + std::to_string(kPrefixes);
+
+    LpmTable table;
+    results.push_back(Run(options, "lpm/build" + suffix, kPrefixes, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) DoNotOptimize(table.build(prefixes));
+    }));
+    results.push_back(Run(options, "lpm/dir24_8" + suffix, 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) DoNotOptimize(table.lookup(addresses[i & 0xFFFF]));
+    }));
+    results.push_back(Run(options, "lpm/linear" + suffix, 1, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) DoNotOptimize(LinearLpm(prefixes, addresses[i & 0xFFFF]));
+    }));
+}
+
+// Classification of 64-frame bursts against the managed set: per frame
+// with hash map lookups (as DataPlane::process does), then the batch
+// kernels; and the data plane itself, frame by frame and in bursts
+static void BenchClassify(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const size_t kBurst = PacketIO::kMaxBurst;
+    const uint32_t kBursts = 64;
+    uint8_t our_mac[6], gateway_mac[6];
+    WriteMac(our_mac, kClassifyOurKey);
+    WriteMac(gateway_mac, kClassifyGatewayKey);
+
+    for (uint32_t devices : { 16u, 4096u, 65536u }) {
+        std::string suffix = "/" + std::to_string(devices);
+        std::vector<uint8_t> storage;
+        std::vector<size_t> lengths;
+        MakeClassifyFrames(kBurst * kBursts, devices, 0x5EEDu, storage, lengths);
+        std::vector<ReceivedFrame> frames(lengths.size());
+        for (size_t i = 0; i < frames.size(); ++i) {
+            frames[i].data = &storage[i * 128];
+            frames[i].capacity = 128;
+            frames[i].length = lengths[i];
+            frames[i].timestamp_ns = 0;
+        }
+
+        std::unordered_map<uint64_t, uint32_t> map;
+        FrameClassifier classifier;
+        classifier.setAddresses(our_mac, gateway_mac);
+        for (uint32_t i = 0; i < devices; ++i) {
+            map[ClassifyDeviceKey(i)] = i;
+            classifier.managed().insert(ClassifyDeviceKey(i), i);
+        }
+
+        std::vector<FrameClass> out(kBurst);
+        results.push_back(Run(options, "classify/per_frame_map" + suffix, kBurst, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                const ReceivedFrame* burst = &frames[(i % kBursts) * kBurst];
+                for (size_t f = 0; f < kBurst; ++f) out[f] = ReferenceClass(burst[f].data, burst[f].length, map);
+                DoNotOptimize(out[0]);
+            }
+        }));
+        for (int isa = FrameClassifier::kIsaScalar; isa <= FrameClassifier::BestIsa(); ++isa) {
+            classifier.setIsa(static_cast<FrameClassifier::Isa>(isa));
+            results.push_back(Run(options, std::string("classify/") + FrameClassifier::IsaName(classifier.isa()) + suffix,
+                                  kBurst, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    classifier.classify(&frames[(i % kBursts) * kBurst], kBurst, out.data());
+                    DoNotOptimize(out[0]);
+                }
+            }));
+        }
+
+        // Forwarding rewrites the headers, so every pass restores them first.
+        // Each variant gets its own plane so neither inherits the other's state.
+        std::vector<uint8_t> pristine(storage);
+        for (bool batched : { false, true }) {
+            VirtualClock clock;
+            DataPlane::Config config;
+            memcpy(config.our_mac, our_mac, 6);
+            memcpy(config.gateway_mac, gateway_mac, 6);
+            DataPlane plane(config, nullptr, clock);
+            for (uint32_t i = 0; i < devices; ++i) {
+                DevicePolicy policy = {};
+                WriteMac(policy.mac, ClassifyDeviceKey(i));
+                policy.ip[0] = 10;
+                policy.ip[1] = static_cast<uint8_t>(i >> 16);
+                policy.ip[2] = static_cast<uint8_t>(i >> 8);
+                policy.ip[3] = static_cast<uint8_t>(i);
+                policy.counter_slot = i % TrafficCounters::kMaxSlots;   // nothing reads them here
+                plane.setDevice(policy);
+            }
+            results.push_back(Run(options, std::string("classify/data_plane_") + (batched ? "burst" : "frame") + suffix,
+                                  kBurst, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    size_t first = (i % kBursts) * kBurst;
+                    memcpy(&storage[first * 128], &pristine[first * 128], kBurst * 128);
+                    if (batched) {
+                        plane.processBurst(&frames[first], kBurst);
+                    } else {
+                        for (size_t f = first; f < first + kBurst; ++f) plane.process(frames[f].data, frames[f].length);
+                    }
+                }
+                DoNotOptimize(plane.stats().packets);
+            }));
+        }
+    }
+}
+
+static void BenchMark(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const uint32_t kBurst = 64;
+    const uint32_t kBursts = 64;
+    std::vector<uint8_t> frames;
+    MakeMarkFrames(kBurst * kBursts, 0xD5C1u, frames);
+    std::vector<uint8_t*> headers(kBurst * kBursts);
+    for (size_t i = 0; i < headers.size(); ++i) headers[i] = &frames[i * kMarkFrameSize + 14];
+    // Alternate between two code points so every pass rewrites every header
+    std::vector<uint8_t> dscp[2] = { std::vector<uint8_t>(kBurst, 46), std::vector<uint8_t>(kBurst, 10) };
+
+    results.push_back(Run(options, "mark/dscp_recompute", kBurst, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            uint8_t* const* burst = &headers[(i % kBursts) * kBurst];
+            uint8_t value = dscp[(i / kBursts) & 1][0];
+            for (uint32_t f = 0; f < kBurst; ++f) {
+                uint8_t* ip = burst[f];
+                ip[1] = static_cast<uint8_t>((ip[1] & 0x03) | (value << 2));
+                uint16_t checksum = Ipv4HeaderChecksum(ip, static_cast<size_t>(ip[0] & 0x0F) * 4);
+                ip[10] = static_cast<uint8_t>(checksum >> 8);
+                ip[11] = static_cast<uint8_t>(checksum);
+            }
+        }
+    }));
+    results.push_back(Run(options, "mark/dscp_incremental", kBurst, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            uint8_t* const* burst = &headers[(i % kBursts) * kBurst];
+            uint8_t value = dscp[(i / kBursts) & 1][0];
+            for (uint32_t f = 0; f < kBurst; ++f) MarkIpv4Dscp(burst[f], value);
+        }
+    }));
+    results.push_back(Run(options, "mark/dscp_burst", kBurst, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            MarkIpv4DscpBurst(&headers[(i % kBursts) * kBurst], dscp[(i / kBursts) & 1].data(), kBurst);
+        }
+    }));
+
+    std::vector<uint8_t> tagged(kMarkFrameSize + 4);
+    results.push_back(Run(options, "mark/vlan_insert", kBurst, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            const uint8_t* burst = &frames[(i % kBursts) * kBurst * kMarkFrameSize];
+            for (uint32_t f = 0; f < kBurst; ++f) {
+                InsertVlanTag(burst + f * kMarkFrameSize, kMarkFrameSize, 5, 0, tagged.data());
+                DoNotOptimize(tagged[14]);
+            }
+        }
+    }));
+}
+
+static void BenchWindow(const BenchOptions& options, std::vector<BenchResult>& results) {
+    const uint32_t kBurst = 64;
+    const uint8_t syn_options[8] = { 1, 2, 4, 0x05, 0xB4, 3, 3, 7 };
+    const uint8_t ip_a[4] = { 10, 0, 0, 1 };
+    const uint8_t ip_b[4] = { 10, 9, 0, 1 };
+    std::vector<uint8_t> syns(kBurst * 128), acks(kBurst * 128);
+    for (uint32_t i = 0; i < kBurst; ++i) {
+        MakeTcpFrame(&syns[i * 128], kClassifyOurKey, ClassifyDeviceKey(i), ip_a, ip_b, static_cast<uint16_t>(40000 + i),
+                     443, kTcpSyn, 0xFFFF, syn_options, sizeof(syn_options));
+        MakeTcpFrame(&acks[i * 128], kClassifyOurKey, ClassifyDeviceKey(i), ip_a, ip_b, static_cast<uint16_t>(40000 + i),
+                     443, kTcpAck, 0xFFFF, nullptr, 0);
+    }
+
+    // Each pass puts the MSS and window back up so the clamp always
+    // rewrites; that leaves the checksums stale, which timing does not mind
+    results.push_back(Run(options, "window/syn_mss", kBurst, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            for (uint32_t f = 0; f < kBurst; ++f) {
+                uint8_t* tcp = &syns[f * 128 + 34];
+                TcpSynOptions syn;
+                ParseTcpSynOptions(tcp, 28, syn);
+                ClampTcpMss(tcp, syn.mss_offset, 0);
+                tcp[syn.mss_offset] = 0x05;
+                DoNotOptimize(syn.window_scale);
+            }
+        }
+    }));
+    results.push_back(Run(options, "window/ack_window", kBurst, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            uint32_t window = i & 1 ? 20000 : 40000;
+            for (uint32_t f = 0; f < kBurst; ++f) {
+                uint8_t* tcp = &acks[f * 128 + 34];
+                tcp[14] = 0xFF;
+                ClampTcpWindow(tcp, window, 7);
+            }
+        }
+    }));
+}
+
+static std::string ToJson(const std::vector<BenchResult>& results, bool quick) {
+    std::string json = "{\n  \"suite\": \"netshaper-native\",\n  \"schema\": 1,\n";
+    json += "  \"timestamp\": " + std::to_string(static_cast<long long>(time(nullptr))) + ",\n";
+    json += std::string("  \"quick\": ") + (quick ? "true" : "false") + ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, "
+                 "\"items_per_op\": %llu, \"ns_per_item\": %.3f}%s\n",
+                 r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.min_ns_per_op,
+                 static_cast<unsigned long long>(r.items_per_op), r.ns_per_op / static_cast<double>(r.items_per_op),
+                 (i + 1 < results.size()) ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            options.out_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--filter <substring>] [--out <file.json>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!VerifyFrames() || !VerifyFlowTable() || !VerifyRules() || !VerifyLpm() || !VerifyCaptureFilter() ||
+        !VerifyCaptureProfile() || !VerifyFrameClassifier() || !VerifyPriorityMark() ||
+        !VerifyWindowShaping() || !VerifyAckHandling() || !VerifyNameResolver() ||
+        !VerifyNameDiscovery() || !VerifyDeviceIpMove() || !VerifyCounterSlot() ||
+        !VerifyInventoryRecovery() || !VerifyArpStats()) {
+        return 1;
+    }
+
+    struct Group {
+        const char* name;
+        void (*run)(const BenchOptions&, std::vector<BenchResult>&);
+    };
+    static const Group kGroups[] = {
+        { "frame/", BenchFrames },
+        { "string/", BenchStrings },
+        { "poison_cycle/", BenchPoisonCycle },
+        { "arp_table_diff/", BenchArpDiff },
+        { "device_table_pack/", BenchDeviceTable },
+        { "flow_table/", BenchFlowTable },
+        { "rules/", BenchRules },
+        { "lpm/", BenchLpm },
+        { "classify/", BenchClassify },
+        { "mark/", BenchMark },
+        { "window/", BenchWindow },
+    };
+
+    std::vector<BenchResult> results;
+    for (const Group& group : kGroups) {
+        std::vector<BenchResult> group_results;
+        if (!options.filter.empty() && std::string(group.name).find(options.filter) == std::string::npos &&
+            options.filter.find(group.name) == std::string::npos) {
+            continue;
+        }
+        group.run(options, group_results);
+        for (auto& result : group_results) {
+            if (options.filter.empty() || result.name.find(options.filter) != std::string::npos) {
+                results.push_back(std::move(result));
+            }
+        }
+    }
+
+    std::string json = ToJson(results, options.quick);
+    if (options.out_path.empty()) {
+        fwrite(json.data(), 1, json.size(), stdout);
+    } else {
+        FILE* file = fopen(options.out_path.c_str(), "wb");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.out_path.c_str());
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), file);
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,678 @@
+// Offline capture replay through the data plane
+//
+// Usage:
+//   netshaper_replay <capture.pcap|.pcapng> [options]
+//     --clock original|wall     original: virtual clock follows the capture
+//                               timestamps (default); wall: real time, so
+//                               shaping sees the replay speed
+//     --loops N                 replay the capture N times
+//     --gateway MAC             default: the MAC with the most peers
+//     --our-mac MAC             default: 02:00:00:00:00:01
+//     --limit MAC=DOWN/UP       Mbps per device (0 = unlimited)
+//     --default-limit DOWN/UP   limit for every device without --limit
+//     --block MAC
+//     --rule RULE               port/protocol shaping rule, repeatable; see
+//                               ParseShapingRule (rule_classifier.h)
+//     --destination P[,P...]=ACTION
+//                               destination policy for prefixes P (CIDR);
+//                               ACTION is exempt, block or limit:DOWN/UP
+//     --capture-filter          run frames through the kernel capture filter
+//                               built from the devices and gateway first;
+//                               rejected frames never reach the data plane
+//     --no-profile              skip per-stage timing
+//     --flows N                 track up to N connections and report the
+//                               busiest ones with their handshake RTT
+//     --window-shaping          also shape limited devices' TCP flows through
+//                               their advertised windows (needs --flows)
+//     --clamp-mss N             lower the MSS of TCP SYNs to N
+//     --ack-handling MODE       pure TCP ACKs of limited directions:
+//                               prioritize (default), filter or police.
+//                               Packets are replayed one at a time, so
+//                               filter drops nothing here (see DataPlane)
+//     --check-accuracy PCT      exit 1 if a saturated limited device is off
+//                               its configured rate by more than PCT percent
+//     --out FILE                write the JSON report to FILE (else stdout)
+//
+//   netshaper_replay --synthesize <out.pcap|.pcapng> [--devices N]
+//                    [--seconds S] [--rate-mbps R]
+//     writes a deterministic traffic mix: N devices each offering R Mbps up
+//     and down through one gateway, plus ARP chatter
+//
+// Every non-gateway unicast MAC sending IPv4 becomes a managed device. The
+// report has throughput (Mpps), per-stage cost per packet, drop reasons and,
+// per device, offered vs achieved rate against its limit; with --flows, the
+// flow table counters and the top flows; with --rule and --destination, what
+// each rule and destination policy matched.
+#include "capture_filter.h"
+#include "data_plane.h"
+#include "device_table.h"
+#include "pcap_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+
+struct ReplayOptions {
+    std::string capture_path;
+    bool original_clock = true;
+    uint32_t loops = 1;
+    std::string gateway_mac;
+    std::string our_mac = "02:00:00:00:00:01";
+    std::map<std::string, std::pair<double, double>> limits;
+    bool has_default_limit = false;
+    std::pair<double, double> default_limit{ 0, 0 };
+    std::set<std::string> blocked;
+    std::vector<ShapingRule> rules;
+    std::vector<DestinationPolicy> destinations;
+    bool profile = true;
+    double check_accuracy = -1;
+    uint32_t flows = 0;
+    bool window_shaping = false;
+    uint16_t clamp_mss = 0;
+    AckHandling ack_handling = kAckPrioritize;
+    bool capture_filter = false;
+    std::string out_path;
+
+    std::string synthesize_path;
+    uint32_t synth_devices = 8;
+    double synth_seconds = 10;
+    double synth_rate_mbps = 20;
+};
+
+static std::string FormatMacString(const uint8_t* mac) {
+    char buffer[18];
+    FormatMac(mac, buffer);
+    return std::string(buffer, 17);
+}
+
+static bool ParseLimit(const std::string& text, std::pair<double, double>& limit) {
+    size_t slash = text.find('/');
+    if (slash == std::string::npos) return false;
+    char* end = nullptr;
+    limit.first = strtod(text.c_str(), &end);
+    if (end != text.c_str() + slash) return false;
+    limit.second = strtod(text.c_str() + slash + 1, &end);
+    return *end == '\0' && limit.first >= 0 && limit.second >= 0;
+}
+
+static bool ParseDestination(const std::string& text, DestinationPolicy& policy) {
+    size_t eq = text.rfind('=');
+    if (eq == std::string::npos) return false;
+    std::string action = text.substr(eq + 1);
+    policy.download_mbps = policy.upload_mbps = 0;
+    if (action == "exempt") {
+        policy.action = kRulePrioritize;
+    } else if (action == "block") {
+        policy.action = kRuleBlock;
+    } else if (action.compare(0, 6, "limit:") == 0) {
+        std::pair<double, double> limit;
+        if (!ParseLimit(action.substr(6), limit)) return false;
+        policy.action = kRuleLimit;
+        policy.download_mbps = limit.first;
+        policy.upload_mbps = limit.second;
+    } else {
+        return false;
+    }
+
+    size_t start = 0;
+    while (start < eq) {
+        size_t comma = std::min(text.find(',', start), eq);
+        uint32_t address;
+        uint8_t length;
+        if (!ParseIpv4Prefix(text.substr(start, comma - start), address, length)) return false;
+        policy.prefixes.emplace_back(address, length);
+        start = comma + 1;
+    }
+    return !policy.prefixes.empty();
+}
+
+static bool ParseArgs(int argc, char** argv, ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) return false;
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+
+        if (arg == "--synthesize") {
+            if (!value(options.synthesize_path)) return false;
+        } else if (arg == "--devices" && value(text)) {
+            options.synth_devices = static_cast<uint32_t>(std::max(1, atoi(text.c_str())));
+        } else if (arg == "--seconds" && value(text)) {
+            options.synth_seconds = atof(text.c_str());
+        } else if (arg == "--rate-mbps" && value(text)) {
+            options.synth_rate_mbps = atof(text.c_str());
+        } else if (arg == "--clock" && value(text)) {
+            if (text != "original" && text != "wall") return false;
+            options.original_clock = (text == "original");
+        } else if (arg == "--loops" && value(text)) {
+            options.loops = static_cast<uint32_t>(std::max(1, atoi(text.c_str())));
+        } else if (arg == "--gateway") {
+            if (!value(options.gateway_mac)) return false;
+        } else if (arg == "--our-mac") {
+            if (!value(options.our_mac)) return false;
+        } else if (arg == "--limit" && value(text)) {
+            size_t eq = text.find('=');
+            std::pair<double, double> limit;
+            if (eq == std::string::npos || !ParseLimit(text.substr(eq + 1), limit)) return false;
+            options.limits[text.substr(0, eq)] = limit;
+        } else if (arg == "--default-limit" && value(text)) {
+            if (!ParseLimit(text, options.default_limit)) return false;
+            options.has_default_limit = true;
+        } else if (arg == "--block" && value(text)) {
+            options.blocked.insert(text);
+        } else if (arg == "--rule" && value(text)) {
+            ShapingRule rule;
+            std::string error;
+            if (!ParseShapingRule(text, rule, error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return false;
+            }
+            if (rule.id == 0) rule.id = static_cast<uint32_t>(options.rules.size() + 1);
+            options.rules.push_back(rule);
+        } else if (arg == "--destination" && value(text)) {
+            DestinationPolicy policy;
+            if (!ParseDestination(text, policy)) return false;
+            policy.id = static_cast<uint32_t>(options.destinations.size() + 1);
+            options.destinations.push_back(policy);
+        } else if (arg == "--capture-filter") {
+            options.capture_filter = true;
+        } else if (arg == "--no-profile") {
+            options.profile = false;
+        } else if (arg == "--flows" && value(text)) {
+            options.flows = static_cast<uint32_t>(std::max(0, atoi(text.c_str())));
+        } else if (arg == "--window-shaping") {
+            options.window_shaping = true;
+        } else if (arg == "--clamp-mss" && value(text)) {
+            options.clamp_mss = static_cast<uint16_t>(std::min(65535, std::max(0, atoi(text.c_str()))));
+        } else if (arg == "--ack-handling") {
+            if (!value(text)) return false;
+            if (text == "prioritize") {
+                options.ack_handling = kAckPrioritize;
+            } else if (text == "filter") {
+                options.ack_handling = kAckFilter;
+            } else if (text == "police") {
+                options.ack_handling = kAckPolice;
+            } else {
+                return false;
+            }
+        } else if (arg == "--check-accuracy" && value(text)) {
+            options.check_accuracy = atof(text.c_str());
+        } else if (arg == "--out") {
+            if (!value(options.out_path)) return false;
+        } else if (!arg.empty() && arg[0] != '-' && options.capture_path.empty()) {
+            options.capture_path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.capture_path.empty() || !options.synthesize_path.empty();
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic capture
+
+static size_t BuildIpv4Frame(uint8_t* frame, const uint8_t* dst_mac, const uint8_t* src_mac,
+                             const uint8_t* src_ip, const uint8_t* dst_ip, size_t length) {
+    memset(frame, 0, length);
+    memcpy(frame, dst_mac, 6);
+    memcpy(frame + 6, src_mac, 6);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    uint8_t* ip = frame + 14;
+    uint16_t total_length = static_cast<uint16_t>(length - 14);
+    ip[0] = 0x45;
+    ip[2] = static_cast<uint8_t>(total_length >> 8);
+    ip[3] = static_cast<uint8_t>(total_length & 0xFF);
+    ip[8] = 64;   // TTL
+    ip[9] = 17;   // UDP
+    memcpy(ip + 12, src_ip, 4);
+    memcpy(ip + 16, dst_ip, 4);
+    return length;
+}
+
+static int Synthesize(const ReplayOptions& options) {
+    bool pcapng = options.synthesize_path.size() > 7 &&
+                  options.synthesize_path.compare(options.synthesize_path.size() - 7, 7, ".pcapng") == 0;
+    PcapFileWriter writer;
+    if (!writer.open(options.synthesize_path, pcapng)) {
+        fprintf(stderr, "Cannot write %s\n", options.synthesize_path.c_str());
+        return 1;
+    }
+
+    static const uint8_t kGatewayMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0xFE };
+    static const uint8_t kRemoteIp[4] = { 93, 184, 216, 34 };
+    static const size_t kSizes[] = { 1514, 1514, 590, 1514, 74 };
+    const uint64_t start_ns = 1700000000ULL * 1000000000ULL;
+    const uint64_t end_ns = start_ns + static_cast<uint64_t>(options.synth_seconds * 1e9);
+
+    // One stream per device and direction, merged in timestamp order
+    struct Stream {
+        uint64_t next_ns;
+        uint32_t device;
+        int direction;   // TrafficDirection
+        uint32_t sequence;
+        bool operator>(const Stream& other) const { return next_ns > other.next_ns; }
+    };
+    std::priority_queue<Stream, std::vector<Stream>, std::greater<Stream>> streams;
+    for (uint32_t d = 0; d < options.synth_devices; ++d) {
+        streams.push({ start_ns + d * 1000, d, kTrafficDown, 0 });
+        streams.push({ start_ns + d * 1000 + 500, d, kTrafficUp, 0 });
+    }
+
+    const double bytes_per_ns = options.synth_rate_mbps * 1e6 / 8.0 / 1e9;
+    uint8_t frame[1514];
+    uint64_t written = 0;
+    uint64_t next_arp_ns = start_ns;
+
+    while (!streams.empty()) {
+        Stream stream = streams.top();
+        streams.pop();
+        if (stream.next_ns >= end_ns) continue;
+
+        // ARP broadcast from every device once a second
+        while (next_arp_ns <= stream.next_ns) {
+            for (uint32_t d = 0; d < options.synth_devices; ++d) {
+                uint8_t mac[6] = { 0x02, 0x10, 0x00, 0x00, static_cast<uint8_t>(d >> 8), static_cast<uint8_t>(d) };
+                memset(frame, 0, 60);
+                memset(frame, 0xFF, 6);
+                memcpy(frame + 6, mac, 6);
+                frame[12] = 0x08;
+                frame[13] = 0x06;
+                writer.write(frame, 60, next_arp_ns + d);
+                ++written;
+            }
+            next_arp_ns += 1000000000ULL;
+        }
+
+        uint32_t d = stream.device;
+        uint8_t device_mac[6] = { 0x02, 0x10, 0x00, 0x00, static_cast<uint8_t>(d >> 8), static_cast<uint8_t>(d) };
+        uint8_t device_ip[4] = { 192, 168, static_cast<uint8_t>(50 + d / 200), static_cast<uint8_t>(10 + d % 200) };
+        size_t length = kSizes[(stream.sequence + d) % (sizeof(kSizes) / sizeof(kSizes[0]))];
+
+        if (stream.direction == kTrafficUp) {
+            BuildIpv4Frame(frame, kGatewayMac, device_mac, device_ip, kRemoteIp, length);
+        } else {
+            BuildIpv4Frame(frame, device_mac, kGatewayMac, kRemoteIp, device_ip, length);
+        }
+        writer.write(frame, static_cast<uint32_t>(length), stream.next_ns);
+        ++written;
+
+        stream.next_ns += static_cast<uint64_t>(static_cast<double>(length) / bytes_per_ns);
+        ++stream.sequence;
+        streams.push(stream);
+    }
+
+    writer.close();
+    fprintf(stderr, "Wrote %llu packets to %s\n", static_cast<unsigned long long>(written),
+            options.synthesize_path.c_str());
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+
+struct DiscoveredDevice {
+    uint8_t mac[6];
+    uint8_t ip[4];
+};
+
+// Find the gateway (most distinct peers) and the IPv4 senders behind it
+static bool DiscoverTopology(PcapFileReader& reader, ReplayOptions& options, uint8_t* gateway_mac,
+                             std::vector<DiscoveredDevice>& devices, uint64_t& first_ns, uint64_t& last_ns) {
+    std::map<uint64_t, std::set<uint64_t>> peers;
+    std::map<uint64_t, DiscoveredDevice> senders;
+    PcapFileReader::Packet packet;
+    first_ns = 0;
+    last_ns = 0;
+
+    while (reader.next(packet)) {
+        if (first_ns == 0) first_ns = packet.timestamp_ns;
+        last_ns = std::max(last_ns, packet.timestamp_ns);
+        if (packet.captured_length < 34) continue;
+        const uint8_t* frame = packet.data;
+        if (frame[0] & 0x01) continue;   // broadcast/multicast destination
+        uint64_t dst = MacKey(frame);
+        uint64_t src = MacKey(frame + 6);
+        peers[src].insert(dst);
+        peers[dst].insert(src);
+        if (frame[12] == 0x08 && frame[13] == 0x00 && !senders.count(src)) {
+            DiscoveredDevice device;
+            memcpy(device.mac, frame + 6, 6);
+            memcpy(device.ip, frame + 26, 4);
+            senders[src] = device;
+        }
+    }
+    reader.rewind();
+
+    uint64_t gateway_key = 0;
+    if (!options.gateway_mac.empty()) {
+        if (!ParseMac(options.gateway_mac, gateway_mac)) return false;
+        gateway_key = MacKey(gateway_mac);
+    } else {
+        size_t best = 0;
+        for (const auto& entry : peers) {
+            if (entry.second.size() > best) {
+                best = entry.second.size();
+                gateway_key = entry.first;
+            }
+        }
+        if (best == 0) return false;
+        for (int i = 0; i < 6; ++i) gateway_mac[i] = static_cast<uint8_t>(gateway_key >> (40 - 8 * i));
+        options.gateway_mac = FormatMacString(gateway_mac);
+    }
+
+    for (const auto& entry : senders) {
+        if (entry.first != gateway_key) devices.push_back(entry.second);
+    }
+    return true;
+}
+
+static int Replay(ReplayOptions& options) {
+    PcapFileReader reader;
+    if (!reader.open(options.capture_path)) {
+        fprintf(stderr, "%s\n", reader.getLastError().c_str());
+        return 1;
+    }
+
+    DataPlane::Config config;
+    std::vector<DiscoveredDevice> discovered;
+    uint64_t first_ns = 0, last_ns = 0;
+    if (!ParseMac(options.our_mac, config.our_mac) ||
+        !DiscoverTopology(reader, options, config.gateway_mac, discovered, first_ns, last_ns)) {
+        fprintf(stderr, "Could not determine the gateway; pass --gateway\n");
+        return 1;
+    }
+
+    VirtualClock virtual_clock;
+    SteadyClock steady_clock;
+    const Clock& clock = options.original_clock ? static_cast<const Clock&>(virtual_clock)
+                                                : static_cast<const Clock&>(steady_clock);
+    NullPacketIO io;
+    DataPlane plane(config, &io, clock);
+    plane.setProfiling(options.profile);
+    if (options.flows) plane.setFlowTracking(options.flows);
+    if (!plane.setRules(options.rules) || !plane.setDestinations(options.destinations)) {
+        fprintf(stderr, "%s\n", plane.lastError().c_str());
+        return 1;
+    }
+
+    virtual_clock.set(first_ns);
+    for (const auto& found : discovered) {
+        DevicePolicy policy = {};
+        memcpy(policy.mac, found.mac, 6);
+        memcpy(policy.ip, found.ip, 4);
+        std::string mac = FormatMacString(found.mac);
+        auto limit = options.limits.find(mac);
+        if (limit != options.limits.end()) {
+            policy.download_mbps = limit->second.first;
+            policy.upload_mbps = limit->second.second;
+        } else if (options.has_default_limit) {
+            policy.download_mbps = options.default_limit.first;
+            policy.upload_mbps = options.default_limit.second;
+        }
+        policy.blocked = options.blocked.count(mac) > 0;
+        policy.window_shaping = options.window_shaping;
+        policy.clamp_mss = options.clamp_mss;
+        policy.ack_handling = options.ack_handling;
+        policy.counter_slot = GetTrafficCounters().acquireSlot();   // as its TrafficControl would
+        plane.setDevice(policy);
+    }
+
+    std::vector<BpfInstruction> filter;
+    if (options.capture_filter) {
+        std::vector<uint64_t> macs = { MacKey(config.gateway_mac) };
+        for (const auto& found : discovered) macs.push_back(MacKey(found.mac));
+        filter = BuildCaptureFilter(macs, 65536);
+    }
+    uint64_t filtered = 0;
+
+    // The loop period: capture span plus one average packet gap, so looped
+    // timestamps keep increasing
+    uint64_t span_ns = last_ns > first_ns ? last_ns - first_ns : 0;
+    std::vector<uint8_t> buffer(65536);
+    uint64_t capture_ticks = 0;
+    uint64_t packets_per_loop = 0;
+    PcapFileReader::Packet packet;
+
+    auto wall_start = std::chrono::steady_clock::now();
+    for (uint32_t loop = 0; loop < options.loops; ++loop) {
+        uint64_t loop_offset = loop * (span_ns + (packets_per_loop ? span_ns / packets_per_loop : 0));
+        for (;;) {
+            uint64_t t0 = options.profile ? ReadCycleClock() : 0;
+            if (!reader.next(packet)) break;
+            if (loop == 0) ++packets_per_loop;
+            // What the kernel would drop is never copied
+            if (!filter.empty() && !RunCaptureFilter(filter, packet.data, packet.captured_length)) {
+                ++filtered;
+                if (options.profile) capture_ticks += ReadCycleClock() - t0;
+                continue;
+            }
+            size_t length = std::min<size_t>(packet.captured_length, buffer.size());
+            memcpy(buffer.data(), packet.data, length);
+            if (options.profile) capture_ticks += ReadCycleClock() - t0;
+
+            virtual_clock.set(packet.timestamp_ns + loop_offset);
+            plane.process(buffer.data(), length, packet.original_length);
+        }
+        reader.rewind();
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    const DataPlane::Stats& stats = plane.stats();
+    double traffic_seconds = options.original_clock
+        ? static_cast<double>(span_ns) * options.loops / 1e9
+        : wall_seconds;
+    if (traffic_seconds <= 0) traffic_seconds = 1e-9;
+
+    // Report
+    std::string json = "{\n";
+    char line[1024];
+    snprintf(line, sizeof(line),
+             "  \"capture\": \"%s\",\n  \"format\": \"%s\",\n  \"clock\": \"%s\",\n  \"loops\": %u,\n"
+             "  \"gateway\": \"%s\",\n  \"packets\": %llu,\n  \"bytes\": %llu,\n  \"skipped\": %llu,\n"
+             "  \"filtered\": %llu,\n  \"marked\": %llu,\n  \"windows_clamped\": %llu,\n  \"mss_clamped\": %llu,\n"
+             "  \"acks_prioritized\": %llu,\n"
+             "  \"wall_seconds\": %.6f,\n  \"traffic_seconds\": %.6f,\n  \"mpps\": %.3f,\n  \"gbps\": %.3f,\n",
+             options.capture_path.c_str(), reader.isPcapng() ? "pcapng" : "pcap",
+             options.original_clock ? "original" : "wall", options.loops, options.gateway_mac.c_str(),
+             static_cast<unsigned long long>(stats.packets), static_cast<unsigned long long>(stats.bytes),
+             static_cast<unsigned long long>(reader.skippedPackets()),
+             static_cast<unsigned long long>(filtered), static_cast<unsigned long long>(stats.marked),
+             static_cast<unsigned long long>(stats.windows_clamped), static_cast<unsigned long long>(stats.mss_clamped),
+             static_cast<unsigned long long>(stats.acks_prioritized),
+             wall_seconds, traffic_seconds,
+             stats.packets / wall_seconds / 1e6, stats.bytes * 8.0 / wall_seconds / 1e9);
+    json += line;
+
+    json += "  \"stages\": {";
+    if (options.profile && stats.packets) {
+        double ticks_per_ns = CycleClockTicksPerNs();
+        uint64_t ticks[kStageCount] = { capture_ticks, stats.stage_ticks[kStageClassify],
+                                        stats.stage_ticks[kStageShape], stats.stage_ticks[kStageForward] };
+        for (int stage = 0; stage < kStageCount; ++stage) {
+            double per_packet = static_cast<double>(ticks[stage]) / static_cast<double>(stats.packets);
+            snprintf(line, sizeof(line), "%s\n    \"%s\": {\"ticks_per_packet\": %.1f, \"ns_per_packet\": %.1f}",
+                     stage ? "," : "", LatencyStageName(static_cast<LatencyStage>(stage)),
+                     per_packet, per_packet / ticks_per_ns);
+            json += line;
+        }
+        json += "\n  ";
+    }
+    json += "},\n  \"drops\": {";
+    bool first = true;
+    for (int reason = 1; reason < kDropReasonCount; ++reason) {
+        if (!stats.drops[reason]) continue;
+        snprintf(line, sizeof(line), "%s\"%s\": %llu", first ? "" : ", ",
+                 DropReasonName(static_cast<DropReason>(reason)),
+                 static_cast<unsigned long long>(stats.drops[reason]));
+        json += line;
+        first = false;
+    }
+    json += "},\n  \"devices\": [";
+
+    int accuracy_failures = 0;
+    std::vector<DevicePolicy> policies = plane.devices();
+    std::sort(policies.begin(), policies.end(), [](const DevicePolicy& a, const DevicePolicy& b) {
+        return memcmp(a.mac, b.mac, 6) < 0;
+    });
+    for (size_t i = 0; i < policies.size(); ++i) {
+        const DevicePolicy& policy = policies[i];
+        DataPlane::DeviceStats device_stats;
+        plane.deviceStats(policy.mac, device_stats);
+        char ip[16];
+        FormatIpv4(policy.ip, ip);
+
+        json += i ? ",\n    {" : "\n    {";
+        snprintf(line, sizeof(line), "\"mac\": \"%s\", \"ip\": \"%s\", \"blocked\": %s",
+                 FormatMacString(policy.mac).c_str(), ip, policy.blocked ? "true" : "false");
+        json += line;
+
+        const double limits[2] = { policy.download_mbps, policy.upload_mbps };
+        const char* names[2] = { "down", "up" };
+        for (int d = 0; d < 2; ++d) {
+            double offered = device_stats.offered_bytes[d] * 8.0 / traffic_seconds / 1e6;
+            double achieved = device_stats.forwarded_bytes[d] * 8.0 / traffic_seconds / 1e6;
+            double expected = limits[d] > 0 ? std::min(limits[d], offered) : offered;
+            double accuracy = expected > 0 ? achieved / expected : 1.0;
+            snprintf(line, sizeof(line),
+                     ", \"%s\": {\"limit_mbps\": %.3f, \"offered_mbps\": %.3f, \"achieved_mbps\": %.3f, "
+                     "\"accuracy\": %.4f, \"dropped_packets\": %llu}",
+                     names[d], limits[d], offered, achieved, accuracy,
+                     static_cast<unsigned long long>(device_stats.dropped_packets[d]));
+            json += line;
+
+            // Only saturated, limited, unblocked directions say anything
+            // about shaping accuracy
+            if (options.check_accuracy >= 0 && limits[d] > 0 && !policy.blocked && offered > limits[d] * 1.1 &&
+                std::fabs(accuracy - 1.0) * 100.0 > options.check_accuracy) {
+                fprintf(stderr, "Shaping accuracy: %s %s achieved %.3f Mbps for a %.3f Mbps limit\n",
+                        FormatMacString(policy.mac).c_str(), names[d], achieved, limits[d]);
+                ++accuracy_failures;
+            }
+        }
+        json += "}";
+    }
+    json += policies.empty() ? "]" : "\n  ]";
+
+    if (!options.rules.empty()) {
+        const std::vector<ShapingRule>& rules = plane.rules().rules();
+        snprintf(line, sizeof(line), ",\n  \"rules\": {\"tuples\": %zu, \"entries\": %zu, \"matched\": [",
+                 plane.rules().tupleCount(), plane.rules().entryCount());
+        json += line;
+        for (size_t i = 0; i < rules.size(); ++i) {
+            DataPlane::RuleStats rule_stats;
+            plane.ruleStats(rules[i].id, rule_stats);
+            snprintf(line, sizeof(line),
+                     "%s\n    {\"id\": %u, \"action\": \"%s\", \"packets\": %llu, \"forwarded_bytes\": %llu, "
+                     "\"dropped_packets\": %llu}",
+                     i ? "," : "", rules[i].id, RuleActionName(rules[i].action),
+                     static_cast<unsigned long long>(rule_stats.matched_packets[kTrafficDown] +
+                                                     rule_stats.matched_packets[kTrafficUp]),
+                     static_cast<unsigned long long>(rule_stats.forwarded_bytes[kTrafficDown] +
+                                                     rule_stats.forwarded_bytes[kTrafficUp]),
+                     static_cast<unsigned long long>(rule_stats.dropped_packets[kTrafficDown] +
+                                                     rule_stats.dropped_packets[kTrafficUp]));
+            json += line;
+        }
+        json += "\n  ]}";
+    }
+
+    if (!options.destinations.empty()) {
+        json += ",\n  \"destinations\": [";
+        for (size_t i = 0; i < options.destinations.size(); ++i) {
+            const DestinationPolicy& policy = options.destinations[i];
+            DataPlane::RuleStats policy_stats;
+            plane.destinationStats(policy.id, policy_stats);
+            snprintf(line, sizeof(line),
+                     "%s\n    {\"id\": %u, \"action\": \"%s\", \"prefixes\": %zu, \"packets\": %llu, "
+                     "\"forwarded_bytes\": %llu, \"dropped_packets\": %llu}",
+                     i ? "," : "", policy.id, policy.action == kRulePrioritize ? "exempt" : RuleActionName(policy.action),
+                     policy.prefixes.size(),
+                     static_cast<unsigned long long>(policy_stats.matched_packets[kTrafficDown] +
+                                                     policy_stats.matched_packets[kTrafficUp]),
+                     static_cast<unsigned long long>(policy_stats.forwarded_bytes[kTrafficDown] +
+                                                     policy_stats.forwarded_bytes[kTrafficUp]),
+                     static_cast<unsigned long long>(policy_stats.dropped_packets[kTrafficDown] +
+                                                     policy_stats.dropped_packets[kTrafficUp]));
+            json += line;
+        }
+        json += "\n  ]";
+    }
+
+    if (const FlowTable* flows = plane.flows()) {
+        const FlowTable::Stats& flow_stats = flows->stats();
+        snprintf(line, sizeof(line),
+                 ",\n  \"flows\": {\"active\": %zu, \"capacity\": %zu, \"inserts\": %llu, \"insert_failures\": %llu, "
+                 "\"displacements\": %llu, \"expired\": %llu, \"top\": [",
+                 flows->size(), flows->capacity(), static_cast<unsigned long long>(flow_stats.inserts),
+                 static_cast<unsigned long long>(flow_stats.insert_failures),
+                 static_cast<unsigned long long>(flow_stats.displacements),
+                 static_cast<unsigned long long>(flow_stats.expired));
+        json += line;
+        std::vector<FlowEntry> top = flows->topFlows(10);
+        for (size_t i = 0; i < top.size(); ++i) {
+            const FlowEntry& flow = top[i];
+            uint8_t a[4], b[4];
+            for (int k = 0; k < 4; ++k) {
+                a[k] = static_cast<uint8_t>(flow.key.ip_a >> (24 - 8 * k));
+                b[k] = static_cast<uint8_t>(flow.key.ip_b >> (24 - 8 * k));
+            }
+            char ip_a[16], ip_b[16];
+            FormatIpv4(a, ip_a);
+            FormatIpv4(b, ip_b);
+            snprintf(line, sizeof(line),
+                     "%s\n    {\"a\": \"%s:%u\", \"b\": \"%s:%u\", \"protocol\": %u, \"bytes_down\": %llu, "
+                     "\"bytes_up\": %llu, \"packets\": %llu, \"rtt_us\": %.1f}",
+                     i ? "," : "", ip_a, flow.key.port_a, ip_b, flow.key.port_b, flow.key.protocol,
+                     static_cast<unsigned long long>(flow.bytes[kTrafficDown]),
+                     static_cast<unsigned long long>(flow.bytes[kTrafficUp]),
+                     static_cast<unsigned long long>(flow.packets[kTrafficDown] + flow.packets[kTrafficUp]),
+                     flow.rtt_ns / 1e3);
+            json += line;
+        }
+        json += top.empty() ? "]}" : "\n  ]}";
+    }
+    json += "\n}\n";
+
+    if (options.out_path.empty()) {
+        fwrite(json.data(), 1, json.size(), stdout);
+    } else {
+        FILE* file = fopen(options.out_path.c_str(), "wb");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.out_path.c_str());
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), file);
+        fclose(file);
+    }
+
+    fprintf(stderr, "%llu packets in %.3f s (%.2f Mpps), %llu forwarded, %zu devices\n",
+            static_cast<unsigned long long>(stats.packets), wall_seconds, stats.packets / wall_seconds / 1e6,
+            static_cast<unsigned long long>(stats.forwarded), policies.size());
+    return accuracy_failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s <capture> [--clock original|wall] [--loops N] [--gateway MAC] [--our-mac MAC]\n"
+                "          [--limit MAC=DOWN/UP] [--default-limit DOWN/UP] [--block MAC] [--no-profile]\n"
+                "          [--flows N] [--rule RULE] [--destination P[,P...]=ACTION] [--check-accuracy PCT]\n"
+                "          [--window-shaping] [--clamp-mss N]\n"
+                "          [--ack-handling prioritize|filter|police] [--out FILE]\n"
+                "       %s --synthesize <out.pcap|out.pcapng> [--devices N] [--seconds S] [--rate-mbps R]\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+    return options.synthesize_path.empty() ? Replay(options) : Synthesize(options);
+}
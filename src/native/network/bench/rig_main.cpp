@@ -0,0 +1,749 @@
+// End-to-end relay rig over real interfaces (Linux, run by tools/netns_bench.sh)
+//
+// Four roles, each bound to AF_PACKET sockets in its own namespace:
+//
+//   netshaper_rig client --if IF --dst-mac MAC [--devices N] [--seconds S]
+//                        [--rate-mbps R] [--size BYTES] [--label TEXT] [--out FILE]
+//     Sends UDP frames from N device MACs (02:10:00:00:hi:lo, 10.77.x.y) to
+//     dst-mac, round robin, paced to R Mbps in total (0 = as fast as the
+//     socket takes them). Each frame carries a send timestamp; echoes coming
+//     back give throughput, RTT and jitter.
+//
+//   netshaper_rig relay --down IF --up IF --gateway-mac MAC
+//                       [--default-limit DOWN/UP] [--no-profile] [--out FILE]
+//                       [--backend packet|uring|xdp|xdp-generic] [--devices N]
+//                       [--classify frame|burst]
+//     The NetShaper host: frames arriving on either interface go through the
+//     DataPlane and leave on the interface facing their destination. Devices
+//     are added as they first send upstream. Runs until SIGINT/SIGTERM, then
+//     writes its stats. Frames are received a burst at a time; --classify
+//     burst also hands the burst to DataPlane::processBurst() instead of
+//     process() per frame. The uring backend drives AF_PACKET through io_uring
+//     (uring_packet_io.h). The xdp backends use AF_XDP sockets
+//     (xdp_socket_io.h); their XDP program only passes managed MACs up, so
+//     the relay registers the gateway and the client's N device MACs in
+//     advance.
+//
+//   netshaper_rig gateway --if IF
+//     Echoes every IPv4 frame back to its sender with addresses swapped.
+//     Runs until SIGINT/SIGTERM.
+//
+//   netshaper_rig io --if IF --rx IF [--seconds S] [--size BYTES] [--out FILE]
+//     Socket cost alone, one thread, no DataPlane: sends bursts of 64 frames
+//     out of --if and drains them from --rx (the other end of a veth pair),
+//     for S seconds per backend: send()/recv() per frame, sendmmsg/recvmmsg
+//     64 at a time, and io_uring. Reports frames per second, thread CPU and
+//     syscalls per frame (one frame = one send plus one receive).
+//
+// Reports are JSON. Both ends of the relay interfaces must carry the same MAC
+// (the relay's "our MAC"), as a poisoning host uses one MAC on the LAN.
+#include "data_plane.h"
+#include "device_table.h"
+#include "latency_histogram.h"
+#include "packet_io.h"
+#include "uring_packet_io.h"
+#include "xdp_socket_io.h"
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+static const size_t kEthernetHeaderSize = 14;
+static const size_t kIpv4HeaderSize = 20;
+static const size_t kUdpHeaderSize = 8;
+static const size_t kPayloadOffset = kEthernetHeaderSize + kIpv4HeaderSize + kUdpHeaderSize;
+static const uint32_t kMagic = 0x4E535247;   // "NSRG"
+static const int kBurst = 64;
+
+static std::atomic<bool> g_stop{ false };
+
+static void OnSignal(int) {
+    g_stop.store(true);
+}
+
+static uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static bool WriteReport(const std::string& path, const std::string& json) {
+    if (path.empty()) {
+        fwrite(json.data(), 1, json.size(), stdout);
+        return true;
+    }
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    fwrite(json.data(), 1, json.size(), file);
+    fclose(file);
+    return true;
+}
+
+static std::string FormatMacString(const uint8_t* mac) {
+    char buffer[18];
+    FormatMac(mac, buffer);
+    return std::string(buffer, 17);
+}
+
+// Options shared by all roles; each role reads what it needs
+struct RigOptions {
+    std::string role;
+    std::string interface_name;
+    std::string rx_interface;
+    std::string down_interface;
+    std::string up_interface;
+    std::string dst_mac;
+    std::string gateway_mac;
+    uint32_t devices = 1;
+    double seconds = 5;
+    double rate_mbps = 0;
+    size_t frame_size = 1400;
+    std::string label;
+    bool has_limit = false;
+    double download_mbps = 0;
+    double upload_mbps = 0;
+    bool profile = true;
+    bool burst_classify = false;
+    std::string backend = "packet";
+    std::string out_path;
+};
+
+static bool ParseArgs(int argc, char** argv, RigOptions& options) {
+    if (argc < 2) return false;
+    options.role = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) return false;
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+
+        if (arg == "--if") {
+            if (!value(options.interface_name)) return false;
+        } else if (arg == "--rx") {
+            if (!value(options.rx_interface)) return false;
+        } else if (arg == "--down") {
+            if (!value(options.down_interface)) return false;
+        } else if (arg == "--up") {
+            if (!value(options.up_interface)) return false;
+        } else if (arg == "--dst-mac") {
+            if (!value(options.dst_mac)) return false;
+        } else if (arg == "--gateway-mac") {
+            if (!value(options.gateway_mac)) return false;
+        } else if (arg == "--devices" && value(text)) {
+            options.devices = static_cast<uint32_t>(std::min(65000, std::max(1, atoi(text.c_str()))));
+        } else if (arg == "--seconds" && value(text)) {
+            options.seconds = atof(text.c_str());
+        } else if (arg == "--rate-mbps" && value(text)) {
+            options.rate_mbps = atof(text.c_str());
+        } else if (arg == "--size" && value(text)) {
+            options.frame_size = static_cast<size_t>(std::min(1514, std::max(64, atoi(text.c_str()))));
+        } else if (arg == "--label") {
+            if (!value(options.label)) return false;
+        } else if (arg == "--default-limit" && value(text)) {
+            if (sscanf(text.c_str(), "%lf/%lf", &options.download_mbps, &options.upload_mbps) != 2) return false;
+            options.has_limit = true;
+        } else if (arg == "--no-profile") {
+            options.profile = false;
+        } else if (arg == "--classify") {
+            if (!value(text) || (text != "frame" && text != "burst")) return false;
+            options.burst_classify = text == "burst";
+        } else if (arg == "--backend") {
+            if (!value(options.backend)) return false;
+            if (options.backend != "packet" && options.backend != "uring" && options.backend != "xdp" &&
+                options.backend != "xdp-generic") {
+                return false;
+            }
+        } else if (arg == "--out") {
+            if (!value(options.out_path)) return false;
+        } else {
+            return false;
+        }
+    }
+    if (options.role == "client") return !options.interface_name.empty() && !options.dst_mac.empty();
+    if (options.role == "relay") {
+        return !options.down_interface.empty() && !options.up_interface.empty() && !options.gateway_mac.empty();
+    }
+    if (options.role == "gateway") return !options.interface_name.empty();
+    if (options.role == "io") return !options.interface_name.empty() && !options.rx_interface.empty();
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Client
+
+static void DeviceAddress(uint32_t index, uint8_t* mac, uint8_t* ip) {
+    uint32_t n = index + 1;
+    const uint8_t device_mac[6] = { 0x02, 0x10, 0x00, 0x00, static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n & 0xFF) };
+    memcpy(mac, device_mac, 6);
+    uint32_t host = 10 + index;
+    const uint8_t device_ip[4] = { 10, 77, static_cast<uint8_t>(host >> 8), static_cast<uint8_t>(host & 0xFF) };
+    memcpy(ip, device_ip, 4);
+}
+
+static void BuildProbeFrame(uint8_t* frame, size_t size, const uint8_t* dst_mac, uint32_t device) {
+    static const uint8_t kRemoteIp[4] = { 10, 78, 0, 1 };
+    uint8_t mac[6], ip[4];
+    DeviceAddress(device, mac, ip);
+    memset(frame, 0, size);
+
+    memcpy(frame, dst_mac, 6);
+    memcpy(frame + 6, mac, 6);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+
+    uint8_t* l3 = frame + kEthernetHeaderSize;
+    size_t ip_length = size - kEthernetHeaderSize;
+    l3[0] = 0x45;
+    l3[2] = static_cast<uint8_t>(ip_length >> 8);
+    l3[3] = static_cast<uint8_t>(ip_length & 0xFF);
+    l3[8] = 64;
+    l3[9] = 17;
+    memcpy(l3 + 12, ip, 4);
+    memcpy(l3 + 16, kRemoteIp, 4);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < kIpv4HeaderSize; i += 2) sum += static_cast<uint32_t>((l3[i] << 8) | l3[i + 1]);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    l3[10] = static_cast<uint8_t>((~sum >> 8) & 0xFF);
+    l3[11] = static_cast<uint8_t>(~sum & 0xFF);
+
+    uint8_t* l4 = l3 + kIpv4HeaderSize;
+    size_t udp_length = ip_length - kIpv4HeaderSize;
+    l4[0] = 0xC3; l4[1] = 0x50;     // 50000
+    l4[2] = 0x13; l4[3] = 0x89;     // 5001
+    l4[4] = static_cast<uint8_t>(udp_length >> 8);
+    l4[5] = static_cast<uint8_t>(udp_length & 0xFF);
+
+    memcpy(frame + kPayloadOffset, &kMagic, 4);
+    memcpy(frame + kPayloadOffset + 4, &device, 4);
+}
+
+static int RunClient(const RigOptions& options) {
+    uint8_t dst_mac[6];
+    if (!ParseMac(options.dst_mac, dst_mac)) {
+        fprintf(stderr, "Invalid --dst-mac %s\n", options.dst_mac.c_str());
+        return 2;
+    }
+    PacketSocketIO io;
+    if (!io.open(options.interface_name, true)) {
+        fprintf(stderr, "%s\n", io.lastError().c_str());
+        return 1;
+    }
+
+    size_t size = std::max(options.frame_size, kPayloadOffset + 24);
+    std::vector<std::vector<uint8_t>> frames(options.devices, std::vector<uint8_t>(size));
+    for (uint32_t i = 0; i < options.devices; ++i) {
+        BuildProbeFrame(frames[i].data(), size, dst_mac, i);
+    }
+
+    LatencyHistogram rtt;
+    std::vector<uint64_t> received_bytes(options.devices, 0);
+    uint64_t sent = 0, send_failures = 0, received = 0, total_received_bytes = 0;
+    uint64_t last_rtt = 0, jitter_sum = 0, jitter_samples = 0;
+    uint8_t buffer[2048];
+
+    auto drain = [&]() {
+        uint64_t timestamp = 0;
+        size_t length;
+        int budget = kBurst;
+        while (budget-- > 0 && (length = io.receive(buffer, sizeof(buffer), timestamp)) > 0) {
+            uint32_t magic = 0, device = 0;
+            uint64_t sent_ns = 0;
+            if (length < kPayloadOffset + 24) continue;
+            memcpy(&magic, buffer + kPayloadOffset, 4);
+            memcpy(&device, buffer + kPayloadOffset + 4, 4);
+            memcpy(&sent_ns, buffer + kPayloadOffset + 16, 8);
+            if (magic != kMagic || device >= options.devices || timestamp < sent_ns) continue;
+
+            uint64_t sample = timestamp - sent_ns;
+            rtt.record(sample);
+            if (received > 0) {
+                jitter_sum += sample > last_rtt ? sample - last_rtt : last_rtt - sample;
+                ++jitter_samples;
+            }
+            last_rtt = sample;
+            ++received;
+            received_bytes[device] += length;
+            total_received_bytes += length;
+        }
+    };
+
+    double interval_ns = options.rate_mbps > 0 ? size * 8.0 * 1000.0 / options.rate_mbps : 0.0;
+    uint64_t start = NowNs();
+    uint64_t end = start + static_cast<uint64_t>(options.seconds * 1e9);
+    double next_send = static_cast<double>(start);
+    uint32_t device = 0;
+
+    while (!g_stop.load()) {
+        uint64_t now = NowNs();
+        if (now >= end) break;
+        if (interval_ns <= 0 || static_cast<double>(now) >= next_send) {
+            std::vector<uint8_t>& frame = frames[device];
+            uint64_t seq = sent;
+            memcpy(frame.data() + kPayloadOffset + 8, &seq, 8);
+            memcpy(frame.data() + kPayloadOffset + 16, &now, 8);
+            if (io.send(frame.data(), frame.size())) ++sent; else ++send_failures;
+            device = (device + 1) % options.devices;
+            next_send += interval_ns;
+        }
+        drain();
+    }
+    uint64_t send_end = NowNs();
+    // Collect echoes still in flight
+    while (NowNs() < send_end + 300000000ULL) drain();
+
+    double seconds = static_cast<double>(send_end - start) / 1e9;
+    LatencySummary summary = rtt.summarize();
+    double min_device = 0, max_device = 0, sum_device = 0;
+    for (uint32_t i = 0; i < options.devices; ++i) {
+        double mbps = received_bytes[i] * 8.0 / seconds / 1e6;
+        min_device = i ? std::min(min_device, mbps) : mbps;
+        max_device = std::max(max_device, mbps);
+        sum_device += mbps;
+    }
+
+    char json[2048];
+    snprintf(json, sizeof(json),
+             "{\n  \"role\": \"client\",\n  \"label\": \"%s\",\n  \"devices\": %u,\n  \"frame_size\": %zu,\n"
+             "  \"seconds\": %.3f,\n  \"target_mbps\": %.3f,\n  \"sent\": %llu,\n  \"send_failures\": %llu,\n"
+             "  \"received\": %llu,\n  \"loss\": %.6f,\n  \"offered_mbps\": %.3f,\n  \"achieved_mbps\": %.3f,\n"
+             "  \"per_device_mbps\": {\"min\": %.3f, \"mean\": %.3f, \"max\": %.3f},\n"
+             "  \"rtt_us\": {\"count\": %llu, \"mean\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f},\n"
+             "  \"jitter_us\": %.2f\n}\n",
+             options.label.c_str(), options.devices, size, seconds, options.rate_mbps,
+             static_cast<unsigned long long>(sent), static_cast<unsigned long long>(send_failures),
+             static_cast<unsigned long long>(received), sent ? 1.0 - static_cast<double>(received) / sent : 0.0,
+             sent * size * 8.0 / seconds / 1e6, total_received_bytes * 8.0 / seconds / 1e6,
+             min_device, sum_device / options.devices, max_device,
+             static_cast<unsigned long long>(summary.count), summary.mean_ms * 1000.0, summary.p50_ms * 1000.0,
+             summary.p90_ms * 1000.0, summary.p99_ms * 1000.0, summary.max_ms * 1000.0,
+             jitter_samples ? jitter_sum / 1000.0 / jitter_samples : 0.0);
+    fprintf(stderr, "%s: %u devices, %.1f Mbps achieved, loss %.4f, RTT p50 %.1f us, p99 %.1f us\n",
+            options.label.c_str(), options.devices, total_received_bytes * 8.0 / seconds / 1e6,
+            sent ? 1.0 - static_cast<double>(received) / sent : 0.0,
+            summary.p50_ms * 1000.0, summary.p99_ms * 1000.0);
+    return WriteReport(options.out_path, json) ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Relay
+
+// Sends each forwarded frame out of the interface facing its destination
+class RelayIO : public PacketIO {
+public:
+    RelayIO(PacketIO& down, PacketIO& up, const uint8_t* gateway_mac)
+        : down_(down), up_(up), gateway_key_(MacKey(gateway_mac)) {}
+
+    bool send(const uint8_t* frame, size_t length) override {
+        return MacKey(frame) == gateway_key_ ? up_.send(frame, length) : down_.send(frame, length);
+    }
+    std::string lastError() const override { return down_.lastError() + " / " + up_.lastError(); }
+
+private:
+    PacketIO& down_;
+    PacketIO& up_;
+    uint64_t gateway_key_;
+};
+
+// AF_XDP and io_uring queue sends until flushed; AF_PACKET sends right away
+static void FlushSends(PacketSocketIO&) {}
+static void FlushSends(UringPacketIO& io) {
+    io.flush();
+}
+static void FlushSends(XdpSocketIO& io) {
+    io.flush();
+}
+
+template <typename Socket>
+static int RunRelayOver(const RigOptions& options, DataPlane::Config config, Socket& down, Socket& up) {
+    memcpy(config.our_mac, down.interfaceMac(), 6);
+
+    SteadyClock clock;
+    RelayIO io(down, up, config.gateway_mac);
+    DataPlane plane(config, &io, clock);
+    plane.setProfiling(options.profile);
+
+    std::unordered_set<uint64_t> known;
+    uint64_t gateway_key = MacKey(config.gateway_mac);
+    std::vector<uint8_t> buffers(kBurst * 2048);
+    ReceivedFrame frames[kBurst];
+    for (int i = 0; i < kBurst; ++i) {
+        frames[i].data = &buffers[static_cast<size_t>(i) * 2048];
+        frames[i].capacity = 2048;
+    }
+    struct pollfd fds[2] = { { down.fd(), POLLIN, 0 }, { up.fd(), POLLIN, 0 } };
+    Socket* sockets[2] = { &down, &up };
+    uint64_t start = NowNs();
+
+    while (!g_stop.load()) {
+        if (poll(fds, 2, 100) <= 0) continue;
+        for (int s = 0; s < 2; ++s) {
+            size_t count = sockets[s]->receiveBurst(frames, kBurst);
+            // Adopt new devices the first time they send upstream
+            for (size_t i = 0; s == 0 && i < count; ++i) {
+                const uint8_t* frame = frames[i].data;
+                if (frames[i].length < kEthernetHeaderSize + kIpv4HeaderSize || frame[12] != 0x08 ||
+                    frame[13] != 0x00) {
+                    continue;
+                }
+                uint64_t key = MacKey(frame + 6);
+                if (key != gateway_key && known.insert(key).second) {
+                    DevicePolicy policy = {};
+                    memcpy(policy.mac, frame + 6, 6);
+                    memcpy(policy.ip, frame + kEthernetHeaderSize + 12, 4);
+                    policy.download_mbps = options.download_mbps;
+                    policy.upload_mbps = options.upload_mbps;
+                    policy.counter_slot = GetTrafficCounters().acquireSlot();   // as its TrafficControl would
+                    plane.setDevice(policy);
+                }
+            }
+            if (options.burst_classify) {
+                plane.processBurst(frames, count);
+            } else {
+                for (size_t i = 0; i < count; ++i) plane.process(frames[i].data, frames[i].length);
+            }
+        }
+        FlushSends(down);
+        FlushSends(up);
+    }
+
+    double seconds = static_cast<double>(NowNs() - start) / 1e9;
+    const DataPlane::Stats& stats = plane.stats();
+    std::string json = "{\n  \"role\": \"relay\",\n  \"backend\": \"" + options.backend + "\",\n";
+    json += std::string("  \"classify\": \"") + (options.burst_classify ? "burst" : "frame") + "\",\n";
+    char line[512];
+    snprintf(line, sizeof(line),
+             "  \"our_mac\": \"%s\",\n  \"devices\": %zu,\n  \"limit_mbps\": {\"down\": %.3f, \"up\": %.3f},\n"
+             "  \"seconds\": %.3f,\n  \"packets\": %llu,\n  \"forwarded\": %llu,\n  \"drops\": {",
+             FormatMacString(config.our_mac).c_str(), known.size(), options.download_mbps, options.upload_mbps,
+             seconds, static_cast<unsigned long long>(stats.packets), static_cast<unsigned long long>(stats.forwarded));
+    json += line;
+    for (int reason = kDropMalformed; reason < kDropReasonCount; ++reason) {
+        snprintf(line, sizeof(line), "%s\"%s\": %llu", reason == kDropMalformed ? "" : ", ",
+                 DropReasonName(static_cast<DropReason>(reason)),
+                 static_cast<unsigned long long>(stats.drops[reason]));
+        json += line;
+    }
+    json += "},\n  \"stage_ns_per_packet\": {";
+    for (int stage = kStageClassify; stage <= kStageForward; ++stage) {
+        double ns = stats.profiled_packets
+            ? CycleClockToNs(stats.stage_ticks[stage]) / static_cast<double>(stats.profiled_packets) : 0.0;
+        snprintf(line, sizeof(line), "%s\"%s\": %.1f", stage == kStageClassify ? "" : ", ",
+                 LatencyStageName(static_cast<LatencyStage>(stage)), ns);
+        json += line;
+    }
+    json += "}\n}\n";
+    return WriteReport(options.out_path, json) ? 0 : 1;
+}
+
+static int RunRelay(const RigOptions& options) {
+    DataPlane::Config config;
+    if (!ParseMac(options.gateway_mac, config.gateway_mac)) {
+        fprintf(stderr, "Invalid --gateway-mac %s\n", options.gateway_mac.c_str());
+        return 2;
+    }
+    if (options.backend == "packet") {
+        PacketSocketIO down, up;
+        if (!down.open(options.down_interface) || !up.open(options.up_interface)) {
+            fprintf(stderr, "%s%s\n", down.lastError().c_str(), up.lastError().c_str());
+            return 1;
+        }
+        return RunRelayOver(options, config, down, up);
+    }
+    if (options.backend == "uring") {
+        UringPacketIO down, up;
+        if (!down.open(options.down_interface) || !up.open(options.up_interface)) {
+            fprintf(stderr, "%s%s\n", down.lastError().c_str(), up.lastError().c_str());
+            return 1;
+        }
+        return RunRelayOver(options, config, down, up);
+    }
+
+    XdpSocketOptions xdp;
+    xdp.mode = options.backend == "xdp-generic" ? kXdpAttachGeneric : kXdpAttachAuto;
+    std::vector<uint64_t> devices;
+    uint8_t mac[6], ip[4];
+    for (uint32_t i = 0; i < options.devices; ++i) {
+        DeviceAddress(i, mac, ip);
+        devices.push_back(MacKey(mac));
+    }
+    XdpSocketIO down, up;
+    down.setManagedMacs(devices);
+    up.setManagedMacs({ MacKey(config.gateway_mac) });
+    if (!down.open(options.down_interface, xdp) || !up.open(options.up_interface, xdp)) {
+        fprintf(stderr, "%s%s\n", down.lastError().c_str(), up.lastError().c_str());
+        return 1;
+    }
+    fprintf(stderr, "relay: AF_XDP in %s mode, %s\n", down.genericMode() ? "generic" : "native",
+            down.zeroCopy() ? "zero copy" : "copy");
+    return RunRelayOver(options, config, down, up);
+}
+
+// ---------------------------------------------------------------------------
+// Gateway
+
+static int RunGateway(const RigOptions& options) {
+    PacketSocketIO io;
+    if (!io.open(options.interface_name)) {
+        fprintf(stderr, "%s\n", io.lastError().c_str());
+        return 1;
+    }
+    uint8_t buffer[2048];
+    uint8_t swap[6];
+    struct pollfd fds[1] = { { io.fd(), POLLIN, 0 } };
+
+    while (!g_stop.load()) {
+        if (poll(fds, 1, 100) <= 0) continue;
+        uint64_t timestamp = 0;
+        size_t length;
+        int budget = kBurst;
+        while (budget-- > 0 && (length = io.receive(buffer, sizeof(buffer), timestamp)) > 0) {
+            if (length < kPayloadOffset || buffer[12] != 0x08 || buffer[13] != 0x00) continue;
+            memcpy(buffer, buffer + 6, 6);
+            memcpy(buffer + 6, io.interfaceMac(), 6);
+            uint8_t* l3 = buffer + kEthernetHeaderSize;
+            memcpy(swap, l3 + 12, 4);
+            memcpy(l3 + 12, l3 + 16, 4);
+            memcpy(l3 + 16, swap, 4);
+            uint8_t* l4 = l3 + kIpv4HeaderSize;
+            memcpy(swap, l4, 2);
+            memcpy(l4, l4 + 2, 2);
+            memcpy(l4 + 2, swap, 2);
+            io.send(buffer, length);
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Socket I/O cost
+
+// One way of moving bursts from the send interface to the receive one
+class IoBackend {
+public:
+    virtual ~IoBackend() {}
+    virtual const char* name() const = 0;
+    virtual bool open(const RigOptions& options) = 0;
+    virtual const uint8_t* receiveMac() const = 0;
+    virtual size_t sendBurst(uint8_t* const* frames, size_t count, size_t length) = 0;
+    virtual size_t drain() = 0;
+    virtual uint64_t syscalls() const = 0;
+    virtual std::string lastError() const = 0;
+};
+
+// send()/recv() per frame
+class PacketIoBackend : public IoBackend {
+public:
+    const char* name() const override { return "packet"; }
+    bool open(const RigOptions& options) override {
+        return tx_.open(options.interface_name) && rx_.open(options.rx_interface);
+    }
+    const uint8_t* receiveMac() const override { return rx_.interfaceMac(); }
+    size_t sendBurst(uint8_t* const* frames, size_t count, size_t length) override {
+        size_t sent = 0;
+        for (size_t i = 0; i < count; ++i) {
+            ++syscalls_;
+            if (tx_.send(frames[i], length)) ++sent;
+        }
+        return sent;
+    }
+    size_t drain() override {
+        uint8_t buffer[2048];
+        uint64_t timestamp = 0;
+        size_t received = 0;
+        for (;;) {
+            ++syscalls_;
+            if (rx_.receive(buffer, sizeof(buffer), timestamp) == 0) return received;
+            ++received;
+        }
+    }
+    uint64_t syscalls() const override { return syscalls_; }
+    std::string lastError() const override { return tx_.lastError() + rx_.lastError(); }
+
+protected:
+    PacketSocketIO tx_, rx_;
+    uint64_t syscalls_ = 0;
+};
+
+// sendmmsg/recvmmsg on the same sockets, kBurst frames per call
+class MmsgIoBackend : public PacketIoBackend {
+public:
+    const char* name() const override { return "mmsg"; }
+    size_t sendBurst(uint8_t* const* frames, size_t count, size_t length) override {
+        struct mmsghdr messages[kBurst];
+        struct iovec vectors[kBurst];
+        count = std::min(count, static_cast<size_t>(kBurst));
+        for (size_t i = 0; i < count; ++i) {
+            vectors[i].iov_base = frames[i];
+            vectors[i].iov_len = length;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        ++syscalls_;
+        int sent = sendmmsg(tx_.fd(), messages, static_cast<unsigned>(count), 0);
+        return sent > 0 ? static_cast<size_t>(sent) : 0;
+    }
+    size_t drain() override {
+        static uint8_t buffers[kBurst][2048];
+        struct mmsghdr messages[kBurst];
+        struct iovec vectors[kBurst];
+        size_t received = 0;
+        for (;;) {
+            for (int i = 0; i < kBurst; ++i) {
+                vectors[i].iov_base = buffers[i];
+                vectors[i].iov_len = sizeof(buffers[i]);
+                memset(&messages[i], 0, sizeof(messages[i]));
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            ++syscalls_;
+            int count = recvmmsg(rx_.fd(), messages, kBurst, MSG_DONTWAIT, nullptr);
+            if (count <= 0) return received;
+            received += static_cast<size_t>(count);
+            if (count < kBurst) return received;
+        }
+    }
+};
+
+// io_uring: batched send SQEs, multishot receive
+class UringIoBackend : public IoBackend {
+public:
+    const char* name() const override { return "uring"; }
+    bool open(const RigOptions& options) override {
+        return tx_.open(options.interface_name) && rx_.open(options.rx_interface);
+    }
+    const uint8_t* receiveMac() const override { return rx_.interfaceMac(); }
+    size_t sendBurst(uint8_t* const* frames, size_t count, size_t length) override {
+        size_t sent = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (tx_.send(frames[i], length)) ++sent;
+        }
+        tx_.flush();
+        return sent;
+    }
+    size_t drain() override {
+        uint8_t buffer[2048];
+        uint64_t timestamp = 0;
+        size_t received = 0;
+        while (rx_.receive(buffer, sizeof(buffer), timestamp) > 0) ++received;
+        return received;
+    }
+    uint64_t syscalls() const override { return tx_.syscalls() + rx_.syscalls(); }
+    std::string lastError() const override { return tx_.lastError() + rx_.lastError(); }
+
+private:
+    UringPacketIO tx_, rx_;
+};
+
+static double ThreadCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static bool MeasureIo(const RigOptions& options, IoBackend& backend, std::string& json) {
+    if (!backend.open(options)) {
+        fprintf(stderr, "%s: %s\n", backend.name(), backend.lastError().c_str());
+        return false;
+    }
+    size_t size = std::max(options.frame_size, kPayloadOffset + 24);
+    std::vector<std::vector<uint8_t>> frames(kBurst, std::vector<uint8_t>(size));
+    uint8_t* bursts[kBurst];
+    for (int i = 0; i < kBurst; ++i) {
+        BuildProbeFrame(frames[i].data(), size, backend.receiveMac(), static_cast<uint32_t>(i));
+        bursts[i] = frames[i].data();
+    }
+
+    // Warm up, then measure from a drained receive side
+    uint64_t warmup_end = NowNs() + 200000000ULL;
+    while (NowNs() < warmup_end) {
+        backend.sendBurst(bursts, kBurst, size);
+        backend.drain();
+    }
+    backend.drain();
+
+    uint64_t sent = 0, received = 0;
+    uint64_t syscalls = backend.syscalls();
+    double cpu = ThreadCpuSeconds();
+    uint64_t start = NowNs();
+    uint64_t end = start + static_cast<uint64_t>(options.seconds * 1e9);
+    uint64_t now = start;
+    while (now < end && !g_stop.load()) {
+        sent += backend.sendBurst(bursts, kBurst, size);
+        received += backend.drain();
+        now = NowNs();
+    }
+    received += backend.drain();
+    double seconds = static_cast<double>(NowNs() - start) / 1e9;
+    cpu = ThreadCpuSeconds() - cpu;
+    syscalls = backend.syscalls() - syscalls;
+
+    double frames_done = static_cast<double>(std::max<uint64_t>(received, 1));
+    char line[512];
+    snprintf(line, sizeof(line),
+             "%s    {\"backend\": \"%s\", \"sent\": %llu, \"received\": %llu, \"mpps\": %.3f, "
+             "\"cpu_ns_per_frame\": %.1f, \"syscalls_per_frame\": %.3f}",
+             json.empty() ? "" : ",\n", backend.name(), static_cast<unsigned long long>(sent),
+             static_cast<unsigned long long>(received), static_cast<double>(received) / seconds / 1e6,
+             cpu * 1e9 / frames_done, static_cast<double>(syscalls) / frames_done);
+    json += line;
+    fprintf(stderr, "io: %-6s %.3f Mpps, %.1f ns CPU and %.3f syscalls per frame\n", backend.name(),
+            static_cast<double>(received) / seconds / 1e6, cpu * 1e9 / frames_done,
+            static_cast<double>(syscalls) / frames_done);
+    return true;
+}
+
+static int RunIo(const RigOptions& options) {
+    PacketIoBackend packet;
+    MmsgIoBackend mmsg;
+    UringIoBackend uring;
+    IoBackend* backends[] = { &packet, &mmsg, &uring };
+
+    std::string runs;
+    for (IoBackend* backend : backends) {
+        if (!MeasureIo(options, *backend, runs)) return 1;
+    }
+    char line[256];
+    snprintf(line, sizeof(line), "{\n  \"role\": \"io\",\n  \"frame_size\": %zu,\n  \"burst\": %d,\n  \"runs\": [\n",
+             std::max(options.frame_size, kPayloadOffset + 24), kBurst);
+    return WriteReport(options.out_path, std::string(line) + runs + "\n  ]\n}\n") ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    RigOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s client --if IF --dst-mac MAC [--devices N] [--seconds S] [--rate-mbps R]\n"
+                "                 [--size BYTES] [--label TEXT] [--out FILE]\n"
+                "       %s relay --down IF --up IF --gateway-mac MAC [--default-limit DOWN/UP]\n"
+                "                 [--no-profile] [--out FILE] [--backend packet|uring|xdp|xdp-generic]\n"
+                "                 [--devices N] [--classify frame|burst]\n"
+                "       %s gateway --if IF\n"
+                "       %s io --if IF --rx IF [--seconds S] [--size BYTES] [--out FILE]\n",
+                argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    if (options.role == "client") return RunClient(options);
+    if (options.role == "relay") return RunRelay(options);
+    if (options.role == "io") return RunIo(options);
+    return RunGateway(options);
+}
@@ -0,0 +1,393 @@
+// Deterministic LAN simulation of the discovery, poisoning and restore paths
+//
+// Usage:
+//   netshaper_sim [options]
+//     --devices N             simulated devices (default 1000)
+//     --seed S                simulation seed (default 1)
+//     --response-rate R       fraction of devices answering ARP (default 0.95)
+//     --traffic-mbps R        per device and direction (default 0.1)
+//     --capture FILE          write every frame we receive to a pcapng file,
+//                             e.g. for netshaper_replay
+//     --check                 exit 1 unless every scenario check passes and a
+//                             second run with the same seed is identical
+//     --out FILE              write the JSON report to FILE (else stdout)
+//
+// Runs one scenario on a SimulatedNetwork under a virtual clock:
+//   sweep     ARP request to every device IP; replies must match exactly the
+//             devices that answer ARP
+//   poison    SendSpoofPair for each discovered device on the poisoning
+//             worker's 2 s cycle for 30 s, with the intercepted traffic run
+//             through the DataPlane; nothing may lapse and every intercepted
+//             frame must be delivered
+//   lapse     refreshing stops; after the cache timeout every entry must
+//             have been re-resolved to the real MAC
+//   restore   poison once more, then the worker's restore (3 rounds of
+//             legitimate replies); every device must be restored
+//   chatter   mDNS announcements seen along the way must name every device
+#include "arp_frame.h"
+#include "data_plane.h"
+#include "device_table.h"
+#include "name_discovery.h"
+#include "pcap_file.h"
+#include "simulated_network.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+static const uint64_t kMs = 1000000ULL;
+static const uint64_t kSecond = 1000 * kMs;
+static const uint64_t kRefreshNs = 2 * kSecond;       // PoisoningWorker cycle
+static const uint64_t kCacheTimeoutNs = 60 * kSecond;
+static const uint64_t kStepNs = 10 * kMs;
+static const uint64_t kSweepGapNs = 10000;            // 100k requests per second
+
+struct SimOptions {
+    uint32_t devices = 1000;
+    uint32_t seed = 1;
+    double response_rate = 0.95;
+    double traffic_mbps = 0.1;
+    std::string capture_path;
+    bool check = false;
+    std::string out_path;
+};
+
+struct ScenarioResult {
+    uint32_t responding = 0;
+    uint32_t discovered = 0;
+    uint32_t reply_mismatches = 0;
+    uint32_t poisoned_after_first_cycle = 0;
+    uint32_t poisoned_after_refresh = 0;
+    uint64_t lapses_while_refreshing = 0;
+    uint32_t poisoned_after_lapse = 0;
+    uint64_t lapses_after_refresh = 0;
+    uint32_t restored = 0;
+    uint32_t named = 0;
+    uint64_t dhcp_frames = 0;
+    uint64_t frames_received = 0;
+    uint64_t forwarded = 0;
+    double refresh_ns_per_device = 0;   // wall time of one refresh cycle
+    double wall_seconds = 0;
+    SimulatedNetwork::Stats stats = {};
+};
+
+static bool ParseArgs(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) return false;
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+
+        if (arg == "--devices" && value(text)) {
+            options.devices = static_cast<uint32_t>(std::max(1, atoi(text.c_str())));
+        } else if (arg == "--seed" && value(text)) {
+            options.seed = static_cast<uint32_t>(strtoul(text.c_str(), nullptr, 10));
+        } else if (arg == "--response-rate" && value(text)) {
+            options.response_rate = atof(text.c_str());
+        } else if (arg == "--traffic-mbps" && value(text)) {
+            options.traffic_mbps = atof(text.c_str());
+        } else if (arg == "--capture") {
+            if (!value(options.capture_path)) return false;
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (arg == "--out") {
+            if (!value(options.out_path)) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t HostIndex(const uint8_t* ip) {
+    return ((static_cast<uint32_t>(ip[2]) << 8) | ip[3]) - 10;
+}
+
+static ScenarioResult RunScenario(const SimOptions& options, bool write_capture) {
+    ScenarioResult result;
+    auto wall_start = std::chrono::steady_clock::now();
+
+    VirtualClock clock(kSecond);
+    SimulatedNetwork::Config config;
+    config.device_count = options.devices;
+    config.seed = options.seed;
+    config.response_rate = options.response_rate;
+    config.arp_cache_timeout_ns = kCacheTimeoutNs;
+    config.dhcp_interval_ns = 30 * kSecond;
+    config.mdns_interval_ns = 20 * kSecond;
+    config.traffic_mbps = options.traffic_mbps;
+    SimulatedNetwork network(config, clock);
+
+    for (uint32_t i = 0; i < network.deviceCount(); ++i) {
+        if (network.respondsToArp(i)) ++result.responding;
+    }
+
+    PcapFileWriter capture;
+    if (write_capture && !options.capture_path.empty() && !capture.open(options.capture_path, true)) {
+        fprintf(stderr, "Cannot write %s\n", options.capture_path.c_str());
+    }
+
+    DataPlane::Config plane_config;
+    memcpy(plane_config.our_mac, network.ourMac(), 6);
+    memcpy(plane_config.gateway_mac, network.gatewayMac(), 6);
+    DataPlane plane(plane_config, &network, clock);
+
+    struct Found {
+        uint8_t ip[4];
+        uint8_t mac[6];
+    };
+    std::vector<Found> found;
+    std::vector<bool> seen(network.deviceCount(), false);
+    std::set<uint32_t> named;
+
+    // Receive side: what a host on the LAN gets to see
+    uint8_t buffer[2048];
+    auto drain = [&]() {
+        uint64_t timestamp = 0;
+        size_t length;
+        while ((length = network.receive(buffer, sizeof(buffer), timestamp)) > 0) {
+            ++result.frames_received;
+            capture.write(buffer, static_cast<uint32_t>(length), timestamp);
+
+            uint16_t ethertype = static_cast<uint16_t>((buffer[12] << 8) | buffer[13]);
+            if (ethertype == 0x0806 && length >= sizeof(ArpFrame)) {
+                const ArpFrame* arp = reinterpret_cast<const ArpFrame*>(buffer);
+                bool reply = buffer[20] == 0 && buffer[21] == 2;
+                if (!reply || memcmp(arp->eth.dest_mac, network.ourMac(), 6) != 0) continue;
+                uint32_t index = HostIndex(arp->arp.sender_ip);
+                if (index >= network.deviceCount()) continue;   // the gateway
+                uint8_t expected[6];
+                network.deviceMac(index, expected);
+                if (memcmp(expected, arp->arp.sender_mac, 6) != 0) {
+                    ++result.reply_mismatches;
+                } else if (!seen[index]) {
+                    seen[index] = true;
+                    Found entry;
+                    memcpy(entry.ip, arp->arp.sender_ip, 4);
+                    memcpy(entry.mac, arp->arp.sender_mac, 6);
+                    found.push_back(entry);
+                }
+                continue;
+            }
+            if (ethertype != 0x0800 || length < 42) continue;
+
+            uint16_t dst_port = static_cast<uint16_t>((buffer[36] << 8) | buffer[37]);
+            if (buffer[23] == 17 && dst_port == 5353) {
+                std::vector<DiscoveredName> names;
+                NameDiscovery::parseDnsResponse(buffer + 42, length - 42, "mdns", names);
+                for (const auto& name : names) {
+                    uint8_t ip[4];
+                    if (!ParseIpv4(name.ip, ip)) continue;
+                    uint32_t index = HostIndex(ip);
+                    if (name.name == "sim-device-" + std::to_string(index)) named.insert(index);
+                }
+            } else if (buffer[23] == 17 && dst_port == 67) {
+                ++result.dhcp_frames;
+            } else if (memcmp(buffer, network.ourMac(), 6) == 0) {
+                plane.process(buffer, length);
+            }
+        }
+    };
+    auto run_for = [&](uint64_t duration_ns) {
+        for (uint64_t elapsed = 0; elapsed < duration_ns; elapsed += kStepNs) {
+            clock.advance(kStepNs);
+            drain();
+        }
+    };
+
+    SpoofEndpoints local;
+    memcpy(local.our_mac, network.ourMac(), 6);
+    memcpy(local.gateway_ip, network.gatewayIp(), 4);
+    memcpy(local.gateway_mac, network.gatewayMac(), 6);
+    ArpFrame frame;
+    auto refresh = [&]() {
+        for (const Found& device : found) {
+            SendSpoofPair(network, frame, local, device.ip, device.mac);
+        }
+    };
+
+    // Sweep: one request per device IP, paced
+    for (uint32_t i = 0; i < network.deviceCount(); ++i) {
+        uint8_t ip[4];
+        network.deviceIp(i, ip);
+        BuildArpRequest(frame, network.ourMac(), network.ourIp(), ip);
+        network.send(reinterpret_cast<const uint8_t*>(&frame), sizeof(frame));
+        clock.advance(kSweepGapNs);
+        if (i % 1000 == 999) drain();
+    }
+    run_for(100 * kMs);
+    result.discovered = static_cast<uint32_t>(found.size());
+
+    for (const Found& device : found) {
+        DevicePolicy policy = {};
+        memcpy(policy.mac, device.mac, 6);
+        memcpy(policy.ip, device.ip, 4);
+        policy.counter_slot = GetTrafficCounters().acquireSlot();   // as its TrafficControl would
+        plane.setDevice(policy);
+    }
+
+    // Poison on the worker's cycle
+    uint64_t refresh_wall_ns = 0;
+    uint32_t cycles = 0;
+    for (uint64_t t = 0; t < 30 * kSecond; t += kRefreshNs) {
+        auto start = std::chrono::steady_clock::now();
+        refresh();
+        refresh_wall_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        ++cycles;
+        if (t == 0) result.poisoned_after_first_cycle = network.poisonedCount();
+        run_for(kRefreshNs);
+    }
+    result.poisoned_after_refresh = network.poisonedCount();
+    result.lapses_while_refreshing = network.stats().poison_lapses;
+    result.refresh_ns_per_device = found.empty() ? 0.0
+        : static_cast<double>(refresh_wall_ns) / cycles / static_cast<double>(found.size());
+
+    // Stop refreshing and let the caches age out
+    run_for(kCacheTimeoutNs + 2 * kSecond);
+    result.poisoned_after_lapse = network.poisonedCount();
+    result.lapses_after_refresh = network.stats().poison_lapses - result.lapses_while_refreshing;
+
+    // Poison again, then restore as PoisoningWorker::stopAll does
+    refresh();
+    run_for(kRefreshNs);
+    for (int round = 0; round < 3; ++round) {
+        for (const Found& device : found) {
+            BuildArpReply(frame, network.gatewayMac(), network.gatewayIp(), device.mac, device.ip);
+            network.send(reinterpret_cast<const uint8_t*>(&frame), sizeof(frame));
+            BuildArpReply(frame, device.mac, device.ip, network.gatewayMac(), network.gatewayIp());
+            network.send(reinterpret_cast<const uint8_t*>(&frame), sizeof(frame));
+        }
+        run_for(100 * kMs);
+    }
+    result.restored = network.restoredCount();
+
+    result.named = static_cast<uint32_t>(named.size());
+    result.forwarded = plane.stats().forwarded;
+    result.stats = network.stats();
+    result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    return result;
+}
+
+// Deterministic part of a result, for comparing two runs
+static std::string Fingerprint(const ScenarioResult& r) {
+    const SimulatedNetwork::Stats& s = r.stats;
+    char text[512];
+    snprintf(text, sizeof(text), "%u %u %u %u %llu %u %u %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+             r.discovered, r.poisoned_after_first_cycle, r.poisoned_after_lapse, r.restored,
+             static_cast<unsigned long long>(r.frames_received), r.named, r.responding,
+             static_cast<unsigned long long>(r.forwarded),
+             static_cast<unsigned long long>(s.arp_replies),
+             static_cast<unsigned long long>(s.poison_updates),
+             static_cast<unsigned long long>(s.restore_updates),
+             static_cast<unsigned long long>(s.cache_expiries),
+             static_cast<unsigned long long>(s.poison_lapses),
+             static_cast<unsigned long long>(s.chatter_frames),
+             static_cast<unsigned long long>(s.traffic_generated),
+             static_cast<unsigned long long>(s.traffic_intercepted),
+             static_cast<unsigned long long>(s.frames_delivered));
+    return text;
+}
+
+static int Check(bool ok, const char* what, unsigned long long actual, unsigned long long expected) {
+    if (ok) return 0;
+    fprintf(stderr, "Check failed: %s (got %llu, expected %llu)\n", what, actual, expected);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--devices N] [--seed S] [--response-rate R] [--traffic-mbps R]\n"
+                "          [--capture FILE] [--check] [--out FILE]\n",
+                argv[0]);
+        return 2;
+    }
+
+    ScenarioResult r = RunScenario(options, true);
+    const SimulatedNetwork::Stats& s = r.stats;
+
+    std::string json = "{\n";
+    char line[512];
+    snprintf(line, sizeof(line),
+             "  \"devices\": %u,\n  \"seed\": %u,\n  \"responding\": %u,\n  \"discovered\": %u,\n"
+             "  \"reply_mismatches\": %u,\n  \"poisoned_after_first_cycle\": %u,\n"
+             "  \"poisoned_after_refresh\": %u,\n  \"lapses_while_refreshing\": %llu,\n"
+             "  \"poisoned_after_lapse\": %u,\n  \"lapses_after_refresh\": %llu,\n  \"restored\": %u,\n",
+             options.devices, options.seed, r.responding, r.discovered, r.reply_mismatches,
+             r.poisoned_after_first_cycle, r.poisoned_after_refresh,
+             static_cast<unsigned long long>(r.lapses_while_refreshing), r.poisoned_after_lapse,
+             static_cast<unsigned long long>(r.lapses_after_refresh), r.restored);
+    json += line;
+    snprintf(line, sizeof(line),
+             "  \"named\": %u,\n  \"dhcp_frames\": %llu,\n  \"frames_received\": %llu,\n  \"forwarded\": %llu,\n"
+             "  \"refresh_ns_per_device\": %.1f,\n  \"wall_seconds\": %.3f,\n",
+             r.named, static_cast<unsigned long long>(r.dhcp_frames),
+             static_cast<unsigned long long>(r.frames_received), static_cast<unsigned long long>(r.forwarded),
+             r.refresh_ns_per_device, r.wall_seconds);
+    json += line;
+    snprintf(line, sizeof(line),
+             "  \"network\": {\"arp_requests\": %llu, \"arp_replies\": %llu, \"poison_updates\": %llu, "
+             "\"restore_updates\": %llu, \"cache_expiries\": %llu, \"poison_lapses\": %llu, \"chatter_frames\": %llu, "
+             "\"traffic_generated\": %llu, \"traffic_intercepted\": %llu, \"frames_delivered\": %llu, "
+             "\"frames_unroutable\": %llu, \"rx_dropped\": %llu}\n}\n",
+             static_cast<unsigned long long>(s.arp_requests), static_cast<unsigned long long>(s.arp_replies),
+             static_cast<unsigned long long>(s.poison_updates), static_cast<unsigned long long>(s.restore_updates),
+             static_cast<unsigned long long>(s.cache_expiries), static_cast<unsigned long long>(s.poison_lapses),
+             static_cast<unsigned long long>(s.chatter_frames), static_cast<unsigned long long>(s.traffic_generated),
+             static_cast<unsigned long long>(s.traffic_intercepted), static_cast<unsigned long long>(s.frames_delivered),
+             static_cast<unsigned long long>(s.frames_unroutable), static_cast<unsigned long long>(s.rx_dropped));
+    json += line;
+
+    if (options.out_path.empty()) {
+        fwrite(json.data(), 1, json.size(), stdout);
+    } else {
+        FILE* file = fopen(options.out_path.c_str(), "wb");
+        if (!file) {
+            fprintf(stderr, "Cannot write %s\n", options.out_path.c_str());
+            return 1;
+        }
+        fwrite(json.data(), 1, json.size(), file);
+        fclose(file);
+    }
+
+    fprintf(stderr, "%u devices: %u discovered, %llu frames received, %llu forwarded, %.1f ns per refresh, %.2f s\n",
+            options.devices, r.discovered, static_cast<unsigned long long>(r.frames_received),
+            static_cast<unsigned long long>(r.forwarded), r.refresh_ns_per_device, r.wall_seconds);
+    if (!options.check) return 0;
+
+    int failures = 0;
+    failures += Check(r.discovered == r.responding, "sweep finds every responding device", r.discovered, r.responding);
+    failures += Check(r.reply_mismatches == 0, "ARP replies carry the device MAC", r.reply_mismatches, 0);
+    failures += Check(r.poisoned_after_first_cycle == r.discovered, "one refresh cycle poisons every device",
+                      r.poisoned_after_first_cycle, r.discovered);
+    failures += Check(r.poisoned_after_refresh == r.discovered, "refreshing keeps every device poisoned",
+                      r.poisoned_after_refresh, r.discovered);
+    failures += Check(r.lapses_while_refreshing == 0, "no lapses while refreshing", r.lapses_while_refreshing, 0);
+    failures += Check(r.poisoned_after_lapse == 0, "unrefreshed poisoning ages out", r.poisoned_after_lapse, 0);
+    failures += Check(r.lapses_after_refresh == 2ULL * r.discovered, "both cache entries lapse per device",
+                      r.lapses_after_refresh, 2ULL * r.discovered);
+    failures += Check(r.restored == options.devices, "restore fixes every cache", r.restored, options.devices);
+    failures += Check(r.named == options.devices, "mDNS names every device", r.named, options.devices);
+    failures += Check(s.traffic_intercepted > 0 || options.traffic_mbps <= 0, "traffic is intercepted",
+                      s.traffic_intercepted, 1);
+    failures += Check(r.forwarded == s.frames_delivered, "forwarded frames reach their host",
+                      r.forwarded, s.frames_delivered);
+    failures += Check(s.rx_dropped == 0, "no receive queue overflow", s.rx_dropped, 0);
+
+    ScenarioResult again = RunScenario(options, false);
+    if (Fingerprint(again) != Fingerprint(r)) {
+        fprintf(stderr, "Check failed: runs with the same seed differ\n  %s\n  %s\n",
+                Fingerprint(r).c_str(), Fingerprint(again).c_str());
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
@@ -1,18 +1,35 @@
 {
+  "variables": {
+    # Interpreter for build actions: node-gyp's (npm config python / PYTHON)
+    "python%": "<!(node -p \"process.env.npm_config_python || process.env.PYTHON || (process.platform === 'win32' ? 'python' : 'python3')\")",
+    # ARP engine and traffic control, shared by the addon and netshaperd so
+    # the two link lists cannot drift apart
+    "arp_engine_sources": [ "arp.cpp", "arp_frame.cpp", "arp_stats.cpp", "capture_filter.cpp", "capture_profile.cpp", "cycle_clock.cpp", "device_table.cpp", "latency_histogram.cpp", "packet_io.cpp", "ring_log.cpp", "traffic_control.cpp", "traffic_counters.cpp" ]
+  },
   "targets": [
     {
       "target_name": "network",
-      "sources": [ "network.cpp", "arp.cpp" ],
+      "actions": [
+        {
+          "action_name": "gen_oui_table",
+          "inputs": [ "tools/gen_oui_table.py", "<!@(node -p \"require('fs').readdirSync('data').filter(f => f.endsWith('.csv')).map(f => 'data/' + f).join(' ')\")" ],
+          "outputs": [ "<(SHARED_INTERMEDIATE_DIR)/oui_registry_table.inc" ],
+          "action": [ "<(python)", "tools/gen_oui_table.py", "--out", "<(SHARED_INTERMEDIATE_DIR)/oui_registry_table.inc" ]
+        }
+      ],
+      "sources": [ "network.cpp", "name_resolver.cpp", "name_discovery.cpp", "oui_db.cpp", "device_inventory.cpp", "simulated_network.cpp", "<@(arp_engine_sources)" ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
-        "./lib/Npcap/include"
+        "./lib/Npcap/include",
+        "<(SHARED_INTERMEDIATE_DIR)"
       ],
       "dependencies": [
         "<!(node -p \"require('node-addon-api').gyp\")"
       ],
       "cflags!": [ "-fno-exceptions" ],
       "cflags_cc!": [ "-fno-exceptions" ],
-      "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS", "WPCAP", "HAVE_REMOTE" ],
+      "cflags_cc": [ "-std=c++17" ],
+      "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS", "WPCAP", "HAVE_REMOTE", "NETSHAPER_GENERATED_OUI_TABLE" ],
       "conditions": [
         ["OS=='win'", {
           "conditions": [
@@ -35,11 +52,72 @@
           ],
           "msvs_settings": {
             "VCCLCompilerTool": {
-              "ExceptionHandling": 1
+              "ExceptionHandling": 1,
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }]
+      ]
+    },
+    {
+      "target_name": "netshaperd",
+      "type": "executable",
+      "sources": [ "daemon/netshaperd_main.cpp", "control_server.cpp", "<@(arp_engine_sources)" ],
+      "include_dirs": [
+        ".",
+        "./lib/Npcap/include"
+      ],
+      "cflags!": [ "-fno-exceptions" ],
+      "cflags_cc!": [ "-fno-exceptions" ],
+      "cflags_cc": [ "-std=c++17" ],
+      "defines": [ "NETSHAPERD_WITH_ARP", "WPCAP", "HAVE_REMOTE" ],
+      "conditions": [
+        ["OS=='win'", {
+          "conditions": [
+            ["target_arch=='x64'", {
+              "libraries": [
+                "../lib/Npcap/Lib/x64/wpcap.lib",
+                "../lib/Npcap/Lib/x64/Packet.lib",
+                "ws2_32.lib",
+                "iphlpapi.lib"
+              ]
+            }],
+            ["target_arch=='ia32'", {
+              "libraries": [
+                "../lib/Npcap/Lib/wpcap.lib",
+                "../lib/Npcap/Lib/Packet.lib",
+                "ws2_32.lib",
+                "iphlpapi.lib"
+              ]
+            }]
+          ],
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "ExceptionHandling": 1,
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }]
+      ]
+    },
+    {
+      "target_name": "netshaperctl",
+      "type": "executable",
+      "sources": [ "daemon/netshaperctl_main.cpp", "control_server.cpp" ],
+      "include_dirs": [ "." ],
+      "cflags!": [ "-fno-exceptions" ],
+      "cflags_cc!": [ "-fno-exceptions" ],
+      "cflags_cc": [ "-std=c++17" ],
+      "conditions": [
+        ["OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "ExceptionHandling": 1,
+              "AdditionalOptions": [ "/std:c++17" ]
             }
           }
         }]
       ]
     }
   ]
-}
\ No newline at end of file
+}
@@ -0,0 +1,85 @@
+#include "capture_filter.h"
+#include <algorithm>
+
+// Opcodes (BPF_LD|BPF_H|BPF_ABS etc. from <pcap/bpf.h>)
+static const uint16_t kLdWordAbs = 0x20;
+static const uint16_t kLdHalfAbs = 0x28;
+static const uint16_t kJmpJa = 0x05;
+static const uint16_t kJmpJeqK = 0x15;
+static const uint16_t kRetK = 0x06;
+
+static const uint32_t kEtherTypeIpv4 = 0x0800;
+static const uint32_t kEtherTypeArp = 0x0806;
+static const uint32_t kEtherTypeVlan = 0x8100;
+
+static BpfInstruction Insn(uint16_t code, uint32_t k, uint8_t jt = 0, uint8_t jf = 0) {
+    BpfInstruction insn;
+    insn.code = code;
+    insn.jt = jt;
+    insn.jf = jf;
+    insn.k = k;
+    return insn;
+}
+
+std::vector<BpfInstruction> BuildCaptureFilter(const std::vector<uint64_t>& macs, uint32_t snaplen) {
+    std::vector<uint64_t> sorted(macs);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    bool match_all = sorted.size() > kMaxFilterMacs;
+
+    std::vector<BpfInstruction> program;
+    program.push_back(Insn(kLdHalfAbs, 12));                     // 0: A = ethertype
+    program.push_back(Insn(kJmpJeqK, kEtherTypeArp, 0, 1));      // 1: ARP?
+    program.push_back(Insn(kRetK, snaplen));                     // 2:   accept
+    program.push_back(Insn(kJmpJeqK, kEtherTypeIpv4, 2, 0));     // 3: IPv4? -> 6
+    program.push_back(Insn(kJmpJeqK, kEtherTypeVlan, 1, 0));     // 4: 802.1Q? -> 6
+    size_t jump_to_reject = program.size();
+    program.push_back(Insn(kJmpJa, 0));                          // 5: -> reject (patched)
+
+    if (match_all) {
+        program.push_back(Insn(kRetK, snaplen));
+    } else {
+        // Per MAC: source MAC bytes 6..9, then 10..11; short jumps only,
+        // so the list can be longer than a jt/jf offset reaches
+        for (uint64_t mac : sorted) {
+            program.push_back(Insn(kLdWordAbs, 6));
+            program.push_back(Insn(kJmpJeqK, static_cast<uint32_t>(mac >> 16), 0, 3));
+            program.push_back(Insn(kLdHalfAbs, 10));
+            program.push_back(Insn(kJmpJeqK, static_cast<uint32_t>(mac & 0xFFFF), 0, 1));
+            program.push_back(Insn(kRetK, snaplen));
+        }
+    }
+
+    program[jump_to_reject].k = static_cast<uint32_t>(program.size() - jump_to_reject - 1);
+    program.push_back(Insn(kRetK, 0));
+    return program;
+}
+
+uint32_t RunCaptureFilter(const std::vector<BpfInstruction>& program, const uint8_t* frame, size_t length) {
+    uint32_t a = 0;
+    for (size_t pc = 0; pc < program.size(); ++pc) {
+        const BpfInstruction& insn = program[pc];
+        switch (insn.code) {
+            case kLdWordAbs:
+                if (insn.k + 4 > length) return 0;
+                a = (static_cast<uint32_t>(frame[insn.k]) << 24) | (static_cast<uint32_t>(frame[insn.k + 1]) << 16) |
+                    (static_cast<uint32_t>(frame[insn.k + 2]) << 8) | frame[insn.k + 3];
+                break;
+            case kLdHalfAbs:
+                if (insn.k + 2 > length) return 0;
+                a = (static_cast<uint32_t>(frame[insn.k]) << 8) | frame[insn.k + 1];
+                break;
+            case kJmpJa:
+                pc += insn.k;
+                break;
+            case kJmpJeqK:
+                pc += a == insn.k ? insn.jt : insn.jf;
+                break;
+            case kRetK:
+                return static_cast<uint32_t>(std::min<size_t>(insn.k, length));
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Classic BPF instruction, laid out like libpcap's struct bpf_insn and
+// Linux's struct sock_filter so a program can be handed to either as is
+struct BpfInstruction {
+    uint16_t code;
+    uint8_t jt;
+    uint8_t jf;
+    uint32_t k;
+};
+static_assert(sizeof(BpfInstruction) == 8, "BpfInstruction must match struct bpf_insn");
+
+// Capture filter for the relay: accepts ARP, and IPv4 (also 802.1Q
+// tagged) frames sent by one of macs, i.e. by a managed device or the
+// gateway. Everything else is dropped before it is copied to userspace.
+// Accepted frames are truncated to snaplen. Each MAC costs five
+// instructions; above kMaxFilterMacs the program falls back to accepting
+// all ARP and IPv4, since Linux charges the program (8 bytes per
+// instruction) against optmem_max, 20 KB by default on older kernels.
+static const size_t kMaxFilterMacs = 400;
+
+// macs are packed with MacKey() (device_table.h)
+std::vector<BpfInstruction> BuildCaptureFilter(const std::vector<uint64_t>& macs, uint32_t snaplen);
+
+// Run a program built by BuildCaptureFilter over a frame; returns the
+// number of bytes the kernel would keep (0 = dropped). Supports only the
+// instructions BuildCaptureFilter emits; for tests and offline replay.
+uint32_t RunCaptureFilter(const std::vector<BpfInstruction>& program, const uint8_t* frame, size_t length);
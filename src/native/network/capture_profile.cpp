@@ -0,0 +1,71 @@
+#include "capture_profile.h"
+#include <algorithm>
+
+// Assumed when the adapter does not report its speed
+static const uint64_t kDefaultLinkBps = 1000000000ULL;
+static const size_t kMaxBufferBytes = 256u << 20;
+
+CaptureProfile GetCaptureProfile(CapturePreset preset) {
+    CaptureProfile profile;
+    profile.preset = preset;
+    profile.buffer_bytes = 0;
+    profile.promiscuous = true;
+    switch (preset) {
+        case kCaptureThroughput:
+            // Ethernet + 802.1Q + IPv4 and TCP with full options fit in 160
+            profile.snaplen = 160;
+            profile.immediate = false;
+            profile.nanosecond_timestamps = true;
+            profile.timeout_ms = 100;
+            profile.arp_only = false;
+            break;
+        case kCaptureArpOnly:
+            profile.snaplen = 64;
+            profile.immediate = false;
+            profile.nanosecond_timestamps = false;
+            profile.timeout_ms = 100;
+            profile.arp_only = true;
+            break;
+        case kCaptureLowLatency:
+        default:
+            // Relayed frames are resent as captured, so never truncate
+            profile.preset = kCaptureLowLatency;
+            profile.snaplen = 65536;
+            profile.immediate = true;
+            profile.nanosecond_timestamps = false;
+            profile.timeout_ms = 1;
+            profile.arp_only = false;
+            break;
+    }
+    return profile;
+}
+
+const char* CapturePresetName(CapturePreset preset) {
+    switch (preset) {
+        case kCaptureLowLatency: return "low-latency";
+        case kCaptureThroughput: return "throughput";
+        case kCaptureArpOnly: return "arp-only";
+    }
+    return "unknown";
+}
+
+bool ParseCapturePreset(const std::string& text, CapturePreset& preset) {
+    for (CapturePreset candidate : {kCaptureLowLatency, kCaptureThroughput, kCaptureArpOnly}) {
+        if (text == CapturePresetName(candidate)) {
+            preset = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CaptureBufferBytes(const CaptureProfile& profile, uint64_t link_bps) {
+    if (profile.buffer_bytes) return profile.buffer_bytes;
+    if (profile.arp_only) return 1u << 20;
+
+    uint64_t bytes_per_second = (link_bps ? link_bps : kDefaultLinkBps) / 8;
+    uint64_t window_ms = profile.immediate ? 20 : 500;
+    uint64_t floor = profile.immediate ? (2u << 20) : (16u << 20);
+    uint64_t bytes = std::max(bytes_per_second * window_ms / 1000, floor);
+    return static_cast<size_t>(std::min<uint64_t>(bytes, kMaxBufferBytes));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// How the capture handle is opened (pcap_create + pcap_set_* + pcap_activate)
+enum CapturePreset {
+    kCaptureLowLatency = 0,   // relay: deliver every frame at once, full frames
+    kCaptureThroughput,       // accounting: headers only, big buffer, batched wakeups
+    kCaptureArpOnly           // discovery/poisoning only: kernel keeps ARP, drops the rest
+};
+
+struct CaptureProfile {
+    CapturePreset preset;
+    uint32_t snaplen;              // bytes kept per frame
+    size_t buffer_bytes;           // kernel buffer, 0 = size from the link rate
+    bool immediate;                // pcap_set_immediate_mode: no batching delay
+    bool promiscuous;
+    bool nanosecond_timestamps;    // falls back to microseconds when unsupported
+    int timeout_ms;                // read timeout when not immediate
+    bool arp_only;                 // capture filter accepts ARP only
+};
+
+CaptureProfile GetCaptureProfile(CapturePreset preset);
+const char* CapturePresetName(CapturePreset preset);
+
+// "low-latency", "throughput" or "arp-only"
+bool ParseCapturePreset(const std::string& text, CapturePreset& preset);
+
+// Kernel buffer for profile on a link of link_bps (0 = unknown): enough
+// to ride out a stall of the reader at line rate, 20 ms for the relay and
+// 500 ms for accounting, with a per-preset floor and a 256 MB ceiling.
+// An explicit buffer_bytes is returned as is.
+size_t CaptureBufferBytes(const CaptureProfile& profile, uint64_t link_bps);
+
+// Kernel capture counters since the handle was opened
+struct CaptureStats {
+    uint64_t received;            // frames that passed the filter
+    uint64_t dropped;             // lost because the capture buffer was full
+    uint64_t interface_dropped;   // lost by the driver/NIC (0 when unknown)
+};
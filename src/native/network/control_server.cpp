@@ -0,0 +1,487 @@
+#include "control_server.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// JSON output
+
+void AppendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (!has_items_.empty()) {
+        if (has_items_.back()) out_ += ',';
+        has_items_.back() = true;
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    out_ += '{';
+    has_items_.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    out_ += '}';
+    if (!has_items_.empty()) has_items_.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    out_ += '[';
+    has_items_.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    out_ += ']';
+    if (!has_items_.empty()) has_items_.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string& name) {
+    separate();
+    AppendJsonString(out_, name);
+    out_ += ':';
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& text) {
+    separate();
+    AppendJsonString(out_, text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separate();
+    // JSON has no NaN/Infinity
+    if (number != number || number > 1e308 || number < -1e308) {
+        out_ += "null";
+        return *this;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%.15g", number);
+    out_ += text;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t number) {
+    separate();
+    out_ += std::to_string(number);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    out_ += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out_ += "null";
+    return *this;
+}
+
+// ---------------------------------------------------------------------------
+// Requests
+
+bool ParseControlRequest(const std::string& line, ControlRequest& request) {
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) ++pos;
+        size_t start = pos;
+        while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t') ++pos;
+        if (pos > start) tokens.push_back(line.substr(start, pos - start));
+    }
+    if (tokens.size() < 2) return false;
+
+    const std::string& id = tokens[0];
+    if (id.empty() || id.size() > 19 || id.find_first_not_of("0123456789") != std::string::npos) return false;
+
+    request.id = std::stoull(id);
+    request.command = tokens[1];
+    request.args.assign(tokens.begin() + 2, tokens.end());
+    return true;
+}
+
+std::string DefaultControlEndpoint() {
+#ifdef _WIN32
+    return "\\\\.\\pipe\\netshaperd";
+#else
+    return "/run/netshaperd.sock";
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Server
+
+void ControlServer::setError(const std::string& error) {
+    last_error_ = error;
+}
+
+void ControlServer::on(const std::string& command, Handler handler) {
+    std::lock_guard<std::mutex> lock(handler_mutex_);
+    handlers_[command] = std::move(handler);
+}
+
+std::string ControlServer::handleLine(const std::string& line) {
+    ControlRequest request;
+    std::string response = "{\"id\":";
+    if (!ParseControlRequest(line, request)) {
+        response += "0,\"ok\":false,\"error\":\"Malformed request, expected <id> <command> [arg ...]\"}";
+        return response;
+    }
+    response += std::to_string(request.id);
+
+    JsonWriter result;
+    std::string error;
+    bool ok = false;
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex_);
+        auto it = handlers_.find(request.command);
+        if (it == handlers_.end()) {
+            error = "Unknown command: " + request.command;
+        } else {
+            try {
+                ok = it->second(request, result, error);
+            } catch (const std::exception& e) {
+                ok = false;
+                error = e.what();
+            }
+        }
+    }
+    requests_handled_.fetch_add(1, std::memory_order_relaxed);
+
+    if (ok) {
+        response += ",\"ok\":true,\"result\":";
+        response += result.empty() ? "null" : result.str();
+    } else {
+        response += ",\"ok\":false,\"error\":";
+        AppendJsonString(response, error.empty() ? "Request failed" : error);
+    }
+    response += '}';
+    return response;
+}
+
+// Move complete lines out of buffer into responses. Returns false when a
+// line grows past kMaxLineLength without a newline.
+static bool DrainLines(ControlServer& server, std::string& buffer, std::string& responses) {
+    size_t start = 0;
+    size_t newline;
+    while ((newline = buffer.find('\n', start)) != std::string::npos) {
+        size_t end = newline;
+        if (end > start && buffer[end - 1] == '\r') --end;
+        if (end > start) {
+            responses += server.handleLine(buffer.substr(start, end - start));
+            responses += '\n';
+        }
+        start = newline + 1;
+    }
+    buffer.erase(0, start);
+    return buffer.size() <= ControlServer::kMaxLineLength;
+}
+
+#ifdef _WIN32
+
+// Poll interval for noticing stop() while waiting on a pipe
+static const DWORD kStopPollMs = 200;
+
+static HANDLE CreatePipeInstance(const std::string& name, bool first) {
+    DWORD open_mode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+    if (first) open_mode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+    return CreateNamedPipeA(name.c_str(), open_mode,
+                            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                            PIPE_UNLIMITED_INSTANCES, 64 * 1024, 64 * 1024, 0, NULL);
+}
+
+// Wait for an overlapped operation, giving up when stopping is set.
+// Returns false on failure or stop; the operation is cancelled in that case.
+static bool WaitOverlapped(HANDLE pipe, OVERLAPPED& overlapped, DWORD& transferred,
+                           const std::atomic<bool>& stopping) {
+    while (WaitForSingleObject(overlapped.hEvent, kStopPollMs) == WAIT_TIMEOUT) {
+        if (stopping.load()) {
+            CancelIo(pipe);
+            GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+            return false;
+        }
+    }
+    return GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) != FALSE;
+}
+
+ControlServer::ControlServer() {}
+
+ControlServer::~ControlServer() {}
+
+bool ControlServer::listen(const std::string& endpoint) {
+    if (endpoint.compare(0, 9, "\\\\.\\pipe\\") != 0) {
+        setError("Control endpoint must be a local pipe name (\\\\.\\pipe\\...): " + endpoint);
+        return false;
+    }
+    // FILE_FLAG_FIRST_PIPE_INSTANCE fails if another daemon owns the name
+    HANDLE pipe = CreatePipeInstance(endpoint, true);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        setError(error == ERROR_ACCESS_DENIED ? "Control pipe already in use: " + endpoint
+                                              : "CreateNamedPipe failed (" + std::to_string(error) + ")");
+        return false;
+    }
+    CloseHandle(pipe);
+    endpoint_ = endpoint;
+    return true;
+}
+
+void ControlServer::serveClient(void* handle) {
+    HANDLE pipe = static_cast<HANDLE>(handle);
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    std::string buffer;
+    std::string responses;
+    char chunk[4096];
+
+    while (!stopping_.load()) {
+        DWORD transferred = 0;
+        ResetEvent(overlapped.hEvent);
+        if (!ReadFile(pipe, chunk, sizeof(chunk), &transferred, &overlapped)) {
+            if (GetLastError() != ERROR_IO_PENDING) break;
+            if (!WaitOverlapped(pipe, overlapped, transferred, stopping_)) break;
+        }
+        if (transferred == 0) continue;
+
+        buffer.append(chunk, transferred);
+        responses.clear();
+        bool keep = DrainLines(*this, buffer, responses);
+
+        if (!responses.empty()) {
+            ResetEvent(overlapped.hEvent);
+            // Replies are always completed, so "shutdown" gets its answer
+            if (!WriteFile(pipe, responses.data(), static_cast<DWORD>(responses.size()), &transferred, &overlapped)) {
+                if (GetLastError() != ERROR_IO_PENDING) break;
+                if (!GetOverlappedResult(pipe, &overlapped, &transferred, TRUE)) break;
+            }
+        }
+        if (!keep) break;
+    }
+
+    DisconnectNamedPipe(pipe);
+    CloseHandle(pipe);
+    CloseHandle(overlapped.hEvent);
+    active_clients_.fetch_sub(1);
+}
+
+void ControlServer::run() {
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+    while (!stopping_.load()) {
+        HANDLE pipe = CreatePipeInstance(endpoint_, false);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            setError("CreateNamedPipe failed (" + std::to_string(GetLastError()) + ")");
+            Sleep(kStopPollMs);
+            continue;
+        }
+
+        ResetEvent(overlapped.hEvent);
+        bool connected = ConnectNamedPipe(pipe, &overlapped) != FALSE;
+        if (!connected) {
+            DWORD error = GetLastError();
+            DWORD transferred = 0;
+            if (error == ERROR_PIPE_CONNECTED) {
+                connected = true;
+            } else if (error == ERROR_IO_PENDING) {
+                connected = WaitOverlapped(pipe, overlapped, transferred, stopping_);
+            }
+        }
+        if (!connected) {
+            CloseHandle(pipe);
+            continue;
+        }
+
+        if (active_clients_.load() >= kMaxClients) {
+            DisconnectNamedPipe(pipe);
+            CloseHandle(pipe);
+            continue;
+        }
+        active_clients_.fetch_add(1);
+        std::thread(&ControlServer::serveClient, this, static_cast<void*>(pipe)).detach();
+    }
+
+    // Client threads notice stopping_ within kStopPollMs
+    while (active_clients_.load() > 0) {
+        Sleep(10);
+    }
+    CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+// Poll interval for noticing stop()
+static const int kStopPollMs = 200;
+
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+ControlServer::ControlServer() : listen_fd_(-1) {}
+
+ControlServer::~ControlServer() {
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(endpoint_.c_str());
+    }
+}
+
+bool ControlServer::listen(const std::string& endpoint) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (endpoint.empty() || endpoint.size() >= sizeof(addr.sun_path)) {
+        setError("Invalid control socket path: " + endpoint);
+        return false;
+    }
+    memcpy(addr.sun_path, endpoint.c_str(), endpoint.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        setError(std::string("socket failed: ") + strerror(errno));
+        return false;
+    }
+
+    // A socket file nobody answers on is left over from a crash
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+        close(fd);
+        setError("Control socket already in use: " + endpoint);
+        return false;
+    }
+    unlink(endpoint.c_str());
+
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        chmod(endpoint.c_str(), S_IRUSR | S_IWUSR) < 0 ||
+        ::listen(fd, static_cast<int>(kMaxClients)) < 0) {
+        setError("Cannot listen on " + endpoint + ": " + strerror(errno));
+        close(fd);
+        unlink(endpoint.c_str());
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    listen_fd_ = fd;
+    endpoint_ = endpoint;
+    return true;
+}
+
+void ControlServer::run() {
+    struct Client {
+        int fd;
+        std::string in;
+        std::string out;
+    };
+    std::vector<Client> clients;
+    std::vector<struct pollfd> fds;
+    char chunk[4096];
+
+    while (!stopping_.load() && listen_fd_ >= 0) {
+        fds.clear();
+        fds.push_back({ listen_fd_, static_cast<short>(clients.size() < kMaxClients ? POLLIN : 0), 0 });
+        for (const Client& client : clients) {
+            fds.push_back({ client.fd, static_cast<short>(client.out.empty() ? POLLIN : POLLOUT), 0 });
+        }
+        if (poll(fds.data(), fds.size(), kStopPollMs) <= 0) continue;
+
+        // Clients first: accepting appends to clients, which fds mirrors
+        for (size_t i = clients.size(); i-- > 0;) {
+            Client& client = clients[i];
+            short revents = fds[i + 1].revents;
+            bool keep = true;
+
+            if (revents & POLLOUT) {
+                ssize_t sent = send(client.fd, client.out.data(), client.out.size(), kSendFlags);
+                if (sent > 0) {
+                    client.out.erase(0, static_cast<size_t>(sent));
+                } else if (sent < 0 && errno != EAGAIN && errno != EINTR) {
+                    keep = false;
+                }
+            } else if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t received = recv(client.fd, chunk, sizeof(chunk), 0);
+                if (received > 0) {
+                    client.in.append(chunk, static_cast<size_t>(received));
+                    keep = DrainLines(*this, client.in, client.out);
+                } else if (received == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    keep = false;
+                }
+            }
+
+            if (!keep) {
+                close(client.fd);
+                clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while (clients.size() < kMaxClients && (fd = accept(listen_fd_, NULL, NULL)) >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+                clients.push_back({ fd, std::string(), std::string() });
+            }
+        }
+    }
+
+    // Deliver replies already queued (e.g. the answer to "shutdown")
+    for (const Client& client : clients) {
+        if (!client.out.empty()) {
+            fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL, 0) & ~O_NONBLOCK);
+            send(client.fd, client.out.data(), client.out.size(), kSendFlags);
+        }
+        close(client.fd);
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(endpoint_.c_str());
+        listen_fd_ = -1;
+    }
+}
+
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Builds one JSON value (object, array or scalar) with comma handling, for
+// control protocol results. Keys and strings are escaped; numbers are
+// written as doubles or unsigned integers.
+class JsonWriter {
+public:
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(const std::string& name);
+
+    JsonWriter& value(const std::string& text);
+    JsonWriter& value(const char* text) { return value(std::string(text)); }
+    JsonWriter& value(double number);
+    JsonWriter& value(uint64_t number);
+    JsonWriter& value(uint32_t number) { return value(static_cast<uint64_t>(number)); }
+    JsonWriter& value(bool flag);
+    JsonWriter& null();
+
+    bool empty() const { return out_.empty(); }
+    const std::string& str() const { return out_; }
+
+private:
+    std::string out_;
+    std::vector<bool> has_items_;   // one entry per open object/array
+    bool after_key_ = false;
+
+    void separate();
+};
+
+// Append text to out as a quoted, escaped JSON string
+void AppendJsonString(std::string& out, const std::string& text);
+
+// One parsed control request line
+struct ControlRequest {
+    uint64_t id;
+    std::string command;
+    std::vector<std::string> args;
+};
+
+// Parse "<id> <command> [arg ...]". Tokens are separated by spaces or tabs,
+// so arguments cannot contain whitespace (MACs, IPs, numbers and pcap
+// adapter names never do). Returns false for blank or malformed lines.
+bool ParseControlRequest(const std::string& line, ControlRequest& request);
+
+// Default endpoint: \\.\pipe\netshaperd on Windows, /run/netshaperd.sock
+// elsewhere
+std::string DefaultControlEndpoint();
+
+// Local control endpoint for netshaperd
+//
+// Clients connect to a Unix domain socket (POSIX) or a local named pipe
+// (Windows) and exchange newline-terminated lines:
+//
+//   request   <id> <command> [arg ...]
+//   response  {"id":<id>,"ok":true,"result":<json>}
+//             {"id":<id>,"ok":false,"error":"<message>"}
+//
+// Responses come back in request order on each connection. Commands are
+// dispatched to handlers registered with on(); handlers run one at a time
+// (on the server thread on POSIX, serialized across the per-client threads
+// on Windows), so they need no locking against each other. The socket is
+// created owner-only (0600); the pipe keeps the default DACL, which only
+// lets administrators and the owner write to it, and rejects remote clients.
+class ControlServer {
+public:
+    // Fill result and return true, or set error and return false. A handler
+    // that writes no result answers null.
+    using Handler = std::function<bool(const ControlRequest& request, JsonWriter& result, std::string& error)>;
+
+    static const size_t kMaxLineLength = 64 * 1024;
+    static const size_t kMaxClients = 16;
+
+    ControlServer();
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    void on(const std::string& command, Handler handler);
+
+    // Create the endpoint. A stale socket file left by a crashed daemon is
+    // replaced; a live one (another daemon answering) is an error.
+    bool listen(const std::string& endpoint);
+
+    // Serve clients until stop() is called. Closes the endpoint on return.
+    void run();
+
+    // Ask run() to return; safe from any thread and from signal handlers
+    void stop() { stopping_.store(true); }
+
+    // Dispatch one request line and return the response line (no newline).
+    // Used by run() and usable in-process without a connection.
+    std::string handleLine(const std::string& line);
+
+    const std::string& endpoint() const { return endpoint_; }
+    std::string lastError() const { return last_error_; }
+    uint64_t requestsHandled() const { return requests_handled_.load(std::memory_order_relaxed); }
+
+private:
+    std::map<std::string, Handler> handlers_;
+    std::mutex handler_mutex_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> requests_handled_{0};
+    std::string endpoint_;
+    std::string last_error_;
+#ifdef _WIN32
+    std::atomic<size_t> active_clients_{0};
+
+    void serveClient(void* pipe);
+#else
+    int listen_fd_;
+#endif
+
+    void setError(const std::string& error);
+};
@@ -0,0 +1,28 @@
+#include "cycle_clock.h"
+#include <chrono>
+#include <thread>
+
+static double MeasureTicksPerNs() {
+#ifdef NS_HAVE_TSC
+    auto start_time = std::chrono::steady_clock::now();
+    uint64_t start_ticks = ReadCycleClock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t end_ticks = ReadCycleClock();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    if (elapsed <= 0 || end_ticks <= start_ticks) return 1.0;
+    return static_cast<double>(end_ticks - start_ticks) / static_cast<double>(elapsed);
+#else
+    return 1.0;
+#endif
+}
+
+double CycleClockTicksPerNs() {
+    static const double ticks_per_ns = MeasureTicksPerNs();
+    return ticks_per_ns;
+}
+
+uint64_t SteadyClock::nowNs() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define NS_HAVE_TSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define NS_HAVE_TSC 1
+#else
+#include <chrono>
+#endif
+
+// Cheap timestamp for per-stage cost accounting
+//
+// On x86 this is the invariant TSC (a few ns to read, no syscall); elsewhere
+// it falls back to the steady clock in nanoseconds. Ticks are only
+// comparable within one process; convert with CycleClockTicksPerNs().
+inline uint64_t ReadCycleClock() {
+#ifdef NS_HAVE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Tick rate, measured once against the steady clock (about 10 ms on the
+// first call)
+double CycleClockTicksPerNs();
+
+inline uint64_t CycleClockToNs(uint64_t ticks) {
+    return static_cast<uint64_t>(static_cast<double>(ticks) / CycleClockTicksPerNs());
+}
+
+// Time source for the data plane: real (steady clock) or virtual, where the
+// caller sets the time explicitly (replay, simulation)
+class Clock {
+public:
+    virtual ~Clock() = default;
+    virtual uint64_t nowNs() const = 0;
+};
+
+class SteadyClock : public Clock {
+public:
+    uint64_t nowNs() const override;
+};
+
+class VirtualClock : public Clock {
+public:
+    explicit VirtualClock(uint64_t start_ns = 0) : now_ns_(start_ns) {}
+
+    uint64_t nowNs() const override { return now_ns_; }
+    void set(uint64_t now_ns) { now_ns_ = now_ns; }
+    void advance(uint64_t delta_ns) { now_ns_ += delta_ns; }
+
+private:
+    uint64_t now_ns_;
+};
@@ -0,0 +1,132 @@
+// netshaperctl: command line client for netshaperd
+//
+//   netshaperctl [--endpoint PATH] [--wait SECONDS] COMMAND [ARG ...]
+//
+// Sends one request (see control_server.h for the protocol and
+// netshaperd_main.cpp for the commands), prints the result JSON on stdout
+// and exits 0, or prints the error on stderr and exits 1. Exits 2 when the
+// daemon cannot be reached; with --wait it keeps retrying the connection
+// for that long first, which scripts use right after starting the daemon.
+#include "control_server.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// One request/response exchange over a fresh connection. Returns false if
+// the endpoint cannot be reached or closes before answering.
+static bool Exchange(const std::string& endpoint, const std::string& request, std::string& response) {
+    std::string line = request + "\n";
+    char chunk[4096];
+    response.clear();
+
+#ifdef _WIN32
+    HANDLE pipe = CreateFileA(endpoint.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (pipe == INVALID_HANDLE_VALUE) return false;
+
+    DWORD transferred = 0;
+    bool ok = WriteFile(pipe, line.data(), static_cast<DWORD>(line.size()), &transferred, NULL) != FALSE;
+    while (ok && response.find('\n') == std::string::npos) {
+        if (!ReadFile(pipe, chunk, sizeof(chunk), &transferred, NULL) || transferred == 0) {
+            ok = false;
+            break;
+        }
+        response.append(chunk, transferred);
+    }
+    CloseHandle(pipe);
+#else
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (endpoint.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, endpoint.c_str(), endpoint.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    bool ok = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+              send(fd, line.data(), line.size(), 0) == static_cast<ssize_t>(line.size());
+    while (ok && response.find('\n') == std::string::npos) {
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            ok = false;
+            break;
+        }
+        response.append(chunk, static_cast<size_t>(received));
+    }
+    close(fd);
+#endif
+
+    if (ok) response.erase(response.find('\n'));
+    return ok;
+}
+
+// Pull the "result" (after "ok":true) or "error" message out of a response
+// line; both follow the fixed prefix written by ControlServer::handleLine
+static bool SplitResponse(const std::string& response, std::string& payload) {
+    static const char kOk[] = ",\"ok\":true,\"result\":";
+    static const char kError[] = ",\"ok\":false,\"error\":";
+    size_t pos = response.find(kOk);
+    if (pos != std::string::npos) {
+        payload = response.substr(pos + sizeof(kOk) - 1, response.size() - pos - sizeof(kOk));
+        return true;
+    }
+    pos = response.find(kError);
+    payload = pos != std::string::npos
+        ? response.substr(pos + sizeof(kError) - 1, response.size() - pos - sizeof(kError))
+        : response;
+    return false;
+}
+
+int main(int argc, char** argv) {
+    std::string endpoint = DefaultControlEndpoint();
+    double wait_seconds = 0;
+    int i = 1;
+    for (; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--endpoint" && i + 1 < argc) {
+            endpoint = argv[++i];
+        } else if (arg == "--wait" && i + 1 < argc) {
+            wait_seconds = atof(argv[++i]);
+        } else {
+            break;
+        }
+    }
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [--endpoint PATH] [--wait SECONDS] COMMAND [ARG ...]\n", argv[0]);
+        return 2;
+    }
+
+    std::string request = "1";
+    for (; i < argc; ++i) {
+        request += ' ';
+        request += argv[i];
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(wait_seconds);
+    std::string response;
+    while (!Exchange(endpoint, request, response)) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            fprintf(stderr, "Cannot reach netshaperd at %s\n", endpoint.c_str());
+            return 2;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::string payload;
+    if (!SplitResponse(response, payload)) {
+        fprintf(stderr, "%s\n", payload.c_str());
+        return 1;
+    }
+    printf("%s\n", payload.c_str());
+    return 0;
+}
@@ -0,0 +1,381 @@
+// netshaperd: the native engine as a headless daemon
+//
+//   netshaperd [--endpoint PATH] [--adapter NAME] [--capture-profile PROFILE]
+//
+// Hosts the ARP/poisoning engine and the traffic control table without
+// Electron, so limits stay enforced on always-on machines and a UI crash
+// cannot take the data plane down. Clients (the Electron app, scripts) talk
+// to it over the control endpoint described in control_server.h; command
+// names and result shapes match the NetworkModule methods of the addon, so
+// the app can use either interchangeably (see src/main/daemonClient.ts).
+//
+// Commands:
+//   ping | status | shutdown
+//   enumerateNetworkAdapters | initializeArp ADAPTER [PROFILE] | getNetworkTopology
+//   sendArpRequest IP | getArpPerformanceStats | cleanupArp
+//   startArpPoisoning IP MAC | stopArpPoisoning IP
+//   setBandwidthLimit MAC DOWN UP | setDeviceBlocked MAC true|false
+//   removeTrafficControl MAC | getActiveControls
+//
+// The ARP commands need arp.cpp (Windows, Npcap) and are only available when
+// built with NETSHAPERD_WITH_ARP (the netshaperd target in binding.gyp). The
+// portable build from the bench CMake project serves the rest, which is what
+// ctest uses to exercise the protocol. On exit (SIGINT/SIGTERM, Ctrl+C or
+// "shutdown") poisoned devices are restored before the endpoint closes.
+// PROFILE is a capture preset (capture_profile.h): low-latency (default),
+// throughput or arp-only.
+#include "capture_profile.h"
+#include "control_server.h"
+#include "latency_histogram.h"
+#include "ring_log.h"
+#include "traffic_control.h"
+#include "traffic_counters.h"
+#ifdef NETSHAPERD_WITH_ARP
+#include "arp.h"
+#endif
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char* kVersion = "0.1.0";
+
+static ControlServer* g_server = nullptr;
+
+static void OnSignal(int) {
+    if (g_server) g_server->stop();
+}
+
+#ifdef _WIN32
+static BOOL WINAPI OnConsoleEvent(DWORD) {
+    OnSignal(0);
+    return TRUE;
+}
+#endif
+
+struct DaemonOptions {
+    std::string endpoint = DefaultControlEndpoint();
+    std::string adapter;
+    CapturePreset capture_preset = kCaptureLowLatency;
+};
+
+static bool ParseArgs(int argc, char** argv, DaemonOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--endpoint" && i + 1 < argc) {
+            options.endpoint = argv[++i];
+        } else if (arg == "--adapter" && i + 1 < argc) {
+            options.adapter = argv[++i];
+        } else if (arg == "--capture-profile" && i + 1 < argc) {
+            if (!ParseCapturePreset(argv[++i], options.capture_preset)) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ExpectArgs(const ControlRequest& request, size_t count, const char* usage, std::string& error) {
+    if (request.args.size() == count) return true;
+    error = std::string("Expected ") + request.command + " " + usage;
+    return false;
+}
+
+static bool ParseNumber(const std::string& text, double& number) {
+    char* end = nullptr;
+    number = strtod(text.c_str(), &end);
+    return !text.empty() && end && *end == '\0';
+}
+
+static void WriteTrafficCounters(JsonWriter& json, uint32_t counterSlot) {
+    TrafficCounters::Totals totals = GetTrafficCounters().read(counterSlot);
+    json.key("bytesDown").value(totals.bytes[kTrafficDown]);
+    json.key("bytesUp").value(totals.bytes[kTrafficUp]);
+    json.key("packetsDown").value(totals.packets[kTrafficDown]);
+    json.key("packetsUp").value(totals.packets[kTrafficUp]);
+    json.key("dropsDown").value(totals.drops[kTrafficDown]);
+    json.key("dropsUp").value(totals.drops[kTrafficUp]);
+}
+
+// Traffic control commands, backed by GetTrafficControls()
+static void RegisterTrafficControlCommands(ControlServer& server) {
+    server.on("setBandwidthLimit", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        double downloadLimit = 0, uploadLimit = 0;
+        if (!ExpectArgs(request, 3, "MAC DOWNLOAD_MBPS UPLOAD_MBPS", error)) return false;
+        if (!ParseNumber(request.args[1], downloadLimit) || !ParseNumber(request.args[2], uploadLimit) ||
+            !GetTrafficControls().setLimit(request.args[0], downloadLimit, uploadLimit)) {
+            error = "Bandwidth limits must be between 0 and 1000 Mbps";
+            return false;
+        }
+        NS_LOG_INFO("netshaperd: limit %s to %.1f/%.1f Mbps\n", request.args[0].c_str(), downloadLimit, uploadLimit);
+        result.value(true);
+        return true;
+    });
+
+    server.on("setDeviceBlocked", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        if (!ExpectArgs(request, 2, "MAC true|false", error)) return false;
+        const std::string& flag = request.args[1];
+        if (flag != "true" && flag != "false") {
+            error = "Expected true or false, got " + flag;
+            return false;
+        }
+        GetTrafficControls().setBlocked(request.args[0], flag == "true");
+        NS_LOG_INFO("netshaperd: %s %s\n", flag == "true" ? "block" : "unblock", request.args[0].c_str());
+        result.value(true);
+        return true;
+    });
+
+    server.on("removeTrafficControl", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        if (!ExpectArgs(request, 1, "MAC", error)) return false;
+        TrafficCounters::Totals totals;
+        GetTrafficControls().remove(request.args[0], totals);
+        result.value(true);
+        return true;
+    });
+
+    server.on("getActiveControls", [](const ControlRequest&, JsonWriter& result, std::string&) {
+        result.beginArray();
+        for (const TrafficControl& control : GetTrafficControls().list()) {
+            result.beginObject();
+            result.key("mac").value(control.deviceMac);
+            result.key("downloadLimit").value(control.downloadLimit);
+            result.key("uploadLimit").value(control.uploadLimit);
+            result.key("isBlocked").value(control.isBlocked);
+            result.key("isActive").value(control.isActive);
+            WriteTrafficCounters(result, control.counterSlot);
+            result.endObject();
+        }
+        result.endArray();
+        return true;
+    });
+}
+
+#ifdef NETSHAPERD_WITH_ARP
+
+static void WriteLatencySummary(JsonWriter& json, const LatencySummary& summary) {
+    json.beginObject();
+    json.key("count").value(summary.count);
+    json.key("meanMs").value(summary.mean_ms);
+    json.key("p50Ms").value(summary.p50_ms);
+    json.key("p90Ms").value(summary.p90_ms);
+    json.key("p99Ms").value(summary.p99_ms);
+    json.key("p999Ms").value(summary.p999_ms);
+    json.key("maxMs").value(summary.max_ms);
+    json.endObject();
+}
+
+// ARP, topology and poisoning commands, backed by the functions in arp.h
+static void RegisterArpCommands(ControlServer& server) {
+    server.on("enumerateNetworkAdapters", [](const ControlRequest&, JsonWriter& result, std::string&) {
+        result.beginArray();
+        for (const NetworkAdapter& adapter : GetNetworkAdapters()) {
+            result.beginObject();
+            result.key("name").value(adapter.name);
+            result.key("description").value(adapter.description);
+            result.key("friendlyName").value(adapter.friendly_name);
+            result.key("macAddress").value(adapter.mac_address);
+            result.key("ipAddress").value(adapter.ip_address);
+            result.key("subnetMask").value(adapter.subnet_mask);
+            result.key("gateway").value(adapter.gateway);
+            result.key("isActive").value(adapter.is_active);
+            result.key("isWireless").value(adapter.is_wireless);
+            result.key("pcapName").value(adapter.pcap_name);
+            result.endObject();
+        }
+        result.endArray();
+        return true;
+    });
+
+    server.on("initializeArp", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        CapturePreset preset = kCaptureLowLatency;
+        if (request.args.size() == 2) {
+            if (!ParseCapturePreset(request.args[1], preset)) {
+                error = "Unknown capture profile: " + request.args[1];
+                return false;
+            }
+        } else if (!ExpectArgs(request, 1, "ADAPTER [PROFILE]", error)) {
+            return false;
+        }
+        result.value(InitializeArpManager(request.args[0], preset));
+        return true;
+    });
+
+    server.on("getNetworkTopology", [](const ControlRequest&, JsonWriter& result, std::string&) {
+        NetworkInfo topology = GetNetworkTopology();
+        result.beginObject();
+        result.key("localIp").value(topology.local_ip);
+        result.key("subnetMask").value(topology.subnet_mask);
+        result.key("gatewayIp").value(topology.gateway_ip);
+        result.key("gatewayMac").value(topology.gateway_mac);
+        result.key("interfaceName").value(topology.interface_name);
+        result.key("interfaceMac").value(topology.interface_mac);
+        result.key("subnetCidr").value(topology.subnet_cidr);
+        result.key("isValid").value(topology.is_valid);
+        result.endObject();
+        return true;
+    });
+
+    server.on("sendArpRequest", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        if (!ExpectArgs(request, 1, "IP", error)) return false;
+        result.value(SendArpRequest(request.args[0]));
+        return true;
+    });
+
+    server.on("getArpPerformanceStats", [](const ControlRequest&, JsonWriter& result, std::string&) {
+        ArpManager::PerformanceStats stats = GetArpPerformanceStats();
+        result.beginObject();
+        result.key("packetsSent").value(stats.packets_sent);
+        result.key("packetsReceived").value(stats.packets_received);
+        result.key("sendErrors").value(stats.send_errors);
+        result.key("receiveErrors").value(stats.receive_errors);
+        result.key("avgSendTimeMs").value(stats.avg_send_time_ms);
+        result.key("avgReceiveTimeMs").value(stats.avg_receive_time_ms);
+        result.key("sendLatency");
+        WriteLatencySummary(result, stats.send_latency);
+        result.key("receiveLatency");
+        WriteLatencySummary(result, stats.receive_latency);
+        result.key("captureProfile").value(stats.capture_profile ? stats.capture_profile : "");
+        result.key("captureBufferBytes").value(stats.capture_buffer_bytes);
+        result.key("captureReceived").value(stats.capture.received);
+        result.key("captureDropped").value(stats.capture.dropped);
+        result.key("captureInterfaceDropped").value(stats.capture.interface_dropped);
+        result.key("stageLatency").beginObject();
+        for (int stage = 0; stage < kStageCount; ++stage) {
+            LatencyStage latencyStage = static_cast<LatencyStage>(stage);
+            result.key(LatencyStageName(latencyStage));
+            WriteLatencySummary(result, GetStageLatency(latencyStage).summarize());
+        }
+        result.endObject();
+        result.endObject();
+        return true;
+    });
+
+    server.on("cleanupArp", [](const ControlRequest&, JsonWriter&, std::string&) {
+        CleanupArpManager();
+        return true;
+    });
+
+    server.on("startArpPoisoning", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        if (!ExpectArgs(request, 2, "IP MAC", error)) return false;
+        result.value(StartArpPoisoning(request.args[0], request.args[1]));
+        return true;
+    });
+
+    server.on("stopArpPoisoning", [](const ControlRequest& request, JsonWriter& result, std::string& error) {
+        if (!ExpectArgs(request, 1, "IP", error)) return false;
+        result.value(StopArpPoisoning(request.args[0]));
+        return true;
+    });
+}
+
+#else
+
+// Without arp.cpp the ARP commands answer with an error instead of
+// "Unknown command", so clients can tell a partial build from a typo
+static void RegisterArpCommands(ControlServer& server) {
+    static const char* kArpCommands[] = {
+        "enumerateNetworkAdapters", "initializeArp", "getNetworkTopology", "sendArpRequest",
+        "getArpPerformanceStats", "cleanupArp", "startArpPoisoning", "stopArpPoisoning"
+    };
+    for (const char* command : kArpCommands) {
+        server.on(command, [](const ControlRequest& request, JsonWriter&, std::string& error) {
+            error = request.command + " is not available: netshaperd was built without the ARP engine";
+            return false;
+        });
+    }
+}
+
+#endif
+
+int main(int argc, char** argv) {
+    DaemonOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--endpoint PATH] [--adapter NAME] [--capture-profile PROFILE]\n", argv[0]);
+        return 2;
+    }
+
+    ControlServer server;
+    auto started = std::chrono::steady_clock::now();
+
+    server.on("ping", [](const ControlRequest&, JsonWriter& result, std::string&) {
+        result.value("pong");
+        return true;
+    });
+    server.on("status", [&server, started](const ControlRequest&, JsonWriter& result, std::string&) {
+        double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        result.beginObject();
+        result.key("version").value(kVersion);
+#ifdef _WIN32
+        result.key("pid").value(static_cast<uint64_t>(GetCurrentProcessId()));
+#else
+        result.key("pid").value(static_cast<uint64_t>(getpid()));
+#endif
+#ifdef NETSHAPERD_WITH_ARP
+        result.key("arpEngine").value(true);
+        result.key("arpInitialized").value(g_arp_manager != nullptr);
+#else
+        result.key("arpEngine").value(false);
+        result.key("arpInitialized").value(false);
+#endif
+        result.key("uptimeSeconds").value(uptime);
+        result.key("activeControls").value(static_cast<uint64_t>(GetTrafficControls().size()));
+        result.key("requestsHandled").value(server.requestsHandled());
+        result.key("logDropped").value(LogDroppedCount());
+        result.endObject();
+        return true;
+    });
+    server.on("shutdown", [&server](const ControlRequest&, JsonWriter& result, std::string&) {
+        server.stop();
+        result.value(true);
+        return true;
+    });
+    RegisterTrafficControlCommands(server);
+    RegisterArpCommands(server);
+
+#ifdef NETSHAPERD_WITH_ARP
+    if (!options.adapter.empty() && !InitializeArpManager(options.adapter, options.capture_preset)) {
+        LogFlush();   // the engine's reasons, before exiting
+        fprintf(stderr, "netshaperd: cannot initialize adapter %s\n", options.adapter.c_str());
+        return 1;
+    }
+#else
+    if (!options.adapter.empty()) {
+        fprintf(stderr, "netshaperd: --adapter needs the ARP engine, which this build does not include\n");
+        return 2;
+    }
+#endif
+
+    if (!server.listen(options.endpoint)) {
+        fprintf(stderr, "netshaperd: %s\n", server.lastError().c_str());
+        return 1;
+    }
+
+    g_server = &server;
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+#ifdef _WIN32
+    SetConsoleCtrlHandler(OnConsoleEvent, TRUE);
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    fprintf(stderr, "netshaperd %s listening on %s\n", kVersion, server.endpoint().c_str());
+    server.run();
+    g_server = nullptr;
+
+#ifdef NETSHAPERD_WITH_ARP
+    // Restores the ARP caches of every poisoned device
+    CleanupArpManager();
+#endif
+    LogFlush();
+    fprintf(stderr, "netshaperd stopped after %llu requests\n",
+            static_cast<unsigned long long>(server.requestsHandled()));
+    return 0;
+}
@@ -0,0 +1,706 @@
+#include "data_plane.h"
+#include <algorithm>
+#include <cstring>
+
+static const size_t kEthernetHeaderSize = 14;
+static const size_t kVlanTagSize = 4;
+static const size_t kIpv4MinHeaderSize = 20;
+static const uint16_t kEtherTypeIpv4 = 0x0800;
+static const uint16_t kEtherTypeVlan = 0x8100;
+static const uint8_t kProtocolTcp = 6;
+static const uint8_t kProtocolUdp = 17;
+static const size_t kTcpMinHeaderSize = 20;
+static const uint64_t kWindowIntervalNs = 100000000;   // window shaping: flow activity interval
+static const uint64_t kMinWindowRttNs = 1000000;       // RTTs below this are treated as 1 ms
+static const double kDefaultMss = 1460.0;
+static const double kMaxWindowBytes = 1 << 30;
+static const double kBurstSeconds = 0.05;          // bucket depth: 50 ms at the configured rate
+static const double kMinBurstBytes = 2 * 1514.0;   // at least two full frames
+
+static inline uint16_t ReadBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ReadBe32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline uint32_t IpKey(const uint8_t* ip) {
+    return ReadBe32(ip);
+}
+
+const char* DropReasonName(DropReason reason) {
+    switch (reason) {
+        case kDropNone: return "forwarded";
+        case kDropMalformed: return "malformed";
+        case kDropNotIpv4: return "not_ipv4";
+        case kDropOwnFrame: return "own_frame";
+        case kDropUnmanaged: return "unmanaged";
+        case kDropBlocked: return "blocked";
+        case kDropRateLimited: return "rate_limited";
+        case kDropSendFailed: return "send_failed";
+        case kDropAckFiltered: return "ack_filtered";
+        default: return "unknown";
+    }
+}
+
+void DataPlane::TokenBucket::configure(double mbps, uint64_t now_ns) {
+    rate = mbps > 0 ? mbps * 1e6 / 8.0 / 1e9 : 0.0;
+    burst = std::max(rate * kBurstSeconds * 1e9, kMinBurstBytes);
+    tokens = burst;
+    last_ns = now_ns;
+}
+
+void DataPlane::TokenBucket::refill(uint64_t now_ns) {
+    if (now_ns > last_ns) {
+        tokens = std::min(burst, tokens + static_cast<double>(now_ns - last_ns) * rate);
+        last_ns = now_ns;
+    }
+}
+
+bool DataPlane::TokenBucket::take(size_t bytes, uint64_t now_ns) {
+    refill(now_ns);
+    if (tokens < static_cast<double>(bytes)) return false;
+    tokens -= static_cast<double>(bytes);
+    return true;
+}
+
+bool DataPlane::TokenBucket::charge(size_t bytes, uint64_t now_ns) {
+    refill(now_ns);
+    bool enough = tokens >= static_cast<double>(bytes);
+    tokens = std::max(-burst, tokens - static_cast<double>(bytes));
+    return enough;
+}
+
+// The TCP segment of an unfragmented IPv4 packet as an ACK; ack_number is
+// set for pure ACKs
+static TcpAckKind ReadPureAck(const uint8_t* frame, size_t length, size_t l3_offset, uint32_t& ack_number) {
+    const uint8_t* l3 = frame + l3_offset;
+    size_t ip_header_length = static_cast<size_t>(l3[0] & 0x0F) * 4;
+    size_t l4_offset = l3_offset + ip_header_length;
+    if (l3[9] != kProtocolTcp || (ReadBe16(l3 + 6) & 0x3FFF) != 0 || length < l4_offset + kTcpMinHeaderSize) {
+        return kTcpNotPureAck;
+    }
+    const uint8_t* tcp = frame + l4_offset;
+    size_t header_length = static_cast<size_t>(tcp[12] >> 4) * 4;
+    size_t ip_length = ReadBe16(l3 + 2);
+    if (header_length < kTcpMinHeaderSize || length < l4_offset + header_length ||
+        ip_length < ip_header_length + header_length) {
+        return kTcpNotPureAck;
+    }
+    TcpAckKind kind = ClassifyTcpAck(tcp, header_length, ip_length - ip_header_length - header_length);
+    if (kind != kTcpNotPureAck) ack_number = ReadBe32(tcp + 8);
+    return kind;
+}
+
+DataPlane::DataPlane(const Config& config, PacketIO* io, const Clock& clock)
+    : config_(config), our_key_(MacKey(config.our_mac)), gateway_key_(MacKey(config.gateway_mac)),
+      io_(io), clock_(clock), profiling_(false), ack_filter_devices_(0), destinations_version_(0),
+      active_version_(0) {
+    frame_classifier_.setAddresses(config.our_mac, config.gateway_mac);
+    resetStats();
+}
+
+DataPlane::~DataPlane() {}
+
+bool DataPlane::setDevice(const DevicePolicy& policy) {
+    uint64_t key = MacKey(policy.mac);
+    if (key == our_key_ || key == gateway_key_) return false;
+    if (!IsValidPriorityMark(policy.mark)) {
+        last_error_ = "Invalid priority mark";
+        return false;
+    }
+
+    uint64_t now = clock_.nowNs();
+    auto it = devices_.find(key);
+    if (it == devices_.end()) {
+        Device device;
+        device.policy = policy;
+        device.buckets[kTrafficDown].configure(policy.download_mbps, now);
+        device.buckets[kTrafficUp].configure(policy.upload_mbps, now);
+        memset(&device.stats, 0, sizeof(device.stats));
+        device.window_interval = 0;
+        device.window_flows = 0;
+        device.window_flows_last = 0;
+        if (free_device_slots_.empty()) {
+            device.slot = static_cast<uint32_t>(device_slots_.size());
+            device_slots_.push_back(nullptr);
+        } else {
+            device.slot = free_device_slots_.back();
+            free_device_slots_.pop_back();
+        }
+        Device& added = devices_.emplace(key, device).first->second;
+        device_slots_[added.slot] = &added;
+        frame_classifier_.managed().insert(key, added.slot);
+        if (policy.ack_handling == kAckFilter) ++ack_filter_devices_;
+    } else {
+        Device& device = it->second;
+        // The IP may have moved to another device since
+        auto ip_it = ip_to_mac_.find(IpKey(device.policy.ip));
+        if (ip_it != ip_to_mac_.end() && ip_it->second == key) {
+            ip_to_mac_.erase(ip_it);
+        }
+        if (device.policy.download_mbps != policy.download_mbps) {
+            device.buckets[kTrafficDown].configure(policy.download_mbps, now);
+        }
+        if (device.policy.upload_mbps != policy.upload_mbps) {
+            device.buckets[kTrafficUp].configure(policy.upload_mbps, now);
+        }
+        if (device.policy.ack_handling == kAckFilter) --ack_filter_devices_;
+        if (policy.ack_handling == kAckFilter) ++ack_filter_devices_;
+        device.policy = policy;
+    }
+
+    ip_to_mac_[IpKey(policy.ip)] = key;
+    return true;
+}
+
+bool DataPlane::removeDevice(const uint8_t* mac) {
+    auto it = devices_.find(MacKey(mac));
+    if (it == devices_.end()) return false;
+
+    auto ip_it = ip_to_mac_.find(IpKey(it->second.policy.ip));
+    if (ip_it != ip_to_mac_.end() && ip_it->second == it->first) {
+        ip_to_mac_.erase(ip_it);
+    }
+    if (it->second.policy.ack_handling == kAckFilter) --ack_filter_devices_;
+    frame_classifier_.managed().erase(it->first);
+    device_slots_[it->second.slot] = nullptr;
+    free_device_slots_.push_back(it->second.slot);
+    devices_.erase(it);
+    return true;
+}
+
+std::vector<DevicePolicy> DataPlane::devices() const {
+    std::vector<DevicePolicy> result;
+    result.reserve(devices_.size());
+    for (const auto& entry : devices_) {
+        result.push_back(entry.second.policy);
+    }
+    return result;
+}
+
+bool DataPlane::deviceStats(const uint8_t* mac, DeviceStats& stats) const {
+    auto it = devices_.find(MacKey(mac));
+    if (it == devices_.end()) return false;
+    stats = it->second.stats;
+    return true;
+}
+
+void DataPlane::resetStats() {
+    memset(&stats_, 0, sizeof(stats_));
+    for (auto& entry : devices_) {
+        memset(&entry.second.stats, 0, sizeof(entry.second.stats));
+    }
+}
+
+void DataPlane::setFlowTracking(uint32_t capacity, uint64_t idle_timeout_ns) {
+    flows_.reset(capacity ? new FlowTable(capacity, idle_timeout_ns) : nullptr);
+}
+
+bool DataPlane::setRules(const std::vector<ShapingRule>& rules) {
+    if (!classifier_.compile(rules)) {
+        last_error_ = classifier_.lastError();
+        return false;
+    }
+
+    uint64_t now = clock_.nowNs();
+    const std::vector<ShapingRule>& compiled = classifier_.rules();
+    rule_state_.assign(compiled.size(), Rule());
+    for (size_t i = 0; i < compiled.size(); ++i) {
+        bool limited = compiled[i].action == kRuleLimit;
+        rule_state_[i].action = compiled[i].action;
+        rule_state_[i].mark = compiled[i].mark;
+        rule_state_[i].buckets[kTrafficDown].configure(limited ? compiled[i].download_mbps : 0, now);
+        rule_state_[i].buckets[kTrafficUp].configure(limited ? compiled[i].upload_mbps : 0, now);
+        memset(&rule_state_[i].stats, 0, sizeof(RuleStats));
+    }
+    if (flows_) flows_->forEach([](FlowEntry& entry) { entry.user_data = 0; });
+    return true;
+}
+
+bool DataPlane::setDestinations(const std::vector<DestinationPolicy>& policies) {
+    std::shared_ptr<DestinationSet> set;
+    if (!policies.empty()) {
+        if (policies.size() > LpmTable::kMaxValue) {
+            last_error_ = "Too many destination policies";
+            return false;
+        }
+        set = std::make_shared<DestinationSet>();
+        std::vector<Ipv4Prefix> prefixes;
+        for (size_t i = 0; i < policies.size(); ++i) {
+            for (const auto& prefix : policies[i].prefixes) {
+                prefixes.push_back({ prefix.first, prefix.second, static_cast<uint16_t>(i + 1) });
+            }
+        }
+        if (!set->table.build(prefixes)) {
+            last_error_ = set->table.lastError();
+            return false;
+        }
+
+        uint64_t now = clock_.nowNs();
+        set->policies = policies;
+        set->state.assign(policies.size(), Rule());
+        for (size_t i = 0; i < policies.size(); ++i) {
+            Rule& state = set->state[i];
+            bool limited = policies[i].action == kRuleLimit;
+            state.action = policies[i].action;
+            state.buckets[kTrafficDown].configure(limited ? policies[i].download_mbps : 0, now);
+            state.buckets[kTrafficUp].configure(limited ? policies[i].upload_mbps : 0, now);
+            memset(&state.stats, 0, sizeof(RuleStats));
+        }
+    }
+
+    std::atomic_store(&pending_destinations_, set);
+    destinations_version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool DataPlane::destinationStats(uint32_t policy_id, RuleStats& stats) const {
+    std::shared_ptr<DestinationSet> set = std::atomic_load(&pending_destinations_);
+    if (!set) return false;
+    for (size_t i = 0; i < set->policies.size(); ++i) {
+        if (set->policies[i].id == policy_id) {
+            stats = set->state[i].stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DataPlane::ruleStats(uint32_t rule_id, RuleStats& stats) const {
+    const std::vector<ShapingRule>& compiled = classifier_.rules();
+    for (size_t i = 0; i < compiled.size(); ++i) {
+        if (compiled[i].id == rule_id) {
+            stats = rule_state_[i].stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+DropReason DataPlane::classify(const uint8_t* frame, size_t length, Device*& device,
+                               TrafficDirection& direction, size_t& l3_offset, const FrameClass* hint) {
+    if (length < kEthernetHeaderSize) return kDropMalformed;
+
+    l3_offset = kEthernetHeaderSize;
+    uint16_t ethertype = ReadBe16(frame + 12);
+    if (ethertype == kEtherTypeVlan) {
+        if (length < kEthernetHeaderSize + kVlanTagSize) return kDropMalformed;
+        ethertype = ReadBe16(frame + 16);
+        l3_offset += kVlanTagSize;
+    }
+    if (ethertype != kEtherTypeIpv4) return kDropNotIpv4;
+    if (length < l3_offset + kIpv4MinHeaderSize || (frame[l3_offset] >> 4) != 4) return kDropMalformed;
+
+    uint64_t src_key = MacKey(frame + 6);
+    if (src_key == our_key_) return kDropOwnFrame;
+
+    if (src_key == gateway_key_) {
+        // Downstream: poisoned frames are addressed to our MAC, so fall back
+        // to the destination IP
+        direction = kTrafficDown;
+        if (hint && (hint->flags & kFrameDstManaged)) {
+            device = device_slots_[hint->dst_value];
+            return kDropNone;
+        }
+        uint64_t dst_key = MacKey(frame);
+        if (dst_key == our_key_) {
+            auto ip_it = ip_to_mac_.find(IpKey(frame + l3_offset + 16));
+            if (ip_it == ip_to_mac_.end()) return kDropUnmanaged;
+            dst_key = ip_it->second;
+        } else if (hint) {
+            return kDropUnmanaged;
+        }
+        auto it = devices_.find(dst_key);
+        if (it == devices_.end()) return kDropUnmanaged;
+        device = &it->second;
+        return kDropNone;
+    }
+
+    direction = kTrafficUp;
+    if (hint) {
+        if (!(hint->flags & kFrameSrcManaged)) return kDropUnmanaged;
+        device = device_slots_[hint->src_value];
+        return kDropNone;
+    }
+    auto it = devices_.find(src_key);
+    if (it == devices_.end()) return kDropUnmanaged;
+    device = &it->second;
+    return kDropNone;
+}
+
+// Ports and TCP flags are left 0 for non-first fragments, truncated L4
+// headers and protocols without ports
+void DataPlane::parseTuple(const uint8_t* frame, size_t length, size_t l3_offset, PacketTuple& tuple) const {
+    const uint8_t* l3 = frame + l3_offset;
+    size_t header_length = static_cast<size_t>(l3[0] & 0x0F) * 4;
+    bool first_fragment = (ReadBe16(l3 + 6) & 0x1FFF) == 0;
+    size_t l4_offset = l3_offset + header_length;
+
+    tuple.src_ip = IpKey(l3 + 12);
+    tuple.dst_ip = IpKey(l3 + 16);
+    tuple.protocol = l3[9];
+    tuple.src_port = 0;
+    tuple.dst_port = 0;
+    tuple.tcp_flags = 0;
+    if (header_length >= kIpv4MinHeaderSize && first_fragment &&
+        (tuple.protocol == kProtocolTcp || tuple.protocol == kProtocolUdp) && length >= l4_offset + 4) {
+        tuple.src_port = ReadBe16(frame + l4_offset);
+        tuple.dst_port = ReadBe16(frame + l4_offset + 2);
+        if (tuple.protocol == kProtocolTcp && length >= l4_offset + 14) tuple.tcp_flags = frame[l4_offset + 13];
+    }
+}
+
+// Verdict cached in FlowEntry::user_data: 0 = not classified yet,
+// kNoRuleCached = no rule matched, else rule index + 1
+static const uint32_t kNoRuleCached = 0xFFFFFFFF;
+
+uint32_t DataPlane::matchRule(const Device& device, TrafficDirection direction, const PacketTuple& tuple,
+                              FlowEntry* flow) const {
+    if (flow && flow->user_data) {
+        return flow->user_data == kNoRuleCached ? RuleClassifier::kNoRule : flow->user_data - 1;
+    }
+
+    RuleMatchFields fields;
+    fields.mac = MacKey(device.policy.mac);
+    fields.protocol = tuple.protocol;
+    fields.local_port = direction == kTrafficUp ? tuple.src_port : tuple.dst_port;
+    fields.remote_port = direction == kTrafficUp ? tuple.dst_port : tuple.src_port;
+    uint32_t rule = classifier_.classify(fields);
+    if (flow) flow->user_data = rule == RuleClassifier::kNoRule ? kNoRuleCached : rule + 1;
+    return rule;
+}
+
+DataPlane::Rule* DataPlane::matchDestination(const uint8_t* l3, TrafficDirection direction) {
+    uint64_t version = destinations_version_.load(std::memory_order_acquire);
+    if (version != active_version_) {
+        active_destinations_ = std::atomic_load(&pending_destinations_);
+        active_version_ = version;
+    }
+    if (!active_destinations_) return nullptr;
+
+    uint16_t value = active_destinations_->table.lookup(IpKey(l3 + (direction == kTrafficUp ? 16 : 12)));
+    return value == LpmTable::kNoMatch ? nullptr : &active_destinations_->state[value - 1];
+}
+
+// Blocks first, so no bucket spends tokens on a packet that is dropped
+// anyway; a limiting rule or destination polices in addition to the device
+// unless the other one exempts the packet. Prioritized ACKs are charged to
+// every bucket but always pass.
+DropReason DataPlane::shape(Device& device, TrafficDirection direction, size_t bytes, uint64_t now_ns,
+                            Rule* rule, Rule* destination, bool pure_ack) {
+    if (device.policy.blocked) return kDropBlocked;
+    if ((rule && rule->action == kRuleBlock) || (destination && destination->action == kRuleBlock)) {
+        return kDropBlocked;
+    }
+    bool exempt = (rule && rule->action == kRulePrioritize) ||
+                  (destination && destination->action == kRulePrioritize);
+    if (pure_ack) {
+        bool short_bucket = false;
+        for (Rule* policy : { rule, destination }) {
+            if (!policy || policy->action != kRuleLimit) continue;
+            TokenBucket& policy_bucket = policy->buckets[direction];
+            if (policy_bucket.rate > 0 && !policy_bucket.charge(bytes, now_ns)) short_bucket = true;
+        }
+        TokenBucket& bucket = device.buckets[direction];
+        if (!exempt && bucket.rate > 0 && !bucket.charge(bytes, now_ns)) short_bucket = true;
+        if (short_bucket) ++stats_.acks_prioritized;
+        return kDropNone;
+    }
+
+    for (Rule* policy : { rule, destination }) {
+        if (!policy || policy->action != kRuleLimit) continue;
+        TokenBucket& policy_bucket = policy->buckets[direction];
+        if (policy_bucket.rate > 0 && !policy_bucket.take(bytes, now_ns)) return kDropRateLimited;
+    }
+    if (exempt) return kDropNone;
+
+    TokenBucket& bucket = device.buckets[direction];
+    if (bucket.rate > 0 && !bucket.take(bytes, now_ns)) return kDropRateLimited;
+    return kDropNone;
+}
+
+// Rewrites TCP headers only: MSS on SYNs, and the window of every other
+// segment of a flow whose handshake (window scales, RTT) was seen. Frames
+// carry windows for the opposite direction, so upstream ones are held to
+// the download rate and downstream ones to the upload rate.
+void DataPlane::shapeWindow(uint8_t* frame, size_t length, size_t l3_offset, Device& device,
+                            TrafficDirection direction, FlowEntry* flow, uint64_t now_ns) {
+    const uint8_t* l3 = frame + l3_offset;
+    size_t l4_offset = l3_offset + static_cast<size_t>(l3[0] & 0x0F) * 4;
+    if (l3[9] != kProtocolTcp || (ReadBe16(l3 + 6) & 0x1FFF) != 0 || length < l4_offset + kTcpMinHeaderSize) return;
+    uint8_t* tcp = frame + l4_offset;
+    size_t header_length = static_cast<size_t>(tcp[12] >> 4) * 4;
+    if (header_length < kTcpMinHeaderSize || length < l4_offset + header_length) return;
+
+    if (tcp[13] & kTcpSyn) {
+        TcpSynOptions options;
+        if (!ParseTcpSynOptions(tcp, header_length, options)) return;
+        if (device.policy.clamp_mss && options.mss_offset && ClampTcpMss(tcp, options.mss_offset,
+                                                                         device.policy.clamp_mss)) {
+            ++stats_.mss_clamped;
+        }
+        if (flow) RecordWindowScale(flow->window_scale[direction], options.window_scale);
+        return;
+    }
+    if (!device.policy.window_shaping || !flow || !flow->rtt_ns) return;
+    int shift = EffectiveWindowShift(flow->window_scale[direction], flow->window_scale[1 - direction]);
+    double rate = device.buckets[direction == kTrafficUp ? kTrafficDown : kTrafficUp].rate;
+    if (shift < 0 || rate <= 0) return;
+
+    // Active flows: those seen in this interval or the one before
+    uint64_t interval = now_ns / kWindowIntervalNs;
+    if (interval != device.window_interval) {
+        device.window_flows_last = interval == device.window_interval + 1 ? device.window_flows : 0;
+        device.window_flows = 0;
+        device.window_interval = interval;
+    }
+    if (flow->window_interval != static_cast<uint32_t>(interval)) {
+        flow->window_interval = static_cast<uint32_t>(interval);
+        ++device.window_flows;
+    }
+    uint32_t flows = std::max(std::max(device.window_flows, device.window_flows_last), 1u);
+
+    uint64_t rtt = std::max(flow->rtt_ns, kMinWindowRttNs);
+    double window = rate * static_cast<double>(rtt) / flows;
+    double floor = 2.0 * (device.policy.clamp_mss ? device.policy.clamp_mss : kDefaultMss);
+    window = std::min(std::max(window, floor), kMaxWindowBytes);
+    if (ClampTcpWindow(tcp, static_cast<uint32_t>(window), static_cast<uint8_t>(shift))) ++stats_.windows_clamped;
+}
+
+// Fields the rule sets replace the device's
+static inline void MergeMark(PriorityMark& mark, const PriorityMark& rule) {
+    if (rule.flags & kMarkDscp) mark.dscp = rule.dscp;
+    if (rule.flags & kMarkVlanPriority) {
+        mark.pcp = rule.pcp;
+        mark.vlan_id = rule.vlan_id;
+    }
+    mark.flags |= rule.flags;
+}
+
+DropReason DataPlane::forward(uint8_t* frame, size_t length, size_t l3_offset, const Device& device,
+                              TrafficDirection direction, const PriorityMark& mark) {
+    memcpy(frame, direction == kTrafficUp ? config_.gateway_mac : device.policy.mac, 6);
+    memcpy(frame + 6, config_.our_mac, 6);
+
+    bool marked = mark.flags != 0;
+    if (marked) {
+        if (mark.flags & kMarkDscp) MarkIpv4Dscp(frame + l3_offset, mark.dscp);
+        if (mark.flags & kMarkVlanPriority) {
+            if (l3_offset > kEthernetHeaderSize) {
+                SetVlanPriority(frame + kEthernetHeaderSize, mark.pcp);
+            } else {
+                if (tag_buffer_.size() < length + kVlanTagSize) tag_buffer_.resize(length + kVlanTagSize);
+                length = InsertVlanTag(frame, length, mark.pcp, mark.vlan_id, tag_buffer_.data());
+                frame = tag_buffer_.data();
+            }
+        }
+    }
+    if (io_ && !io_->send(frame, length)) return kDropSendFailed;
+    if (marked) ++stats_.marked;
+    return kDropNone;
+}
+
+DropReason DataPlane::process(uint8_t* frame, size_t length, size_t wire_length) {
+    return processFrame(frame, length, wire_length, nullptr, false);
+}
+
+// Policy and buckets, and the stats that follow
+template <typename T>
+static inline void PrefetchDevice(const T* device) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(device);
+    __builtin_prefetch(reinterpret_cast<const char*>(device) + 64, 1);
+    __builtin_prefetch(reinterpret_cast<const char*>(device) + 128, 1);
+#else
+    (void)device;
+#endif
+}
+
+// The burst stands in for CAKE's queue: an ACK is superseded by the next
+// pure ACK of its flow (same direction) in the burst when that one
+// acknowledges more. Duplicate ACKs are kept for fast retransmit, and only
+// plain ACKs are dropped, so the newer ACK carries everything they did.
+void DataPlane::findSupersededAcks(const ReceivedFrame* frames, size_t count, const FrameClass* classes,
+                                   bool* superseded) {
+    // Newest pure ACK of each flow so far
+    struct LatestAck {
+        uint32_t src_ip;
+        uint32_t dst_ip;
+        uint32_t ports;
+        uint32_t ack_number;
+        uint32_t index;
+        bool plain;
+    };
+    LatestAck latest[PacketIO::kMaxBurst];
+    size_t flows = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        superseded[i] = false;
+        const ReceivedFrame& frame = frames[i];
+        Device* device = nullptr;
+        TrafficDirection direction = kTrafficUp;
+        size_t l3_offset = 0;
+        if (classify(frame.data, frame.length, device, direction, l3_offset, &classes[i]) != kDropNone) continue;
+        if (device->policy.ack_handling != kAckFilter || device->buckets[direction].rate <= 0) continue;
+        uint32_t ack_number = 0;
+        TcpAckKind kind = ReadPureAck(frame.data, frame.length, l3_offset, ack_number);
+        if (kind == kTcpNotPureAck) continue;
+
+        const uint8_t* l3 = frame.data + l3_offset;
+        LatestAck ack;
+        ack.src_ip = IpKey(l3 + 12);
+        ack.dst_ip = IpKey(l3 + 16);
+        ack.ports = ReadBe32(l3 + static_cast<size_t>(l3[0] & 0x0F) * 4);
+        ack.ack_number = ack_number;
+        ack.index = static_cast<uint32_t>(i);
+        ack.plain = kind == kTcpPlainAck;
+
+        size_t f = 0;
+        while (f < flows && (latest[f].src_ip != ack.src_ip || latest[f].dst_ip != ack.dst_ip ||
+                             latest[f].ports != ack.ports)) {
+            ++f;
+        }
+        if (f == flows) {
+            ++flows;
+        } else if (latest[f].plain && static_cast<int32_t>(ack.ack_number - latest[f].ack_number) > 0) {
+            superseded[latest[f].index] = true;
+        }
+        latest[f] = ack;
+    }
+}
+
+void DataPlane::processBurst(ReceivedFrame* frames, size_t count, DropReason* results) {
+    FrameClass classes[PacketIO::kMaxBurst];
+    bool superseded[PacketIO::kMaxBurst];
+    for (size_t done = 0; done < count; done += PacketIO::kMaxBurst) {
+        size_t batch = count - done < PacketIO::kMaxBurst ? count - done : PacketIO::kMaxBurst;
+        // The batch pass is charged to the classify stage
+        uint64_t t0 = profiling_ ? ReadCycleClock() : 0;
+        frame_classifier_.classify(frames + done, batch, classes);
+        // Device state of the whole batch is in flight before the first
+        // frame needs it
+        for (size_t i = 0; i < batch; ++i) {
+            const FrameClass& frame_class = classes[i];
+            if ((frame_class.flags & (kFrameFromGateway | kFrameDstManaged)) ==
+                (kFrameFromGateway | kFrameDstManaged)) {
+                PrefetchDevice(device_slots_[frame_class.dst_value]);
+            } else if (frame_class.flags & kFrameSrcManaged) {
+                PrefetchDevice(device_slots_[frame_class.src_value]);
+            }
+        }
+        if (ack_filter_devices_) findSupersededAcks(frames + done, batch, classes, superseded);
+        if (profiling_) stats_.stage_ticks[kStageClassify] += ReadCycleClock() - t0;
+
+        for (size_t i = 0; i < batch; ++i) {
+            ReceivedFrame& frame = frames[done + i];
+            DropReason reason = processFrame(frame.data, frame.length, 0, &classes[i],
+                                             ack_filter_devices_ && superseded[i]);
+            if (results) results[done + i] = reason;
+        }
+    }
+}
+
+DropReason DataPlane::processFrame(uint8_t* frame, size_t length, size_t wire_length, const FrameClass* hint,
+                                   bool superseded) {
+    if (wire_length == 0) wire_length = length;
+    ++stats_.packets;
+    stats_.bytes += wire_length;
+
+    uint64_t t0 = profiling_ ? ReadCycleClock() : 0;
+
+    Device* device = nullptr;
+    TrafficDirection direction = kTrafficUp;
+    size_t l3_offset = 0;
+    FlowEntry* flow = nullptr;
+    Rule* rule = nullptr;
+    Rule* destination = nullptr;
+    PacketTuple tuple;
+    tuple.tcp_flags = 0;
+    uint64_t now = 0;
+    DropReason reason = classify(frame, length, device, direction, l3_offset, hint);
+    if (reason == kDropNone) {
+        now = clock_.nowNs();
+        if (flows_ || !classifier_.empty()) parseTuple(frame, length, l3_offset, tuple);
+        if (flows_) {
+            flows_->expire(now);
+            flow = flows_->track(MakeFlowKey(tuple.src_ip, tuple.dst_ip, tuple.src_port, tuple.dst_port,
+                                             tuple.protocol), now);
+        }
+        if (!classifier_.empty()) {
+            uint32_t index = matchRule(*device, direction, tuple, flow);
+            if (index != RuleClassifier::kNoRule) rule = &rule_state_[index];
+        }
+        destination = matchDestination(frame + l3_offset, direction);
+    }
+    uint64_t t1 = profiling_ ? ReadCycleClock() : 0;
+
+    if (reason == kDropNone) {
+        device->stats.offered_bytes[direction] += wire_length;
+        uint32_t ack_number = 0;
+        bool pure_ack = device->policy.ack_handling != kAckPolice &&
+                        ReadPureAck(frame, length, l3_offset, ack_number) != kTcpNotPureAck;
+        reason = superseded ? kDropAckFiltered
+                            : shape(*device, direction, wire_length, now, rule, destination, pure_ack);
+    }
+    uint64_t t2 = profiling_ ? ReadCycleClock() : 0;
+
+    if (reason == kDropNone && (device->policy.window_shaping || device->policy.clamp_mss)) {
+        shapeWindow(frame, length, l3_offset, *device, direction, flow, now);
+    }
+    if (reason == kDropNone) {
+        PriorityMark mark = {};
+        if (direction == kTrafficUp) {
+            mark = device->policy.mark;
+            if (rule && rule->mark.flags) MergeMark(mark, rule->mark);
+        }
+        reason = forward(frame, length, l3_offset, *device, direction, mark);
+    }
+    uint64_t t3 = profiling_ ? ReadCycleClock() : 0;
+
+    if (device) {
+        DeviceStats& device_stats = device->stats;
+        if (reason == kDropNone) {
+            device_stats.forwarded_bytes[direction] += wire_length;
+            ++device_stats.forwarded_packets[direction];
+            GetTrafficCounters().count(device->policy.counter_slot, direction, static_cast<uint32_t>(wire_length));
+        } else {
+            device_stats.dropped_bytes[direction] += wire_length;
+            ++device_stats.dropped_packets[direction];
+            GetTrafficCounters().countDrop(device->policy.counter_slot, direction);
+        }
+    }
+
+    for (Rule* policy : { rule, destination }) {
+        if (!policy) continue;
+        ++policy->stats.matched_packets[direction];
+        if (reason == kDropNone) {
+            policy->stats.forwarded_bytes[direction] += wire_length;
+        } else {
+            ++policy->stats.dropped_packets[direction];
+        }
+    }
+
+    if (flow) {
+        FlowTable::count(*flow, direction, wire_length, tuple.tcp_flags, reason == kDropNone, now);
+    }
+
+    if (reason == kDropNone) {
+        ++stats_.forwarded;
+    } else {
+        ++stats_.drops[reason];
+    }
+
+    if (profiling_) {
+        stats_.stage_ticks[kStageClassify] += t1 - t0;
+        stats_.stage_ticks[kStageShape] += t2 - t1;
+        stats_.stage_ticks[kStageForward] += t3 - t2;
+        ++stats_.profiled_packets;
+        GetStageLatency(kStageClassify).record(CycleClockToNs(t1 - t0));
+        GetStageLatency(kStageShape).record(CycleClockToNs(t2 - t1));
+        GetStageLatency(kStageForward).record(CycleClockToNs(t3 - t2));
+    }
+    return reason;
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "cycle_clock.h"
+#include "device_table.h"
+#include "flow_table.h"
+#include "frame_classifier.h"
+#include "latency_histogram.h"
+#include "lpm_table.h"
+#include "packet_io.h"
+#include "priority_mark.h"
+#include "rule_classifier.h"
+#include "tcp_window.h"
+#include "traffic_counters.h"
+
+// Why a frame was not forwarded
+enum DropReason : uint8_t {
+    kDropNone = 0,         // forwarded
+    kDropMalformed,        // truncated Ethernet/IPv4 header
+    kDropNotIpv4,          // ARP, IPv6, ... (left to the host stack)
+    kDropOwnFrame,         // sent by us
+    kDropUnmanaged,        // no managed device on either end
+    kDropBlocked,
+    kDropRateLimited,
+    kDropSendFailed,
+    kDropAckFiltered,      // pure TCP ACK superseded later in its burst
+    kDropReasonCount
+};
+
+const char* DropReasonName(DropReason reason);
+
+// How pure TCP ACKs (no payload) are treated in a limited direction
+enum AckHandling : uint8_t {
+    kAckPrioritize = 0,   // charged to the buckets but never dropped by them
+    kAckFilter,           // prioritized, and dropped when a newer cumulative
+                          // ACK of the flow follows in the same burst
+    kAckPolice            // policed like any other packet
+};
+
+// Traffic policy for one managed device
+struct DevicePolicy {
+    uint8_t mac[6];
+    uint8_t ip[4];
+    double download_mbps;   // 0 = unlimited
+    double upload_mbps;     // 0 = unlimited
+    bool blocked;
+    PriorityMark mark;      // for the device's upstream frames
+    bool window_shaping;    // also slow TCP senders down through advertised windows
+    uint16_t clamp_mss;     // lower the MSS of TCP SYNs to this, 0 = leave
+    AckHandling ack_handling;
+    uint32_t counter_slot;  // GetTrafficCounters() slot, owned by the device's
+                            // TrafficControl; TrafficCounters::kInvalidSlot = none
+};
+
+// Policy for traffic whose remote end (destination upstream, source
+// downstream) falls in one of the prefixes. kRulePrioritize exempts the
+// traffic from device limits, kRuleLimit polices it with the policy's own
+// rates (shared by everything it matches) on top of them.
+struct DestinationPolicy {
+    uint32_t id;
+    RuleAction action;
+    double download_mbps;   // 0 = unlimited
+    double upload_mbps;
+    std::vector<std::pair<uint32_t, uint8_t>> prefixes;   // address, length
+};
+
+// Classification, shaping and forwarding of intercepted frames
+//
+// Frames redirected to us by ARP poisoning go through three stages:
+//   classify  Ethernet/IPv4 parse, direction and managed-device lookup
+//             (upstream by source MAC, downstream by destination MAC or IP)
+//   shape     block check and per-direction token bucket policing
+//   forward   rewrite MACs (src = us, dst = gateway or device), apply the
+//             priority mark of upstream frames, and send
+//
+// Time comes from a Clock, so the same code runs live (SteadyClock) or
+// under replay/simulation (VirtualClock). A DataPlane is used from a single
+// thread. Per-device totals go to the GetTrafficCounters() slot in the
+// device's policy, the one its TrafficControl reports; with profiling on,
+// per-stage costs are accumulated in stats() and GetStageLatency(). With
+// flow tracking on, classify also looks up the packet's 5-tuple in a
+// FlowTable, which keeps per-flow counters and handshake RTT. Shaping rules
+// (port/protocol) are matched in classify too; with flow tracking on, the
+// verdict is cached in the flow and later packets skip the rule lookup.
+// Destination policies are found by longest-prefix match on the remote
+// address. processBurst() classifies a whole receive burst first
+// (FrameClassifier), so managed devices are found without a hash map
+// lookup per frame. Upstream frames get their device's priority mark, with
+// the parts their shaping rule sets taking precedence: the DSCP is
+// rewritten in place with an incremental checksum update, and a frame
+// without an 802.1Q tag is copied into a scratch buffer to gain one.
+//
+// Window shaping (DevicePolicy::window_shaping, needs flow tracking) keeps
+// a limited device's TCP flows under its limits without holding any
+// packets: the receive windows advertised to the sender are lowered to
+// the flow's share of the rate times its handshake RTT, so senders pace
+// themselves and the policer rarely has to drop. The share divides the
+// rate by the device's flows active in the last interval. Per flow this
+// costs two bytes of window scale and a counter in the FlowEntry; the
+// policer stays as the backstop for senders that ignore windows.
+//
+// Pure TCP ACKs in a limited direction are prioritized by default
+// (DevicePolicy::ack_handling): they are charged to the token buckets like
+// any packet, but a short bucket lets them through and goes into debt
+// instead, so the bulk traffic they travel with waits for the tokens. An
+// upload limit then no longer starves the device's downloads of ACKs.
+// There is no queue to pick superseded ACKs from, so ACK filtering works
+// on receive bursts: processBurst() drops a pure ACK when a later frame of
+// the burst carries a newer cumulative ACK of the same flow and nothing
+// the first one had (SACK blocks, ECN flags, ...). process() never filters.
+class DataPlane {
+public:
+    struct Config {
+        uint8_t our_mac[6];
+        uint8_t gateway_mac[6];
+    };
+
+    struct DeviceStats {
+        uint64_t offered_bytes[2];    // indexed by TrafficDirection
+        uint64_t forwarded_bytes[2];
+        uint64_t dropped_bytes[2];
+        uint64_t forwarded_packets[2];
+        uint64_t dropped_packets[2];
+    };
+
+    struct Stats {
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t forwarded;
+        uint64_t marked;                     // forwarded with a DSCP or 802.1p mark
+        uint64_t windows_clamped;            // TCP windows lowered by window shaping
+        uint64_t mss_clamped;                // SYNs with their MSS lowered
+        uint64_t acks_prioritized;           // pure TCP ACKs let through a short bucket
+        uint64_t drops[kDropReasonCount];
+        uint64_t stage_ticks[kStageCount];   // ReadCycleClock ticks, profiling only
+        uint64_t profiled_packets;
+    };
+
+    // io may be null: frames are then counted as forwarded but not sent
+    DataPlane(const Config& config, PacketIO* io, const Clock& clock);
+    ~DataPlane();
+
+    DataPlane(const DataPlane&) = delete;
+    DataPlane& operator=(const DataPlane&) = delete;
+
+    // Stats of a shaping rule or destination policy
+    struct RuleStats {
+        uint64_t matched_packets[2];   // indexed by TrafficDirection
+        uint64_t forwarded_bytes[2];
+        uint64_t dropped_packets[2];
+    };
+
+    // Add or update a device; existing token buckets and stats are kept.
+    // Fails for our or the gateway's MAC and for an invalid mark.
+    bool setDevice(const DevicePolicy& policy);
+    bool removeDevice(const uint8_t* mac);
+    std::vector<DevicePolicy> devices() const;
+    bool deviceStats(const uint8_t* mac, DeviceStats& stats) const;
+
+    // Run one frame through the pipeline. The frame is rewritten in place
+    // when forwarded. wire_length (for shaping and accounting) defaults to
+    // length; pass the original length for truncated captures.
+    DropReason process(uint8_t* frame, size_t length, size_t wire_length = 0);
+
+    // Run a receive burst through the pipeline, frame by frame, after
+    // classifying it in one batch. Same results as process() on each frame;
+    // results, when given, gets one DropReason per frame.
+    void processBurst(ReceivedFrame* frames, size_t count, DropReason* results = nullptr);
+
+    void setProfiling(bool enabled) { profiling_ = enabled; }
+
+    // Track flows of managed devices in a table preallocated for capacity
+    // flows; capacity 0 turns tracking off and drops the table
+    static const uint64_t kDefaultFlowIdleNs = 120ULL * 1000000000ULL;
+    void setFlowTracking(uint32_t capacity, uint64_t idle_timeout_ns = kDefaultFlowIdleNs);
+    const FlowTable* flows() const { return flows_.get(); }
+
+    // Replace the shaping rules. Limits of a rule are shared by all traffic
+    // it matches. Cached verdicts are dropped; rule stats start over.
+    bool setRules(const std::vector<ShapingRule>& rules);
+    const RuleClassifier& rules() const { return classifier_; }
+    bool ruleStats(uint32_t rule_id, RuleStats& stats) const;
+
+    // Replace the destination policies. The lookup table is built first and
+    // then swapped in; this is the one setter that may be called from
+    // another thread while process() runs, which picks the new table up on
+    // its next packet.
+    bool setDestinations(const std::vector<DestinationPolicy>& policies);
+    bool destinationStats(uint32_t policy_id, RuleStats& stats) const;
+
+    const std::string& lastError() const { return last_error_; }
+    const Stats& stats() const { return stats_; }
+    void resetStats();
+
+private:
+    // Policer: rate in bytes per ns, burst in bytes
+    struct TokenBucket {
+        double rate;
+        double burst;
+        double tokens;
+        uint64_t last_ns;
+
+        void configure(double mbps, uint64_t now_ns);
+        bool take(size_t bytes, uint64_t now_ns);
+        // Take bytes even when short: tokens go negative (at most one
+        // burst deep) and later packets wait for the debt. False when the
+        // bucket was short.
+        bool charge(size_t bytes, uint64_t now_ns);
+        void refill(uint64_t now_ns);
+    };
+
+    struct Rule {
+        RuleAction action;
+        TokenBucket buckets[2];
+        RuleStats stats;
+        PriorityMark mark;
+    };
+
+    // L3/L4 fields for flow tracking and rule matching
+    struct PacketTuple {
+        uint32_t src_ip;
+        uint32_t dst_ip;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint8_t protocol;
+        uint8_t tcp_flags;
+    };
+
+    struct Device {
+        DevicePolicy policy;
+        TokenBucket buckets[2];
+        DeviceStats stats;
+        uint32_t slot;            // in device_slots_, the value in the burst classifier's set
+
+        // Window shaping: TCP flows seen in the current and previous interval
+        uint64_t window_interval;
+        uint32_t window_flows;
+        uint32_t window_flows_last;
+    };
+
+    Config config_;
+    uint64_t our_key_;
+    uint64_t gateway_key_;
+    PacketIO* io_;
+    const Clock& clock_;
+    bool profiling_;
+    Stats stats_;
+    std::unordered_map<uint64_t, Device> devices_;        // by MAC key
+    std::unordered_map<uint32_t, uint64_t> ip_to_mac_;    // IPv4 -> MAC key
+    FrameClassifier frame_classifier_;                    // managed set: MAC key -> slot
+    std::vector<Device*> device_slots_;                   // map nodes do not move
+    std::vector<uint32_t> free_device_slots_;
+    uint32_t ack_filter_devices_;                         // devices with kAckFilter
+    std::unique_ptr<FlowTable> flows_;
+    RuleClassifier classifier_;
+    std::vector<Rule> rule_state_;                       // parallel to classifier_.rules()
+
+    // Destination policies: setDestinations() publishes a new set in
+    // pending_ and bumps the version; the data path moves it to active_
+    // when it sees the change, releasing the old set on its own thread
+    struct DestinationSet {
+        LpmTable table;   // value = policy index + 1
+        std::vector<DestinationPolicy> policies;
+        std::vector<Rule> state;
+    };
+    std::shared_ptr<DestinationSet> pending_destinations_;
+    std::atomic<uint64_t> destinations_version_;
+    std::shared_ptr<DestinationSet> active_destinations_;
+    uint64_t active_version_;
+
+    std::vector<uint8_t> tag_buffer_;   // frames gaining an 802.1Q tag
+
+    std::string last_error_;
+
+    // superseded: the frame is a pure ACK that ACK filtering drops
+    DropReason processFrame(uint8_t* frame, size_t length, size_t wire_length, const FrameClass* hint,
+                            bool superseded);
+    // hint: the frame's burst classification, used instead of the device
+    // map lookups
+    DropReason classify(const uint8_t* frame, size_t length, Device*& device, TrafficDirection& direction,
+                        size_t& l3_offset, const FrameClass* hint);
+    void parseTuple(const uint8_t* frame, size_t length, size_t l3_offset, PacketTuple& tuple) const;
+    uint32_t matchRule(const Device& device, TrafficDirection direction, const PacketTuple& tuple,
+                       FlowEntry* flow) const;
+    Rule* matchDestination(const uint8_t* l3, TrafficDirection direction);
+    // Marks the frames of a burst that ACK filtering drops
+    void findSupersededAcks(const ReceivedFrame* frames, size_t count, const FrameClass* classes,
+                            bool* superseded);
+    // pure_ack: a pure TCP ACK to prioritize
+    DropReason shape(Device& device, TrafficDirection direction, size_t bytes, uint64_t now_ns, Rule* rule,
+                     Rule* destination, bool pure_ack);
+    void shapeWindow(uint8_t* frame, size_t length, size_t l3_offset, Device& device, TrafficDirection direction,
+                     FlowEntry* flow, uint64_t now_ns);
+    DropReason forward(uint8_t* frame, size_t length, size_t l3_offset, const Device& device,
+                       TrafficDirection direction, const PriorityMark& mark);
+};
@@ -0,0 +1,592 @@
+#include "device_inventory.h"
+#include "ring_log.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// On-disk layout (little-endian, native alignment):
+//
+//   [FileHeader]                64 bytes
+//   [Record x capacity]         open-addressed, linear probing, never deleted
+//
+// capacity is a power of two and the table is rebuilt at twice the size
+// (into a temp file that atomically replaces the original) when it passes
+// 75% load.
+static const uint32_t kInventoryMagic = 0x5649534E; // "NSIV"
+static const uint16_t kInventoryVersion = 1;
+static const uint32_t kMinCapacity = 64;
+static const size_t kNameBytes = 80;
+static const size_t kVendorBytes = 56;
+static const uint64_t kKeyPresent = 1ULL << 63;
+
+struct DeviceInventory::FileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t capacity;
+    uint32_t count;           // advisory, recomputed on open
+    uint8_t reserved[48];
+};
+
+struct DeviceInventory::Version {
+    uint32_t seq;             // odd while being written, 0 = never written
+    uint32_t checksum;        // FNV-1a over key and everything after this field
+    uint8_t ip[4];
+    uint8_t name_len;
+    uint8_t vendor_len;
+    uint8_t reserved[2];
+    uint64_t first_seen;      // ms since epoch
+    uint64_t last_seen;
+    uint64_t bytes_down;
+    uint64_t bytes_up;
+    uint64_t packets_down;
+    uint64_t packets_up;
+    char name[kNameBytes];    // empty when only the IP is known
+    char vendor[kVendorBytes];
+};
+
+struct DeviceInventory::Record {
+    uint64_t key;             // packed MAC | kKeyPresent, 0 = empty slot
+    uint64_t reserved;
+    Version versions[2];
+};
+
+static_assert(sizeof(DeviceInventory::FileHeader) == 64, "FileHeader layout changed");
+static_assert(sizeof(DeviceInventory::Version) == 200, "Version layout changed");
+static_assert(sizeof(DeviceInventory::Record) == 416, "Record layout changed");
+
+// MacKey() plus the presence bit, so an all-zero MAC is not an empty slot
+static uint64_t RecordKey(const uint8_t* mac) {
+    return MacKey(mac) | kKeyPresent;
+}
+
+static uint64_t MixKey(uint64_t key) {
+    // splitmix64 finalizer; MACs from one vendor share their top bytes
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
+
+static uint32_t VersionChecksum(uint64_t key, const DeviceInventory::Version& version) {
+    uint32_t hash = 2166136261u;
+    const uint8_t* key_bytes = reinterpret_cast<const uint8_t*>(&key);
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        hash = (hash ^ key_bytes[i]) * 16777619u;
+    }
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&version) + offsetof(DeviceInventory::Version, ip);
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(&version) + sizeof(version);
+    for (; p < end; ++p) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+static bool VersionValid(uint64_t key, const DeviceInventory::Version& version) {
+    uint32_t seq = *reinterpret_cast<const volatile uint32_t*>(&version.seq);
+    if (seq == 0 || (seq & 1)) return false;
+    return VersionChecksum(key, version) == version.checksum;
+}
+
+// Index of the newest valid version, or -1 if neither is usable
+static int CurrentVersion(const DeviceInventory::Record& record) {
+    bool valid0 = VersionValid(record.key, record.versions[0]);
+    bool valid1 = VersionValid(record.key, record.versions[1]);
+    if (valid0 && valid1) {
+        // Serial number comparison so the sequence may wrap
+        int32_t diff = static_cast<int32_t>(record.versions[1].seq - record.versions[0].seq);
+        return diff > 0 ? 1 : 0;
+    }
+    if (valid0) return 0;
+    if (valid1) return 1;
+    return -1;
+}
+
+// Copy at most max_len bytes without splitting a UTF-8 sequence
+static uint8_t CopyString(char* dest, size_t max_len, const std::string& value) {
+    size_t len = value.size();
+    if (len > max_len) {
+        len = max_len;
+        while (len > 0 && (static_cast<uint8_t>(value[len]) & 0xC0) == 0x80) --len;
+    }
+    memset(dest, 0, max_len);
+    memcpy(dest, value.data(), len);
+    return static_cast<uint8_t>(len);
+}
+
+static bool IsPlaceholderName(const DeviceInfo& device) {
+    return device.name.empty() || device.name == device.ip;
+}
+
+DeviceInventory::DeviceInventory()
+    : file_handle_(nullptr), mapping_handle_(nullptr), base_(nullptr), mapped_size_(0) {}
+
+DeviceInventory::~DeviceInventory() {
+    close();
+}
+
+void DeviceInventory::setError(const std::string& error) {
+    last_error = error;
+    NS_LOG_ERROR("DeviceInventory error: %s\n", error);
+}
+
+DeviceInventory::FileHeader* DeviceInventory::header() const {
+    return reinterpret_cast<FileHeader*>(base_);
+}
+
+DeviceInventory::Record* DeviceInventory::records() const {
+    return reinterpret_cast<Record*>(base_ + sizeof(FileHeader));
+}
+
+bool DeviceInventory::mapFile(const std::string& path, size_t min_size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        setError("Failed to open " + path + " (error " + std::to_string(GetLastError()) + ")");
+        return false;
+    }
+
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(file, &current)) {
+        setError("Failed to get size of " + path);
+        CloseHandle(file);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(current.QuadPart);
+    if (size < min_size) size = min_size;
+    if (size == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Mapping with a larger size than the file extends it (zero-filled)
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                        static_cast<DWORD>(size & 0xFFFFFFFF), NULL);
+    if (!mapping) {
+        setError("Failed to create mapping for " + path + " (error " + std::to_string(GetLastError()) + ")");
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        setError("Failed to map " + path + " (error " + std::to_string(GetLastError()) + ")");
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        setError("Failed to open " + path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        setError("Failed to get size of " + path);
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < min_size) {
+        if (ftruncate(fd, static_cast<off_t>(min_size)) != 0) {
+            setError("Failed to extend " + path);
+            ::close(fd);
+            return false;
+        }
+        size = min_size;
+    }
+    if (size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        setError("Failed to map " + path);
+        ::close(fd);
+        return false;
+    }
+
+    file_handle_ = reinterpret_cast<void*>(static_cast<intptr_t>(fd));
+    mapping_handle_ = nullptr;
+#endif
+
+    base_ = static_cast<uint8_t*>(view);
+    mapped_size_ = size;
+    return true;
+}
+
+void DeviceInventory::unmapFile() {
+    if (!base_) return;
+#ifdef _WIN32
+    FlushViewOfFile(base_, 0);
+    UnmapViewOfFile(base_);
+    CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    CloseHandle(static_cast<HANDLE>(file_handle_));
+#else
+    msync(base_, mapped_size_, MS_ASYNC);
+    munmap(base_, mapped_size_);
+    ::close(static_cast<int>(reinterpret_cast<intptr_t>(file_handle_)));
+#endif
+    base_ = nullptr;
+    mapped_size_ = 0;
+    file_handle_ = nullptr;
+    mapping_handle_ = nullptr;
+}
+
+bool DeviceInventory::initializeFile(const std::string& path, uint32_t capacity) {
+    std::remove(path.c_str());
+    size_t size = sizeof(FileHeader) + static_cast<size_t>(capacity) * sizeof(Record);
+    if (!mapFile(path, size)) return false;
+
+    FileHeader* file_header = header();
+    memset(file_header, 0, sizeof(FileHeader));
+    file_header->magic = kInventoryMagic;
+    file_header->version = kInventoryVersion;
+    file_header->record_size = sizeof(Record);
+    file_header->capacity = capacity;
+    file_header->count = 0;
+    return true;
+}
+
+bool DeviceInventory::headerValid() const {
+    if (mapped_size_ < sizeof(FileHeader)) return false;
+    const FileHeader* file_header = header();
+    if (file_header->magic != kInventoryMagic ||
+        file_header->version != kInventoryVersion ||
+        file_header->record_size != sizeof(Record)) {
+        return false;
+    }
+    uint32_t capacity = file_header->capacity;
+    if (capacity < kMinCapacity || (capacity & (capacity - 1)) != 0) return false;
+    return mapped_size_ >= sizeof(FileHeader) + static_cast<size_t>(capacity) * sizeof(Record);
+}
+
+bool DeviceInventory::open(const std::string& path, uint32_t initial_capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unmapFile();
+    path_ = path;
+
+    uint32_t capacity = kMinCapacity;
+    while (capacity < initial_capacity && capacity < (1u << 30)) capacity <<= 1;
+
+    if (!mapFile(path, sizeof(FileHeader))) return false;
+
+    if (!headerValid()) {
+        // A file that was never written is simply initialized. Anything else
+        // (damaged, or from a newer format version) is kept for the user
+        // under another name rather than deleted.
+        bool was_empty = std::all_of(base_, base_ + mapped_size_, [](uint8_t byte) { return byte == 0; });
+        unmapFile();
+        if (!was_empty) {
+            std::string aside = path + ".corrupt-" + std::to_string(static_cast<long long>(time(nullptr)));
+            if (std::rename(path.c_str(), aside.c_str()) != 0) {
+                setError(path + " is not a valid inventory and could not be moved aside");
+                return false;
+            }
+            setError(path + " is not a valid inventory, moved it to " + aside + " and starting fresh");
+        }
+        if (!initializeFile(path, capacity)) return false;
+    }
+
+    // The stored count is only advisory; a crash between publishing a key
+    // and bumping the count would otherwise leave it stale
+    uint32_t count = 0;
+    Record* table = records();
+    for (uint32_t i = 0; i < header()->capacity; ++i) {
+        if (table[i].key != 0) ++count;
+    }
+    header()->count = count;
+
+    NS_LOG_INFO("DeviceInventory: opened %s (%u devices, capacity %u)\n", path, count, header()->capacity);
+    return true;
+}
+
+void DeviceInventory::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unmapFile();
+}
+
+bool DeviceInventory::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return base_ != nullptr;
+}
+
+DeviceInventory::Record* DeviceInventory::findSlot(uint64_t key, bool for_insert) const {
+    uint32_t capacity = header()->capacity;
+    uint32_t mask = capacity - 1;
+    uint32_t index = static_cast<uint32_t>(MixKey(key)) & mask;
+    Record* table = records();
+
+    for (uint32_t probe = 0; probe < capacity; ++probe) {
+        Record& record = table[(index + probe) & mask];
+        if (record.key == key) return &record;
+        if (record.key == 0) return for_insert ? &record : nullptr;
+    }
+    return nullptr;
+}
+
+bool DeviceInventory::readRecord(const Record& record, Entry& entry) {
+    int current = CurrentVersion(record);
+    if (current < 0) return false;
+    const Version& version = record.versions[current];
+
+    uint8_t mac[6];
+    uint64_t key = record.key & ~kKeyPresent;
+    for (int i = 5; i >= 0; --i) {
+        mac[i] = static_cast<uint8_t>(key & 0xFF);
+        key >>= 8;
+    }
+
+    char mac_str[18];
+    char ip_str[16];
+    FormatMac(mac, mac_str);
+    FormatIpv4(version.ip, ip_str);
+
+    entry.device.mac = mac_str;
+    entry.device.ip = ip_str;
+    entry.device.name.assign(version.name, version.name_len > kNameBytes ? kNameBytes : version.name_len);
+    if (entry.device.name.empty()) entry.device.name = entry.device.ip;
+    entry.device.vendor.assign(version.vendor, version.vendor_len > kVendorBytes ? kVendorBytes : version.vendor_len);
+    entry.device.isOnline = false;
+    entry.device.lastSeen = version.last_seen;
+    entry.first_seen = version.first_seen;
+    entry.traffic.bytes_down = version.bytes_down;
+    entry.traffic.bytes_up = version.bytes_up;
+    entry.traffic.packets_down = version.packets_down;
+    entry.traffic.packets_up = version.packets_up;
+    return true;
+}
+
+bool DeviceInventory::writeLocked(uint64_t key, const Entry& entry) {
+    Record* record = findSlot(key, true);
+    if (!record) {
+        setError("Inventory is full");
+        return false;
+    }
+
+    bool is_new = record->key != key;
+    int current = is_new ? -1 : CurrentVersion(*record);
+    uint32_t seq = current >= 0 ? record->versions[current].seq : 0;
+    Version& target = record->versions[current == 0 ? 1 : 0];
+    volatile uint32_t* target_seq = &target.seq;
+
+    // Mark the version as being written before touching the payload, so a
+    // crash part way through leaves it odd and ignored
+    *target_seq = seq + 1;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memset(target.ip, 0, sizeof(target.ip));
+    ParseIpv4(entry.device.ip, target.ip);
+    target.name_len = CopyString(target.name, kNameBytes,
+                                 IsPlaceholderName(entry.device) ? std::string() : entry.device.name);
+    target.vendor_len = CopyString(target.vendor, kVendorBytes, entry.device.vendor);
+    memset(target.reserved, 0, sizeof(target.reserved));
+    target.first_seen = entry.first_seen;
+    target.last_seen = entry.device.lastSeen;
+    target.bytes_down = entry.traffic.bytes_down;
+    target.bytes_up = entry.traffic.bytes_up;
+    target.packets_down = entry.traffic.packets_down;
+    target.packets_up = entry.traffic.packets_up;
+    target.checksum = VersionChecksum(key, target);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    *target_seq = (seq + 2 == 0) ? 2 : seq + 2;
+
+    if (is_new) {
+        // Publish the key only once its first version is complete
+        std::atomic_thread_fence(std::memory_order_release);
+        *reinterpret_cast<volatile uint64_t*>(&record->key) = key;
+        header()->count++;
+    }
+    return true;
+}
+
+bool DeviceInventory::grow() {
+    uint32_t new_capacity = header()->capacity * 2;
+    std::vector<Entry> entries = snapshotLocked();
+
+    // Build the larger table beside the original and swap it in atomically,
+    // so a crash during the rebuild leaves the old file intact
+    std::string tmp_path = path_ + ".tmp";
+    unmapFile();
+    if (!initializeFile(tmp_path, new_capacity)) {
+        mapFile(path_, 0);
+        return false;
+    }
+
+    for (const Entry& entry : entries) {
+        uint8_t mac[6];
+        if (ParseMac(entry.device.mac, mac)) {
+            writeLocked(RecordKey(mac), entry);
+        }
+    }
+    unmapFile();
+
+#ifdef _WIN32
+    bool replaced = MoveFileExA(tmp_path.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool replaced = std::rename(tmp_path.c_str(), path_.c_str()) == 0;
+#endif
+    if (!replaced) {
+        setError("Failed to replace " + path_ + " after resize");
+        std::remove(tmp_path.c_str());
+    }
+
+    if (!mapFile(path_, 0) || !headerValid()) {
+        unmapFile();
+        setError("Failed to reopen " + path_ + " after resize");
+        return false;
+    }
+    return replaced;
+}
+
+bool DeviceInventory::upsert(const DeviceInfo& device) {
+    uint8_t mac[6];
+    if (!ParseMac(device.mac, mac)) return false;
+    uint64_t key = RecordKey(mac);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!base_) return false;
+
+    Entry entry;
+    Record* record = findSlot(key, false);
+    bool exists = record && readRecord(*record, entry);
+    if (!exists) {
+        entry.device = device;
+        entry.first_seen = device.lastSeen;
+        memset(&entry.traffic, 0, sizeof(entry.traffic));
+
+        if (!record && (header()->count + 1) * 4 > header()->capacity * 3) {
+            if (!grow()) return false;
+        }
+        return writeLocked(key, entry);
+    }
+
+    // A learned name survives an IP change; a placeholder follows the new IP
+    bool had_name = !IsPlaceholderName(entry.device);
+    if (!device.ip.empty()) entry.device.ip = device.ip;
+    if (!IsPlaceholderName(device)) {
+        entry.device.name = device.name;
+    } else if (!had_name) {
+        entry.device.name = entry.device.ip;
+    }
+    if (!device.vendor.empty() && (device.vendor != "Unknown" || entry.device.vendor.empty())) {
+        entry.device.vendor = device.vendor;
+    }
+    if (device.lastSeen > entry.device.lastSeen) entry.device.lastSeen = device.lastSeen;
+
+    return writeLocked(key, entry);
+}
+
+bool DeviceInventory::updateName(const std::string& mac_str, const std::string& name) {
+    uint8_t mac[6];
+    if (!ParseMac(mac_str, mac)) return false;
+    uint64_t key = RecordKey(mac);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!base_) return false;
+
+    Entry entry;
+    Record* record = findSlot(key, false);
+    if (!record || !readRecord(*record, entry)) return false;
+    if (name.empty() || name == entry.device.ip || name == entry.device.name) return true;
+
+    entry.device.name = name;
+    return writeLocked(key, entry);
+}
+
+bool DeviceInventory::addTraffic(const std::string& mac_str, const TrafficTotals& delta) {
+    uint8_t mac[6];
+    if (!ParseMac(mac_str, mac)) return false;
+    uint64_t key = RecordKey(mac);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!base_) return false;
+
+    Entry entry;
+    Record* record = findSlot(key, false);
+    if (!record || !readRecord(*record, entry)) return false;
+
+    entry.traffic.bytes_down += delta.bytes_down;
+    entry.traffic.bytes_up += delta.bytes_up;
+    entry.traffic.packets_down += delta.packets_down;
+    entry.traffic.packets_up += delta.packets_up;
+    return writeLocked(key, entry);
+}
+
+bool DeviceInventory::lookup(const std::string& mac_str, Entry& entry) const {
+    uint8_t mac[6];
+    if (!ParseMac(mac_str, mac)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!base_) return false;
+
+    Record* record = findSlot(RecordKey(mac), false);
+    return record && readRecord(*record, entry);
+}
+
+std::vector<DeviceInventory::Entry> DeviceInventory::snapshotLocked() const {
+    std::vector<Entry> entries;
+    if (!base_) return entries;
+
+    entries.reserve(header()->count);
+    const Record* table = records();
+    for (uint32_t i = 0; i < header()->capacity; ++i) {
+        if (table[i].key == 0) continue;
+        Entry entry;
+        if (readRecord(table[i], entry)) {
+            entries.push_back(std::move(entry));
+        }
+    }
+    return entries;
+}
+
+std::vector<DeviceInventory::Entry> DeviceInventory::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshotLocked();
+}
+
+size_t DeviceInventory::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return base_ ? header()->count : 0;
+}
+
+void DeviceInventory::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!base_) return;
+#ifdef _WIN32
+    // FlushViewOfFile queues the dirty pages and returns without waiting on
+    // FlushFileBuffers, which is all a scan refresh needs
+    FlushViewOfFile(base_, 0);
+#else
+    msync(base_, mapped_size_, MS_ASYNC);
+#endif
+}
+
+DeviceInventory& GetDeviceInventory() {
+    static DeviceInventory inventory;
+    return inventory;
+}
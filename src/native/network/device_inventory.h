@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "device_table.h"
+
+// Persistent device inventory
+//
+// A memory-mapped file holding everything we have learned about each device
+// (name, vendor, last IP, first/last seen, traffic totals), keyed by packed
+// MAC in an open-addressed hash table. Opening it maps the file and reads the
+// records in place, with no parsing, so the UI can show a fully named device
+// list before the first scan finishes.
+//
+// Crash consistency: every record has two versions. A write goes to the older
+// version and bumps its sequence number before and after the payload. A
+// version is only trusted if its sequence is even and its checksum matches,
+// so a crash mid-write leaves the previous version in effect. A record's key
+// is published only after its first version is complete.
+class DeviceInventory {
+public:
+    struct TrafficTotals {
+        uint64_t bytes_down;
+        uint64_t bytes_up;
+        uint64_t packets_down;
+        uint64_t packets_up;
+    };
+
+    struct Entry {
+        DeviceInfo device;       // isOnline is always false for stored entries
+        uint64_t first_seen;
+        TrafficTotals traffic;
+    };
+
+    DeviceInventory();
+    ~DeviceInventory();
+
+    DeviceInventory(const DeviceInventory&) = delete;
+    DeviceInventory& operator=(const DeviceInventory&) = delete;
+
+    // Map (creating if needed) the inventory file
+    bool open(const std::string& path, uint32_t initial_capacity = 4096);
+    void close();
+    bool isOpen() const;
+
+    // Insert or update a device. A placeholder name (empty or equal to the IP)
+    // never overwrites a real stored name.
+    bool upsert(const DeviceInfo& device);
+    bool updateName(const std::string& mac, const std::string& name);
+    bool addTraffic(const std::string& mac, const TrafficTotals& delta);
+
+    bool lookup(const std::string& mac, Entry& entry) const;
+    std::vector<Entry> snapshot() const;
+    size_t size() const;
+
+    // Schedule write-back of dirty pages (does not block on disk)
+    void flush();
+
+    std::string getLastError() const { return last_error; }
+
+    // File layout, defined in device_inventory.cpp
+    struct FileHeader;
+    struct Version;
+    struct Record;
+
+private:
+    std::string path_;
+    void* file_handle_;
+    void* mapping_handle_;
+    uint8_t* base_;
+    size_t mapped_size_;
+    mutable std::mutex mutex_;
+    std::string last_error;
+
+    bool mapFile(const std::string& path, size_t min_size);
+    void unmapFile();
+    bool initializeFile(const std::string& path, uint32_t capacity);
+    bool headerValid() const;
+    bool grow();
+
+    FileHeader* header() const;
+    Record* records() const;
+    Record* findSlot(uint64_t key, bool for_insert) const;
+    bool writeLocked(uint64_t key, const Entry& entry);
+    std::vector<Entry> snapshotLocked() const;
+    static bool readRecord(const Record& record, Entry& entry);
+    void setError(const std::string& error);
+};
+
+// Shared inventory used by the N-API layer (closed until openDeviceInventory)
+DeviceInventory& GetDeviceInventory();
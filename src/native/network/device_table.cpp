@@ -0,0 +1,191 @@
+#include "device_table.h"
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ParseIpv4(const std::string& ip_str, uint8_t* ip) {
+    const char* p = ip_str.c_str();
+    for (int octet = 0; octet < 4; ++octet) {
+        if (*p < '0' || *p > '9') return false;
+        unsigned value = 0;
+        int digits = 0;
+        while (*p >= '0' && *p <= '9') {
+            value = value * 10 + static_cast<unsigned>(*p - '0');
+            if (++digits > 3 || value > 255) return false;
+            ++p;
+        }
+        ip[octet] = static_cast<uint8_t>(value);
+        if (octet < 3) {
+            if (*p != '.') return false;
+            ++p;
+        }
+    }
+    return *p == '\0';
+}
+
+bool ParseMac(const std::string& mac_str, uint8_t* mac) {
+    if (mac_str.length() != 17) return false;
+
+    for (int i = 0; i < 6; ++i) {
+        int hi = HexValue(mac_str[i * 3]);
+        int lo = HexValue(mac_str[i * 3 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        if (i < 5 && mac_str[i * 3 + 2] != ':' && mac_str[i * 3 + 2] != '-') return false;
+        mac[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+void FormatMac(const uint8_t* mac, char* out) {
+    static const char kHex[] = "0123456789abcdef";
+    for (int i = 0; i < 6; ++i) {
+        out[i * 3] = kHex[mac[i] >> 4];
+        out[i * 3 + 1] = kHex[mac[i] & 0x0F];
+        out[i * 3 + 2] = (i < 5) ? ':' : '\0';
+    }
+}
+
+void FormatIpv4(const uint8_t* ip, char* out) {
+    char* p = out;
+    for (int i = 0; i < 4; ++i) {
+        unsigned value = ip[i];
+        if (value >= 100) *p++ = static_cast<char>('0' + value / 100);
+        if (value >= 10) *p++ = static_cast<char>('0' + (value / 10) % 10);
+        *p++ = static_cast<char>('0' + value % 10);
+        *p++ = (i < 3) ? '.' : '\0';
+    }
+}
+
+std::vector<uint8_t> PackDeviceTable(const std::vector<DeviceInfo>& devices,
+                                     const std::vector<DeviceControlInfo>* controls) {
+    if (controls && controls->size() != devices.size()) {
+        controls = nullptr;
+    }
+
+    // First pass: deduplicate strings. Views point into devices, which
+    // outlives this function body.
+    std::unordered_map<std::string_view, uint32_t> string_index;
+    std::vector<std::string_view> strings;
+    string_index.reserve(devices.size() + 16);
+    strings.reserve(devices.size() + 16);
+    size_t string_bytes = 0;
+
+    auto intern = [&](const std::string& s) -> uint32_t {
+        if (s.empty()) return kNoString;
+        std::string_view view(s);
+        auto it = string_index.find(view);
+        if (it != string_index.end()) return it->second;
+        uint32_t index = static_cast<uint32_t>(strings.size());
+        string_index.emplace(view, index);
+        strings.push_back(view);
+        string_bytes += view.size();
+        return index;
+    };
+
+    std::vector<PackedDeviceRecord> records(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const DeviceInfo& device = devices[i];
+        PackedDeviceRecord& record = records[i];
+        memset(&record, 0, sizeof(record));
+
+        ParseIpv4(device.ip, record.ip);
+        ParseMac(device.mac, record.mac);
+
+        if (device.isOnline) record.flags |= kDeviceFlagOnline;
+        if (device.name == device.ip) {
+            record.flags |= kDeviceFlagNameIsIp;
+            record.name_index = kNoString;
+        } else {
+            record.name_index = intern(device.name);
+        }
+        record.vendor_index = intern(device.vendor);
+        record.last_seen = static_cast<double>(device.lastSeen);
+
+        if (controls) {
+            const DeviceControlInfo& control = (*controls)[i];
+            record.download_limit = control.downloadLimit;
+            record.upload_limit = control.uploadLimit;
+            if (control.isBlocked) record.flags |= kDeviceFlagBlocked;
+            if (control.hasTrafficControl) record.flags |= kDeviceFlagTrafficControl;
+        }
+    }
+
+    // Second pass: lay out header, records, offset table and string data
+    const size_t records_offset = sizeof(PackedDeviceTableHeader);
+    const size_t strings_offset = records_offset + records.size() * sizeof(PackedDeviceRecord);
+    const size_t offsets_size = (strings.size() + 1) * sizeof(uint32_t);
+    const size_t total_size = strings_offset + offsets_size + string_bytes;
+
+    std::vector<uint8_t> buffer(total_size);
+    uint8_t* base = buffer.data();
+
+    PackedDeviceTableHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kDeviceTableMagic;
+    header.version = kDeviceTableVersion;
+    header.record_size = sizeof(PackedDeviceRecord);
+    header.record_count = static_cast<uint32_t>(records.size());
+    header.string_count = static_cast<uint32_t>(strings.size());
+    header.records_offset = static_cast<uint32_t>(records_offset);
+    header.strings_offset = static_cast<uint32_t>(strings_offset);
+    header.total_size = static_cast<uint32_t>(total_size);
+    memcpy(base, &header, sizeof(header));
+
+    if (!records.empty()) {
+        memcpy(base + records_offset, records.data(), records.size() * sizeof(PackedDeviceRecord));
+    }
+
+    uint8_t* offset_table = base + strings_offset;
+    uint8_t* string_data = offset_table + offsets_size;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < strings.size(); ++i) {
+        memcpy(offset_table + i * sizeof(uint32_t), &offset, sizeof(uint32_t));
+        memcpy(string_data + offset, strings[i].data(), strings[i].size());
+        offset += static_cast<uint32_t>(strings[i].size());
+    }
+    memcpy(offset_table + strings.size() * sizeof(uint32_t), &offset, sizeof(uint32_t));
+
+    return buffer;
+}
+
+DeviceTableDiff DiffDeviceTables(const std::map<std::string, DeviceInfo>& previous,
+                                 const std::vector<DeviceInfo>& current) {
+    DeviceTableDiff diff;
+    size_t matched = 0;
+
+    for (size_t i = 0; i < current.size(); ++i) {
+        const DeviceInfo& device = current[i];
+        auto it = previous.find(device.mac);
+        if (it == previous.end()) {
+            diff.added.push_back(i);
+            continue;
+        }
+        ++matched;
+        if (it->second.ip != device.ip || it->second.isOnline != device.isOnline) {
+            diff.changed.push_back(i);
+        }
+    }
+
+    // Every previous entry was seen again (the common case): nothing removed
+    if (matched == previous.size()) return diff;
+
+    std::unordered_set<std::string_view> present;
+    present.reserve(current.size());
+    for (const auto& device : current) {
+        present.insert(device.mac);
+    }
+    for (const auto& entry : previous) {
+        if (!present.count(entry.first)) {
+            diff.removed.push_back(entry.first);
+        }
+    }
+    return diff;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// Structure to hold device information
+struct DeviceInfo {
+    std::string ip;
+    std::string mac;
+    std::string name;
+    std::string vendor;
+    bool isOnline;
+    uint64_t lastSeen;
+};
+
+// Per-device traffic control fields carried alongside a packed device record
+struct DeviceControlInfo {
+    double downloadLimit; // Mbps
+    double uploadLimit;   // Mbps
+    bool isBlocked;
+    bool hasTrafficControl;
+};
+
+// Packed device table wire format (all fields little-endian)
+//
+//   [PackedDeviceTableHeader]
+//   [PackedDeviceRecord x record_count]
+//   [uint32_t string_offsets x (string_count + 1)]   offsets relative to string data
+//   [UTF-8 string data, deduplicated]
+//
+// Strings are referenced by index so repeated vendors/names are stored once.
+// The layout is decoded by NetworkService.decodeDeviceTable in networkService.ts,
+// keep both sides in sync when changing it.
+const uint32_t kDeviceTableMagic = 0x5444534E; // "NSDT"
+const uint16_t kDeviceTableVersion = 1;
+const uint32_t kNoString = 0xFFFFFFFF;
+
+// Record flags
+const uint8_t kDeviceFlagOnline = 0x01;
+const uint8_t kDeviceFlagNameIsIp = 0x02;     // name equals ip, no string stored
+const uint8_t kDeviceFlagBlocked = 0x04;
+const uint8_t kDeviceFlagTrafficControl = 0x08;
+
+#pragma pack(push, 1)
+struct PackedDeviceTableHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t record_count;
+    uint32_t string_count;
+    uint32_t records_offset;
+    uint32_t strings_offset;  // start of string offset table
+    uint32_t total_size;
+    uint32_t reserved;
+};
+
+struct PackedDeviceRecord {
+    uint8_t ip[4];            // network byte order
+    uint8_t mac[6];
+    uint8_t flags;
+    uint8_t reserved0;
+    uint32_t name_index;      // kNoString if absent or kDeviceFlagNameIsIp
+    uint32_t vendor_index;
+    uint32_t reserved1;
+    double last_seen;         // ms since epoch
+    double download_limit;    // Mbps, 0 if no control
+    double upload_limit;      // Mbps, 0 if no control
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PackedDeviceTableHeader) == 32, "PackedDeviceTableHeader layout changed");
+static_assert(sizeof(PackedDeviceRecord) == 48, "PackedDeviceRecord layout changed");
+
+// Fast text <-> binary helpers (no iostreams, no allocation on parse)
+bool ParseIpv4(const std::string& ip_str, uint8_t* ip);
+bool ParseMac(const std::string& mac_str, uint8_t* mac);
+void FormatMac(const uint8_t* mac, char* out); // out must hold 18 bytes
+void FormatIpv4(const uint8_t* ip, char* out); // out must hold 16 bytes
+
+// Packed MAC used as a hash key (first octet most significant)
+inline uint64_t MacKey(const uint8_t* mac) {
+    return (static_cast<uint64_t>(mac[0]) << 40) | (static_cast<uint64_t>(mac[1]) << 32) |
+           (static_cast<uint64_t>(mac[2]) << 24) | (static_cast<uint64_t>(mac[3]) << 16) |
+           (static_cast<uint64_t>(mac[4]) << 8) | static_cast<uint64_t>(mac[5]);
+}
+
+// Serialize devices into the packed format. controls may be null or must be
+// the same length as devices.
+std::vector<uint8_t> PackDeviceTable(const std::vector<DeviceInfo>& devices,
+                                     const std::vector<DeviceControlInfo>* controls = nullptr);
+
+// Changes between the previous scan (keyed by MAC) and a new one. current
+// must not repeat a MAC (scans deduplicate).
+struct DeviceTableDiff {
+    std::vector<size_t> added;         // indices into current
+    std::vector<size_t> changed;       // same MAC, new IP or online state
+    std::vector<std::string> removed;  // MACs missing from current
+};
+
+DeviceTableDiff DiffDeviceTables(const std::map<std::string, DeviceInfo>& previous,
+                                 const std::vector<DeviceInfo>& current);
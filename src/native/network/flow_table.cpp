@@ -0,0 +1,332 @@
+#include "flow_table.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NS_FLOW_SSE2 1
+#endif
+
+// Displacement search limit per insert (buckets visited)
+static const size_t kMaxSearchNodes = 512;
+
+FlowKey MakeFlowKey(uint32_t src_ip, uint32_t dst_ip, uint16_t src_port, uint16_t dst_port, uint8_t protocol) {
+    FlowKey key;
+    memset(&key, 0, sizeof(key));
+    bool swap = src_ip > dst_ip || (src_ip == dst_ip && src_port > dst_port);
+    key.ip_a = swap ? dst_ip : src_ip;
+    key.ip_b = swap ? src_ip : dst_ip;
+    key.port_a = swap ? dst_port : src_port;
+    key.port_b = swap ? src_port : dst_port;
+    key.protocol = protocol;
+    return key;
+}
+
+static inline uint64_t HashFlowKey(const FlowKey& key) {
+    uint64_t words[2];
+    memcpy(words, &key, sizeof(words));
+    uint64_t h = words[0] * 0x9E3779B97F4A7C15ULL ^ (words[1] + 0xC2B2AE3D27D4EB4FULL);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint16_t Signature(uint64_t hash) {
+    uint16_t signature = static_cast<uint16_t>(hash >> 48);
+    return signature ? signature : 1;
+}
+
+// Bit i set when signatures[i] == signature
+static inline uint32_t MatchSignatures(const uint16_t* signatures, uint16_t signature) {
+#ifdef NS_FLOW_SSE2
+    __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(signatures));
+    __m128i equal = _mm_cmpeq_epi16(lanes, _mm_set1_epi16(static_cast<short>(signature)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(equal, _mm_setzero_si128())));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (signatures[i] == signature) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static inline int LowestBit(uint32_t mask) {
+    int bit = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+}
+
+FlowTable::FlowTable(uint32_t capacity, uint64_t idle_timeout_ns)
+    : bucket_mask_(0), size_(0), idle_timeout_ns_(idle_timeout_ns), current_tick_(0), wheel_started_(false) {
+    capacity = std::max(capacity, 1u);
+
+    // Two choices of eight slots reach ~95% occupancy; size for ~50% at
+    // capacity so inserts rarely need to displace
+    uint32_t buckets = 1;
+    while (static_cast<uint64_t>(buckets) * kSlotsPerBucket < static_cast<uint64_t>(capacity) * 2) buckets <<= 1;
+    bucket_mask_ = buckets - 1;
+    buckets_.reset(new Bucket[buckets]);
+    memset(buckets_.get(), 0, sizeof(Bucket) * buckets);
+
+    entries_.resize(capacity);
+    memset(entries_.data(), 0, sizeof(FlowEntry) * capacity);
+    free_entries_.reserve(capacity);
+    for (uint32_t i = capacity; i-- > 0;) free_entries_.push_back(i);
+
+    // The wheel spans four timeouts at 1/64 timeout resolution
+    tick_ns_ = std::max<uint64_t>(idle_timeout_ns_ / 64, 1);
+    for (uint32_t& head : wheel_heads_) head = kInvalidIndex;
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+FlowTable::~FlowTable() {}
+
+uint32_t FlowTable::alternate(uint32_t bucket, uint16_t signature) const {
+    return (bucket ^ (static_cast<uint32_t>(signature) * 0x5BD1E995u)) & bucket_mask_;
+}
+
+uint32_t FlowTable::findIndex(const FlowKey& key, uint64_t hash) const {
+    uint16_t signature = Signature(hash);
+    uint32_t bucket = static_cast<uint32_t>(hash) & bucket_mask_;
+    for (int choice = 0; choice < 2; ++choice) {
+        const Bucket& b = buckets_[bucket];
+        uint32_t mask = MatchSignatures(b.signatures, signature);
+        while (mask) {
+            int slot = LowestBit(mask);
+            mask &= mask - 1;
+            uint32_t index = b.entries[slot];
+            if (entries_[index].key == key) return index;
+        }
+        bucket = alternate(bucket, signature);
+    }
+    return kInvalidIndex;
+}
+
+const FlowEntry* FlowTable::find(const FlowKey& key) const {
+    ++stats_.lookups;
+    uint32_t index = findIndex(key, HashFlowKey(key));
+    if (index == kInvalidIndex) return nullptr;
+    ++stats_.hits;
+    return &entries_[index];
+}
+
+// Put (signature, index) into one of its two buckets, displacing entries
+// along the shortest path to a free slot if both are full
+bool FlowTable::place(uint32_t bucket_a, uint32_t bucket_b, uint16_t signature, uint32_t index) {
+    struct Node {
+        uint32_t bucket;
+        uint32_t parent;   // node index, kInvalidIndex for the roots
+        int parent_slot;   // slot in the parent's bucket whose entry moves here
+    };
+    Node nodes[kMaxSearchNodes];
+    size_t count = 0;
+    nodes[count++] = { bucket_a, kInvalidIndex, -1 };
+    if (bucket_b != bucket_a) nodes[count++] = { bucket_b, kInvalidIndex, -1 };
+
+    for (size_t head = 0; head < count; ++head) {
+        Bucket& b = buckets_[nodes[head].bucket];
+        uint32_t empty = MatchSignatures(b.signatures, 0);
+        if (empty) {
+            // Walk back to the root, shifting each entry one step down the path
+            int slot = LowestBit(empty);
+            size_t node = head;
+            while (nodes[node].parent != kInvalidIndex) {
+                const Node& parent = nodes[nodes[node].parent];
+                Bucket& from = buckets_[parent.bucket];
+                Bucket& to = buckets_[nodes[node].bucket];
+                to.signatures[slot] = from.signatures[nodes[node].parent_slot];
+                to.entries[slot] = from.entries[nodes[node].parent_slot];
+                ++stats_.displacements;
+                slot = nodes[node].parent_slot;
+                node = nodes[node].parent;
+            }
+            Bucket& root = buckets_[nodes[node].bucket];
+            root.signatures[slot] = signature;
+            root.entries[slot] = index;
+            return true;
+        }
+
+        for (int slot = 0; slot < kSlotsPerBucket && count < kMaxSearchNodes; ++slot) {
+            // Paths must not revisit a bucket, or a later move would pick up
+            // an entry an earlier one put there
+            uint32_t next = alternate(nodes[head].bucket, b.signatures[slot]);
+            bool on_path = false;
+            for (uint32_t node = static_cast<uint32_t>(head); node != kInvalidIndex; node = nodes[node].parent) {
+                if (nodes[node].bucket == next) {
+                    on_path = true;
+                    break;
+                }
+            }
+            if (on_path) continue;
+            nodes[count++] = { next, static_cast<uint32_t>(head), slot };
+        }
+    }
+    return false;
+}
+
+FlowEntry* FlowTable::track(const FlowKey& key, uint64_t now_ns) {
+    ++stats_.lookups;
+    uint64_t hash = HashFlowKey(key);
+    uint32_t index = findIndex(key, hash);
+    if (index != kInvalidIndex) {
+        ++stats_.hits;
+        FlowEntry& entry = entries_[index];
+        entry.last_seen_ns = now_ns;
+        return &entry;
+    }
+
+    if (free_entries_.empty()) {
+        ++stats_.insert_failures;
+        return nullptr;
+    }
+    index = free_entries_.back();
+
+    uint16_t signature = Signature(hash);
+    uint32_t bucket = static_cast<uint32_t>(hash) & bucket_mask_;
+    if (!place(bucket, alternate(bucket, signature), signature, index)) {
+        ++stats_.insert_failures;
+        return nullptr;
+    }
+    free_entries_.pop_back();
+    ++size_;
+    ++stats_.inserts;
+
+    FlowEntry& entry = entries_[index];
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    entry.first_seen_ns = now_ns;
+    entry.last_seen_ns = now_ns;
+    entry.in_use = true;
+    if (!wheel_started_) {
+        current_tick_ = now_ns / tick_ns_;
+        wheel_started_ = true;
+    }
+    wheelInsert(index, (now_ns + idle_timeout_ns_) / tick_ns_);
+    return &entry;
+}
+
+void FlowTable::count(FlowEntry& entry, TrafficDirection direction, size_t bytes, uint8_t tcp_flags,
+                      bool forwarded, uint64_t now_ns) {
+    if (forwarded) {
+        entry.bytes[direction] += bytes;
+        ++entry.packets[direction];
+    } else {
+        ++entry.dropped_packets[direction];
+    }
+
+    if (entry.rtt_ns || !(tcp_flags & (kTcpSyn | kTcpAck))) return;
+    if ((tcp_flags & (kTcpSyn | kTcpAck)) == kTcpSyn) {
+        entry.syn_ns = now_ns;
+        entry.syn_direction = static_cast<uint8_t>(direction);
+        entry.syn_ack_ns = 0;
+    } else if ((tcp_flags & kTcpSyn) && entry.syn_ns && direction != entry.syn_direction) {
+        entry.syn_ack_ns = now_ns;
+    } else if (!(tcp_flags & kTcpSyn) && entry.syn_ack_ns && direction == entry.syn_direction) {
+        entry.rtt_ns = std::max<uint64_t>(now_ns - entry.syn_ns, 1);
+    }
+}
+
+void FlowTable::removeFromBuckets(uint32_t index) {
+    uint64_t hash = HashFlowKey(entries_[index].key);
+    uint16_t signature = Signature(hash);
+    uint32_t bucket = static_cast<uint32_t>(hash) & bucket_mask_;
+    for (int choice = 0; choice < 2; ++choice) {
+        Bucket& b = buckets_[bucket];
+        uint32_t mask = MatchSignatures(b.signatures, signature);
+        while (mask) {
+            int slot = LowestBit(mask);
+            mask &= mask - 1;
+            if (b.entries[slot] == index) {
+                b.signatures[slot] = 0;
+                return;
+            }
+        }
+        bucket = alternate(bucket, signature);
+    }
+}
+
+void FlowTable::freeEntry(uint32_t index) {
+    removeFromBuckets(index);
+    entries_[index].in_use = false;
+    free_entries_.push_back(index);
+    --size_;
+}
+
+bool FlowTable::remove(const FlowKey& key) {
+    uint32_t index = findIndex(key, HashFlowKey(key));
+    if (index == kInvalidIndex) return false;
+    wheelUnlink(index);
+    freeEntry(index);
+    ++stats_.removed;
+    return true;
+}
+
+void FlowTable::wheelInsert(uint32_t index, uint64_t tick) {
+    uint32_t slot = static_cast<uint32_t>(tick % kWheelSlots);
+    FlowEntry& entry = entries_[index];
+    entry.wheel_slot = static_cast<uint16_t>(slot);
+    entry.wheel_prev = kInvalidIndex;
+    entry.wheel_next = wheel_heads_[slot];
+    if (entry.wheel_next != kInvalidIndex) entries_[entry.wheel_next].wheel_prev = index;
+    wheel_heads_[slot] = index;
+}
+
+void FlowTable::wheelUnlink(uint32_t index) {
+    FlowEntry& entry = entries_[index];
+    if (entry.wheel_prev != kInvalidIndex) {
+        entries_[entry.wheel_prev].wheel_next = entry.wheel_next;
+    } else {
+        wheel_heads_[entry.wheel_slot] = entry.wheel_next;
+    }
+    if (entry.wheel_next != kInvalidIndex) entries_[entry.wheel_next].wheel_prev = entry.wheel_prev;
+    entry.wheel_prev = entry.wheel_next = kInvalidIndex;
+}
+
+void FlowTable::expire(uint64_t now_ns) {
+    uint64_t target = now_ns / tick_ns_;
+    if (!wheel_started_ || target <= current_tick_) return;
+
+    // After a long pause every slot is visited once
+    if (target - current_tick_ > kWheelSlots) current_tick_ = target - kWheelSlots;
+
+    while (current_tick_ < target) {
+        ++current_tick_;
+        uint32_t slot = static_cast<uint32_t>(current_tick_ % kWheelSlots);
+        uint32_t index = wheel_heads_[slot];
+        wheel_heads_[slot] = kInvalidIndex;
+
+        while (index != kInvalidIndex) {
+            FlowEntry& entry = entries_[index];
+            uint32_t next = entry.wheel_next;
+            uint64_t expiry_tick = (entry.last_seen_ns + idle_timeout_ns_) / tick_ns_;
+            if (expiry_tick <= current_tick_) {
+                entry.wheel_prev = entry.wheel_next = kInvalidIndex;
+                freeEntry(index);
+                ++stats_.expired;
+            } else {
+                wheelInsert(index, expiry_tick);
+            }
+            index = next;
+        }
+    }
+}
+
+std::vector<FlowEntry> FlowTable::topFlows(size_t n) const {
+    std::vector<FlowEntry> flows;
+    flows.reserve(size_);
+    forEach([&flows](const FlowEntry& entry) { flows.push_back(entry); });
+
+    auto total = [](const FlowEntry& entry) { return entry.bytes[kTrafficDown] + entry.bytes[kTrafficUp]; };
+    n = std::min(n, flows.size());
+    std::partial_sort(flows.begin(), flows.begin() + static_cast<std::ptrdiff_t>(n), flows.end(),
+                      [&total](const FlowEntry& a, const FlowEntry& b) { return total(a) > total(b); });
+    flows.resize(n);
+    return flows;
+}
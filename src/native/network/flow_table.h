@@ -0,0 +1,177 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "traffic_counters.h"
+
+// IPv4 5-tuple in canonical order: the endpoint with the lower (ip, port)
+// is "a", so both directions of a connection map to one key. Ports are 0
+// for protocols without them.
+struct FlowKey {
+    uint32_t ip_a;
+    uint32_t ip_b;
+    uint16_t port_a;
+    uint16_t port_b;
+    uint8_t protocol;
+    uint8_t pad[3];
+};
+static_assert(sizeof(FlowKey) == 16, "FlowKey must stay 16 bytes");
+
+inline bool operator==(const FlowKey& a, const FlowKey& b) {
+    return a.ip_a == b.ip_a && a.ip_b == b.ip_b && a.port_a == b.port_a && a.port_b == b.port_b &&
+           a.protocol == b.protocol;
+}
+
+// Build the canonical key for a packet (addresses in host byte order)
+FlowKey MakeFlowKey(uint32_t src_ip, uint32_t dst_ip, uint16_t src_port, uint16_t dst_port, uint8_t protocol);
+
+// TCP flags as in the header's 14th byte
+enum TcpFlag : uint8_t {
+    kTcpFin = 0x01,
+    kTcpSyn = 0x02,
+    kTcpRst = 0x04,
+    kTcpAck = 0x10
+};
+
+// State and counters of one tracked flow
+struct FlowEntry {
+    FlowKey key;
+    uint64_t first_seen_ns;
+    uint64_t last_seen_ns;
+    uint64_t bytes[2];          // indexed by TrafficDirection
+    uint64_t packets[2];
+    uint64_t dropped_packets[2];
+
+    // TCP handshake RTT as seen from the shaper: SYN -> SYN/ACK plus
+    // SYN/ACK -> ACK. 0 until the handshake has been observed.
+    uint64_t rtt_ns;
+    uint64_t syn_ns;
+    uint64_t syn_ack_ns;
+    uint8_t syn_direction;
+
+    // Window shaping (DataPlane): window scale per direction, see
+    // tcp_window.h, and the last interval the flow was counted active in
+    uint8_t window_scale[2];
+    uint32_t window_interval;
+
+    // Caller data, e.g. a cached classification; 0 for new flows
+    uint32_t user_data;
+
+    // Timer wheel links (entry indices)
+    uint32_t wheel_prev;
+    uint32_t wheel_next;
+    uint16_t wheel_slot;
+    bool in_use;
+};
+
+// Connection tracking table
+//
+// Bucketized cuckoo hash: every key has two candidate buckets of eight
+// slots; a slot holds a 16-bit signature of the key and the index of a
+// preallocated FlowEntry. Lookups compare the signatures of a bucket at
+// once (SSE2 where available) and only touch entries whose signature
+// matches, so a lookup is at most two cache lines plus one entry. The
+// second bucket is derived from the first and the signature (partial-key
+// cuckoo), so entries can be moved without rehashing their key. Inserts
+// that find both buckets full search a short displacement path (BFS) and
+// move entries along it; nothing is ever evicted to make room.
+//
+// Idle flows age out through a hashed timer wheel: an entry sits in the slot
+// of its expiry tick and is only looked at when the wheel reaches that
+// slot, where it is freed or, if it saw traffic in the meantime, moved to
+// its new expiry slot. Packets only update last_seen_ns.
+//
+// Used from a single thread (the data path that owns it).
+class FlowTable {
+public:
+    static const uint32_t kInvalidIndex = 0xFFFFFFFF;
+    static const uint32_t kWheelSlots = 256;
+
+    struct Stats {
+        uint64_t lookups;
+        uint64_t hits;
+        uint64_t inserts;
+        uint64_t insert_failures;   // table full or no displacement path
+        uint64_t displacements;     // entries moved to their other bucket
+        uint64_t expired;
+        uint64_t removed;
+    };
+
+    // capacity flows are preallocated; idle_timeout_ns is the time after a
+    // flow's last packet before it is freed
+    FlowTable(uint32_t capacity, uint64_t idle_timeout_ns);
+    ~FlowTable();
+
+    FlowTable(const FlowTable&) = delete;
+    FlowTable& operator=(const FlowTable&) = delete;
+
+    // Find the entry for key, creating it if needed. Returns nullptr when
+    // the table is full. The pointer stays valid until the next call that
+    // inserts, removes or expires.
+    FlowEntry* track(const FlowKey& key, uint64_t now_ns);
+    const FlowEntry* find(const FlowKey& key) const;
+    bool remove(const FlowKey& key);
+
+    // Account one packet to a flow returned by track()
+    static void count(FlowEntry& entry, TrafficDirection direction, size_t bytes, uint8_t tcp_flags,
+                      bool forwarded, uint64_t now_ns);
+
+    // Advance the timer wheel to now_ns, freeing flows idle for longer than
+    // the timeout. Cheap when the wheel tick has not changed.
+    void expire(uint64_t now_ns);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return entries_.size(); }
+    size_t bucketCount() const { return bucket_mask_ + 1; }
+    const Stats& stats() const { return stats_; }
+
+    // The n flows with the most bytes (both directions), largest first
+    std::vector<FlowEntry> topFlows(size_t n) const;
+
+    template <typename F>
+    void forEach(F&& visit) const {
+        for (const FlowEntry& entry : entries_) {
+            if (entry.in_use) visit(entry);
+        }
+    }
+
+    template <typename F>
+    void forEach(F&& visit) {
+        for (FlowEntry& entry : entries_) {
+            if (entry.in_use) visit(entry);
+        }
+    }
+
+private:
+    static const int kSlotsPerBucket = 8;
+
+    struct alignas(64) Bucket {
+        uint16_t signatures[kSlotsPerBucket];   // 0 = empty slot
+        uint32_t entries[kSlotsPerBucket];
+    };
+
+    std::unique_ptr<Bucket[]> buckets_;
+    uint32_t bucket_mask_;
+    std::vector<FlowEntry> entries_;
+    std::vector<uint32_t> free_entries_;
+    size_t size_;
+
+    uint64_t idle_timeout_ns_;
+    uint64_t tick_ns_;
+    uint64_t current_tick_;
+    bool wheel_started_;
+    uint32_t wheel_heads_[kWheelSlots];
+
+    mutable Stats stats_;
+
+    uint32_t alternate(uint32_t bucket, uint16_t signature) const;
+    uint32_t findIndex(const FlowKey& key, uint64_t hash) const;
+    bool place(uint32_t bucket_a, uint32_t bucket_b, uint16_t signature, uint32_t index);
+    void removeFromBuckets(uint32_t index);
+
+    void wheelInsert(uint32_t index, uint64_t tick);
+    void wheelUnlink(uint32_t index);
+    void freeEntry(uint32_t index);
+};
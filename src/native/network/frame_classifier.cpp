@@ -0,0 +1,533 @@
+#include "frame_classifier.h"
+#include "device_table.h"
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define NS_CLASSIFY_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define NS_TARGET(isa)
+#else
+#define NS_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+static const size_t kEthernetHeaderSize = 14;
+static const size_t kVlanTagSize = 4;
+static const uint16_t kEtherTypeIpv4 = 0x0800;
+static const uint16_t kEtherTypeArp = 0x0806;
+static const uint16_t kEtherTypeVlan = 0x8100;
+static const uint32_t kInitialBuckets = 16;
+
+// Stands in for the MACs of frames too short to carry them: wider than 48
+// bits, so it is never stored and never equals kEmptyKey
+static const uint64_t kNoKey = 1ULL << 48;
+
+static inline uint16_t ReadBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// One multiply: the high half picks the first bucket, middle bits an odd
+// (so never zero) offset to the second
+static inline uint64_t HashMacKey(uint64_t key) {
+    return (key ^ (key >> 29)) * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline void Prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(NS_CLASSIFY_X86)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
+
+static inline int LowestBit(uint32_t mask) {
+    int bit = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+}
+
+// ---------------------------------------------------------------------------
+// ManagedMacSet
+
+ManagedMacSet::ManagedMacSet() : mask_(0), size_(0) {
+    reset(kInitialBuckets);
+}
+
+void ManagedMacSet::reset(uint32_t bucket_count) {
+    buckets_.assign(bucket_count, Bucket());
+    for (Bucket& bucket : buckets_) {
+        for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            bucket.keys[slot] = kEmptyKey;
+            bucket.values[slot] = 0;
+            bucket.reserved[slot] = 0;
+        }
+    }
+    mask_ = bucket_count - 1;
+    size_ = 0;
+}
+
+void ManagedMacSet::candidates(uint64_t key, uint32_t& first, uint32_t& second) const {
+    uint64_t hash = HashMacKey(key);
+    first = static_cast<uint32_t>(hash >> 32) & mask_;
+    second = (first ^ (static_cast<uint32_t>(hash >> 8) | 1u)) & mask_;
+}
+
+bool ManagedMacSet::find(uint64_t key, uint32_t& value) const {
+    uint32_t first, second;
+    candidates(key, first, second);
+    for (uint32_t index : { first, second }) {
+        const Bucket& bucket = buckets_[index];
+        for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            if (bucket.keys[slot] == key) {
+                value = bucket.values[slot];
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Into the emptier of the two buckets; false when both are full
+bool ManagedMacSet::place(uint64_t key, uint32_t value) {
+    uint32_t first, second;
+    candidates(key, first, second);
+    int free_slots[2] = { 0, 0 };
+    for (int choice = 0; choice < 2; ++choice) {
+        const Bucket& bucket = buckets_[choice == 0 ? first : second];
+        for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            if (bucket.keys[slot] == kEmptyKey) ++free_slots[choice];
+        }
+    }
+    if (free_slots[0] == 0 && free_slots[1] == 0) return false;
+
+    Bucket& bucket = buckets_[free_slots[0] >= free_slots[1] ? first : second];
+    for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+        if (bucket.keys[slot] == kEmptyKey) {
+            bucket.keys[slot] = key;
+            bucket.values[slot] = value;
+            ++size_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ManagedMacSet::grow() {
+    std::vector<Bucket> old;
+    old.swap(buckets_);
+    uint32_t bucket_count = static_cast<uint32_t>(old.size()) * 2;
+    for (;;) {
+        reset(bucket_count);
+        bool placed = true;
+        for (const Bucket& bucket : old) {
+            for (uint32_t slot = 0; slot < kSlotsPerBucket && placed; ++slot) {
+                if (bucket.keys[slot] != kEmptyKey) placed = place(bucket.keys[slot], bucket.values[slot]);
+            }
+            if (!placed) break;
+        }
+        if (placed) return;
+        bucket_count *= 2;
+    }
+}
+
+void ManagedMacSet::insert(uint64_t key, uint32_t value) {
+    uint32_t first, second;
+    candidates(key, first, second);
+    for (uint32_t index : { first, second }) {
+        Bucket& bucket = buckets_[index];
+        for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            if (bucket.keys[slot] == key) {
+                bucket.values[slot] = value;
+                return;
+            }
+        }
+    }
+    // Kept under 3/4 full so both-full collisions stay rare
+    if ((size_ + 1) * 4 > buckets_.size() * kSlotsPerBucket * 3) grow();
+    while (!place(key, value)) grow();
+}
+
+bool ManagedMacSet::erase(uint64_t key) {
+    uint32_t first, second;
+    candidates(key, first, second);
+    for (uint32_t index : { first, second }) {
+        Bucket& bucket = buckets_[index];
+        for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            if (bucket.keys[slot] == key) {
+                bucket.keys[slot] = kEmptyKey;
+                bucket.values[slot] = 0;
+                --size_;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ManagedMacSet::clear() {
+    reset(kInitialBuckets);
+}
+
+// ---------------------------------------------------------------------------
+// Kernels
+//
+// Each works on up to PacketIO::kMaxBurst frames in passes over small
+// arrays: headers into MAC keys and EtherTypes, EtherType compares (VLAN
+// tags resolved only when the batch has any), our/gateway compares,
+// hashing (with prefetch when the set is larger than L1), managed-set
+// probes, and finally out. keys[2i] is frame i's destination, keys[2i + 1]
+// its source; values likewise.
+
+namespace {
+struct Burst {
+    const ReceivedFrame* frames;
+    size_t count;
+    uint64_t our_key;
+    uint64_t gateway_key;
+    const ManagedMacSet* managed;
+    bool prefetch;
+
+    uint64_t keys[2 * PacketIO::kMaxBurst];
+    uint32_t values[2 * PacketIO::kMaxBurst];
+    uint32_t buckets[4 * PacketIO::kMaxBurst];
+    uint8_t probes[2 * PacketIO::kMaxBurst];  // keys worth a lookup, see LocateKeys()
+    size_t probe_count;
+    uint16_t types[PacketIO::kMaxBurst];     // zero past count, for the vector passes
+    uint16_t flags[PacketIO::kMaxBurst];
+};
+}
+
+// Sets below this many buckets (32 KB) stay in L1, where a prefetch is
+// only an extra instruction
+static const size_t kPrefetchBuckets = 512;
+
+static inline void ExtractScalar(Burst& burst, size_t i) {
+    const ReceivedFrame& frame = burst.frames[i];
+    if (frame.length < kEthernetHeaderSize) {
+        burst.keys[2 * i] = burst.keys[2 * i + 1] = kNoKey;
+        burst.types[i] = 0;
+        burst.flags[i] = kFrameShort;
+        return;
+    }
+    burst.keys[2 * i] = MacKey(frame.data);
+    burst.keys[2 * i + 1] = MacKey(frame.data + 6);
+    burst.types[i] = ReadBe16(frame.data + 12);
+    burst.flags[i] = 0;
+}
+
+static void ResolveVlans(Burst& burst) {
+    for (size_t i = 0; i < burst.count; ++i) {
+        const ReceivedFrame& frame = burst.frames[i];
+        if (burst.types[i] != kEtherTypeVlan || frame.length < kEthernetHeaderSize + kVlanTagSize) continue;
+        burst.types[i] = ReadBe16(frame.data + 16);
+        burst.flags[i] |= kFrameVlan;
+    }
+}
+
+// Bucket candidates of every key that needs a lookup, prefetched so the
+// probes that follow overlap their misses. Our MAC, the gateway's and the
+// stand-in for short frames are never looked up, which in relayed traffic
+// is half the keys.
+static void LocateKeys(Burst& burst) {
+    const ManagedMacSet::Bucket* table = burst.managed->buckets();
+    size_t count = 0;
+    for (size_t k = 0; k < 2 * burst.count; ++k) {
+        uint64_t key = burst.keys[k];
+        burst.values[k] = 0;
+        burst.probes[count] = static_cast<uint8_t>(k);
+        count += key != burst.our_key && key != burst.gateway_key && key != kNoKey;
+    }
+    burst.probe_count = count;
+    for (size_t p = 0; p < count; ++p) {
+        size_t k = burst.probes[p];
+        burst.managed->candidates(burst.keys[k], burst.buckets[2 * k], burst.buckets[2 * k + 1]);
+        if (burst.prefetch) {
+            Prefetch(&table[burst.buckets[2 * k]]);
+            Prefetch(&table[burst.buckets[2 * k + 1]]);
+        }
+    }
+}
+
+static inline void SetManaged(Burst& burst, size_t k, uint32_t value) {
+    burst.values[k] = value;
+    // kFrameDstManaged for a destination (even k), kFrameSrcManaged for a source
+    burst.flags[k / 2] |= static_cast<uint16_t>(kFrameDstManaged >> (k & 1));
+}
+
+static void WriteOut(const Burst& burst, FrameClass* out) {
+    for (size_t i = 0; i < burst.count; ++i) {
+        out[i].ethertype = burst.types[i];
+        out[i].flags = burst.flags[i];
+        out[i].src_value = burst.values[2 * i + 1];
+        out[i].dst_value = burst.values[2 * i];
+    }
+}
+
+static void ClassifyScalar(Burst& burst, FrameClass* out) {
+    bool vlan = false;
+    for (size_t i = 0; i < burst.count; ++i) {
+        ExtractScalar(burst, i);
+        vlan |= burst.types[i] == kEtherTypeVlan;
+    }
+    if (vlan) ResolveVlans(burst);
+    for (size_t i = 0; i < burst.count; ++i) {
+        uint16_t& flags = burst.flags[i];
+        if (burst.types[i] == kEtherTypeIpv4) flags |= kFrameIpv4;
+        if (burst.types[i] == kEtherTypeArp) flags |= kFrameArp;
+        if (burst.keys[2 * i] == burst.our_key) flags |= kFrameToUs;
+        if (burst.keys[2 * i + 1] == burst.our_key) flags |= kFrameFromUs;
+        if (burst.keys[2 * i + 1] == burst.gateway_key) flags |= kFrameFromGateway;
+    }
+
+    LocateKeys(burst);
+    const ManagedMacSet::Bucket* table = burst.managed->buckets();
+    for (size_t p = 0; p < burst.probe_count; ++p) {
+        size_t k = burst.probes[p];
+        bool found = false;
+        for (int choice = 0; choice < 2 && !found; ++choice) {
+            const ManagedMacSet::Bucket& bucket = table[burst.buckets[2 * k + choice]];
+            for (uint32_t slot = 0; slot < ManagedMacSet::kSlotsPerBucket; ++slot) {
+                if (bucket.keys[slot] == burst.keys[k]) {
+                    SetManaged(burst, k, bucket.values[slot]);
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+    WriteOut(burst, out);
+}
+
+#ifdef NS_CLASSIFY_X86
+// Flags of one frame from its two address compare bits against our MAC
+// (bit 0 destination, bit 1 source) and against the gateway's (bits 2-3)
+static const uint16_t kAddressFlags[16] = {
+    0, kFrameToUs, kFrameFromUs, kFrameToUs | kFrameFromUs,
+    0, kFrameToUs, kFrameFromUs, kFrameToUs | kFrameFromUs,
+    kFrameFromGateway, kFrameToUs | kFrameFromGateway, kFrameFromUs | kFrameFromGateway,
+    kFrameToUs | kFrameFromUs | kFrameFromGateway,
+    kFrameFromGateway, kFrameToUs | kFrameFromGateway, kFrameFromUs | kFrameFromGateway,
+    kFrameToUs | kFrameFromUs | kFrameFromGateway,
+};
+
+// Frames with at least 16 readable bytes: one unaligned load, and a
+// shuffle reverses bytes 0-5 and 6-11 into the two MacKey() values
+NS_TARGET("sse4.1")
+static void ExtractSse41(Burst& burst) {
+    const __m128i shuffle = _mm_setr_epi8(5, 4, 3, 2, 1, 0, -1, -1, 11, 10, 9, 8, 7, 6, -1, -1);
+    for (size_t i = 0; i < burst.count; ++i) {
+        const ReceivedFrame& frame = burst.frames[i];
+        if (frame.length < kEthernetHeaderSize || frame.capacity < 16) {
+            ExtractScalar(burst, i);
+            continue;
+        }
+        __m128i header = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame.data));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&burst.keys[2 * i]), _mm_shuffle_epi8(header, shuffle));
+        burst.types[i] = ReadBe16(frame.data + 12);
+        burst.flags[i] = 0;
+    }
+    for (size_t i = burst.count; i < PacketIO::kMaxBurst; ++i) burst.types[i] = burst.flags[i] = 0;
+}
+
+NS_TARGET("sse4.1")
+static void ClassifySse41(Burst& burst, FrameClass* out) {
+    ExtractSse41(burst);
+
+    // EtherTypes, eight frames per compare, straight into the flag words
+    const __m128i vlan = _mm_set1_epi16(static_cast<short>(kEtherTypeVlan));
+    __m128i any_vlan = _mm_setzero_si128();
+    for (size_t i = 0; i < burst.count; i += 8) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(burst.types + i));
+        any_vlan = _mm_or_si128(any_vlan, _mm_cmpeq_epi16(lanes, vlan));
+    }
+    if (!_mm_testz_si128(any_vlan, any_vlan)) ResolveVlans(burst);
+    const __m128i ipv4 = _mm_set1_epi16(static_cast<short>(kEtherTypeIpv4));
+    const __m128i arp = _mm_set1_epi16(static_cast<short>(kEtherTypeArp));
+    const __m128i ipv4_flag = _mm_set1_epi16(static_cast<short>(kFrameIpv4));
+    const __m128i arp_flag = _mm_set1_epi16(static_cast<short>(kFrameArp));
+    for (size_t i = 0; i < burst.count; i += 8) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(burst.types + i));
+        __m128i flags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(burst.flags + i));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_cmpeq_epi16(lanes, ipv4), ipv4_flag));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_cmpeq_epi16(lanes, arp), arp_flag));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(burst.flags + i), flags);
+    }
+
+    // One frame's destination and source per compare
+    const __m128i ours = _mm_set1_epi64x(static_cast<long long>(burst.our_key));
+    const __m128i gateway = _mm_set1_epi64x(static_cast<long long>(burst.gateway_key));
+    for (size_t i = 0; i < burst.count; ++i) {
+        __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&burst.keys[2 * i]));
+        int us = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(keys, ours)));
+        int gw = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(keys, gateway)));
+        burst.flags[i] |= kAddressFlags[us | gw << 2];
+    }
+
+    // A bucket is two compares of two keys
+    LocateKeys(burst);
+    const ManagedMacSet::Bucket* table = burst.managed->buckets();
+    for (size_t p = 0; p < burst.probe_count; ++p) {
+        size_t k = burst.probes[p];
+        __m128i key = _mm_set1_epi64x(static_cast<long long>(burst.keys[k]));
+        for (int choice = 0; choice < 2; ++choice) {
+            const ManagedMacSet::Bucket& bucket = table[burst.buckets[2 * k + choice]];
+            __m128i low = _mm_cmpeq_epi64(_mm_load_si128(reinterpret_cast<const __m128i*>(bucket.keys)), key);
+            __m128i high = _mm_cmpeq_epi64(_mm_load_si128(reinterpret_cast<const __m128i*>(bucket.keys + 2)), key);
+            uint32_t match = static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(low)) |
+                                                   (_mm_movemask_pd(_mm_castsi128_pd(high)) << 2));
+            if (match) {
+                SetManaged(burst, k, bucket.values[LowestBit(match)]);
+                break;
+            }
+        }
+    }
+    WriteOut(burst, out);
+}
+
+NS_TARGET("avx2")
+static void ClassifyAvx2(Burst& burst, FrameClass* out) {
+    // Same extraction as SSE4.1 (VEX-encoded here, so no transition stalls)
+    const __m128i shuffle = _mm_setr_epi8(5, 4, 3, 2, 1, 0, -1, -1, 11, 10, 9, 8, 7, 6, -1, -1);
+    for (size_t i = 0; i < burst.count; ++i) {
+        const ReceivedFrame& frame = burst.frames[i];
+        if (frame.length < kEthernetHeaderSize || frame.capacity < 16) {
+            ExtractScalar(burst, i);
+            continue;
+        }
+        __m128i header = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame.data));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&burst.keys[2 * i]), _mm_shuffle_epi8(header, shuffle));
+        burst.types[i] = ReadBe16(frame.data + 12);
+        burst.flags[i] = 0;
+    }
+    for (size_t i = burst.count; i < PacketIO::kMaxBurst; ++i) burst.types[i] = burst.flags[i] = 0;
+
+    // EtherTypes, sixteen frames per compare
+    const __m256i vlan = _mm256_set1_epi16(static_cast<short>(kEtherTypeVlan));
+    __m256i any_vlan = _mm256_setzero_si256();
+    for (size_t i = 0; i < burst.count; i += 16) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(burst.types + i));
+        any_vlan = _mm256_or_si256(any_vlan, _mm256_cmpeq_epi16(lanes, vlan));
+    }
+    if (!_mm256_testz_si256(any_vlan, any_vlan)) ResolveVlans(burst);
+    const __m256i ipv4 = _mm256_set1_epi16(static_cast<short>(kEtherTypeIpv4));
+    const __m256i arp = _mm256_set1_epi16(static_cast<short>(kEtherTypeArp));
+    const __m256i ipv4_flag = _mm256_set1_epi16(static_cast<short>(kFrameIpv4));
+    const __m256i arp_flag = _mm256_set1_epi16(static_cast<short>(kFrameArp));
+    for (size_t i = 0; i < burst.count; i += 16) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(burst.types + i));
+        __m256i flags = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(burst.flags + i));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_cmpeq_epi16(lanes, ipv4), ipv4_flag));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_cmpeq_epi16(lanes, arp), arp_flag));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(burst.flags + i), flags);
+    }
+
+    // Two frames per compare: lanes are dst0, src0, dst1, src1. An odd
+    // count reads one stale pair, whose bits are not used.
+    const __m256i ours = _mm256_set1_epi64x(static_cast<long long>(burst.our_key));
+    const __m256i gateway = _mm256_set1_epi64x(static_cast<long long>(burst.gateway_key));
+    for (size_t i = 0; i < burst.count; i += 2) {
+        __m256i keys = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&burst.keys[2 * i]));
+        int us = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys, ours)));
+        int gw = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys, gateway)));
+        burst.flags[i] |= kAddressFlags[(us & 3) | (gw & 3) << 2];
+        if (i + 1 < burst.count) burst.flags[i + 1] |= kAddressFlags[(us >> 2) | (gw >> 2) << 2];
+    }
+
+    // A bucket is one compare
+    LocateKeys(burst);
+    const ManagedMacSet::Bucket* table = burst.managed->buckets();
+    for (size_t p = 0; p < burst.probe_count; ++p) {
+        size_t k = burst.probes[p];
+        __m256i key = _mm256_set1_epi64x(static_cast<long long>(burst.keys[k]));
+        for (int choice = 0; choice < 2; ++choice) {
+            const ManagedMacSet::Bucket& bucket = table[burst.buckets[2 * k + choice]];
+            __m256i equal = _mm256_cmpeq_epi64(_mm256_load_si256(reinterpret_cast<const __m256i*>(bucket.keys)), key);
+            uint32_t match = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(equal)));
+            if (match) {
+                SetManaged(burst, k, bucket.values[LowestBit(match)]);
+                break;
+            }
+        }
+    }
+    WriteOut(burst, out);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// FrameClassifier
+
+// Keys start as kEmptyKey, which no extracted key equals
+FrameClassifier::FrameClassifier()
+    : our_key_(ManagedMacSet::kEmptyKey), gateway_key_(ManagedMacSet::kEmptyKey), isa_(BestIsa()) {}
+
+void FrameClassifier::setAddresses(const uint8_t* our_mac, const uint8_t* gateway_mac) {
+    our_key_ = MacKey(our_mac);
+    gateway_key_ = MacKey(gateway_mac);
+}
+
+FrameClassifier::Isa FrameClassifier::BestIsa() {
+#ifdef NS_CLASSIFY_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    // AVX2 needs the OS to save the YMM state (OSXSAVE, XCR0 bits 1-2)
+    bool ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    bool avx2 = false;
+    if (max_leaf >= 7 && ymm) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (avx2) return kIsaAvx2;
+    if (sse41) return kIsaSse41;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return kIsaAvx2;
+    if (__builtin_cpu_supports("sse4.1")) return kIsaSse41;
+#endif
+#endif
+    return kIsaScalar;
+}
+
+FrameClassifier::Isa FrameClassifier::setIsa(Isa isa) {
+    Isa best = BestIsa();
+    isa_ = isa > best ? best : isa;
+    return isa_;
+}
+
+const char* FrameClassifier::IsaName(Isa isa) {
+    switch (isa) {
+        case kIsaAvx2: return "avx2";
+        case kIsaSse41: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+void FrameClassifier::classify(const ReceivedFrame* frames, size_t count, FrameClass* out) const {
+    Burst burst;
+    burst.our_key = our_key_;
+    burst.gateway_key = gateway_key_;
+    burst.managed = &managed_;
+    burst.prefetch = managed_.bucketCount() >= kPrefetchBuckets;
+    for (size_t done = 0; done < count; done += PacketIO::kMaxBurst) {
+        burst.frames = frames + done;
+        burst.count = count - done < PacketIO::kMaxBurst ? count - done : PacketIO::kMaxBurst;
+        switch (isa_) {
+#ifdef NS_CLASSIFY_X86
+            case kIsaAvx2: ClassifyAvx2(burst, out + done); break;
+            case kIsaSse41: ClassifySse41(burst, out + done); break;
+#endif
+            default: ClassifyScalar(burst, out + done); break;
+        }
+    }
+}
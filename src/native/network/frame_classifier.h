@@ -0,0 +1,109 @@
+#pragma once
+
+#include "packet_io.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// What the burst classifier found in one frame
+enum FrameClassFlag : uint16_t {
+    kFrameIpv4 = 0x0001,          // EtherType, after one VLAN tag, is IPv4
+    kFrameArp = 0x0002,
+    kFrameVlan = 0x0004,          // one 802.1Q tag, EtherType is the inner one
+    kFrameFromUs = 0x0008,        // source MAC is our MAC
+    kFrameToUs = 0x0010,          // destination MAC is our MAC
+    kFrameFromGateway = 0x0020,
+    kFrameSrcManaged = 0x0040,    // source MAC in the managed set, src_value valid
+    kFrameDstManaged = 0x0080,    // destination MAC in the managed set, dst_value valid
+                                  // (our and the gateway's MACs are not looked up)
+    kFrameShort = 0x0100          // no complete Ethernet header; nothing else set
+};
+
+struct FrameClass {
+    uint16_t ethertype;   // host order; 0 for short frames
+    uint16_t flags;       // FrameClassFlag bits
+    uint32_t src_value;   // ManagedMacSet values of the source/destination MAC
+    uint32_t dst_value;
+};
+
+// Set of MAC keys (MacKey(), device_table.h), each with a 32-bit value
+//
+// Two-choice hashing over buckets of four keys: a key lives in one of the
+// two buckets its hash picks, so a lookup compares at most eight keys, a
+// bucket at a time with one vector compare. Buckets are one cache line.
+// Inserts that find both buckets full grow the table; nothing is ever
+// displaced, so a lookup never has to look further.
+class ManagedMacSet {
+public:
+    static const uint32_t kSlotsPerBucket = 4;
+
+    struct alignas(64) Bucket {
+        uint64_t keys[kSlotsPerBucket];     // kEmptyKey when free
+        uint32_t values[kSlotsPerBucket];
+        uint32_t reserved[kSlotsPerBucket];
+    };
+    static const uint64_t kEmptyKey = ~0ULL;
+
+    ManagedMacSet();
+
+    // Add key, or update its value. Keys are 48-bit MAC keys.
+    void insert(uint64_t key, uint32_t value);
+    bool erase(uint64_t key);
+    void clear();
+    bool find(uint64_t key, uint32_t& value) const;
+    size_t size() const { return size_; }
+
+    // The two buckets key may live in, for batched probes
+    void candidates(uint64_t key, uint32_t& first, uint32_t& second) const;
+    const Bucket* buckets() const { return buckets_.data(); }
+    size_t bucketCount() const { return buckets_.size(); }
+
+private:
+    std::vector<Bucket> buckets_;
+    uint32_t mask_;
+    size_t size_;
+
+    void reset(uint32_t bucket_count);
+    bool place(uint64_t key, uint32_t value);
+    void grow();
+};
+
+// Batch classification of received frames
+//
+// classify() works on a burst at a time: it pulls the MACs and EtherType
+// out of every header, compares the EtherTypes and the MACs against our
+// and the gateway's for the whole batch, hashes all the MACs and
+// prefetches their buckets, and only then probes the managed set, so the
+// cache misses of a burst overlap. The compares and probes use AVX2 or
+// SSE4.1 when the CPU has them (chosen at run time) with a scalar
+// fallback; every kernel gives the same result.
+class FrameClassifier {
+public:
+    enum Isa : uint8_t {
+        kIsaScalar = 0,
+        kIsaSse41,
+        kIsaAvx2
+    };
+
+    FrameClassifier();
+
+    void setAddresses(const uint8_t* our_mac, const uint8_t* gateway_mac);
+    ManagedMacSet& managed() { return managed_; }
+    const ManagedMacSet& managed() const { return managed_; }
+
+    // Fill out[i] for frames[i], i < count (any count)
+    void classify(const ReceivedFrame* frames, size_t count, FrameClass* out) const;
+
+    // Kernel in use, the best the CPU supports unless lowered (benchmarks,
+    // checks). setIsa() returns the kernel actually selected.
+    Isa isa() const { return isa_; }
+    Isa setIsa(Isa isa);
+    static Isa BestIsa();
+    static const char* IsaName(Isa isa);
+
+private:
+    ManagedMacSet managed_;
+    uint64_t our_key_;
+    uint64_t gateway_key_;
+    Isa isa_;
+};
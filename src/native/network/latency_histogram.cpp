@@ -0,0 +1,128 @@
+#include "latency_histogram.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static int HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < kSubBucketCount) {
+        return static_cast<size_t>(value);
+    }
+    // Octave o (value in [2^(o+4), 2^(o+5))) starts at bucket (o + 1) * 16
+    int shift = HighestBit(value) - kSubBucketBits;
+    return (static_cast<size_t>(shift) + 1) * kSubBucketCount +
+           static_cast<size_t>((value >> shift) & (kSubBucketCount - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    int shift = static_cast<int>(index / kSubBucketCount) - 1;
+    uint64_t lower = (kSubBucketCount + (index % kSubBucketCount)) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value_ns) {
+    buckets_[bucketIndex(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value_ns, std::memory_order_relaxed);
+
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while (value_ns > current &&
+           !max_.compare_exchange_weak(current, value_ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::mergeInto(LatencyHistogram& target) const {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+        if (n) target.buckets_[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    target.count_.fetch_add(count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    target.sum_.fetch_add(sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t value = max_.load(std::memory_order_relaxed);
+    uint64_t current = target.max_.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const {
+    // Buckets are read one at a time while writers may be active, so use
+    // the bucket total rather than count_ to stay self-consistent
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0) return 0;
+
+    if (quantile < 0) quantile = 0;
+    if (quantile > 1) quantile = 1;
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5);
+    if (rank == 0) rank = 1;
+
+    uint64_t max_value = max_.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t bound = bucketUpperBound(i);
+            return bound < max_value ? bound : max_value;
+        }
+    }
+    return max_value;
+}
+
+LatencySummary LatencyHistogram::summarize() const {
+    const double kNsPerMs = 1e6;
+    LatencySummary summary;
+    summary.count = count_.load(std::memory_order_relaxed);
+    uint64_t sum = sum_.load(std::memory_order_relaxed);
+    summary.mean_ms = summary.count ? static_cast<double>(sum) / static_cast<double>(summary.count) / kNsPerMs : 0.0;
+    summary.p50_ms = static_cast<double>(percentile(0.50)) / kNsPerMs;
+    summary.p90_ms = static_cast<double>(percentile(0.90)) / kNsPerMs;
+    summary.p99_ms = static_cast<double>(percentile(0.99)) / kNsPerMs;
+    summary.p999_ms = static_cast<double>(percentile(0.999)) / kNsPerMs;
+    summary.max_ms = static_cast<double>(max_.load(std::memory_order_relaxed)) / kNsPerMs;
+    return summary;
+}
+
+const char* LatencyStageName(LatencyStage stage) {
+    switch (stage) {
+        case kStageCapture: return "capture";
+        case kStageClassify: return "classify";
+        case kStageShape: return "shape";
+        case kStageForward: return "forward";
+        default: return "unknown";
+    }
+}
+
+LatencyHistogram& GetStageLatency(LatencyStage stage) {
+    static LatencyHistogram stages[kStageCount];
+    return stages[stage < kStageCount ? stage : kStageCapture];
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Percentile summary of a latency histogram, in milliseconds
+struct LatencySummary {
+    uint64_t count;
+    double mean_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double p999_ms;
+    double max_ms;
+};
+
+// HDR-style log-linear latency histogram
+//
+// Values are nanoseconds. Every power-of-two range is split into 16 linear
+// sub-buckets, so any recorded value lands in a bucket no wider than 1/16 of
+// its magnitude (percentiles are within ~6%) across the full 64-bit range,
+// in a fixed 976-bucket array. Recording is a handful of relaxed atomic
+// adds with no locks or allocation, safe from any number of threads.
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 4;
+    static const uint64_t kSubBucketCount = 1 << kSubBucketBits;
+    static const size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t value_ns);
+    void reset();
+
+    // Add this histogram's contents into another (used to merge shards)
+    void mergeInto(LatencyHistogram& target) const;
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t percentile(double quantile) const;   // quantile in [0, 1], returns ns
+    LatencySummary summarize() const;
+
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);  // highest value mapping to index
+
+private:
+    std::atomic<uint64_t> buckets_[kBucketCount];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+// Stages of the packet data path, each with its own latency histogram
+enum LatencyStage {
+    kStageCapture = 0,   // frame read from the capture backend
+    kStageClassify,      // device/flow lookup and verdict
+    kStageShape,         // token bucket and queueing
+    kStageForward,       // frame handed back to the backend
+    kStageCount
+};
+
+const char* LatencyStageName(LatencyStage stage);
+LatencyHistogram& GetStageLatency(LatencyStage stage);
@@ -0,0 +1,79 @@
+#include "lpm_table.h"
+#include "device_table.h"
+#include <algorithm>
+#include <cstdlib>
+
+bool ParseIpv4Prefix(const std::string& text, uint32_t& address, uint8_t& length) {
+    size_t slash = text.find('/');
+    uint8_t ip[4];
+    if (!ParseIpv4(text.substr(0, slash), ip)) return false;
+    address = (static_cast<uint32_t>(ip[0]) << 24) | (static_cast<uint32_t>(ip[1]) << 16) |
+              (static_cast<uint32_t>(ip[2]) << 8) | static_cast<uint32_t>(ip[3]);
+
+    length = 32;
+    if (slash != std::string::npos) {
+        const char* start = text.c_str() + slash + 1;
+        char* end = nullptr;
+        long bits = strtol(start, &end, 10);
+        if (end == start || *end != '\0' || bits < 0 || bits > 32) return false;
+        length = static_cast<uint8_t>(bits);
+    }
+    uint32_t mask = length ? 0xFFFFFFFFu << (32 - length) : 0;
+    return (address & ~mask) == 0;
+}
+
+LpmTable::LpmTable() : prefix_count_(0) {}
+
+bool LpmTable::build(const std::vector<Ipv4Prefix>& prefixes) {
+    for (const Ipv4Prefix& prefix : prefixes) {
+        if (prefix.length > 32 || prefix.value == kNoMatch || prefix.value > kMaxValue) {
+            setError("Invalid prefix length or value");
+            return false;
+        }
+    }
+
+    // Shorter prefixes first, so longer ones overwrite what they cover
+    std::vector<Ipv4Prefix> sorted(prefixes);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Ipv4Prefix& a, const Ipv4Prefix& b) {
+        return a.length < b.length;
+    });
+
+    std::vector<uint16_t> tbl24(1u << 24, kNoMatch);
+    std::vector<uint16_t> tbl8;
+
+    for (const Ipv4Prefix& prefix : sorted) {
+        uint32_t mask = prefix.length ? 0xFFFFFFFFu << (32 - prefix.length) : 0;
+        uint32_t address = prefix.address & mask;
+
+        if (prefix.length <= 24) {
+            // No tbl8 group exists yet: all prefixes > 24 come later
+            size_t first = address >> 8;
+            size_t count = static_cast<size_t>(1) << (24 - prefix.length);
+            std::fill(tbl24.begin() + first, tbl24.begin() + first + count, prefix.value);
+            continue;
+        }
+
+        uint16_t& entry = tbl24[address >> 8];
+        if (!(entry & kExtended)) {
+            if (tbl8.size() / 256 >= kMaxGroups) {
+                setError("Too many prefixes longer than /24 (more than " + std::to_string(kMaxGroups) +
+                         " distinct /24s)");
+                return false;
+            }
+            // The new group inherits the /24's current match
+            uint16_t group = static_cast<uint16_t>(tbl8.size() / 256);
+            tbl8.insert(tbl8.end(), 256, entry);
+            entry = static_cast<uint16_t>(kExtended | group);
+        }
+        size_t base = static_cast<size_t>(entry & kMaxValue) << 8;
+        size_t first = address & 0xFF;
+        size_t count = static_cast<size_t>(1) << (32 - prefix.length);
+        std::fill(tbl8.begin() + base + first, tbl8.begin() + base + first + count, prefix.value);
+    }
+
+    tbl24_.swap(tbl24);
+    tbl8_.swap(tbl8);
+    prefix_count_ = prefixes.size();
+    last_error_.clear();
+    return true;
+}
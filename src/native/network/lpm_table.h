@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// IPv4 prefix with a value (host byte order address)
+struct Ipv4Prefix {
+    uint32_t address;
+    uint8_t length;     // 0..32
+    uint16_t value;     // 1..LpmTable::kMaxValue
+};
+
+// Parse "a.b.c.d/len" (or a bare address as /32); host bits must be zero
+bool ParseIpv4Prefix(const std::string& text, uint32_t& address, uint8_t& length);
+
+// Longest-prefix match over IPv4 addresses (DIR-24-8)
+//
+// tbl24 has one 16-bit entry per /24: either the value of the longest
+// prefix of length <= 24 covering it, or, when longer prefixes exist
+// inside that /24, the index of a 256-entry tbl8 group that resolves the
+// last octet. A lookup is one tbl24 read and at most one tbl8 read.
+//
+// Tables are built once and never modified; to change the prefix set,
+// build a new table and swap it in (see DataPlane::setDestinations).
+// tbl24 alone is 32 MB; lookup() is only valid after a successful build().
+class LpmTable {
+public:
+    static const uint16_t kNoMatch = 0;
+    static const uint16_t kMaxValue = 0x7FFF;
+    static const uint32_t kMaxGroups = 0x8000;
+
+    LpmTable();
+
+    // Overlapping prefixes resolve to the longest; for duplicates the
+    // last one wins
+    bool build(const std::vector<Ipv4Prefix>& prefixes);
+
+    uint16_t lookup(uint32_t address) const {
+        uint16_t entry = tbl24_[address >> 8];
+        if (entry & kExtended) {
+            entry = tbl8_[(static_cast<size_t>(entry & kMaxValue) << 8) | (address & 0xFF)];
+        }
+        return entry;
+    }
+
+    size_t prefixCount() const { return prefix_count_; }
+    size_t groupCount() const { return tbl8_.size() / 256; }
+    size_t memoryBytes() const { return (tbl24_.size() + tbl8_.size()) * sizeof(uint16_t); }
+    const std::string& lastError() const { return last_error_; }
+
+private:
+    static const uint16_t kExtended = 0x8000;
+
+    std::vector<uint16_t> tbl24_;
+    std::vector<uint16_t> tbl8_;
+    size_t prefix_count_;
+    std::string last_error_;
+
+    void setError(const std::string& error) { last_error_ = error; }
+};
@@ -0,0 +1,462 @@
+#include "name_discovery.h"
+#include "device_table.h"
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define CLOSE_SOCKET closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#endif
+
+namespace {
+
+const uint16_t kMdnsPort = 5353;
+const uint16_t kNbnsPort = 137;
+const uint16_t kLlmnrPort = 5355;
+const char* kMdnsGroup = "224.0.0.251";
+
+const uint16_t kTypeA = 1;
+const uint16_t kTypePtr = 12;
+const uint16_t kTypeNbstat = 0x21;
+const uint16_t kClassIn = 1;
+const uint16_t kClassUnicastResponse = 0x8000; // mDNS QU bit
+
+// Lower value wins when several protocols name the same IP
+int SourcePriority(const std::string& source) {
+    if (source == "mdns") return 0;
+    if (source == "nbns") return 1;
+    return 2;
+}
+
+// select() was interrupted by a signal rather than failing
+bool Interrupted() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEINTR;
+#else
+    return errno == EINTR;
+#endif
+}
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+uint16_t GetU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+void PutHeader(std::vector<uint8_t>& out, uint16_t id, uint16_t flags, uint16_t qdcount) {
+    PutU16(out, id);
+    PutU16(out, flags);
+    PutU16(out, qdcount);
+    PutU16(out, 0); // ancount
+    PutU16(out, 0); // nscount
+    PutU16(out, 0); // arcount
+}
+
+void PutLabel(std::vector<uint8_t>& out, const std::string& label) {
+    out.push_back(static_cast<uint8_t>(label.size()));
+    out.insert(out.end(), label.begin(), label.end());
+}
+
+// Append "d.c.b.a" labels for a reverse lookup of a.b.c.d; the in-addr.arpa
+// suffix is appended by the caller (or compressed to a pointer)
+bool PutReverseLabels(std::vector<uint8_t>& out, const std::string& ip) {
+    uint8_t bytes[4];
+    if (!ParseIpv4(ip, bytes)) return false;
+    for (int i = 3; i >= 0; --i) {
+        PutLabel(out, std::to_string(bytes[i]));
+    }
+    return true;
+}
+
+// Read a possibly compressed DNS name. Returns false on malformed input.
+bool ReadName(const uint8_t* data, size_t len, size_t& offset, std::string& name) {
+    name.clear();
+    size_t pos = offset;
+    bool jumped = false;
+    int hops = 0;
+    
+    while (true) {
+        if (pos >= len) return false;
+        uint8_t label_len = data[pos];
+        
+        if ((label_len & 0xC0) == 0xC0) {
+            if (pos + 1 >= len || ++hops > 16) return false;
+            size_t target = static_cast<size_t>(((label_len & 0x3F) << 8) | data[pos + 1]);
+            if (!jumped) offset = pos + 2;
+            jumped = true;
+            pos = target;
+            continue;
+        }
+        if (label_len & 0xC0) return false;
+        
+        pos++;
+        if (label_len == 0) break;
+        if (pos + label_len > len) return false;
+        if (!name.empty()) name.push_back('.');
+        name.append(reinterpret_cast<const char*>(data + pos), label_len);
+        pos += label_len;
+    }
+    
+    if (!jumped) offset = pos;
+    return true;
+}
+
+// "4.3.2.1.in-addr.arpa" -> "1.2.3.4"
+bool ReverseNameToIp(const std::string& name, std::string& ip) {
+    static const std::string kSuffix = ".in-addr.arpa";
+    if (name.size() <= kSuffix.size()) return false;
+    
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower.compare(lower.size() - kSuffix.size(), kSuffix.size(), kSuffix) != 0) return false;
+    
+    std::string octets = lower.substr(0, lower.size() - kSuffix.size());
+    std::string parts[4];
+    size_t start = 0;
+    for (int i = 0; i < 4; ++i) {
+        size_t dot = octets.find('.', start);
+        if ((i < 3) != (dot != std::string::npos)) return false;
+        parts[i] = octets.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+        start = dot + 1;
+    }
+    ip = parts[3] + "." + parts[2] + "." + parts[1] + "." + parts[0];
+    uint8_t check[4];
+    return ParseIpv4(ip, check);
+}
+
+// "Living-Room-TV.local." -> "Living-Room-TV"
+std::string ShortHostName(const std::string& fqdn) {
+    std::string name = fqdn;
+    while (!name.empty() && name.back() == '.') name.pop_back();
+    size_t dot = name.find('.');
+    if (dot != std::string::npos) name = name.substr(0, dot);
+    return name;
+}
+
+socket_t OpenUdpSocket(const std::string& local_ip, bool broadcast) {
+    socket_t sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+    
+    if (broadcast) {
+        int enable = 1;
+        setsockopt(sock, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char*>(&enable), sizeof(enable));
+    }
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    if (local_ip.empty() || inet_pton(AF_INET, local_ip.c_str(), &addr.sin_addr) != 1) {
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    }
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        CLOSE_SOCKET(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+void SendTo(socket_t sock, const std::vector<uint8_t>& message, const std::string& ip, uint16_t port) {
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip.c_str(), &dest.sin_addr) != 1) return;
+    sendto(sock, reinterpret_cast<const char*>(message.data()), static_cast<int>(message.size()), 0,
+           reinterpret_cast<struct sockaddr*>(&dest), sizeof(dest));
+}
+
+} // namespace
+
+std::vector<std::vector<uint8_t>> NameDiscovery::buildMdnsQueries(const std::vector<std::string>& ips,
+                                                                   uint16_t transaction_id, size_t max_size) {
+    std::vector<std::vector<uint8_t>> messages;
+    std::vector<uint8_t> message;
+    uint16_t questions = 0;
+    size_t suffix_offset = 0; // offset of the first "in-addr.arpa" for compression
+    
+    auto finish = [&]() {
+        if (questions == 0) return;
+        message[4] = static_cast<uint8_t>(questions >> 8);
+        message[5] = static_cast<uint8_t>(questions & 0xFF);
+        messages.push_back(std::move(message));
+        message.clear();
+        questions = 0;
+    };
+    
+    for (const auto& ip : ips) {
+        // Worst case per question: 4 x (1 + 3) labels + 15 suffix + 4 type/class
+        if (!message.empty() && message.size() + 35 > max_size) {
+            finish();
+        }
+        if (message.empty()) {
+            PutHeader(message, transaction_id, 0x0000, 0);
+            suffix_offset = 0;
+        }
+        
+        size_t rollback = message.size();
+        if (!PutReverseLabels(message, ip)) {
+            message.resize(rollback);
+            continue;
+        }
+        if (suffix_offset == 0) {
+            suffix_offset = message.size();
+            PutLabel(message, "in-addr");
+            PutLabel(message, "arpa");
+            message.push_back(0);
+        } else {
+            PutU16(message, static_cast<uint16_t>(0xC000 | suffix_offset));
+        }
+        PutU16(message, kTypePtr);
+        PutU16(message, kClassIn | kClassUnicastResponse);
+        questions++;
+    }
+    finish();
+    
+    return messages;
+}
+
+std::vector<uint8_t> NameDiscovery::buildNbstatQuery(uint16_t transaction_id) {
+    std::vector<uint8_t> message;
+    PutHeader(message, transaction_id, 0x0000, 1);
+    
+    // First-level encoded wildcard name "*" padded with NULs to 16 bytes
+    message.push_back(0x20);
+    uint8_t raw[16] = { '*' };
+    for (int i = 0; i < 16; ++i) {
+        message.push_back(static_cast<uint8_t>('A' + (raw[i] >> 4)));
+        message.push_back(static_cast<uint8_t>('A' + (raw[i] & 0x0F)));
+    }
+    message.push_back(0);
+    PutU16(message, kTypeNbstat);
+    PutU16(message, kClassIn);
+    return message;
+}
+
+std::vector<uint8_t> NameDiscovery::buildLlmnrPtrQuery(const std::string& ip, uint16_t transaction_id) {
+    std::vector<uint8_t> message;
+    PutHeader(message, transaction_id, 0x0000, 1);
+    if (!PutReverseLabels(message, ip)) return {};
+    PutLabel(message, "in-addr");
+    PutLabel(message, "arpa");
+    message.push_back(0);
+    PutU16(message, kTypePtr);
+    PutU16(message, kClassIn);
+    return message;
+}
+
+void NameDiscovery::parseDnsResponse(const uint8_t* data, size_t len, const std::string& source,
+                                     std::vector<DiscoveredName>& out) {
+    if (len < 12) return;
+    uint16_t flags = GetU16(data + 2);
+    if (!(flags & 0x8000)) return; // not a response
+    
+    uint16_t qdcount = GetU16(data + 4);
+    uint32_t rrcount = static_cast<uint32_t>(GetU16(data + 6)) + GetU16(data + 8) + GetU16(data + 10);
+    size_t offset = 12;
+    std::string name;
+    
+    for (uint16_t i = 0; i < qdcount; ++i) {
+        if (!ReadName(data, len, offset, name) || offset + 4 > len) return;
+        offset += 4;
+    }
+    
+    for (uint32_t i = 0; i < rrcount; ++i) {
+        if (!ReadName(data, len, offset, name) || offset + 10 > len) return;
+        uint16_t type = GetU16(data + offset);
+        uint16_t rdlength = GetU16(data + offset + 8);
+        offset += 10;
+        if (offset + rdlength > len) return;
+        
+        if (type == kTypePtr) {
+            size_t rdata_offset = offset;
+            std::string target;
+            std::string ip;
+            if (ReadName(data, len, rdata_offset, target) && ReverseNameToIp(name, ip)) {
+                std::string host = ShortHostName(target);
+                if (!host.empty()) out.push_back(DiscoveredName{ ip, host, source });
+            }
+        } else if (type == kTypeA && rdlength == 4) {
+            std::string host = ShortHostName(name);
+            if (!host.empty()) {
+                char ip_str[16];
+                FormatIpv4(data + offset, ip_str);
+                out.push_back(DiscoveredName{ ip_str, host, source });
+            }
+        }
+        offset += rdlength;
+    }
+}
+
+bool NameDiscovery::parseNbstatResponse(const uint8_t* data, size_t len, const std::string& from_ip,
+                                        DiscoveredName& out) {
+    if (len < 12) return false;
+    uint16_t flags = GetU16(data + 2);
+    if (!(flags & 0x8000) || GetU16(data + 6) == 0) return false;
+    
+    size_t offset = 12;
+    std::string name;
+    if (!ReadName(data, len, offset, name) || offset + 10 > len) return false;
+    if (GetU16(data + offset) != kTypeNbstat) return false;
+    offset += 10;
+    
+    if (offset + 1 > len) return false;
+    uint8_t num_names = data[offset++];
+    
+    for (uint8_t i = 0; i < num_names; ++i) {
+        if (offset + 18 > len) return false;
+        const uint8_t* entry = data + offset;
+        uint8_t suffix = entry[15];
+        uint16_t name_flags = GetU16(entry + 16);
+        offset += 18;
+        
+        // Workstation service (<00>) registered as a unique name
+        if (suffix == 0x00 && !(name_flags & 0x8000)) {
+            std::string netbios(reinterpret_cast<const char*>(entry), 15);
+            size_t end = netbios.find_last_not_of(' ');
+            if (end == std::string::npos) continue;
+            netbios.resize(end + 1);
+            out = DiscoveredName{ from_ip, netbios, "nbns" };
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<DiscoveredName> NameDiscovery::run(const Config& config) {
+    std::vector<DiscoveredName> results;
+    if (config.target_ips.empty()) return results;
+    
+    const uint16_t transaction_id = static_cast<uint16_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count() & 0xFFFF);
+    
+    socket_t mdns_sock = config.use_mdns ? OpenUdpSocket(config.local_ip, false) : INVALID_SOCKET;
+    socket_t nbns_sock = config.use_nbns ? OpenUdpSocket(config.local_ip, true) : INVALID_SOCKET;
+    socket_t llmnr_sock = config.use_llmnr ? OpenUdpSocket(config.local_ip, false) : INVALID_SOCKET;
+    
+    // Burst out every query before waiting for any reply
+    if (mdns_sock != INVALID_SOCKET) {
+        unsigned char ttl = 255;
+        setsockopt(mdns_sock, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl), sizeof(ttl));
+        struct in_addr iface;
+        if (!config.local_ip.empty() && inet_pton(AF_INET, config.local_ip.c_str(), &iface) == 1) {
+            setsockopt(mdns_sock, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&iface), sizeof(iface));
+        }
+        for (const auto& message : buildMdnsQueries(config.target_ips, 0)) {
+            SendTo(mdns_sock, message, kMdnsGroup, kMdnsPort);
+        }
+    }
+    if (nbns_sock != INVALID_SOCKET) {
+        std::vector<uint8_t> query = buildNbstatQuery(transaction_id);
+        SendTo(nbns_sock, query, config.broadcast_ip, kNbnsPort);
+        for (const auto& ip : config.target_ips) {
+            SendTo(nbns_sock, query, ip, kNbnsPort);
+        }
+    }
+    if (llmnr_sock != INVALID_SOCKET) {
+        for (const auto& ip : config.target_ips) {
+            std::vector<uint8_t> query = buildLlmnrPtrQuery(ip, transaction_id);
+            if (!query.empty()) SendTo(llmnr_sock, query, ip, kLlmnrPort);
+        }
+    }
+    
+    // Collect replies from all protocols within one window. A target is
+    // settled once it has a name from the most preferred protocol queried;
+    // until all are, a later reply may still replace a lower-priority one.
+    int top_priority = SourcePriority("llmnr");
+    if (nbns_sock != INVALID_SOCKET) top_priority = SourcePriority("nbns");
+    if (mdns_sock != INVALID_SOCKET) top_priority = SourcePriority("mdns");
+    std::set<std::string> targets(config.target_ips.begin(), config.target_ips.end());
+    std::map<std::string, DiscoveredName> best;
+    size_t settled = 0;
+    auto consider = [&](const DiscoveredName& found) {
+        if (targets.count(found.ip) == 0 || found.name.empty()) return;
+        int priority = SourcePriority(found.source);
+        auto it = best.find(found.ip);
+        if (it == best.end() || priority < SourcePriority(it->second.source)) {
+            best[found.ip] = found;
+            if (priority == top_priority) ++settled;
+        }
+    };
+    
+    auto deadline = std::chrono::steady_clock::now() + config.window;
+    uint8_t buffer[2048];
+    std::vector<DiscoveredName> parsed;
+    
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline || settled == targets.size()) break;
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+        
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        socket_t max_fd = 0;
+        for (socket_t sock : { mdns_sock, nbns_sock, llmnr_sock }) {
+            if (sock == INVALID_SOCKET) continue;
+            FD_SET(sock, &readfds);
+            if (sock > max_fd) max_fd = sock;
+        }
+        
+        struct timeval tv;
+        tv.tv_sec = static_cast<long>(remaining.count() / 1000000);
+        tv.tv_usec = static_cast<long>(remaining.count() % 1000000);
+        int ready = select(static_cast<int>(max_fd + 1), &readfds, nullptr, nullptr, &tv);
+        if (ready < 0 && Interrupted()) continue;   // the deadline still bounds the window
+        if (ready <= 0) break;
+        
+        for (socket_t sock : { mdns_sock, nbns_sock, llmnr_sock }) {
+            if (sock == INVALID_SOCKET || !FD_ISSET(sock, &readfds)) continue;
+            
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            int received = recvfrom(sock, reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+                                    reinterpret_cast<struct sockaddr*>(&from), &from_len);
+            if (received <= 0) continue;
+            
+            char from_str[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &from.sin_addr, from_str, sizeof(from_str));
+            
+            if (sock == nbns_sock) {
+                DiscoveredName found;
+                if (parseNbstatResponse(buffer, static_cast<size_t>(received), from_str, found)) {
+                    consider(found);
+                }
+            } else {
+                parsed.clear();
+                parseDnsResponse(buffer, static_cast<size_t>(received),
+                                 sock == mdns_sock ? "mdns" : "llmnr", parsed);
+                for (const auto& found : parsed) {
+                    consider(found);
+                }
+            }
+        }
+    }
+    
+    for (socket_t sock : { mdns_sock, nbns_sock, llmnr_sock }) {
+        if (sock != INVALID_SOCKET) CLOSE_SOCKET(sock);
+    }
+    
+    results.reserve(best.size());
+    for (auto& pair : best) {
+        results.push_back(std::move(pair.second));
+    }
+    return results;
+}
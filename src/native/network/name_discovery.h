@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+// Name learned from a local-link name service
+struct DiscoveredName {
+    std::string ip;
+    std::string name;
+    std::string source;   // "mdns", "nbns" or "llmnr"
+};
+
+// Batched local-link name discovery
+//
+// Reverse DNS misses most consumer devices, and querying hosts one at a time
+// costs a round trip each. Instead every protocol's queries for the whole
+// target set are sent back-to-back in one burst, and all replies arriving
+// within a single window are parsed:
+//
+//   mDNS  - one multicast message to 224.0.0.251:5353 carrying a PTR question
+//           per target (split only when the message would exceed the MTU).
+//           Sent from an ephemeral port, so responders answer us unicast.
+//   NBNS  - a wildcard node status (NBSTAT) request to the subnet broadcast
+//           address, plus unicast NBSTAT to each target for hosts that
+//           ignore broadcast status requests.
+//   LLMNR - RFC 4795 requires reverse (PTR) queries to be unicast, so one
+//           PTR query per target goes out in the same burst.
+//
+// Total cost is one round trip for the whole subnet instead of N.
+class NameDiscovery {
+public:
+    struct Config {
+        std::string local_ip;                   // interface to send from ("" = any)
+        std::string broadcast_ip = "255.255.255.255";
+        std::vector<std::string> target_ips;
+        std::chrono::milliseconds window{1500};
+        bool use_mdns = true;
+        bool use_nbns = true;
+        bool use_llmnr = true;
+    };
+
+    // Run one discovery round; blocks for config.window. At most one name
+    // per IP is returned, preferring mDNS, then NBNS, then LLMNR.
+    static std::vector<DiscoveredName> run(const Config& config);
+
+    // Message builders/parsers, exposed for testing and benchmarking
+    static std::vector<std::vector<uint8_t>> buildMdnsQueries(const std::vector<std::string>& ips,
+                                                               uint16_t transaction_id, size_t max_size = 1400);
+    static std::vector<uint8_t> buildNbstatQuery(uint16_t transaction_id);
+    static std::vector<uint8_t> buildLlmnrPtrQuery(const std::string& ip, uint16_t transaction_id);
+
+    // Parse a DNS-format (mDNS/LLMNR) response: collects PTR answers for
+    // in-addr.arpa names and A records from all sections
+    static void parseDnsResponse(const uint8_t* data, size_t len, const std::string& source,
+                                 std::vector<DiscoveredName>& out);
+    // Parse an NBSTAT response; from_ip is the responder
+    static bool parseNbstatResponse(const uint8_t* data, size_t len, const std::string& from_ip,
+                                    DiscoveredName& out);
+};
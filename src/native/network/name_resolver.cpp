@@ -0,0 +1,353 @@
+#include "name_resolver.h"
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+
+NameResolver::NameResolver() : NameResolver(Config()) {}
+
+NameResolver::NameResolver(const Config& config) : config_(config) {
+    if (config_.worker_count == 0) config_.worker_count = 1;
+    if (config_.cache_capacity == 0) config_.cache_capacity = 1;
+    max_retry_active_ = config_.worker_count > 1 ? config_.worker_count / 2 : 1;
+    start();
+}
+
+NameResolver::~NameResolver() {
+    shutdown();
+}
+
+void NameResolver::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < config_.worker_count; ++i) {
+        spawnWorkerLocked();
+    }
+    watchdog_ = std::thread(&NameResolver::watchdogLoop, this);
+}
+
+void NameResolver::spawnWorkerLocked() {
+    // Retired workers have left their loop, so joining them is immediate
+    for (auto it = workers_.begin(); it != workers_.end();) {
+        if (it->finished) {
+            it->thread.join();
+            it = workers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto self = workers_.emplace(workers_.end());
+    self->thread = std::thread(&NameResolver::workerLoop, this, self);
+}
+
+void NameResolver::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    watchdog_cv_.notify_all();
+    
+    // Nothing spawns workers once stopping_ is set
+    if (watchdog_.joinable()) {
+        watchdog_.join();
+    }
+    for (auto& worker : workers_) {
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+    }
+    workers_.clear();
+    
+    // Fail anything still waiting so callers are not left hanging
+    std::unordered_map<std::string, Pending> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        abandoned.swap(pending_);
+        fresh_queue_.clear();
+        retry_queue_.clear();
+    }
+    for (auto& pair : abandoned) {
+        for (auto& callback : pair.second.callbacks) {
+            callback(pair.first, "", false);
+        }
+    }
+}
+
+void NameResolver::resolveAsync(const std::string& ip, Callback callback) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    requests_++;
+    
+    if (stopping_) {
+        lock.unlock();
+        callback(ip, "", false);
+        return;
+    }
+    
+    // Fresh cache entry: answer immediately
+    bool retry_lane = false;
+    auto cached = cache_.find(ip);
+    if (cached != cache_.end()) {
+        if (Clock::now() < cached->second.expires) {
+            cache_hits_++;
+            lru_.splice(lru_.begin(), lru_, cached->second.lru_pos);
+            std::string name = cached->second.name;
+            bool found = cached->second.found;
+            lock.unlock();
+            callback(ip, name, found);
+            return;
+        }
+        // Expired negative answers go to the retry lane
+        retry_lane = !cached->second.found;
+    }
+    
+    // Already in flight: coalesce onto the existing lookup
+    auto pending = pending_.find(ip);
+    if (pending != pending_.end()) {
+        coalesced_++;
+        pending->second.callbacks.push_back(std::move(callback));
+        return;
+    }
+    
+    Pending& entry = pending_[ip];
+    entry.callbacks.push_back(std::move(callback));
+    entry.retry_lane = retry_lane;
+    if (retry_lane) {
+        retry_queue_.push_back(ip);
+    } else {
+        fresh_queue_.push_back(ip);
+    }
+    lock.unlock();
+    work_cv_.notify_one();
+}
+
+std::string NameResolver::resolve(const std::string& ip, std::chrono::milliseconds timeout) {
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+        std::string name;
+    };
+    auto waiter = std::make_shared<Waiter>();
+    
+    resolveAsync(ip, [waiter](const std::string&, const std::string& name, bool found) {
+        std::lock_guard<std::mutex> lock(waiter->mutex);
+        waiter->name = found ? name : "";
+        waiter->done = true;
+        waiter->cv.notify_all();
+    });
+    
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    waiter->cv.wait_for(lock, timeout, [&waiter] { return waiter->done; });
+    return waiter->done ? waiter->name : "";
+}
+
+bool NameResolver::lookupCached(const std::string& ip, std::string& name, bool& found) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cached = cache_.find(ip);
+    if (cached == cache_.end() || Clock::now() >= cached->second.expires) {
+        return false;
+    }
+    name = cached->second.name;
+    found = cached->second.found;
+    return true;
+}
+
+void NameResolver::clearCache() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+    lru_.clear();
+}
+
+NameResolver::Stats NameResolver::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.requests = requests_;
+    stats.cache_hits = cache_hits_;
+    stats.coalesced = coalesced_;
+    stats.lookups = lookups_;
+    stats.lookups_failed = lookups_failed_;
+    stats.cache_size = cache_.size();
+    stats.queued = fresh_queue_.size() + retry_queue_.size();
+    stats.in_flight = pending_.size() - stats.queued;
+    stats.slow_lookups = slow_active_;
+    return stats;
+}
+
+void NameResolver::workerLoop(std::list<Worker>::iterator self) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (true) {
+        work_cv_.wait(lock, [this] {
+            return stopping_ || !fresh_queue_.empty() ||
+                   (!retry_queue_.empty() && retry_active_ < max_retry_active_);
+        });
+        if (stopping_) return;
+        
+        // Live/new hosts first; the retry lane only gets its share of workers
+        std::string ip;
+        bool retry_lane = false;
+        std::list<ActiveLookup>::iterator active;
+        if (!fresh_queue_.empty()) {
+            ip = std::move(fresh_queue_.front());
+            fresh_queue_.pop_front();
+            active = active_.insert(active_.end(), ActiveLookup{ Clock::now() + config_.slow_lookup, false });
+            watchdog_cv_.notify_one();
+        } else {
+            ip = std::move(retry_queue_.front());
+            retry_queue_.pop_front();
+            retry_lane = true;
+            retry_active_++;
+        }
+        
+        lock.unlock();
+        std::string name = lookup(ip);
+        lock.lock();
+        
+        bool found = !name.empty();
+        bool retire = false;
+        lookups_++;
+        if (!found) lookups_failed_++;
+        if (retry_lane) {
+            retry_active_--;
+            work_cv_.notify_one();
+        } else {
+            retire = active->slow;
+            active_.erase(active);
+            if (retire) {
+                slow_active_--;
+                watchdog_cv_.notify_one();
+            }
+        }
+        storeLocked(ip, name, found);
+        
+        std::vector<Callback> callbacks;
+        auto pending = pending_.find(ip);
+        if (pending != pending_.end()) {
+            callbacks.swap(pending->second.callbacks);
+            pending_.erase(pending);
+        }
+        
+        lock.unlock();
+        for (auto& callback : callbacks) {
+            callback(ip, name, found);
+        }
+        lock.lock();
+        
+        // A replacement took this worker's place when the lookup went slow
+        if (retire) {
+            self->finished = true;
+            return;
+        }
+    }
+}
+
+void NameResolver::watchdogLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (!stopping_) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point next = Clock::time_point::max();
+        for (auto& active : active_) {
+            if (active.slow) continue;
+            if (active.deadline > now) {
+                if (active.deadline < next) next = active.deadline;
+            } else if (slow_active_ < config_.max_slow_lookups) {
+                // Past the limit the lookup keeps its worker; it is looked
+                // at again when a slow lookup ends
+                active.slow = true;
+                slow_active_++;
+                spawnWorkerLocked();
+            }
+        }
+        if (next == Clock::time_point::max()) {
+            watchdog_cv_.wait(lock);
+        } else {
+            watchdog_cv_.wait_until(lock, next);
+        }
+    }
+}
+
+std::string NameResolver::lookup(const std::string& ip) const {
+    return config_.lookup ? config_.lookup(ip) : lookupName(ip);
+}
+
+void NameResolver::storeLocked(const std::string& ip, const std::string& name, bool found) {
+    auto ttl = found ? config_.positive_ttl : config_.negative_ttl;
+    auto expires = Clock::now() + ttl;
+    
+    auto cached = cache_.find(ip);
+    if (cached != cache_.end()) {
+        cached->second.name = name;
+        cached->second.found = found;
+        cached->second.expires = expires;
+        lru_.splice(lru_.begin(), lru_, cached->second.lru_pos);
+        return;
+    }
+    
+    // Evict least recently used entries to stay within capacity
+    while (cache_.size() >= config_.cache_capacity && !lru_.empty()) {
+        cache_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    
+    lru_.push_front(ip);
+    CacheEntry entry;
+    entry.name = name;
+    entry.found = found;
+    entry.expires = expires;
+    entry.lru_pos = lru_.begin();
+    cache_.emplace(ip, std::move(entry));
+}
+
+// Reverse DNS lookup for one IPv4 address; returns the short host name or
+// an empty string if nothing meaningful was found
+std::string NameResolver::lookupName(const std::string& ip) {
+    char hostname[NI_MAXHOST];
+    memset(hostname, 0, sizeof(hostname));
+    
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    
+    if (inet_pton(AF_INET, ip.c_str(), &sa.sin_addr) != 1) {
+        return "";
+    }
+    
+    int result = getnameinfo((struct sockaddr*)&sa, sizeof(sa),
+                             hostname, sizeof(hostname),
+                             NULL, 0, NI_NAMEREQD);
+    if (result != 0 || hostname[0] == '\0') {
+        return "";
+    }
+    
+    std::string name = hostname;
+    if (name == ip) {
+        return "";
+    }
+    
+    // Only remove domain suffix if it's actually a hostname, not an IP
+    if (name.find_first_not_of("0123456789.") != std::string::npos) {
+        size_t dotPos = name.find('.');
+        if (dotPos != std::string::npos) {
+            name = name.substr(0, dotPos);
+        }
+    }
+    
+    return name;
+}
+
+NameResolver& GetNameResolver() {
+    // Intentionally leaked: workers may still be blocked in getnameinfo when
+    // the module unloads, and joining them from static destruction would hang
+    static NameResolver* resolver = new NameResolver();
+    return *resolver;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Asynchronous reverse-name resolver
+//
+// A fixed pool of worker threads performs blocking getnameinfo lookups.
+// Duplicate requests for an IP that is already in flight are coalesced onto
+// the same lookup, and results land in an LRU cache with separate TTLs for
+// positive (name found) and negative (no name) answers, so a rescan only
+// resolves new or expired entries.
+//
+// Dead hosts must not hold up live ones. IPs whose last lookup failed are
+// queued in a separate retry lane that may use at most half of the workers.
+// IPs never looked up before cannot be told apart in advance, so a fresh
+// lookup that runs past slow_lookup is assumed to be for a dead host: a
+// watchdog hands its worker's place to a new thread and the thread retires
+// when the lookup ends. At most max_slow_lookups of these run at once (past
+// that, slow lookups keep their worker).
+class NameResolver {
+public:
+    struct Config {
+        size_t worker_count = 8;
+        size_t cache_capacity = 4096;
+        std::chrono::milliseconds positive_ttl{10 * 60 * 1000};  // 10 minutes
+        std::chrono::milliseconds negative_ttl{60 * 1000};       // 1 minute
+        std::chrono::milliseconds slow_lookup{500};
+        size_t max_slow_lookups = 32;
+
+        // Replaces the getnameinfo lookup (tests); returns "" for no name
+        std::function<std::string(const std::string& ip)> lookup;
+    };
+
+    struct Stats {
+        uint64_t requests;
+        uint64_t cache_hits;
+        uint64_t coalesced;
+        uint64_t lookups;
+        uint64_t lookups_failed;
+        size_t cache_size;
+        size_t queued;
+        size_t in_flight;
+        size_t slow_lookups;   // fresh lookups running past slow_lookup
+    };
+
+    // Invoked with (ip, name, found). Runs on a worker thread, or on the
+    // calling thread when the answer is already cached.
+    using Callback = std::function<void(const std::string& ip, const std::string& name, bool found)>;
+
+    NameResolver();
+    explicit NameResolver(const Config& config);
+    ~NameResolver();
+
+    NameResolver(const NameResolver&) = delete;
+    NameResolver& operator=(const NameResolver&) = delete;
+
+    // Queue a lookup; callback fires exactly once
+    void resolveAsync(const std::string& ip, Callback callback);
+
+    // Blocking convenience wrapper; returns empty string if no name was
+    // found or the timeout expired (the lookup keeps running in that case)
+    std::string resolve(const std::string& ip, std::chrono::milliseconds timeout);
+
+    // Cache-only lookup; returns true if a fresh entry exists
+    bool lookupCached(const std::string& ip, std::string& name, bool& found);
+
+    void clearCache();
+    void shutdown();
+    Stats getStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct CacheEntry {
+        std::string name;
+        bool found;
+        Clock::time_point expires;
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    struct Pending {
+        std::vector<Callback> callbacks;
+        bool retry_lane;
+    };
+
+    struct Worker {
+        std::thread thread;
+        bool finished = false;
+    };
+
+    // Fresh lookup in flight, watched for slow_lookup
+    struct ActiveLookup {
+        Clock::time_point deadline;
+        bool slow;   // worker replaced; retires when the lookup ends
+    };
+
+    Config config_;
+    std::list<Worker> workers_;
+    std::thread watchdog_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable watchdog_cv_;
+    bool stopping_ = false;
+
+    std::deque<std::string> fresh_queue_;   // never looked up or expired positive
+    std::deque<std::string> retry_queue_;   // last lookup failed
+    size_t retry_active_ = 0;
+    size_t max_retry_active_;
+    std::list<ActiveLookup> active_;
+    size_t slow_active_ = 0;
+
+    std::unordered_map<std::string, Pending> pending_;     // coalescing map
+    std::unordered_map<std::string, CacheEntry> cache_;
+    std::list<std::string> lru_;                           // front = most recent
+
+    // Counters (guarded by mutex_)
+    uint64_t requests_ = 0;
+    uint64_t cache_hits_ = 0;
+    uint64_t coalesced_ = 0;
+    uint64_t lookups_ = 0;
+    uint64_t lookups_failed_ = 0;
+
+    void start();
+    void spawnWorkerLocked();
+    void workerLoop(std::list<Worker>::iterator self);
+    void watchdogLoop();
+    void storeLocked(const std::string& ip, const std::string& name, bool found);
+    std::string lookup(const std::string& ip) const;
+    static std::string lookupName(const std::string& ip);
+};
+
+// Shared resolver instance used by the N-API layer
+NameResolver& GetNameResolver();
@@ -6,11 +6,23 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include "arp.h"
+#include "device_table.h"
+#include "name_resolver.h"
+#include "name_discovery.h"
+#include "oui_db.h"
+#include "device_inventory.h"
+#include "traffic_counters.h"
+#include "traffic_control.h"
+#include "ring_log.h"
+#include "simulated_network.h"
 
 // Windows-specific includes for network operations
 #ifdef _WIN32
@@ -35,30 +47,22 @@
 #include <cstdio>
 #endif
 
-// Structure to hold device information
-struct DeviceInfo {
-    std::string ip;
-    std::string mac;
-    std::string name;
-    std::string vendor;
-    bool isOnline;
-    uint64_t lastSeen;
-};
-
-// Structure to hold traffic control settings for a device
-struct TrafficControl {
-    std::string deviceMac;
-    double downloadLimit; // Mbps
-    double uploadLimit;   // Mbps
-    bool isBlocked;
-    bool isActive;
-};
-
-// Global storage for discovered devices and traffic controls
+// Global storage for discovered devices (traffic controls live in
+// GetTrafficControls(), shared with netshaperd)
 static std::map<std::string, DeviceInfo> discoveredDevices;
-static std::map<std::string, TrafficControl> activeControls;
 static std::atomic<bool> scanningActive{false};
 
+// Add per-direction traffic counters for a control entry to a JS object
+static void SetTrafficCounters(Napi::Env env, Napi::Object& obj, uint32_t counterSlot) {
+    TrafficCounters::Totals totals = GetTrafficCounters().read(counterSlot);
+    obj.Set("bytesDown", Napi::Number::New(env, static_cast<double>(totals.bytes[kTrafficDown])));
+    obj.Set("bytesUp", Napi::Number::New(env, static_cast<double>(totals.bytes[kTrafficUp])));
+    obj.Set("packetsDown", Napi::Number::New(env, static_cast<double>(totals.packets[kTrafficDown])));
+    obj.Set("packetsUp", Napi::Number::New(env, static_cast<double>(totals.packets[kTrafficUp])));
+    obj.Set("dropsDown", Napi::Number::New(env, static_cast<double>(totals.drops[kTrafficDown])));
+    obj.Set("dropsUp", Napi::Number::New(env, static_cast<double>(totals.drops[kTrafficUp])));
+}
+
 // Helper function to convert MAC address bytes to string
 #ifdef _WIN32
 std::string MacToString(const BYTE* mac) {
@@ -73,106 +77,99 @@ std::string MacToString(const unsigned char* mac) {
     return ss.str();
 }
 
-// Helper function to get device name using FAST DNS lookup with timeout
+// Timeout for a single blocking name lookup from the JS thread
+static const std::chrono::milliseconds kNameLookupTimeout(5000);
+
+// Helper function to get device name through the shared resolver pool.
+// Cached and coalesced; returns empty string if no name found.
 std::string GetDeviceName(const std::string& ip) {
-#ifdef _WIN32
-    char debug_msg[256]; // Single declaration for the entire function
-    // Use Windows console output instead of std::cout
-    sprintf_s(debug_msg, sizeof(debug_msg), "Fast DNS: Trying to resolve name for IP: %s\n", ip.c_str());
-    OutputDebugStringA(debug_msg);
-#endif
-    printf("DEBUG: Fast DNS: Trying to resolve name for IP: %s\n", ip.c_str());
-    fflush(stdout);
-    
-#ifdef _WIN32
-    // Initialize Winsock if not already done
-    static bool wsaInitialized = false;
-    if (!wsaInitialized) {
-        WSADATA wsaData;
-        int wsaResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-        if (wsaResult == 0) {
-            wsaInitialized = true;
-            OutputDebugStringA("Winsock initialized successfully\n");
-            printf("DEBUG: Winsock initialized successfully\n");
-        } else {
-            sprintf_s(debug_msg, sizeof(debug_msg), "Winsock initialization failed: %d\n", wsaResult);
-            OutputDebugStringA(debug_msg);
-            printf("DEBUG: Winsock initialization failed: %d\n", wsaResult);
-        }
-        fflush(stdout);
+    return GetNameResolver().resolve(ip, kNameLookupTimeout);
+}
+
+// Resolve names for a batch of devices concurrently. Devices without a name
+// keep their IP as name. Waits at most kNameLookupTimeout overall.
+static void ResolveDeviceNamesBatch(std::vector<DeviceInfo>& devices) {
+    struct Batch {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t remaining;
+        std::map<std::string, std::string> names;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->remaining = devices.size();
+    
+    for (const auto& device : devices) {
+        GetNameResolver().resolveAsync(device.ip,
+            [batch](const std::string& ip, const std::string& name, bool found) {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                if (found) batch->names[ip] = name;
+                if (--batch->remaining == 0) batch->cv.notify_all();
+            });
     }
-#endif
     
-    // Method 1: FAST reverse DNS lookup (getnameinfo) - only try once with no flags
-    char hostname[NI_MAXHOST];
-    memset(hostname, 0, sizeof(hostname));
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->cv.wait_for(lock, kNameLookupTimeout, [&batch] { return batch->remaining == 0; });
     
-    struct sockaddr_in sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sin_family = AF_INET;
-    
-    if (inet_pton(AF_INET, ip.c_str(), &sa.sin_addr) == 1) {
-        // Only try the fastest method with no flags
-        int result = getnameinfo((struct sockaddr*)&sa, sizeof(sa), 
-                                hostname, sizeof(hostname), 
-                                NULL, 0, 0);
-        
-        if (result == 0 && strlen(hostname) > 0) {
-            std::string name = hostname;
-#ifdef _WIN32
-            sprintf_s(debug_msg, sizeof(debug_msg), "Fast DNS: Success for %s: %s\n", ip.c_str(), name.c_str());
-            OutputDebugStringA(debug_msg);
-#endif
-            printf("DEBUG: Fast DNS: Success for %s: %s\n", ip.c_str(), name.c_str());
-            fflush(stdout);
-            
-            // Only remove domain suffix if it's actually a hostname, not an IP
-            if (name != ip && name.find_first_not_of("0123456789.") != std::string::npos) {
-                // This is a real hostname, remove domain suffix
-                size_t dotPos = name.find('.');
-                if (dotPos != std::string::npos) {
-                    name = name.substr(0, dotPos);
-                }
-            }
-            
-            // Return if it's a meaningful name (not just IP)
-            if (name != ip && name.length() > 0) {
-#ifdef _WIN32
-                sprintf_s(debug_msg, sizeof(debug_msg), "Fast DNS: Returning device name: %s for IP: %s\n", name.c_str(), ip.c_str());
-                OutputDebugStringA(debug_msg);
-#endif
-                printf("DEBUG: Fast DNS: Returning device name: %s for IP: %s\n", name.c_str(), ip.c_str());
-                fflush(stdout);
-                return name;
-            }
-        } else {
-#ifdef _WIN32
-            sprintf_s(debug_msg, sizeof(debug_msg), "Fast DNS: Failed for %s (error: %d)\n", ip.c_str(), result);
-            OutputDebugStringA(debug_msg);
-#endif
-            printf("DEBUG: Fast DNS: Failed for %s (error: %d)\n", ip.c_str(), result);
-            fflush(stdout);
+    for (auto& device : devices) {
+        auto it = batch->names.find(device.ip);
+        if (it != batch->names.end()) {
+            device.name = it->second;
+        }
+    }
+}
+
+// Fill placeholder names from the persistent inventory, so devices named in a
+// previous session show their name before any lookup completes
+static void ApplyInventoryNames(std::vector<DeviceInfo>& devices) {
+    DeviceInventory& inventory = GetDeviceInventory();
+    if (!inventory.isOpen()) return;
+    
+    DeviceInventory::Entry entry;
+    for (auto& device : devices) {
+        if (device.name == device.ip && inventory.lookup(device.mac, entry) && entry.device.name != entry.device.ip) {
+            device.name = entry.device.name;
         }
     }
+}
+
+// Record scanned devices in the persistent inventory
+static void StoreInInventory(const std::vector<DeviceInfo>& devices) {
+    DeviceInventory& inventory = GetDeviceInventory();
+    if (!inventory.isOpen()) return;
     
-#ifdef _WIN32
-    sprintf_s(debug_msg, sizeof(debug_msg), "Fast DNS: No name found for %s\n", ip.c_str());
-    OutputDebugStringA(debug_msg);
-#endif
-    printf("DEBUG: Fast DNS: No name found for %s\n", ip.c_str());
-    fflush(stdout);
-    return ""; // Return empty string if no name found
+    for (const auto& device : devices) {
+        inventory.upsert(device);
+    }
+    inventory.flush();
 }
 
-// Function to scan network devices using ARP table (fast scan without DNS)
-Napi::Array ScanDevicesFast(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-    Napi::Array result = Napi::Array::New(env);
+// Apply a resolved name to the online device with this IP, in memory and in the
+// inventory. With onlyPlaceholder set, a name already known is kept.
+// Returns true if any device took the name.
+static bool StoreDeviceName(const std::string& ip, const std::string& name, bool onlyPlaceholder) {
+    if (name.empty() || name == ip) return false;
+    
+    bool applied = false;
+    for (auto& pair : discoveredDevices) {
+        DeviceInfo& device = pair.second;
+        // An offline device's IP may belong to another device by now
+        if (device.ip != ip || !device.isOnline) continue;
+        if (onlyPlaceholder && !device.name.empty() && device.name != device.ip) continue;
+        
+        device.name = name;
+        GetDeviceInventory().updateName(device.mac, name);
+        applied = true;
+    }
+    return applied;
+}
+
+// Read the system ARP table into DeviceInfo entries and refresh discoveredDevices.
+// When resolveNames is set all entries are resolved concurrently through the
+// resolver pool, otherwise the IP is used as the initial name.
+static std::vector<DeviceInfo> ReadArpTableDevices(bool resolveNames) {
+    std::vector<DeviceInfo> devices;
     
 #ifdef _WIN32
-    // Clear previous scan results
-    discoveredDevices.clear();
-    
     // Get ARP table
     ULONG bufferSize = 0;
     DWORD ret = GetIpNetTable(NULL, &bufferSize, FALSE);
@@ -184,8 +181,11 @@ Napi::Array ScanDevicesFast(const Napi::CallbackInfo& info) {
             ret = GetIpNetTable(pIpNetTable, &bufferSize, FALSE);
             
             if (ret == NO_ERROR) {
-                DWORD deviceIndex = 0;
+                devices.reserve(pIpNetTable->dwNumEntries);
                 std::set<std::string> seenMacs; // Track unique MACs to prevent duplicates
+                uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()
+                ).count();
                 
                 for (DWORD i = 0; i < pIpNetTable->dwNumEntries; i++) {
                     MIB_IPNETROW& entry = pIpNetTable->table[i];
@@ -220,7 +220,7 @@ Napi::Array ScanDevicesFast(const Napi::CallbackInfo& info) {
                     if (seenMacs.count(mac) > 0) continue;
                     seenMacs.insert(mac);
                     
-                    // Use IP as device name initially (fast scan)
+                    // Use IP as device name initially (names resolved in one batch below)
                     std::string deviceName = ip;
                     
                     // Create device info
@@ -228,136 +228,219 @@ Napi::Array ScanDevicesFast(const Napi::CallbackInfo& info) {
                     device.ip = ip;
                     device.mac = mac;
                     device.name = deviceName;
-                    device.vendor = "Unknown";
+                    device.vendor = LookupVendorName(mac);
                     device.isOnline = (entry.dwType == MIB_IPNET_TYPE_DYNAMIC || entry.dwType == MIB_IPNET_TYPE_STATIC);
-                    device.lastSeen = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::system_clock::now().time_since_epoch()
-                    ).count();
-                    
-                    // Store in global map
-                    discoveredDevices[mac] = device;
+                    device.lastSeen = now;
                     
-                    // Create JavaScript object for this device
-                    Napi::Object deviceObj = Napi::Object::New(env);
-                    deviceObj.Set("ip", Napi::String::New(env, ip));
-                    deviceObj.Set("mac", Napi::String::New(env, mac));
-                    deviceObj.Set("name", Napi::String::New(env, deviceName));
-                    deviceObj.Set("vendor", Napi::String::New(env, device.vendor));
-                    deviceObj.Set("isOnline", Napi::Boolean::New(env, device.isOnline));
-                    deviceObj.Set("lastSeen", Napi::Number::New(env, device.lastSeen));
-                    
-                    result.Set(deviceIndex++, deviceObj);
+                    devices.push_back(std::move(device));
                 }
             }
             
             free(pIpNetTable);
         }
     }
+    
+    ApplyInventoryNames(devices);
+    
+    if (resolveNames) {
+        ResolveDeviceNamesBatch(devices);
+    }
+    
+    // Replace the previous scan results. Devices the inventory knows stay
+    // listed as offline, as OpenDeviceInventory seeded them.
+    DeviceTableDiff diff = DiffDeviceTables(discoveredDevices, devices);
+    DeviceInventory& inventory = GetDeviceInventory();
+    DeviceInventory::Entry known;
+    size_t gone = 0;
+    for (const auto& mac : diff.removed) {
+        auto it = discoveredDevices.find(mac);
+        if (it->second.isOnline) ++gone;
+        if (inventory.isOpen() && inventory.lookup(mac, known)) {
+            it->second.isOnline = false;
+        } else {
+            discoveredDevices.erase(it);
+        }
+    }
+    for (const auto& device : devices) {
+        discoveredDevices[device.mac] = device;
+    }
+    NS_LOG_INFO("ReadArpTableDevices: %zu devices (%zu new, %zu changed, %zu gone)\n",
+                devices.size(), diff.added.size(), diff.changed.size(), gone);
+    
+    StoreInInventory(devices);
 #else
-    // Linux stub - return empty array
-    printf("ScanDevicesFast: Not implemented on Linux\n");
+    // Linux stub - return empty list
+    (void)resolveNames;
+    NS_LOG_INFO("ReadArpTableDevices: Not implemented on Linux\n");
 #endif
     
+    return devices;
+}
+
+// Convert device list to a JavaScript array of objects (one object per device)
+static Napi::Array DevicesToArray(Napi::Env env, const std::vector<DeviceInfo>& devices) {
+    Napi::Array result = Napi::Array::New(env, devices.size());
+    
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const DeviceInfo& device = devices[i];
+        
+        Napi::Object deviceObj = Napi::Object::New(env);
+        deviceObj.Set("ip", Napi::String::New(env, device.ip));
+        deviceObj.Set("mac", Napi::String::New(env, device.mac));
+        deviceObj.Set("name", Napi::String::New(env, device.name));
+        deviceObj.Set("vendor", Napi::String::New(env, device.vendor));
+        deviceObj.Set("isOnline", Napi::Boolean::New(env, device.isOnline));
+        deviceObj.Set("lastSeen", Napi::Number::New(env, static_cast<double>(device.lastSeen)));
+        
+        result.Set(static_cast<uint32_t>(i), deviceObj);
+    }
+    
     return result;
 }
 
+// Convert device list to a single packed ArrayBuffer (see device_table.h)
+static Napi::ArrayBuffer DevicesToPackedBuffer(Napi::Env env, const std::vector<DeviceInfo>& devices) {
+    std::vector<DeviceControlInfo> controls(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        DeviceControlInfo& control = controls[i];
+        TrafficControl entry;
+        if (GetTrafficControls().find(devices[i].mac, entry)) {
+            control.downloadLimit = entry.downloadLimit;
+            control.uploadLimit = entry.uploadLimit;
+            control.isBlocked = entry.isBlocked;
+            control.hasTrafficControl = entry.isActive;
+        } else {
+            control = DeviceControlInfo{0, 0, false, false};
+        }
+    }
+    
+    std::vector<uint8_t> packed = PackDeviceTable(devices, &controls);
+    Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, packed.size());
+    memcpy(buffer.Data(), packed.data(), packed.size());
+    return buffer;
+}
+
+// Function to scan network devices using ARP table (fast scan without DNS)
+Napi::Array ScanDevicesFast(const Napi::CallbackInfo& info) {
+    return DevicesToArray(info.Env(), ReadArpTableDevices(false));
+}
+
 // Function to scan network devices with DNS resolution (slower but with names)
 Napi::Array ScanDevices(const Napi::CallbackInfo& info) {
+    return DevicesToArray(info.Env(), ReadArpTableDevices(true));
+}
+
+// Fast scan returning the packed device table instead of an object per device
+Napi::ArrayBuffer ScanDevicesPacked(const Napi::CallbackInfo& info) {
+    return DevicesToPackedBuffer(info.Env(), ReadArpTableDevices(false));
+}
+
+// Function to get the last discovered device table in packed form
+Napi::ArrayBuffer GetDeviceTablePacked(const Napi::CallbackInfo& info) {
+    std::vector<DeviceInfo> devices;
+    devices.reserve(discoveredDevices.size());
+    for (const auto& pair : discoveredDevices) {
+        devices.push_back(pair.second);
+    }
+    return DevicesToPackedBuffer(info.Env(), devices);
+}
+
+// Function to open (or create) the persistent device inventory. Known devices
+// are added to discoveredDevices as offline so details are available at once;
+// scans keep them there while they are away.
+Napi::Boolean OpenDeviceInventory(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    Napi::Array result = Napi::Array::New(env);
     
-#ifdef _WIN32
-    // Clear previous scan results
-    discoveredDevices.clear();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected (path: string)").ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
     
-    // Get ARP table
-    ULONG bufferSize = 0;
-    DWORD ret = GetIpNetTable(NULL, &bufferSize, FALSE);
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    DeviceInventory& inventory = GetDeviceInventory();
+    if (!inventory.open(path)) {
+        return Napi::Boolean::New(env, false);
+    }
     
-    if (ret == ERROR_INSUFFICIENT_BUFFER) {
-        PMIB_IPNETTABLE pIpNetTable = (PMIB_IPNETTABLE)malloc(bufferSize);
-        
-        if (pIpNetTable != NULL) {
-            ret = GetIpNetTable(pIpNetTable, &bufferSize, FALSE);
-            
-            if (ret == NO_ERROR) {
-                DWORD deviceIndex = 0;
-                std::set<std::string> seenMacs; // Track unique MACs to prevent duplicates
-                
-                for (DWORD i = 0; i < pIpNetTable->dwNumEntries; i++) {
-                    MIB_IPNETROW& entry = pIpNetTable->table[i];
-                    
-                    // Skip invalid entries
-                    if (entry.dwType == MIB_IPNET_TYPE_INVALID) continue;
-                    
-                    // Convert IP address first to check if we should skip it
-                    struct in_addr addr;
-                    addr.s_addr = entry.dwAddr;
-                    char ip_str[INET_ADDRSTRLEN];
-                    inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
-                    std::string ip = std::string(ip_str);
-                    
-                    // Skip multicast addresses (224.x.x.x - 239.x.x.x)
-                    size_t pos1 = ip.find('.');
-                    if (pos1 != std::string::npos) {
-                        int firstOctet = std::stoi(ip.substr(0, pos1));
-                        if (firstOctet >= 224 && firstOctet <= 239) continue;
-                    }
-                    
-                    // Skip broadcast addresses
-                    if (ip.find(".255") != std::string::npos || ip == "255.255.255.255") continue;
-                    
-                    // Skip localhost
-                    if (ip.find("127.") == 0) continue;
-                    
-                    // Convert MAC address
-                    std::string mac = MacToString(entry.bPhysAddr);
-                    
-                    // Skip duplicates
-                    if (seenMacs.count(mac) > 0) continue;
-                    seenMacs.insert(mac);
-                    
-                    // Get device name with DNS lookup
-                    std::string deviceName = GetDeviceName(ip);
-                    if (deviceName.empty()) {
-                        deviceName = ip; // Fallback to IP if no name found
-                    }
-                    
-                    // Create device info
-                    DeviceInfo device;
-                    device.ip = ip;
-                    device.mac = mac;
-                    device.name = deviceName;
-                    device.vendor = "Unknown";
-                    device.isOnline = (entry.dwType == MIB_IPNET_TYPE_DYNAMIC || entry.dwType == MIB_IPNET_TYPE_STATIC);
-                    device.lastSeen = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::system_clock::now().time_since_epoch()
-                    ).count();
-                    
-                    // Store in global map
-                    discoveredDevices[mac] = device;
-                    
-                    // Create JavaScript object for this device
-                    Napi::Object deviceObj = Napi::Object::New(env);
-                    deviceObj.Set("ip", Napi::String::New(env, ip));
-                    deviceObj.Set("mac", Napi::String::New(env, mac));
-                    deviceObj.Set("name", Napi::String::New(env, deviceName));
-                    deviceObj.Set("vendor", Napi::String::New(env, device.vendor));
-                    deviceObj.Set("isOnline", Napi::Boolean::New(env, device.isOnline));
-                    deviceObj.Set("lastSeen", Napi::Number::New(env, device.lastSeen));
-                    
-                    result.Set(deviceIndex++, deviceObj);
-                }
-            }
-            
-            free(pIpNetTable);
+    for (auto& entry : inventory.snapshot()) {
+        if (discoveredDevices.find(entry.device.mac) == discoveredDevices.end()) {
+            discoveredDevices[entry.device.mac] = std::move(entry.device);
         }
     }
-#else
-    // Linux stub - return empty array
-    printf("ScanDevices: Not implemented on Linux\n");
-#endif
     
+    return Napi::Boolean::New(env, true);
+}
+
+// Function to get every device in the persistent inventory in packed form
+// (all marked offline; a scan reports which are online now)
+Napi::Value GetDeviceInventoryPacked(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    DeviceInventory& inventory = GetDeviceInventory();
+    if (!inventory.isOpen()) {
+        return env.Null();
+    }
+    
+    std::vector<DeviceInventory::Entry> entries = inventory.snapshot();
+    std::vector<DeviceInfo> devices;
+    devices.reserve(entries.size());
+    for (auto& entry : entries) {
+        devices.push_back(std::move(entry.device));
+    }
+    return DevicesToPackedBuffer(env, devices);
+}
+
+// Benchmark object-per-device vs packed transfer on a synthetic device table.
+// Returns timings in milliseconds; does not touch discoveredDevices.
+Napi::Object BenchmarkDeviceTableTransfer(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Expected (count: number, iterations?: number)").ThrowAsJavaScriptException();
+        return Napi::Object::New(env);
+    }
+    
+    uint32_t count = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t iterations = (info.Length() > 1 && info[1].IsNumber()) ? info[1].As<Napi::Number>().Uint32Value() : 10;
+    if (iterations == 0) iterations = 1;
+    
+    // Synthetic LAN: a handful of vendors, most names unresolved (name == ip)
+    static const char* kVendors[] = { "Unknown", "Apple, Inc.", "Intel Corporate", "Raspberry Pi Trading Ltd", "TP-LINK TECHNOLOGIES CO.,LTD." };
+    std::vector<DeviceInfo> devices(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        DeviceInfo& device = devices[i];
+        char ip_str[16];
+        snprintf(ip_str, sizeof(ip_str), "10.%u.%u.%u", (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+        uint8_t mac[6] = { 0x02, 0x00, static_cast<uint8_t>(i >> 24), static_cast<uint8_t>(i >> 16),
+                           static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i) };
+        device.ip = ip_str;
+        device.mac = MacToString(mac);
+        device.name = (i % 4 == 0) ? ("host-" + std::to_string(i)) : device.ip;
+        device.vendor = kVendors[i % 5];
+        device.isOnline = true;
+        device.lastSeen = 1700000000000ULL + i;
+    }
+    
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (uint32_t iter = 0; iter < iterations; ++iter) {
+        DevicesToArray(env, devices);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    Napi::ArrayBuffer packed;
+    for (uint32_t iter = 0; iter < iterations; ++iter) {
+        packed = DevicesToPackedBuffer(env, devices);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    
+    double objectMs = std::chrono::duration<double, std::milli>(t1 - t0).count() / iterations;
+    double packedMs = std::chrono::duration<double, std::milli>(t2 - t1).count() / iterations;
+    
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("count", Napi::Number::New(env, count));
+    result.Set("iterations", Napi::Number::New(env, iterations));
+    result.Set("objectPathMs", Napi::Number::New(env, objectMs));
+    result.Set("packedPathMs", Napi::Number::New(env, packedMs));
+    result.Set("packedBytes", Napi::Number::New(env, static_cast<double>(packed.ByteLength())));
+    result.Set("packed", packed);
     return result;
 }
 
@@ -374,22 +457,12 @@ Napi::Boolean SetBandwidthLimit(const Napi::CallbackInfo& info) {
     double downloadLimit = info[1].As<Napi::Number>().DoubleValue();
     double uploadLimit = info[2].As<Napi::Number>().DoubleValue();
     
-    // Validate limits (0-1000 Mbps)
-    if (downloadLimit < 0 || downloadLimit > 1000 || uploadLimit < 0 || uploadLimit > 1000) {
+    // Create or update traffic control entry (limits must be 0-1000 Mbps)
+    if (!GetTrafficControls().setLimit(mac, downloadLimit, uploadLimit)) {
         Napi::TypeError::New(env, "Bandwidth limits must be between 0 and 1000 Mbps").ThrowAsJavaScriptException();
         return Napi::Boolean::New(env, false);
     }
     
-    // Create or update traffic control entry
-    TrafficControl control;
-    control.deviceMac = mac;
-    control.downloadLimit = downloadLimit;
-    control.uploadLimit = uploadLimit;
-    control.isBlocked = false;
-    control.isActive = true;
-    
-    activeControls[mac] = control;
-    
     // TODO: Implement actual packet filtering using WinDivert
     // For now, we just store the settings
     
@@ -409,19 +482,7 @@ Napi::Boolean SetDeviceBlocked(const Napi::CallbackInfo& info) {
     bool blocked = info[1].As<Napi::Boolean>().Value();
     
     // Create or update traffic control entry
-    if (activeControls.find(mac) == activeControls.end()) {
-        TrafficControl control;
-        control.deviceMac = mac;
-        control.downloadLimit = 0;
-        control.uploadLimit = 0;
-        control.isBlocked = blocked;
-        control.isActive = blocked;
-        activeControls[mac] = control;
-    } else {
-        activeControls[mac].isBlocked = blocked;
-        activeControls[mac].isActive = blocked || 
-            (activeControls[mac].downloadLimit > 0 || activeControls[mac].uploadLimit > 0);
-    }
+    GetTrafficControls().setBlocked(mac, blocked);
     
     // TODO: Implement actual packet blocking using WinDivert
     // For now, we just store the settings
@@ -440,8 +501,16 @@ Napi::Boolean RemoveTrafficControl(const Napi::CallbackInfo& info) {
     
     std::string mac = info[0].As<Napi::String>().Utf8Value();
     
-    // Remove from active controls
-    activeControls.erase(mac);
+    // Remove from active controls, keeping what the device used in its
+    // inventory totals before the counter slot is recycled
+    TrafficCounters::Totals totals;
+    if (GetTrafficControls().remove(mac, totals)) {
+        DeviceInventory::TrafficTotals delta = {
+            totals.bytes[kTrafficDown], totals.bytes[kTrafficUp],
+            totals.packets[kTrafficDown], totals.packets[kTrafficUp]
+        };
+        GetDeviceInventory().addTraffic(mac, delta);
+    }
     
     // TODO: Remove actual packet filtering rules using WinDivert
     
@@ -454,8 +523,7 @@ Napi::Array GetActiveControls(const Napi::CallbackInfo& info) {
     Napi::Array result = Napi::Array::New(env);
     
     uint32_t index = 0;
-    for (const auto& pair : activeControls) {
-        const TrafficControl& control = pair.second;
+    for (const TrafficControl& control : GetTrafficControls().list()) {
         
         Napi::Object controlObj = Napi::Object::New(env);
         controlObj.Set("mac", Napi::String::New(env, control.deviceMac));
@@ -463,6 +531,7 @@ Napi::Array GetActiveControls(const Napi::CallbackInfo& info) {
         controlObj.Set("uploadLimit", Napi::Number::New(env, control.uploadLimit));
         controlObj.Set("isBlocked", Napi::Boolean::New(env, control.isBlocked));
         controlObj.Set("isActive", Napi::Boolean::New(env, control.isActive));
+        SetTrafficCounters(env, controlObj, control.counterSlot);
         
         result.Set(index++, controlObj);
     }
@@ -486,10 +555,169 @@ Napi::String ResolveSingleDeviceName(const Napi::CallbackInfo& info) {
     if (resolvedName.empty()) {
         resolvedName = ip; // Fallback to IP if no name found
     }
+    StoreDeviceName(ip, resolvedName, false);
     
     return Napi::String::New(env, resolvedName);
 }
 
+// Result handed from a resolver worker to the JS thread
+struct ResolvedNameResult {
+    std::string ip;
+    std::string name;
+    uint32_t remaining;
+};
+
+// Function to resolve names for many IPs through the native resolver pool.
+// callback(ip, name, remaining) fires once per IP as results arrive (name is
+// empty if none was found); remaining reaches 0 on the last call.
+Napi::Value ResolveDeviceNames(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (ips: string[], callback: function)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    Napi::Array ipArray = info[0].As<Napi::Array>();
+    std::vector<std::string> ips;
+    ips.reserve(ipArray.Length());
+    for (uint32_t i = 0; i < ipArray.Length(); ++i) {
+        Napi::Value value = ipArray.Get(i);
+        if (value.IsString()) {
+            ips.push_back(value.As<Napi::String>().Utf8Value());
+        }
+    }
+    
+    if (ips.empty()) {
+        return Napi::Number::New(env, 0);
+    }
+    
+    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
+        env, info[1].As<Napi::Function>(), "resolveDeviceNames", 0, 1);
+    auto remaining = std::make_shared<std::atomic<uint32_t>>(static_cast<uint32_t>(ips.size()));
+    
+    for (const auto& ip : ips) {
+        GetNameResolver().resolveAsync(ip,
+            [tsfn, remaining](const std::string& resolvedIp, const std::string& name, bool found) {
+                uint32_t left = remaining->fetch_sub(1) - 1;
+                auto* result = new ResolvedNameResult{ resolvedIp, found ? name : "", left };
+                
+                napi_status status = tsfn.NonBlockingCall(result,
+                    [](Napi::Env env, Napi::Function jsCallback, ResolvedNameResult* data) {
+                        if (env != nullptr && jsCallback != nullptr) {
+                            StoreDeviceName(data->ip, data->name, false);
+                            jsCallback.Call({ Napi::String::New(env, data->ip),
+                                              Napi::String::New(env, data->name),
+                                              Napi::Number::New(env, data->remaining) });
+                        }
+                        delete data;
+                    });
+                if (status != napi_ok) {
+                    delete result;
+                }
+                
+                if (left == 0) {
+                    tsfn.Release();
+                }
+            });
+    }
+    
+    return Napi::Number::New(env, static_cast<double>(ips.size()));
+}
+
+// Function to get resolver pool/cache statistics
+Napi::Object GetResolverStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    NameResolver::Stats stats = GetNameResolver().getStats();
+    
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("requests", Napi::Number::New(env, static_cast<double>(stats.requests)));
+    result.Set("cacheHits", Napi::Number::New(env, static_cast<double>(stats.cache_hits)));
+    result.Set("coalesced", Napi::Number::New(env, static_cast<double>(stats.coalesced)));
+    result.Set("lookups", Napi::Number::New(env, static_cast<double>(stats.lookups)));
+    result.Set("lookupsFailed", Napi::Number::New(env, static_cast<double>(stats.lookups_failed)));
+    result.Set("cacheSize", Napi::Number::New(env, static_cast<double>(stats.cache_size)));
+    result.Set("queued", Napi::Number::New(env, static_cast<double>(stats.queued)));
+    result.Set("inFlight", Napi::Number::New(env, static_cast<double>(stats.in_flight)));
+    return result;
+}
+
+// Background worker for one batched multicast/broadcast name discovery round
+class DiscoverNamesWorker : public Napi::AsyncWorker {
+public:
+    DiscoverNamesWorker(Napi::Env env, const NameDiscovery::Config& config)
+        : Napi::AsyncWorker(env), deferred_(Napi::Promise::Deferred::New(env)), config_(config) {}
+    
+    Napi::Promise GetPromise() const { return deferred_.Promise(); }
+    
+protected:
+    void Execute() override {
+        results_ = NameDiscovery::run(config_);
+    }
+    
+    void OnOK() override {
+        Napi::Env env = Env();
+        
+        // Merge into discoveredDevices, only replacing placeholder names (IP);
+        // applied tells the caller which names the devices actually took
+        Napi::Array result = Napi::Array::New(env, results_.size());
+        for (size_t i = 0; i < results_.size(); ++i) {
+            bool applied = StoreDeviceName(results_[i].ip, results_[i].name, true);
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("ip", Napi::String::New(env, results_[i].ip));
+            entry.Set("name", Napi::String::New(env, results_[i].name));
+            entry.Set("source", Napi::String::New(env, results_[i].source));
+            entry.Set("applied", Napi::Boolean::New(env, applied));
+            result.Set(static_cast<uint32_t>(i), entry);
+        }
+        deferred_.Resolve(result);
+    }
+    
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+    
+private:
+    Napi::Promise::Deferred deferred_;
+    NameDiscovery::Config config_;
+    std::vector<DiscoveredName> results_;
+};
+
+// Function to discover names for all known devices with one mDNS/NBNS/LLMNR
+// query round. Resolves to [{ ip, name, source, applied }] and updates device
+// names that are still placeholders (applied = true).
+Napi::Value DiscoverDeviceNames(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    NameDiscovery::Config config;
+    if (info.Length() > 0 && info[0].IsNumber()) {
+        config.window = std::chrono::milliseconds(info[0].As<Napi::Number>().Uint32Value());
+    }
+    
+    for (const auto& pair : discoveredDevices) {
+        if (pair.second.isOnline) config.target_ips.push_back(pair.second.ip);
+    }
+    
+    // Send from the managed interface and use its subnet broadcast if known
+    NetworkInfo topology = GetNetworkTopology();
+    uint8_t localIp[4], mask[4];
+    if (topology.is_valid && ParseIpv4(topology.local_ip, localIp) && ParseIpv4(topology.subnet_mask, mask)) {
+        uint8_t broadcast[4];
+        for (int i = 0; i < 4; ++i) {
+            broadcast[i] = static_cast<uint8_t>(localIp[i] | ~mask[i]);
+        }
+        char broadcastStr[16];
+        FormatIpv4(broadcast, broadcastStr);
+        config.local_ip = topology.local_ip;
+        config.broadcast_ip = broadcastStr;
+    }
+    
+    DiscoverNamesWorker* worker = new DiscoverNamesWorker(env, config);
+    Napi::Promise promise = worker->GetPromise();
+    worker->Queue();
+    return promise;
+}
+
 // Function to get detailed device information
 Napi::Object GetDeviceDetails(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
@@ -517,18 +745,19 @@ Napi::Object GetDeviceDetails(const Napi::CallbackInfo& info) {
     result.Set("lastSeen", Napi::Number::New(env, device.lastSeen));
     
     // Add traffic control info if available
-    auto controlIt = activeControls.find(mac);
-    if (controlIt != activeControls.end()) {
-        const TrafficControl& control = controlIt->second;
+    TrafficControl control;
+    if (GetTrafficControls().find(mac, control)) {
         result.Set("downloadLimit", Napi::Number::New(env, control.downloadLimit));
         result.Set("uploadLimit", Napi::Number::New(env, control.uploadLimit));
         result.Set("isBlocked", Napi::Boolean::New(env, control.isBlocked));
         result.Set("hasTrafficControl", Napi::Boolean::New(env, control.isActive));
+        SetTrafficCounters(env, result, control.counterSlot);
     } else {
         result.Set("downloadLimit", Napi::Number::New(env, 0));
         result.Set("uploadLimit", Napi::Number::New(env, 0));
         result.Set("isBlocked", Napi::Boolean::New(env, false));
         result.Set("hasTrafficControl", Napi::Boolean::New(env, false));
+        SetTrafficCounters(env, result, TrafficCounters::kInvalidSlot);
     }
     
     return result;
@@ -566,6 +795,11 @@ Napi::Array EnumerateNetworkAdapters(const Napi::CallbackInfo& info) {
     return result;
 }
 
+// Simulated LAN for load testing the ARP and poisoning paths without an
+// adapter (see simulated_network.h). Runs on the steady clock.
+static SteadyClock g_simulated_clock;
+static std::shared_ptr<SimulatedNetwork> g_simulated_network;
+
 Napi::Boolean InitializeArp(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
@@ -576,8 +810,17 @@ Napi::Boolean InitializeArp(const Napi::CallbackInfo& info) {
     
     std::string adapterName = info[0].As<Napi::String>().Utf8Value();
     
+    // Optional capture profile: "low-latency" (default), "throughput", "arp-only"
+    CapturePreset preset = kCaptureLowLatency;
+    if (info.Length() >= 2 && info[1].IsString() &&
+        !ParseCapturePreset(info[1].As<Napi::String>().Utf8Value(), preset)) {
+        Napi::TypeError::New(env, "Unknown capture profile").ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+    
     try {
-        bool result = InitializeArpManager(adapterName);
+        g_simulated_network.reset();
+        bool result = InitializeArpManager(adapterName, preset);
         return Napi::Boolean::New(env, result);
     } catch (const std::exception& e) {
         Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
@@ -627,6 +870,19 @@ Napi::Boolean SendArpRequestWrapper(const Napi::CallbackInfo& info) {
     }
 }
 
+// Convert a latency histogram summary to a JavaScript object (milliseconds)
+static Napi::Object LatencySummaryToObject(Napi::Env env, const LatencySummary& summary) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("count", Napi::Number::New(env, static_cast<double>(summary.count)));
+    obj.Set("meanMs", Napi::Number::New(env, summary.mean_ms));
+    obj.Set("p50Ms", Napi::Number::New(env, summary.p50_ms));
+    obj.Set("p90Ms", Napi::Number::New(env, summary.p90_ms));
+    obj.Set("p99Ms", Napi::Number::New(env, summary.p99_ms));
+    obj.Set("p999Ms", Napi::Number::New(env, summary.p999_ms));
+    obj.Set("maxMs", Napi::Number::New(env, summary.max_ms));
+    return obj;
+}
+
 Napi::Object GetArpPerformanceStatsWrapper(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     Napi::Object result = Napi::Object::New(env);
@@ -640,6 +896,21 @@ Napi::Object GetArpPerformanceStatsWrapper(const Napi::CallbackInfo& info) {
         result.Set("receiveErrors", Napi::Number::New(env, static_cast<double>(stats.receive_errors)));
         result.Set("avgSendTimeMs", Napi::Number::New(env, stats.avg_send_time_ms));
         result.Set("avgReceiveTimeMs", Napi::Number::New(env, stats.avg_receive_time_ms));
+        result.Set("sendLatency", LatencySummaryToObject(env, stats.send_latency));
+        result.Set("receiveLatency", LatencySummaryToObject(env, stats.receive_latency));
+        result.Set("captureProfile", Napi::String::New(env, stats.capture_profile ? stats.capture_profile : ""));
+        result.Set("captureBufferBytes", Napi::Number::New(env, static_cast<double>(stats.capture_buffer_bytes)));
+        result.Set("captureReceived", Napi::Number::New(env, static_cast<double>(stats.capture.received)));
+        result.Set("captureDropped", Napi::Number::New(env, static_cast<double>(stats.capture.dropped)));
+        result.Set("captureInterfaceDropped", Napi::Number::New(env, static_cast<double>(stats.capture.interface_dropped)));
+        
+        Napi::Object stages = Napi::Object::New(env);
+        for (int stage = 0; stage < kStageCount; ++stage) {
+            LatencyStage latencyStage = static_cast<LatencyStage>(stage);
+            stages.Set(LatencyStageName(latencyStage),
+                       LatencySummaryToObject(env, GetStageLatency(latencyStage).summarize()));
+        }
+        result.Set("stageLatency", stages);
         
     } catch (const std::exception& e) {
         Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
@@ -717,6 +988,101 @@ Napi::Array EnumeratePcapDevicesWrapper(const Napi::CallbackInfo& info) {
     return result;
 }
 
+static uint64_t MsOption(const Napi::Object& options, const char* key, uint64_t default_ns) {
+    if (!options.Has(key) || !options.Get(key).IsNumber()) return default_ns;
+    return static_cast<uint64_t>(options.Get(key).As<Napi::Number>().DoubleValue() * 1e6);
+}
+
+Napi::Boolean InitializeSimulatedNetwork(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    SimulatedNetwork::Config config;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("deviceCount") && options.Get("deviceCount").IsNumber()) {
+            config.device_count = options.Get("deviceCount").As<Napi::Number>().Uint32Value();
+        }
+        if (options.Has("seed") && options.Get("seed").IsNumber()) {
+            config.seed = options.Get("seed").As<Napi::Number>().Uint32Value();
+        }
+        if (options.Has("responseRate") && options.Get("responseRate").IsNumber()) {
+            config.response_rate = options.Get("responseRate").As<Napi::Number>().DoubleValue();
+        }
+        if (options.Has("trafficMbps") && options.Get("trafficMbps").IsNumber()) {
+            config.traffic_mbps = options.Get("trafficMbps").As<Napi::Number>().DoubleValue();
+        }
+        config.arp_cache_timeout_ns = MsOption(options, "arpCacheTimeoutMs", config.arp_cache_timeout_ns);
+        config.dhcp_interval_ns = MsOption(options, "dhcpIntervalMs", config.dhcp_interval_ns);
+        config.mdns_interval_ns = MsOption(options, "mdnsIntervalMs", config.mdns_interval_ns);
+    }
+    
+    try {
+        auto network = std::make_shared<SimulatedNetwork>(config, g_simulated_clock);
+        
+        NetworkInfo topology;
+        topology.local_ip = ArpManager::ipToString(network->ourIp());
+        topology.subnet_mask = "255.255.0.0";
+        topology.gateway_ip = ArpManager::ipToString(network->gatewayIp());
+        topology.gateway_mac = ArpManager::macToString(network->gatewayMac());
+        topology.interface_name = "simulated";
+        topology.interface_mac = ArpManager::macToString(network->ourMac());
+        topology.subnet_cidr = 16;
+        topology.is_valid = true;
+        
+        bool result = InitializeArpManagerWithBackend(topology, network);
+        g_simulated_network = result ? network : nullptr;
+        return Napi::Boolean::New(env, result);
+    } catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+}
+
+Napi::Array GetSimulatedDevices(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Array result = Napi::Array::New(env);
+    if (!g_simulated_network) return result;
+    
+    uint8_t mac[6];
+    uint8_t ip[4];
+    for (uint32_t i = 0; i < g_simulated_network->deviceCount(); ++i) {
+        g_simulated_network->deviceMac(i, mac);
+        g_simulated_network->deviceIp(i, ip);
+        Napi::Object device = Napi::Object::New(env);
+        device.Set("ip", Napi::String::New(env, ArpManager::ipToString(ip)));
+        device.Set("mac", Napi::String::New(env, ArpManager::macToString(mac)));
+        device.Set("respondsToArp", Napi::Boolean::New(env, g_simulated_network->respondsToArp(i)));
+        result.Set(i, device);
+    }
+    return result;
+}
+
+Napi::Value GetSimulatedNetworkStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!g_simulated_network) return env.Null();
+    
+    g_simulated_network->poll();
+    SimulatedNetwork::Stats stats = g_simulated_network->stats();
+    
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("devices", Napi::Number::New(env, g_simulated_network->deviceCount()));
+    result.Set("poisonedDevices", Napi::Number::New(env, g_simulated_network->poisonedCount()));
+    result.Set("restoredDevices", Napi::Number::New(env, g_simulated_network->restoredCount()));
+    result.Set("arpRequests", Napi::Number::New(env, static_cast<double>(stats.arp_requests)));
+    result.Set("arpReplies", Napi::Number::New(env, static_cast<double>(stats.arp_replies)));
+    result.Set("poisonUpdates", Napi::Number::New(env, static_cast<double>(stats.poison_updates)));
+    result.Set("restoreUpdates", Napi::Number::New(env, static_cast<double>(stats.restore_updates)));
+    result.Set("cacheExpiries", Napi::Number::New(env, static_cast<double>(stats.cache_expiries)));
+    result.Set("poisonLapses", Napi::Number::New(env, static_cast<double>(stats.poison_lapses)));
+    result.Set("chatterFrames", Napi::Number::New(env, static_cast<double>(stats.chatter_frames)));
+    result.Set("trafficGenerated", Napi::Number::New(env, static_cast<double>(stats.traffic_generated)));
+    result.Set("trafficIntercepted", Napi::Number::New(env, static_cast<double>(stats.traffic_intercepted)));
+    result.Set("framesDelivered", Napi::Number::New(env, static_cast<double>(stats.frames_delivered)));
+    result.Set("framesUnroutable", Napi::Number::New(env, static_cast<double>(stats.frames_unroutable)));
+    result.Set("rxDropped", Napi::Number::New(env, static_cast<double>(stats.rx_dropped)));
+    return result;
+}
+
 // Initialize the module and export functions
 Napi::Object Initialize(Napi::Env env, Napi::Object exports) {
     // Initialize Winsock
@@ -728,8 +1094,16 @@ Napi::Object Initialize(Napi::Env env, Napi::Object exports) {
     // Export network scanning functions
     exports.Set("scanDevices", Napi::Function::New(env, ScanDevices));
     exports.Set("scanDevicesFast", Napi::Function::New(env, ScanDevicesFast));
+    exports.Set("scanDevicesPacked", Napi::Function::New(env, ScanDevicesPacked));
+    exports.Set("getDeviceTablePacked", Napi::Function::New(env, GetDeviceTablePacked));
+    exports.Set("benchmarkDeviceTableTransfer", Napi::Function::New(env, BenchmarkDeviceTableTransfer));
+    exports.Set("openDeviceInventory", Napi::Function::New(env, OpenDeviceInventory));
+    exports.Set("getDeviceInventoryPacked", Napi::Function::New(env, GetDeviceInventoryPacked));
     exports.Set("getDeviceDetails", Napi::Function::New(env, GetDeviceDetails));
     exports.Set("resolveSingleDeviceName", Napi::Function::New(env, ResolveSingleDeviceName));
+    exports.Set("resolveDeviceNames", Napi::Function::New(env, ResolveDeviceNames));
+    exports.Set("getResolverStats", Napi::Function::New(env, GetResolverStats));
+    exports.Set("discoverDeviceNames", Napi::Function::New(env, DiscoverDeviceNames));
     
     // Export traffic control functions
     exports.Set("setBandwidthLimit", Napi::Function::New(env, SetBandwidthLimit));
@@ -750,6 +1124,11 @@ Napi::Object Initialize(Napi::Env env, Napi::Object exports) {
     exports.Set("stopArpPoisoning", Napi::Function::New(env, StopArpPoisoningWrapper));
     exports.Set("enumeratePcapDevices", Napi::Function::New(env, EnumeratePcapDevicesWrapper));
     
+    // Simulated LAN backend for load tests
+    exports.Set("initializeSimulatedNetwork", Napi::Function::New(env, InitializeSimulatedNetwork));
+    exports.Set("getSimulatedDevices", Napi::Function::New(env, GetSimulatedDevices));
+    exports.Set("getSimulatedNetworkStats", Napi::Function::New(env, GetSimulatedNetworkStats));
+    
     return exports;
 }
 
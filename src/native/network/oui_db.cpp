@@ -0,0 +1,74 @@
+#include "oui_db.h"
+#include "device_table.h"
+
+namespace {
+
+struct OuiEntry32 {
+    uint32_t prefix;
+    uint32_t vendor;
+};
+
+struct OuiEntry64 {
+    uint64_t prefix;
+    uint32_t vendor;
+};
+
+// The module build generates the table from the checked-in registry CSVs
+// (binding.gyp); other builds use the checked-in copy
+#ifdef NETSHAPER_GENERATED_OUI_TABLE
+#include "oui_registry_table.inc"
+#else
+#include "oui_table.inc"
+#endif
+
+template <typename Entry, typename Key>
+const char* FindPrefix(const Entry* table, size_t count, Key key) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table[mid].prefix < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < count && table[lo].prefix == key) {
+        return kOuiVendors[table[lo].vendor];
+    }
+    return nullptr;
+}
+
+} // namespace
+
+const char* LookupVendor(const uint8_t* mac) {
+    uint64_t packed = 0;
+    for (int i = 0; i < 6; ++i) {
+        packed = (packed << 8) | mac[i];
+    }
+    
+    // Longest prefix first
+    const char* vendor = FindPrefix(kOuiMaS, kOuiMaSCount, packed >> 12);
+    if (!vendor) vendor = FindPrefix(kOuiMaM, kOuiMaMCount, static_cast<uint32_t>(packed >> 20));
+    if (!vendor) vendor = FindPrefix(kOuiMaL, kOuiMaLCount, static_cast<uint32_t>(packed >> 24));
+    return vendor;
+}
+
+std::string LookupVendorName(const std::string& mac) {
+    uint8_t bytes[6];
+    if (!ParseMac(mac, bytes)) {
+        return "Unknown";
+    }
+    
+    const char* vendor = LookupVendor(bytes);
+    if (vendor) {
+        return vendor;
+    }
+    
+    // Locally administered bit: randomized/private addresses never match
+    return (bytes[0] & 0x02) ? "Private" : "Unknown";
+}
+
+size_t GetOuiDatabaseSize() {
+    return kOuiMaLCount + kOuiMaMCount + kOuiMaSCount;
+}
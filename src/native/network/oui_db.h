@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// IEEE OUI vendor database
+//
+// The MA-L (24-bit), MA-M (28-bit) and MA-S (36-bit) registries are compiled
+// into the binary as sorted arrays (generated by tools/gen_oui_table.py when
+// the module is built, oui_table.inc elsewhere), so there is no file I/O or
+// parsing at startup.
+// Lookup is longest-prefix: MA-S, then MA-M, then MA-L, each a binary search
+// over a packed integer prefix.
+
+// Returns the vendor for a 6-byte MAC, or nullptr if not registered
+const char* LookupVendor(const uint8_t* mac);
+
+// String convenience for scan paths; returns "Unknown" when not found and
+// "Private" for unregistered locally administered (randomized) addresses
+std::string LookupVendorName(const std::string& mac);
+
+// Number of prefixes compiled in (MA-L + MA-M + MA-S)
+size_t GetOuiDatabaseSize();
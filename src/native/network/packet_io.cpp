@@ -0,0 +1,228 @@
+#include "packet_io.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <chrono>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+#endif
+
+bool NullPacketIO::send(const uint8_t* frame, size_t length) {
+    frames_sent_.fetch_add(1, std::memory_order_relaxed);
+    bytes_sent_.fetch_add(length, std::memory_order_relaxed);
+    if (keep_frames_) {
+        std::lock_guard<std::mutex> lock(frames_mutex_);
+        frames_.emplace_back(frame, frame + length);
+    }
+    return true;
+}
+
+std::vector<std::vector<uint8_t>> NullPacketIO::takeFrames() {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    std::vector<std::vector<uint8_t>> frames;
+    frames.swap(frames_);
+    return frames;
+}
+
+#ifdef _WIN32
+bool PcapPacketIO::send(const uint8_t* frame, size_t length) {
+    return pcap_sendpacket(handle_, frame, static_cast<int>(length)) == 0;
+}
+
+size_t PcapPacketIO::receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) {
+    struct pcap_pkthdr* header = nullptr;
+    const u_char* data = nullptr;
+    if (pcap_next_ex(handle_, &header, &data) != 1) return 0;
+
+    size_t copied = header->caplen < capacity ? header->caplen : capacity;
+    memcpy(buffer, data, copied);
+    timestamp_ns = static_cast<uint64_t>(header->ts.tv_sec) * 1000000000ULL +
+                   static_cast<uint64_t>(header->ts.tv_usec) * (nanosecond_timestamps_ ? 1ULL : 1000ULL);
+    return copied;
+}
+
+namespace {
+struct PcapBurst {
+    ReceivedFrame* frames;
+    size_t count;
+    bool nanosecond_timestamps;
+};
+}
+
+static void OnPcapBurstFrame(u_char* user, const struct pcap_pkthdr* header, const u_char* data) {
+    PcapBurst* burst = reinterpret_cast<PcapBurst*>(user);
+    ReceivedFrame& frame = burst->frames[burst->count++];
+    frame.length = header->caplen < frame.capacity ? header->caplen : frame.capacity;
+    memcpy(frame.data, data, frame.length);
+    frame.timestamp_ns = static_cast<uint64_t>(header->ts.tv_sec) * 1000000000ULL +
+                         static_cast<uint64_t>(header->ts.tv_usec) * (burst->nanosecond_timestamps ? 1ULL : 1000ULL);
+}
+
+size_t PcapPacketIO::receiveBurst(ReceivedFrame* frames, size_t max) {
+    if (max == 0) return 0;
+    PcapBurst burst = { frames, 0, nanosecond_timestamps_ };
+    // cnt bounds the callbacks, so the slots cannot overflow
+    pcap_dispatch(handle_, static_cast<int>(max), OnPcapBurstFrame, reinterpret_cast<u_char*>(&burst));
+    return burst.count;
+}
+
+bool PcapPacketIO::setFilter(const std::vector<BpfInstruction>& program) {
+    // pcap_setfilter copies the program; BpfInstruction matches bpf_insn
+    struct bpf_program compiled;
+    compiled.bf_len = static_cast<u_int>(program.size());
+    compiled.bf_insns = reinterpret_cast<struct bpf_insn*>(const_cast<BpfInstruction*>(program.data()));
+    return pcap_setfilter(handle_, &compiled) == 0;
+}
+
+bool PcapPacketIO::captureStats(CaptureStats& stats) {
+    struct pcap_stat raw;
+    if (pcap_stats(handle_, &raw) != 0) return false;
+    // Unsigned 32-bit differences stay correct across one wrap per call
+    totals_.received += static_cast<uint32_t>(raw.ps_recv - last_raw_.ps_recv);
+    totals_.dropped += static_cast<uint32_t>(raw.ps_drop - last_raw_.ps_drop);
+    totals_.interface_dropped += static_cast<uint32_t>(raw.ps_ifdrop - last_raw_.ps_ifdrop);
+    last_raw_ = raw;
+    stats = totals_;
+    return true;
+}
+
+std::string PcapPacketIO::lastError() const {
+    return std::string(pcap_geterr(handle_));
+}
+#endif
+
+#ifdef __linux__
+bool PacketSocketIO::open(const std::string& interface_name, bool promiscuous) {
+    close();
+    totals_ = CaptureStats();
+
+    fd_ = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd_ < 0) {
+        last_error_ = "socket(AF_PACKET) failed: " + std::string(strerror(errno));
+        return false;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface_name.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
+        last_error_ = "Unknown interface " + interface_name;
+        close();
+        return false;
+    }
+    ifindex_ = ifr.ifr_ifindex;
+    if (ioctl(fd_, SIOCGIFHWADDR, &ifr) == 0) {
+        memcpy(mac_, ifr.ifr_hwaddr.sa_data, 6);
+    }
+
+    struct sockaddr_ll address;
+    memset(&address, 0, sizeof(address));
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = ifindex_;
+    if (bind(fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        last_error_ = "bind to " + interface_name + " failed: " + std::string(strerror(errno));
+        close();
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(fd_, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+    int buffer_size = 8 << 20;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &buffer_size, sizeof(buffer_size));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUFFORCE, &buffer_size, sizeof(buffer_size));
+
+    if (promiscuous) {
+        struct packet_mreq membership;
+        memset(&membership, 0, sizeof(membership));
+        membership.mr_ifindex = ifindex_;
+        membership.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+            last_error_ = "Promiscuous mode on " + interface_name + " failed: " + std::string(strerror(errno));
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PacketSocketIO::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool PacketSocketIO::send(const uint8_t* frame, size_t length) {
+    if (::send(fd_, frame, length, 0) == static_cast<ssize_t>(length)) return true;
+    last_error_ = "send failed: " + std::string(strerror(errno));
+    return false;
+}
+
+size_t PacketSocketIO::receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) {
+    ssize_t received = recv(fd_, buffer, capacity, MSG_DONTWAIT | MSG_TRUNC);
+    if (received <= 0) return 0;
+    timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    return std::min(static_cast<size_t>(received), capacity);
+}
+
+size_t PacketSocketIO::receiveBurst(ReceivedFrame* frames, size_t max) {
+    struct mmsghdr messages[kMaxBurst];
+    struct iovec vectors[kMaxBurst];
+    if (max > kMaxBurst) max = kMaxBurst;
+    for (size_t i = 0; i < max; ++i) {
+        vectors[i].iov_base = frames[i].data;
+        vectors[i].iov_len = frames[i].capacity;
+        memset(&messages[i], 0, sizeof(messages[i]));
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int received = recvmmsg(fd_, messages, static_cast<unsigned int>(max), MSG_DONTWAIT | MSG_TRUNC, nullptr);
+    if (received <= 0) return 0;
+    uint64_t timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    for (int i = 0; i < received; ++i) {
+        // msg_len is the frame length even when it was cut to capacity
+        frames[i].length = std::min(static_cast<size_t>(messages[i].msg_len), frames[i].capacity);
+        frames[i].timestamp_ns = timestamp_ns;
+    }
+    return static_cast<size_t>(received);
+}
+
+bool PacketSocketIO::setFilter(const std::vector<BpfInstruction>& program) {
+    // SO_ATTACH_FILTER replaces any previous program in one step
+    struct sock_fprog fprog;
+    fprog.len = static_cast<unsigned short>(program.size());
+    fprog.filter = reinterpret_cast<struct sock_filter*>(const_cast<BpfInstruction*>(program.data()));
+    if (setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) == 0) return true;
+    last_error_ = "SO_ATTACH_FILTER failed: " + std::string(strerror(errno));
+    return false;
+}
+
+bool PacketSocketIO::captureStats(CaptureStats& stats) {
+    struct tpacket_stats raw;
+    socklen_t length = sizeof(raw);
+    if (getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &raw, &length) != 0) {
+        last_error_ = "PACKET_STATISTICS failed: " + std::string(strerror(errno));
+        return false;
+    }
+    // tp_packets already includes tp_drops
+    totals_.received += raw.tp_packets;
+    totals_.dropped += raw.tp_drops;
+    stats = totals_;
+    return true;
+}
+#endif
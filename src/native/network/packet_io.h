@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "capture_filter.h"
+#include "capture_profile.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <pcap.h>
+#endif
+
+// One slot of a receive burst. The caller points data at capacity bytes
+// of its own; receiveBurst() fills in length and timestamp_ns.
+struct ReceivedFrame {
+    uint8_t* data;
+    size_t capacity;
+    size_t length;
+    uint64_t timestamp_ns;
+};
+
+// Packet backend used by ArpManager and DataPlane
+//
+// ArpManager builds frames and hands them to a PacketIO instead of calling
+// pcap directly, so the send path can run against something other than a
+// live adapter (benchmarks, simulations, replay).
+class PacketIO {
+public:
+    virtual ~PacketIO() = default;
+
+    // Transmit one complete Ethernet frame. Returns false on failure, with
+    // the reason available from lastError().
+    virtual bool send(const uint8_t* frame, size_t length) = 0;
+    virtual std::string lastError() const = 0;
+
+    // Fetch one received frame without blocking. Copies at most capacity
+    // bytes and returns the number copied, or 0 when nothing is pending.
+    // Send-only backends keep this default.
+    virtual size_t receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) {
+        (void)buffer;
+        (void)capacity;
+        (void)timestamp_ns;
+        return 0;
+    }
+
+    // Fetch up to max frames without blocking, in arrival order; returns
+    // how many slots were filled. Backends that can take a batch from the
+    // kernel in one call override this; the default loops over receive().
+    static const size_t kMaxBurst = 64;
+    virtual size_t receiveBurst(ReceivedFrame* frames, size_t max) {
+        size_t count = 0;
+        while (count < max) {
+            ReceivedFrame& frame = frames[count];
+            frame.length = receive(frame.data, frame.capacity, frame.timestamp_ns);
+            if (frame.length == 0) break;
+            ++count;
+        }
+        return count;
+    }
+
+    // Replace the receive filter (see BuildCaptureFilter). The switch is
+    // atomic: frames see either the old or the new program. Returns false
+    // when the backend has no kernel filter or the kernel rejected it.
+    virtual bool setFilter(const std::vector<BpfInstruction>& program) {
+        (void)program;
+        return false;
+    }
+
+    // Kernel receive/drop counters. Returns false when the backend has
+    // none (send-only, simulated).
+    virtual bool captureStats(CaptureStats& stats) {
+        (void)stats;
+        return false;
+    }
+};
+
+// Discards frames, only counting them. With keep_frames set the frames are
+// also stored in memory so callers can inspect what would have been sent.
+class NullPacketIO : public PacketIO {
+public:
+    explicit NullPacketIO(bool keep_frames = false) : keep_frames_(keep_frames) {}
+
+    bool send(const uint8_t* frame, size_t length) override;
+    std::string lastError() const override { return ""; }
+
+    uint64_t framesSent() const { return frames_sent_.load(std::memory_order_relaxed); }
+    uint64_t bytesSent() const { return bytes_sent_.load(std::memory_order_relaxed); }
+    std::vector<std::vector<uint8_t>> takeFrames();
+
+private:
+    bool keep_frames_;
+    std::atomic<uint64_t> frames_sent_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::mutex frames_mutex_;
+    std::vector<std::vector<uint8_t>> frames_;
+};
+
+#ifdef _WIN32
+// Sends through an open pcap handle. The handle is not owned.
+// nanosecond_timestamps: the handle was activated with
+// PCAP_TSTAMP_PRECISION_NANO, so ts.tv_usec holds nanoseconds.
+class PcapPacketIO : public PacketIO {
+public:
+    explicit PcapPacketIO(pcap_t* handle, bool nanosecond_timestamps = false)
+        : handle_(handle), nanosecond_timestamps_(nanosecond_timestamps) {}
+
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) override;
+    // One pcap_dispatch() call, so the driver buffer is read once per burst
+    size_t receiveBurst(ReceivedFrame* frames, size_t max) override;
+    bool setFilter(const std::vector<BpfInstruction>& program) override;
+    bool captureStats(CaptureStats& stats) override;
+    std::string lastError() const override;
+
+private:
+    pcap_t* handle_;
+    bool nanosecond_timestamps_;
+    // pcap_stats counters are 32-bit; widened here across wraps
+    struct pcap_stat last_raw_ = {};
+    CaptureStats totals_ = {};
+};
+#endif
+
+#ifdef __linux__
+// Raw AF_PACKET socket bound to one interface, for the Linux bench rig and
+// tools. Sends block when the socket buffer is full; receive() never does.
+// Frames we send are not looped back to receive().
+class PacketSocketIO : public PacketIO {
+public:
+    PacketSocketIO() : fd_(-1), ifindex_(0) {}
+    ~PacketSocketIO() override { close(); }
+
+    PacketSocketIO(const PacketSocketIO&) = delete;
+    PacketSocketIO& operator=(const PacketSocketIO&) = delete;
+
+    // promiscuous: also receive frames addressed to other MACs
+    bool open(const std::string& interface_name, bool promiscuous = false);
+    void close();
+
+    int fd() const { return fd_; }
+    const uint8_t* interfaceMac() const { return mac_; }
+
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) override;
+    // One recvmmsg() call per burst
+    size_t receiveBurst(ReceivedFrame* frames, size_t max) override;
+    bool setFilter(const std::vector<BpfInstruction>& program) override;
+    bool captureStats(CaptureStats& stats) override;
+    std::string lastError() const override { return last_error_; }
+
+private:
+    int fd_;
+    int ifindex_;
+    uint8_t mac_[6] = {};
+    CaptureStats totals_ = {};   // PACKET_STATISTICS resets on every read
+    std::string last_error_;
+};
+#endif
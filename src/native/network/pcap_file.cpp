@@ -0,0 +1,381 @@
+#include "pcap_file.h"
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t kPcapMagicMicro = 0xA1B2C3D4;
+static const uint32_t kPcapMagicNano = 0xA1B23C4D;
+static const uint32_t kPcapngSectionHeader = 0x0A0D0D0A;
+static const uint32_t kPcapngByteOrderMagic = 0x1A2B3C4D;
+static const uint32_t kPcapngInterface = 1;
+static const uint32_t kPcapngSimplePacket = 3;
+static const uint32_t kPcapngEnhancedPacket = 6;
+static const uint16_t kOptionEnd = 0;
+static const uint16_t kOptionTsResol = 9;
+static const uint16_t kLinkTypeEthernet = 1;
+static const size_t kPcapHeaderSize = 24;
+static const size_t kPcapRecordHeaderSize = 16;
+
+static inline uint32_t Swap32(uint32_t value) {
+    return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+}
+
+static inline uint16_t Swap16(uint16_t value) {
+    return static_cast<uint16_t>((value >> 8) | (value << 8));
+}
+
+static inline uint64_t TicksToNs(uint64_t ticks, uint64_t units_per_second) {
+    if (units_per_second == 1000000000ULL) return ticks;
+    return (ticks / units_per_second) * 1000000000ULL +
+           (ticks % units_per_second) * 1000000000ULL / units_per_second;
+}
+
+PcapFileReader::PcapFileReader()
+    : base_(nullptr), size_(0), file_handle_(nullptr), mapping_handle_(nullptr),
+      pcapng_(false), swapped_(false), offset_(0), first_offset_(0),
+      link_type_(0), nanosecond_(false), last_timestamp_ns_(0), skipped_(0) {}
+
+PcapFileReader::~PcapFileReader() {
+    close();
+}
+
+uint16_t PcapFileReader::read16(size_t offset) const {
+    uint16_t value;
+    memcpy(&value, base_ + offset, sizeof(value));
+    return swapped_ ? Swap16(value) : value;
+}
+
+uint32_t PcapFileReader::read32(size_t offset) const {
+    uint32_t value;
+    memcpy(&value, base_ + offset, sizeof(value));
+    return swapped_ ? Swap32(value) : value;
+}
+
+bool PcapFileReader::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        setError("Failed to open " + path + " (error " + std::to_string(GetLastError()) + ")");
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < 4) {
+        setError("Not a capture file: " + path);
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        setError("Failed to create mapping for " + path + " (error " + std::to_string(GetLastError()) + ")");
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        setError("Failed to map " + path + " (error " + std::to_string(GetLastError()) + ")");
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        setError("Failed to open " + path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 4) {
+        setError("Not a capture file: " + path);
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        setError("Failed to map " + path);
+        ::close(fd);
+        return false;
+    }
+    madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    file_handle_ = reinterpret_cast<void*>(static_cast<intptr_t>(fd));
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+
+    base_ = static_cast<uint8_t*>(view);
+
+    uint32_t magic;
+    memcpy(&magic, base_, sizeof(magic));
+
+    if (magic == kPcapngSectionHeader) {
+        pcapng_ = true;
+        offset_ = 0;
+    } else {
+        pcapng_ = false;
+        swapped_ = (magic == Swap32(kPcapMagicMicro) || magic == Swap32(kPcapMagicNano));
+        uint32_t native = swapped_ ? Swap32(magic) : magic;
+        if ((native != kPcapMagicMicro && native != kPcapMagicNano) || size_ < kPcapHeaderSize) {
+            setError("Not a pcap or pcapng file: " + path);
+            close();
+            return false;
+        }
+        nanosecond_ = (native == kPcapMagicNano);
+        link_type_ = static_cast<uint16_t>(read32(20) & 0xFFFF);
+        offset_ = kPcapHeaderSize;
+    }
+
+    first_offset_ = offset_;
+    return true;
+}
+
+void PcapFileReader::close() {
+    if (!base_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    CloseHandle(static_cast<HANDLE>(file_handle_));
+#else
+    munmap(base_, size_);
+    ::close(static_cast<int>(reinterpret_cast<intptr_t>(file_handle_)));
+#endif
+    base_ = nullptr;
+    size_ = 0;
+    file_handle_ = nullptr;
+    mapping_handle_ = nullptr;
+    interfaces_.clear();
+    swapped_ = false;
+    skipped_ = 0;
+}
+
+void PcapFileReader::rewind() {
+    offset_ = first_offset_;
+    interfaces_.clear();
+    last_timestamp_ns_ = 0;
+    skipped_ = 0;
+}
+
+bool PcapFileReader::next(Packet& packet) {
+    if (!base_) return false;
+    return pcapng_ ? nextPcapng(packet) : nextClassic(packet);
+}
+
+bool PcapFileReader::nextClassic(Packet& packet) {
+    while (offset_ + kPcapRecordHeaderSize <= size_) {
+        uint32_t seconds = read32(offset_);
+        uint32_t fraction = read32(offset_ + 4);
+        uint32_t captured = read32(offset_ + 8);
+        uint32_t original = read32(offset_ + 12);
+        size_t data_offset = offset_ + kPcapRecordHeaderSize;
+
+        if (captured > size_ - data_offset) {
+            setError("Truncated packet record");
+            offset_ = size_;
+            return false;
+        }
+        offset_ = data_offset + captured;
+
+        if (link_type_ != kLinkTypeEthernet) {
+            ++skipped_;
+            continue;
+        }
+
+        packet.data = base_ + data_offset;
+        packet.captured_length = captured;
+        packet.original_length = original;
+        packet.timestamp_ns = static_cast<uint64_t>(seconds) * 1000000000ULL +
+                              (nanosecond_ ? fraction : static_cast<uint64_t>(fraction) * 1000ULL);
+        return true;
+    }
+    return false;
+}
+
+bool PcapFileReader::parseSectionHeader(size_t offset) {
+    uint32_t byte_order;
+    memcpy(&byte_order, base_ + offset + 8, sizeof(byte_order));
+    if (byte_order == kPcapngByteOrderMagic) {
+        swapped_ = false;
+    } else if (byte_order == Swap32(kPcapngByteOrderMagic)) {
+        swapped_ = true;
+    } else {
+        return false;
+    }
+    interfaces_.clear();
+    return true;
+}
+
+void PcapFileReader::parseInterface(size_t offset, size_t length) {
+    Interface iface;
+    iface.link_type = read16(offset + 8);
+    iface.units_per_second = 1000000; // default resolution: microseconds
+
+    size_t option = offset + 16;
+    size_t end = offset + length - 4;
+    while (option + 4 <= end) {
+        uint16_t code = read16(option);
+        uint16_t option_length = read16(option + 2);
+        if (code == kOptionEnd || option + 4 + option_length > end) break;
+        if (code == kOptionTsResol && option_length >= 1) {
+            uint8_t resolution = base_[option + 4];
+            uint8_t exponent = resolution & 0x7F;
+            if (resolution & 0x80) {
+                iface.units_per_second = exponent < 64 ? (1ULL << exponent) : 1000000;
+            } else {
+                uint64_t units = 1;
+                for (uint8_t i = 0; i < exponent && i < 19; ++i) units *= 10;
+                iface.units_per_second = units;
+            }
+        }
+        option += 4 + ((option_length + 3u) & ~3u);
+    }
+    interfaces_.push_back(iface);
+}
+
+bool PcapFileReader::nextPcapng(Packet& packet) {
+    while (offset_ + 12 <= size_) {
+        uint32_t raw_type;
+        memcpy(&raw_type, base_ + offset_, sizeof(raw_type));
+
+        // The section header sets the byte order for everything after it,
+        // including its own length field
+        if (raw_type == kPcapngSectionHeader && offset_ + 16 <= size_) {
+            if (!parseSectionHeader(offset_)) {
+                setError("Bad pcapng byte-order magic");
+                offset_ = size_;
+                return false;
+            }
+        }
+
+        uint32_t type = read32(offset_);
+        uint32_t length = read32(offset_ + 4);
+        if (length < 12 || (length & 3) != 0 || length > size_ - offset_) {
+            setError("Corrupt pcapng block");
+            offset_ = size_;
+            return false;
+        }
+
+        size_t block = offset_;
+        offset_ += length;
+
+        if (type == kPcapngInterface && length >= 20) {
+            parseInterface(block, length);
+        } else if (type == kPcapngEnhancedPacket && length >= 32) {
+            uint32_t interface_id = read32(block + 8);
+            uint64_t ticks = (static_cast<uint64_t>(read32(block + 12)) << 32) | read32(block + 16);
+            uint32_t captured = read32(block + 20);
+            uint32_t original = read32(block + 24);
+            if (captured > length - 32 || interface_id >= interfaces_.size()) {
+                ++skipped_;
+                continue;
+            }
+            const Interface& iface = interfaces_[interface_id];
+            if (iface.link_type != kLinkTypeEthernet) {
+                ++skipped_;
+                continue;
+            }
+            last_timestamp_ns_ = TicksToNs(ticks, iface.units_per_second);
+            packet.data = base_ + block + 28;
+            packet.captured_length = captured;
+            packet.original_length = original;
+            packet.timestamp_ns = last_timestamp_ns_;
+            return true;
+        } else if (type == kPcapngSimplePacket && length >= 16) {
+            // No timestamp: reuse the previous packet's
+            uint32_t original = read32(block + 8);
+            uint32_t captured = original < length - 16 ? original : length - 16;
+            if (interfaces_.empty() || interfaces_[0].link_type != kLinkTypeEthernet) {
+                ++skipped_;
+                continue;
+            }
+            packet.data = base_ + block + 12;
+            packet.captured_length = captured;
+            packet.original_length = original;
+            packet.timestamp_ns = last_timestamp_ns_;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PcapFileWriter::open(const std::string& path, bool pcapng) {
+    close();
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    file_ = file;
+    pcapng_ = pcapng;
+
+    if (pcapng) {
+        // Section header: type, length, byte-order magic, version 1.0,
+        // unknown section length, length
+        uint32_t shb[7] = { kPcapngSectionHeader, 28, kPcapngByteOrderMagic, 0x00000001,
+                            0xFFFFFFFF, 0xFFFFFFFF, 28 };
+        // Interface: Ethernet, snaplen 65535, if_tsresol = 9 (nanoseconds)
+        uint8_t idb[32] = {};
+        uint32_t idb_type = kPcapngInterface, idb_length = sizeof(idb), snaplen = 65535;
+        uint16_t link_type = kLinkTypeEthernet;
+        uint16_t tsresol_code = kOptionTsResol, tsresol_length = 1;
+        memcpy(idb, &idb_type, 4);
+        memcpy(idb + 4, &idb_length, 4);
+        memcpy(idb + 8, &link_type, 2);
+        memcpy(idb + 12, &snaplen, 4);
+        memcpy(idb + 16, &tsresol_code, 2);
+        memcpy(idb + 18, &tsresol_length, 2);
+        idb[20] = 9;
+        // idb[24..27]: opt_endofopt (zero)
+        memcpy(idb + 28, &idb_length, 4);
+        fwrite(shb, sizeof(shb), 1, file);
+        fwrite(idb, sizeof(idb), 1, file);
+    } else {
+        uint32_t header[6] = { kPcapMagicMicro, 0x00040002, 0, 0, 65535, kLinkTypeEthernet };
+        fwrite(header, sizeof(header), 1, file);
+    }
+    return true;
+}
+
+bool PcapFileWriter::write(const uint8_t* data, uint32_t length, uint64_t timestamp_ns) {
+    FILE* file = static_cast<FILE*>(file_);
+    if (!file) return false;
+
+    if (pcapng_) {
+        uint32_t padded = (length + 3) & ~3u;
+        uint32_t block_length = 32 + padded;
+        uint32_t header[7] = { kPcapngEnhancedPacket, block_length, 0,
+                               static_cast<uint32_t>(timestamp_ns >> 32),
+                               static_cast<uint32_t>(timestamp_ns & 0xFFFFFFFF), length, length };
+        static const uint8_t kPadding[4] = {};
+        fwrite(header, sizeof(header), 1, file);
+        fwrite(data, 1, length, file);
+        fwrite(kPadding, 1, padded - length, file);
+        return fwrite(&block_length, sizeof(block_length), 1, file) == 1;
+    }
+
+    uint32_t record[4] = { static_cast<uint32_t>(timestamp_ns / 1000000000ULL),
+                           static_cast<uint32_t>((timestamp_ns % 1000000000ULL) / 1000), length, length };
+    fwrite(record, sizeof(record), 1, file);
+    return fwrite(data, 1, length, file) == length;
+}
+
+void PcapFileWriter::close() {
+    if (file_) {
+        fclose(static_cast<FILE*>(file_));
+        file_ = nullptr;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Read-only, memory-mapped pcap / pcapng reader
+//
+// The file is mapped once and packets are returned as views into the
+// mapping, so iterating a capture costs no copies or syscalls. Supports
+// classic pcap (either byte order, micro- or nanosecond timestamps) and
+// pcapng (section/interface blocks, enhanced and simple packet blocks, any
+// if_tsresol). Only Ethernet link types are returned; other packets are
+// skipped and counted.
+class PcapFileReader {
+public:
+    struct Packet {
+        const uint8_t* data;
+        uint32_t captured_length;
+        uint32_t original_length;
+        uint64_t timestamp_ns;   // since the epoch
+    };
+
+    PcapFileReader();
+    ~PcapFileReader();
+
+    PcapFileReader(const PcapFileReader&) = delete;
+    PcapFileReader& operator=(const PcapFileReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // Next Ethernet packet; false at end of file or on a corrupt block
+    bool next(Packet& packet);
+
+    // Start again from the first packet
+    void rewind();
+
+    bool isPcapng() const { return pcapng_; }
+    uint64_t skippedPackets() const { return skipped_; }
+    std::string getLastError() const { return last_error_; }
+
+private:
+    struct Interface {
+        uint16_t link_type;
+        uint64_t units_per_second;  // from if_tsresol
+    };
+
+    uint8_t* base_;
+    size_t size_;
+    void* file_handle_;
+    void* mapping_handle_;
+
+    bool pcapng_;
+    bool swapped_;                 // file byte order differs from ours
+    size_t offset_;
+    size_t first_offset_;
+    uint16_t link_type_;           // classic pcap
+    bool nanosecond_;              // classic pcap
+    std::vector<Interface> interfaces_;
+    uint64_t last_timestamp_ns_;
+    uint64_t skipped_;
+    std::string last_error_;
+
+    uint16_t read16(size_t offset) const;
+    uint32_t read32(size_t offset) const;
+    bool nextClassic(Packet& packet);
+    bool nextPcapng(Packet& packet);
+    bool parseSectionHeader(size_t offset);
+    void parseInterface(size_t offset, size_t length);
+    void setError(const std::string& error) { last_error_ = error; }
+};
+
+// Minimal capture writer (Ethernet only), used to produce replay fixtures
+class PcapFileWriter {
+public:
+    PcapFileWriter() : file_(nullptr), pcapng_(false) {}
+    ~PcapFileWriter() { close(); }
+
+    PcapFileWriter(const PcapFileWriter&) = delete;
+    PcapFileWriter& operator=(const PcapFileWriter&) = delete;
+
+    // pcapng writes one section with a single nanosecond-resolution interface
+    bool open(const std::string& path, bool pcapng = false);
+    bool write(const uint8_t* data, uint32_t length, uint64_t timestamp_ns);
+    void close();
+
+private:
+    void* file_;
+    bool pcapng_;
+};
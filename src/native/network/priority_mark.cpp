@@ -0,0 +1,95 @@
+#include "priority_mark.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NS_MARK_SSE2 1
+#endif
+
+static const uint16_t kEtherTypeVlan = 0x8100;
+static const size_t kMacsSize = 12;
+static const size_t kVlanTagSize = 4;
+static const size_t kChecksumOffset = 10;   // in the IPv4 header
+static const size_t kBurstGroup = 64;
+
+static inline uint16_t ReadBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static inline void WriteBe16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+// First header word (version/IHL, DSCP/ECN) with the DSCP replaced
+static inline uint16_t MarkedWord(uint16_t word, uint8_t dscp) {
+    return static_cast<uint16_t>((word & 0xFF03) | ((dscp & 0x3F) << 2));
+}
+
+bool IsValidPriorityMark(const PriorityMark& mark) {
+    if (mark.flags & ~(kMarkDscp | kMarkVlanPriority)) return false;
+    return mark.dscp <= 63 && mark.pcp <= 7 && mark.vlan_id <= 4094;
+}
+
+bool MarkIpv4Dscp(uint8_t* ipv4, uint8_t dscp) {
+    uint16_t word = ReadBe16(ipv4);
+    uint16_t marked = MarkedWord(word, dscp);
+    if (marked == word) return false;
+    ipv4[1] = static_cast<uint8_t>(marked);
+    WriteBe16(ipv4 + kChecksumOffset, AdjustChecksum(ReadBe16(ipv4 + kChecksumOffset), word, marked));
+    return true;
+}
+
+// Headers are scattered over the burst's frames, so their words are
+// gathered into arrays, the arithmetic runs over the arrays, and changed
+// headers are written back
+void MarkIpv4DscpBurst(uint8_t* const* headers, const uint8_t* dscp, size_t count, size_t* changed) {
+    size_t rewritten = 0;
+    for (size_t done = 0; done < count; done += kBurstGroup) {
+        size_t group = count - done < kBurstGroup ? count - done : kBurstGroup;
+        uint8_t* const* group_headers = headers + done;
+        alignas(16) uint32_t old_words[kBurstGroup];
+        alignas(16) uint32_t new_words[kBurstGroup];
+        alignas(16) uint32_t checksums[kBurstGroup];
+        for (size_t i = 0; i < group; ++i) {
+            old_words[i] = ReadBe16(group_headers[i]);
+            new_words[i] = MarkedWord(static_cast<uint16_t>(old_words[i]), dscp[done + i]);
+            checksums[i] = ReadBe16(group_headers[i] + kChecksumOffset);
+        }
+
+        size_t i = 0;
+#ifdef NS_MARK_SSE2
+        const __m128i low16 = _mm_set1_epi32(0xFFFF);
+        for (; i + 4 <= group; i += 4) {
+            __m128i checksum = _mm_load_si128(reinterpret_cast<const __m128i*>(checksums + i));
+            __m128i old_word = _mm_load_si128(reinterpret_cast<const __m128i*>(old_words + i));
+            __m128i new_word = _mm_load_si128(reinterpret_cast<const __m128i*>(new_words + i));
+            __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_andnot_si128(checksum, low16),
+                                                      _mm_andnot_si128(old_word, low16)), new_word);
+            sum = _mm_add_epi32(_mm_and_si128(sum, low16), _mm_srli_epi32(sum, 16));
+            sum = _mm_add_epi32(_mm_and_si128(sum, low16), _mm_srli_epi32(sum, 16));
+            _mm_store_si128(reinterpret_cast<__m128i*>(checksums + i), _mm_andnot_si128(sum, low16));
+        }
+#endif
+        for (; i < group; ++i) {
+            checksums[i] = AdjustChecksum(static_cast<uint16_t>(checksums[i]), static_cast<uint16_t>(old_words[i]),
+                                          static_cast<uint16_t>(new_words[i]));
+        }
+
+        for (i = 0; i < group; ++i) {
+            if (new_words[i] == old_words[i]) continue;
+            group_headers[i][1] = static_cast<uint8_t>(new_words[i]);
+            WriteBe16(group_headers[i] + kChecksumOffset, static_cast<uint16_t>(checksums[i]));
+            ++rewritten;
+        }
+    }
+    if (changed) *changed = rewritten;
+}
+
+size_t InsertVlanTag(const uint8_t* frame, size_t length, uint8_t pcp, uint16_t vlan_id, uint8_t* out) {
+    memcpy(out, frame, kMacsSize);
+    WriteBe16(out + kMacsSize, kEtherTypeVlan);
+    WriteBe16(out + kMacsSize + 2, static_cast<uint16_t>((pcp & 0x07) << 13 | (vlan_id & 0x0FFF)));
+    memcpy(out + kMacsSize + kVlanTagSize, frame + kMacsSize, length - kMacsSize);
+    return length + kVlanTagSize;
+}
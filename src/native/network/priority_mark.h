@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Which parts of a PriorityMark apply
+enum PriorityMarkFlag : uint8_t {
+    kMarkDscp = 0x01,          // rewrite the IPv4 DSCP (ECN bits are kept)
+    kMarkVlanPriority = 0x02   // 802.1p: set the PCP of the frame's 802.1Q tag,
+                               // adding a tag with vlan_id when it has none
+};
+
+// Priority for the upstream router to honour. Zero-initialised = no marking.
+struct PriorityMark {
+    uint8_t flags;        // PriorityMarkFlag bits
+    uint8_t dscp;         // 0-63, e.g. 46 (EF) for voice
+    uint8_t pcp;          // 0-7
+    uint16_t vlan_id;     // of added tags; 0 = priority tag only
+};
+
+bool IsValidPriorityMark(const PriorityMark& mark);
+
+// RFC 1624 (eqn. 3) update of a ones' complement checksum when one 16-bit
+// word of the covered data changes from old_word to new_word. Words and
+// checksum in the same byte order.
+inline uint16_t AdjustChecksum(uint16_t checksum, uint16_t old_word, uint16_t new_word) {
+    uint32_t sum = static_cast<uint16_t>(~checksum) + static_cast<uint32_t>(static_cast<uint16_t>(~old_word)) +
+                   new_word;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+// Set the DSCP of the IPv4 header at ipv4 and patch its checksum in place.
+// Returns false (header untouched) when the DSCP already matches.
+bool MarkIpv4Dscp(uint8_t* ipv4, uint8_t dscp);
+
+// MarkIpv4Dscp() on count headers, the checksum arithmetic done four
+// headers per SSE2 operation. changed, when given, gets how many headers
+// were rewritten.
+void MarkIpv4DscpBurst(uint8_t* const* headers, const uint8_t* dscp, size_t count, size_t* changed = nullptr);
+
+// Set the priority bits of the 802.1Q tag whose TCI is at tci
+inline void SetVlanPriority(uint8_t* tci, uint8_t pcp) {
+    tci[0] = static_cast<uint8_t>((tci[0] & 0x1F) | (pcp << 5));
+}
+
+// Copy frame (untagged, length >= 12) into out with an 802.1Q tag after
+// the MACs. out needs length + 4 bytes; returns the new length.
+size_t InsertVlanTag(const uint8_t* frame, size_t length, uint8_t pcp, uint16_t vlan_id, uint8_t* out);
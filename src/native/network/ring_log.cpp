@@ -0,0 +1,304 @@
+#include "ring_log.h"
+#include "thread_shards.h"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace ringlog {
+
+static const uint32_t kPadSite = 0xFFFFFFFF;
+static const std::chrono::milliseconds kDrainInterval(20);
+
+// Single-producer (owning thread) / single-consumer (drainer) byte ring.
+// Positions increase monotonically; records never straddle the end, a
+// padding record fills the gap instead.
+struct LogRing {
+    static const size_t kSize = 1 << 16;
+
+    alignas(64) std::atomic<uint64_t> head;     // producer
+    alignas(64) std::atomic<uint64_t> tail;     // consumer
+    alignas(64) std::atomic<uint64_t> dropped;  // producer
+    alignas(8) uint8_t data[kSize];
+};
+
+class Logger {
+public:
+    Logger() {
+        sites_.reserve(256);
+    }
+
+    uint32_t registerSite(LogSite* site) {
+        std::lock_guard<std::mutex> lock(sites_mutex_);
+        sites_.push_back(site);
+        startDrainThread();
+        return static_cast<uint32_t>(sites_.size() - 1);
+    }
+
+    void submit(const uint8_t* record, size_t size) {
+        LogRing& ring = rings_.local();
+        size_t padded = (size + 7) & ~static_cast<size_t>(7);
+
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        uint64_t tail = ring.tail.load(std::memory_order_acquire);
+        size_t offset = static_cast<size_t>(head & (LogRing::kSize - 1));
+        size_t contiguous = LogRing::kSize - offset;
+        size_t needed = padded <= contiguous ? padded : contiguous + padded;
+
+        if (LogRing::kSize - (head - tail) < needed) {
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (padded > contiguous) {
+            RecordHeader pad = { static_cast<uint32_t>(contiguous), kPadSite, 0 };
+            memcpy(ring.data + offset, &pad, sizeof(uint32_t) * 2);
+            head += contiguous;
+            offset = 0;
+        }
+
+        memcpy(ring.data + offset, record, size);
+        ring.head.store(head + padded, std::memory_order_release);
+    }
+
+    // Drain every ring and print in timestamp order. Serialized so the ring
+    // consumer side stays single-threaded.
+    void drain() {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+
+        pending_.clear();
+        rings_.forEach([this](const LogRing& const_ring) {
+            LogRing& ring = const_cast<LogRing&>(const_ring);
+            uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+            uint64_t head = ring.head.load(std::memory_order_acquire);
+
+            while (tail < head) {
+                size_t offset = static_cast<size_t>(tail & (LogRing::kSize - 1));
+                RecordHeader header;
+                memcpy(&header, ring.data + offset, sizeof(uint32_t) * 2);
+                if (header.site != kPadSite) {
+                    memcpy(&header, ring.data + offset, sizeof(header));
+                    const uint8_t* args = ring.data + offset + sizeof(header);
+                    Pending entry;
+                    entry.timestamp = header.timestamp;
+                    entry.site = header.site;
+                    entry.text = format(header.site, args, header.size - sizeof(header));
+                    pending_.push_back(std::move(entry));
+                    tail += (header.size + 7) & ~static_cast<uint64_t>(7);
+                } else {
+                    tail += header.size;
+                }
+            }
+            ring.tail.store(tail, std::memory_order_release);
+        });
+
+        if (pending_.empty()) return;
+
+        std::stable_sort(pending_.begin(), pending_.end(),
+            [](const Pending& a, const Pending& b) { return a.timestamp < b.timestamp; });
+        for (const auto& entry : pending_) {
+            fwrite(entry.text.data(), 1, entry.text.size(), stdout);
+#ifdef _WIN32
+            if (siteLevel(entry.site) >= NS_LOG_LEVEL_WARN) {
+                OutputDebugStringA(entry.text.c_str());
+            }
+#endif
+        }
+        fflush(stdout);
+    }
+
+    uint64_t droppedCount() const {
+        uint64_t total = 0;
+        rings_.forEach([&total](const LogRing& ring) {
+            total += ring.dropped.load(std::memory_order_relaxed);
+        });
+        return total;
+    }
+
+private:
+    struct Pending {
+        uint64_t timestamp;
+        uint32_t site;
+        std::string text;
+    };
+
+    ThreadShards<LogRing> rings_;
+    std::mutex sites_mutex_;
+    std::vector<LogSite*> sites_;
+    std::mutex drain_mutex_;
+    std::vector<Pending> pending_;
+    bool drain_started_ = false;
+
+    void startDrainThread() {
+        if (drain_started_) return;
+        drain_started_ = true;
+        // Detached on purpose: joining from static destruction inside the
+        // addon DLL can deadlock on the loader lock. LogFlush() covers
+        // orderly shutdown.
+        std::thread([this]() {
+            for (;;) {
+                std::this_thread::sleep_for(kDrainInterval);
+                drain();
+            }
+        }).detach();
+    }
+
+    LogSite* site(uint32_t id) {
+        std::lock_guard<std::mutex> lock(sites_mutex_);
+        return id < sites_.size() ? sites_[id] : nullptr;
+    }
+
+    int siteLevel(uint32_t id) {
+        LogSite* s = site(id);
+        return s ? s->level() : NS_LOG_LEVEL_INFO;
+    }
+
+    // printf-style formatting of one record: each conversion is rendered by
+    // snprintf with the matching decoded argument, so a type mismatch between
+    // format and argument degrades the text rather than the process
+    std::string format(uint32_t id, const uint8_t* args, size_t args_size) {
+        LogSite* s = site(id);
+        if (!s) return "(unknown log site)\n";
+
+        std::string out;
+        const uint8_t* arg = args;
+        const uint8_t* args_end = args + args_size;
+        const char* f = s->format();
+
+        while (*f) {
+            if (*f != '%') {
+                out.push_back(*f++);
+                continue;
+            }
+            if (f[1] == '%') {
+                out.push_back('%');
+                f += 2;
+                continue;
+            }
+
+            // Collect flags/width/precision, skip length modifiers
+            char spec[32];
+            size_t n = 0;
+            spec[n++] = *f++;
+            while (*f && strchr("-+ #0123456789.", *f) && n < sizeof(spec) - 5) spec[n++] = *f++;
+            while (*f && strchr("hlLzjtq", *f)) ++f;
+            char conversion = *f ? *f++ : 's';
+
+            char buffer[256];
+            buffer[0] = '\0';
+            if (arg >= args_end) {
+                out += "<?>";
+                continue;
+            }
+
+            ArgType type = static_cast<ArgType>(*arg++);
+            uint64_t bits = 0;
+            std::string str;
+            if (type == kArgString) {
+                uint16_t len;
+                memcpy(&len, arg, sizeof(len));
+                arg += sizeof(len);
+                str.assign(reinterpret_cast<const char*>(arg), len);
+                arg += len;
+            } else {
+                memcpy(&bits, arg, sizeof(bits));
+                arg += sizeof(bits);
+            }
+
+            double as_double;
+            memcpy(&as_double, &bits, sizeof(as_double));
+            long long as_signed = static_cast<long long>(bits);
+            if (type == kArgDouble) as_signed = static_cast<long long>(as_double);
+            else as_double = (type == kArgSigned) ? static_cast<double>(as_signed) : static_cast<double>(bits);
+
+            switch (conversion) {
+                case 'd': case 'i':
+                    memcpy(spec + n, "lld", 4);
+                    snprintf(buffer, sizeof(buffer), spec, as_signed);
+                    break;
+                case 'u': case 'x': case 'X': case 'o':
+                    spec[n] = 'l'; spec[n + 1] = 'l'; spec[n + 2] = conversion; spec[n + 3] = '\0';
+                    snprintf(buffer, sizeof(buffer), spec, static_cast<unsigned long long>(as_signed));
+                    break;
+                case 'c':
+                    spec[n] = 'c'; spec[n + 1] = '\0';
+                    snprintf(buffer, sizeof(buffer), spec, static_cast<int>(as_signed));
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                    spec[n] = conversion; spec[n + 1] = '\0';
+                    snprintf(buffer, sizeof(buffer), spec, as_double);
+                    break;
+                case 'p':
+                    snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(bits));
+                    break;
+                case 's':
+                default:
+                    spec[n] = 's'; spec[n + 1] = '\0';
+                    if (type == kArgString) {
+                        snprintf(buffer, sizeof(buffer), spec, str.c_str());
+                    } else {
+                        snprintf(buffer, sizeof(buffer), "%lld", as_signed);
+                    }
+                    break;
+            }
+            out += buffer;
+        }
+
+        uint32_t suppressed = s->takeSuppressed();
+        if (suppressed) {
+            out += "  (" + std::to_string(suppressed) + " similar messages suppressed)\n";
+        }
+        return out;
+    }
+};
+
+static Logger& GetLogger() {
+    // Intentionally leaked: the drain thread and writer threads may outlive
+    // static destruction
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+void Submit(uint32_t site, const uint8_t* record, size_t size) {
+    (void)site;
+    GetLogger().submit(record, size);
+}
+
+LogSite::LogSite(int level, const char* format, uint32_t per_second)
+    : level_(level), format_(format), per_second_(per_second) {
+    id_ = GetLogger().registerSite(this);
+}
+
+bool LogSite::allow() {
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t start = window_start_.load(std::memory_order_relaxed);
+
+    if (now - start >= 1000) {
+        // New one-second window; whoever wins the exchange resets the count
+        if (window_start_.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+            window_count_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    if (window_count_.fetch_add(1, std::memory_order_relaxed) < per_second_) {
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+} // namespace ringlog
+
+void LogFlush() {
+    ringlog::GetLogger().drain();
+}
+
+uint64_t LogDroppedCount() {
+    return ringlog::GetLogger().droppedCount();
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Asynchronous binary logger for hot paths
+//
+// A log call does no formatting and no I/O. It appends a compact binary record
+// (call-site id, timestamp, raw arguments) to a lock-free ring owned by the
+// calling thread, and a background thread drains every ring, formats the
+// records printf-style in timestamp order and writes them to stdout. When a
+// ring is full the record is dropped and counted rather than blocking.
+//
+//   NS_LOG_INFO("PoisoningWorker: Added target %s\n", ip);
+//   NS_LOG_RATE(NS_LOG_LEVEL_WARN, 1, "Send failed for %s\n", ip);  // <= 1/s
+//
+// Calls below NS_LOG_MIN_LEVEL compile to nothing (arguments are not
+// evaluated). Supported argument types: integers, enums, bool, floating
+// point, C strings, std::string (copied, truncated to 200 bytes) and
+// pointers.
+
+#define NS_LOG_LEVEL_DEBUG 0
+#define NS_LOG_LEVEL_INFO 1
+#define NS_LOG_LEVEL_WARN 2
+#define NS_LOG_LEVEL_ERROR 3
+
+#ifndef NS_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define NS_LOG_MIN_LEVEL NS_LOG_LEVEL_INFO
+#else
+#define NS_LOG_MIN_LEVEL NS_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define NS_LOG_RATE(level, per_second, fmt, ...)                                          \
+    do {                                                                                  \
+        if constexpr ((level) >= NS_LOG_MIN_LEVEL) {                                      \
+            static ringlog::LogSite ns_log_site_((level), (fmt), (per_second));          \
+            ns_log_site_.log(__VA_ARGS__);                                                \
+        }                                                                                 \
+    } while (0)
+
+#define NS_LOG(level, fmt, ...) NS_LOG_RATE(level, 0, fmt, ##__VA_ARGS__)
+#define NS_LOG_DEBUG(fmt, ...) NS_LOG(NS_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define NS_LOG_INFO(fmt, ...) NS_LOG(NS_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define NS_LOG_WARN(fmt, ...) NS_LOG(NS_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define NS_LOG_ERROR(fmt, ...) NS_LOG(NS_LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+// Drain and print everything logged so far (blocks until written)
+void LogFlush();
+
+// Records dropped because a ring was full, since startup
+uint64_t LogDroppedCount();
+
+namespace ringlog {
+
+enum ArgType : uint8_t {
+    kArgSigned = 1,
+    kArgUnsigned,
+    kArgDouble,
+    kArgString,
+    kArgPointer
+};
+
+const size_t kMaxRecordSize = 512;
+const size_t kMaxStringArg = 200;
+
+struct RecordHeader {
+    uint32_t size;        // whole record, padded to 8 bytes
+    uint32_t site;
+    uint64_t timestamp;   // steady clock, ns
+};
+
+// Encodes arguments into a fixed stack buffer; silently stops when full
+class ArgWriter {
+public:
+    ArgWriter(uint8_t* begin, uint8_t* end) : p_(begin), end_(end) {}
+
+    void putScalar(ArgType type, const void* value, size_t size) {
+        if (p_ + 1 + size > end_) return;
+        *p_++ = type;
+        memcpy(p_, value, size);
+        p_ += size;
+    }
+
+    void putString(const char* value, size_t len) {
+        if (!value) { value = "(null)"; len = 6; }
+        if (len > kMaxStringArg) len = kMaxStringArg;
+        if (p_ + 3 + len > end_) return;
+        *p_++ = kArgString;
+        uint16_t len16 = static_cast<uint16_t>(len);
+        memcpy(p_, &len16, sizeof(len16));
+        p_ += sizeof(len16);
+        memcpy(p_, value, len);
+        p_ += len;
+    }
+
+    uint8_t* position() const { return p_; }
+
+private:
+    uint8_t* p_;
+    uint8_t* end_;
+};
+
+template <typename T>
+inline void EncodeArg(ArgWriter& writer, const T& value) {
+    using D = typename std::decay<T>::type;
+    if constexpr (std::is_same<D, bool>::value) {
+        uint64_t v = value ? 1 : 0;
+        writer.putScalar(kArgUnsigned, &v, sizeof(v));
+    } else if constexpr (std::is_integral<D>::value && std::is_signed<D>::value) {
+        int64_t v = static_cast<int64_t>(value);
+        writer.putScalar(kArgSigned, &v, sizeof(v));
+    } else if constexpr (std::is_integral<D>::value || std::is_enum<D>::value) {
+        uint64_t v = static_cast<uint64_t>(value);
+        writer.putScalar(kArgUnsigned, &v, sizeof(v));
+    } else if constexpr (std::is_floating_point<D>::value) {
+        double v = static_cast<double>(value);
+        writer.putScalar(kArgDouble, &v, sizeof(v));
+    } else if constexpr (std::is_same<D, std::string>::value) {
+        writer.putString(value.data(), value.size());
+    } else if constexpr (std::is_same<D, const char*>::value || std::is_same<D, char*>::value) {
+        const char* s = value;
+        writer.putString(s, s ? strlen(s) : 0);
+    } else if constexpr (std::is_pointer<D>::value) {
+        uint64_t v = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+        writer.putScalar(kArgPointer, &v, sizeof(v));
+    } else {
+        static_assert(!sizeof(D), "unsupported log argument type");
+    }
+}
+
+// Append an encoded record to the calling thread's ring
+void Submit(uint32_t site, const uint8_t* record, size_t size);
+
+// One per log statement (function-local static): holds the format string
+// and rate-limit state so records carry only a 32-bit site id
+class LogSite {
+public:
+    LogSite(int level, const char* format, uint32_t per_second);
+
+    template <typename... Args>
+    void log(const Args&... args) {
+        if (per_second_ && !allow()) return;
+
+        alignas(8) uint8_t buffer[kMaxRecordSize];
+        ArgWriter writer(buffer + sizeof(RecordHeader), buffer + sizeof(buffer));
+        (EncodeArg(writer, args), ...);
+
+        RecordHeader header;
+        header.size = static_cast<uint32_t>(writer.position() - buffer);
+        header.site = id_;
+        header.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        memcpy(buffer, &header, sizeof(header));
+        Submit(id_, buffer, header.size);
+    }
+
+    int level() const { return level_; }
+    const char* format() const { return format_; }
+    uint32_t takeSuppressed() { return suppressed_.exchange(0, std::memory_order_relaxed); }
+
+private:
+    int level_;
+    const char* format_;
+    uint32_t per_second_;
+    uint32_t id_;
+    std::atomic<int64_t> window_start_{0};   // ms
+    std::atomic<uint32_t> window_count_{0};
+    std::atomic<uint32_t> suppressed_{0};
+
+    bool allow();
+};
+
+} // namespace ringlog
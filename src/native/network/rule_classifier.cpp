@@ -0,0 +1,306 @@
+#include "rule_classifier.h"
+#include "device_table.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static inline uint64_t HashKey(uint64_t mac_protocol, uint32_t ports) {
+    uint64_t h = mac_protocol * 0x9E3779B97F4A7C15ULL ^ (static_cast<uint64_t>(ports) * 0xC2B2AE3D27D4EB4FULL);
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint32_t PrefixMask(int bits) {
+    return bits ? (0xFFFFu << (16 - bits)) & 0xFFFFu : 0;
+}
+
+// Split [lo, hi] into aligned prefixes whose lengths are multiples of
+// kPrefixStride. Arbitrary lengths would need fewer entries, but every
+// (local, remote) length pair is its own tuple; with the stride there are
+// at most 5 x 5 port tuples per MAC/protocol mask.
+static const int kPrefixStride = 4;
+
+static void RangeToPrefixes(uint32_t lo, uint32_t hi, std::vector<std::pair<uint16_t, uint8_t>>& out) {
+    out.clear();
+    while (lo <= hi) {
+        int bits = 16;
+        while (bits > 0) {
+            int shorter = bits - kPrefixStride;
+            uint32_t size = 1u << (16 - shorter);
+            if ((lo & (size - 1)) != 0 || lo + size - 1 > hi) break;
+            bits = shorter;
+        }
+        out.emplace_back(static_cast<uint16_t>(lo), static_cast<uint8_t>(bits));
+        lo += 1u << (16 - bits);
+    }
+}
+
+const char* RuleActionName(RuleAction action) {
+    switch (action) {
+        case kRuleLimit: return "limit";
+        case kRulePrioritize: return "prioritize";
+        case kRuleBlock: return "block";
+        default: return "unknown";
+    }
+}
+
+void InitShapingRule(ShapingRule& rule) {
+    memset(&rule, 0, sizeof(rule));
+    rule.local_port_max = 0xFFFF;
+    rule.remote_port_max = 0xFFFF;
+    rule.action = kRuleLimit;
+}
+
+static bool ParsePortRange(const std::string& text, uint16_t& lo, uint16_t& hi) {
+    if (text == "any") {
+        lo = 0;
+        hi = 0xFFFF;
+        return true;
+    }
+    char* end = nullptr;
+    long first = strtol(text.c_str(), &end, 10);
+    long last = first;
+    if (end == text.c_str()) return false;
+    if (*end == '-') {
+        const char* start = end + 1;
+        last = strtol(start, &end, 10);
+        if (end == start) return false;
+    }
+    if (*end != '\0' || first < 0 || last > 0xFFFF || first > last) return false;
+    lo = static_cast<uint16_t>(first);
+    hi = static_cast<uint16_t>(last);
+    return true;
+}
+
+bool ParseShapingRule(const std::string& text, ShapingRule& rule, std::string& error) {
+    InitShapingRule(rule);
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) comma = text.size();
+        std::string field = text.substr(start, comma - start);
+        start = comma + 1;
+        if (field.empty()) continue;
+
+        size_t eq = field.find('=');
+        std::string key = field.substr(0, eq);
+        std::string value = eq == std::string::npos ? std::string() : field.substr(eq + 1);
+        char* end = nullptr;
+        bool ok = true;
+
+        if (key == "id") {
+            rule.id = static_cast<uint32_t>(strtoul(value.c_str(), &end, 10));
+            ok = !value.empty() && *end == '\0';
+        } else if (key == "mac") {
+            ok = ParseMac(value, rule.mac);
+            rule.match_mac = ok;
+        } else if (key == "proto") {
+            if (value == "tcp") {
+                rule.protocol = 6;
+            } else if (value == "udp") {
+                rule.protocol = 17;
+            } else if (value == "icmp") {
+                rule.protocol = 1;
+            } else if (value == "any") {
+                rule.protocol = 0;
+            } else {
+                long protocol = strtol(value.c_str(), &end, 10);
+                ok = !value.empty() && *end == '\0' && protocol >= 0 && protocol <= 255;
+                rule.protocol = static_cast<uint8_t>(protocol);
+            }
+        } else if (key == "lport") {
+            ok = ParsePortRange(value, rule.local_port_min, rule.local_port_max);
+        } else if (key == "rport") {
+            ok = ParsePortRange(value, rule.remote_port_min, rule.remote_port_max);
+        } else if (key == "priority") {
+            rule.priority = static_cast<int32_t>(strtol(value.c_str(), &end, 10));
+            ok = !value.empty() && *end == '\0';
+        } else if (key == "limit") {
+            rule.action = kRuleLimit;
+            size_t slash = value.find('/');
+            rule.download_mbps = strtod(value.c_str(), &end);
+            ok = slash != std::string::npos && end == value.c_str() + slash;
+            if (ok) {
+                rule.upload_mbps = strtod(value.c_str() + slash + 1, &end);
+                ok = *end == '\0' && rule.download_mbps >= 0 && rule.upload_mbps >= 0;
+            }
+        } else if (key == "prioritize" && value.empty()) {
+            rule.action = kRulePrioritize;
+        } else if (key == "block" && value.empty()) {
+            rule.action = kRuleBlock;
+        } else if (key == "dscp" || key == "pcp" || key == "vlan") {
+            unsigned long number = strtoul(value.c_str(), &end, 10);
+            ok = !value.empty() && *end == '\0' && number <= (key == "dscp" ? 63 : key == "pcp" ? 7 : 4094);
+            if (key == "dscp") {
+                rule.mark.flags |= kMarkDscp;
+                rule.mark.dscp = static_cast<uint8_t>(number);
+            } else if (key == "pcp") {
+                rule.mark.flags |= kMarkVlanPriority;
+                rule.mark.pcp = static_cast<uint8_t>(number);
+            } else {
+                rule.mark.vlan_id = static_cast<uint16_t>(number);
+            }
+        } else {
+            error = "Unknown rule field '" + field + "'";
+            return false;
+        }
+
+        if (!ok) {
+            error = "Invalid rule field '" + field + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t RuleClassifier::Tuple::find(const Key& key) const {
+    for (uint64_t i = HashKey(key.mac_protocol, key.ports) & slot_mask;; i = (i + 1) & slot_mask) {
+        const Slot& slot = slots[i];
+        if (slot.rule == kNoRule) return kNoRule;
+        if (slot.key.mac_protocol == key.mac_protocol && slot.key.ports == key.ports) return slot.rule;
+    }
+}
+
+// Keep the better (lower) rule when two rules produce the same entry
+void RuleClassifier::Tuple::insert(const Key& key, uint32_t rule) {
+    for (uint64_t i = HashKey(key.mac_protocol, key.ports) & slot_mask;; i = (i + 1) & slot_mask) {
+        Slot& slot = slots[i];
+        if (slot.rule == kNoRule) {
+            slot.key = key;
+            slot.rule = rule;
+            return;
+        }
+        if (slot.key.mac_protocol == key.mac_protocol && slot.key.ports == key.ports) {
+            slot.rule = std::min(slot.rule, rule);
+            return;
+        }
+    }
+}
+
+RuleClassifier::RuleClassifier() : entry_count_(0) {}
+
+bool RuleClassifier::compile(const std::vector<ShapingRule>& rules) {
+    for (const ShapingRule& rule : rules) {
+        if (rule.local_port_min > rule.local_port_max || rule.remote_port_min > rule.remote_port_max) {
+            setError("Rule " + std::to_string(rule.id) + " has an empty port range");
+            return false;
+        }
+        if (rule.action == kRuleLimit && (rule.download_mbps < 0 || rule.upload_mbps < 0)) {
+            setError("Rule " + std::to_string(rule.id) + " has a negative limit");
+            return false;
+        }
+        if (!IsValidPriorityMark(rule.mark)) {
+            setError("Rule " + std::to_string(rule.id) + " has an invalid priority mark");
+            return false;
+        }
+    }
+
+    // Evaluation order: priority, then position; the index in this order is
+    // what the tables store, so a lower index is always the better rule
+    std::vector<ShapingRule> ordered(rules);
+    std::stable_sort(ordered.begin(), ordered.end(), [](const ShapingRule& a, const ShapingRule& b) {
+        return a.priority > b.priority;
+    });
+
+    // Expand ranges and group the entries by mask
+    struct Entry {
+        Key key;
+        uint32_t rule;
+    };
+    struct Group {
+        Tuple tuple;
+        std::vector<Entry> entries;
+    };
+    std::vector<Group> groups;
+    std::vector<std::pair<uint16_t, uint8_t>> local_prefixes, remote_prefixes;
+    size_t total = 0;
+
+    for (uint32_t index = 0; index < ordered.size(); ++index) {
+        const ShapingRule& rule = ordered[index];
+        RangeToPrefixes(rule.local_port_min, rule.local_port_max, local_prefixes);
+        RangeToPrefixes(rule.remote_port_min, rule.remote_port_max, remote_prefixes);
+        total += local_prefixes.size() * remote_prefixes.size();
+        if (total > kMaxEntries) {
+            setError("Rule set expands to more than " + std::to_string(kMaxEntries) + " entries");
+            return false;
+        }
+
+        uint64_t mac_protocol = (rule.match_mac ? MacKey(rule.mac) << 8 : 0) | rule.protocol;
+        for (const auto& local : local_prefixes) {
+            for (const auto& remote : remote_prefixes) {
+                Group* group = nullptr;
+                for (Group& candidate : groups) {
+                    const Tuple& t = candidate.tuple;
+                    if (t.match_mac == rule.match_mac && t.match_protocol == (rule.protocol != 0) &&
+                        t.local_prefix == local.second && t.remote_prefix == remote.second) {
+                        group = &candidate;
+                        break;
+                    }
+                }
+                if (!group) {
+                    groups.emplace_back();
+                    group = &groups.back();
+                    Tuple& t = group->tuple;
+                    t.match_mac = rule.match_mac;
+                    t.match_protocol = rule.protocol != 0;
+                    t.local_prefix = local.second;
+                    t.remote_prefix = remote.second;
+                    t.ports_mask = (PrefixMask(local.second) << 16) | PrefixMask(remote.second);
+                    t.best_rule = index;
+                    t.slot_mask = 0;
+                }
+                Key key;
+                key.mac_protocol = mac_protocol;
+                key.ports = (static_cast<uint32_t>(local.first) << 16) | remote.first;
+                group->entries.push_back({ key, index });
+            }
+        }
+    }
+
+    // Build each tuple's table at <= 50% load
+    std::vector<Tuple> tuples;
+    tuples.reserve(groups.size());
+    for (Group& group : groups) {
+        Tuple& tuple = group.tuple;
+        size_t slots = 2;
+        while (slots < group.entries.size() * 2) slots <<= 1;
+        tuple.slot_mask = slots - 1;
+        Slot empty;
+        empty.key.mac_protocol = 0;
+        empty.key.ports = 0;
+        empty.rule = kNoRule;
+        tuple.slots.assign(slots, empty);
+        for (const Entry& entry : group.entries) tuple.insert(entry.key, entry.rule);
+        tuples.push_back(std::move(tuple));
+    }
+    std::sort(tuples.begin(), tuples.end(), [](const Tuple& a, const Tuple& b) {
+        return a.best_rule < b.best_rule;
+    });
+
+    rules_.swap(ordered);
+    tuples_.swap(tuples);
+    entry_count_ = total;
+    last_error_.clear();
+    return true;
+}
+
+uint32_t RuleClassifier::classify(const RuleMatchFields& fields) const {
+    const uint64_t with_mac = (fields.mac << 8) | fields.protocol;
+    const uint32_t ports = (static_cast<uint32_t>(fields.local_port) << 16) | fields.remote_port;
+    uint32_t best = kNoRule;
+
+    for (const Tuple& tuple : tuples_) {
+        // Tuples are sorted by their best rule: nothing further can win
+        if (tuple.best_rule >= best) break;
+
+        Key key;
+        key.mac_protocol = tuple.match_mac ? with_mac : fields.protocol;
+        if (!tuple.match_protocol) key.mac_protocol &= ~0xFFULL;
+        key.ports = ports & tuple.ports_mask;
+        uint32_t rule = tuple.find(key);
+        if (rule < best) best = rule;
+    }
+    return best;
+}
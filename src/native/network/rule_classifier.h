@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "priority_mark.h"
+
+// What a matching shaping rule does with a packet
+enum RuleAction : uint8_t {
+    kRuleLimit = 0,     // police with the rule's own rates, then the device's
+    kRulePrioritize,    // exempt from the device's limits
+    kRuleBlock
+};
+
+const char* RuleActionName(RuleAction action);
+
+// Port/protocol shaping rule. Ports are as seen from the managed device:
+// local is the device's port, remote the peer's. An empty range
+// (0..65535) and protocol 0 match anything.
+struct ShapingRule {
+    uint32_t id;
+    int32_t priority;           // higher wins; ties go to the earlier rule
+    bool match_mac;
+    uint8_t mac[6];
+    uint8_t protocol;           // IP protocol number, 0 = any
+    uint16_t local_port_min;
+    uint16_t local_port_max;
+    uint16_t remote_port_min;
+    uint16_t remote_port_max;
+    RuleAction action;
+    double download_mbps;       // kRuleLimit only, 0 = unlimited
+    double upload_mbps;
+    PriorityMark mark;          // for the matched upstream traffic, over the device's
+};
+
+// Fill rule with match-anything defaults
+void InitShapingRule(ShapingRule& rule);
+
+// Parse "key=value,..." rule text, e.g.
+//   "mac=aa:bb:cc:dd:ee:ff,proto=udp,rport=3478-3497,limit=2/1"
+//   "proto=tcp,lport=22,prioritize,priority=10"
+//   "proto=udp,rport=10000-20000,prioritize,dscp=46,pcp=5"
+// Keys: id, mac, proto (tcp|udp|icmp|number), lport, rport (N or N-M),
+// priority, limit=DOWN/UP (Mbps), prioritize, block, dscp (0-63), pcp
+// (0-7), vlan (ID of added tags, with pcp).
+bool ParseShapingRule(const std::string& text, ShapingRule& rule, std::string& error);
+
+// Packet fields a rule can match on
+struct RuleMatchFields {
+    uint64_t mac;               // MacKey() of the managed device (device_table.h)
+    uint8_t protocol;
+    uint16_t local_port;
+    uint16_t remote_port;
+};
+
+// Tuple-space search over shaping rules
+//
+// Port ranges are expanded into prefixes, so every rule becomes a set of
+// exact-match entries under a mask of (MAC: all/none, protocol: all/none,
+// local port prefix length, remote port prefix length). Entries with the
+// same mask share one hash table (a "tuple"); a lookup masks the packet
+// fields once per tuple and probes its table. Tuples are visited in order
+// of their best rule, and the search stops as soon as no remaining tuple
+// can hold a better rule than the one already found, so high-priority
+// rules cost one probe no matter how many rules follow them.
+//
+// compile() replaces the rule set; classify() is const and may run
+// concurrently with other classify() calls, but not with compile().
+class RuleClassifier {
+public:
+    static const uint32_t kNoRule = 0xFFFFFFFF;
+    static const size_t kMaxEntries = 1 << 20;   // after range expansion
+
+    RuleClassifier();
+
+    bool compile(const std::vector<ShapingRule>& rules);
+
+    // Index into rules() of the best matching rule, or kNoRule
+    uint32_t classify(const RuleMatchFields& fields) const;
+
+    // Rules in evaluation order (priority, then original order)
+    const std::vector<ShapingRule>& rules() const { return rules_; }
+    bool empty() const { return rules_.empty(); }
+    size_t tupleCount() const { return tuples_.size(); }
+    size_t entryCount() const { return entry_count_; }
+    const std::string& lastError() const { return last_error_; }
+
+private:
+    struct Key {
+        uint64_t mac_protocol;   // mac << 8 | protocol
+        uint32_t ports;          // local << 16 | remote
+    };
+
+    struct Slot {
+        Key key;
+        uint32_t rule;           // kNoRule = empty
+    };
+
+    struct Tuple {
+        bool match_mac;
+        bool match_protocol;
+        uint8_t local_prefix;    // 0..16 bits
+        uint8_t remote_prefix;
+        uint32_t ports_mask;
+        uint32_t best_rule;      // lowest rule index stored
+        uint64_t slot_mask;
+        std::vector<Slot> slots; // open addressing, linear probing
+
+        uint32_t find(const Key& key) const;
+        void insert(const Key& key, uint32_t rule);
+    };
+
+    std::vector<ShapingRule> rules_;
+    std::vector<Tuple> tuples_;
+    size_t entry_count_;
+    std::string last_error_;
+
+    void setError(const std::string& error) { last_error_ = error; }
+};
@@ -0,0 +1,544 @@
+#include "simulated_network.h"
+#include "arp_frame.h"
+#include "data_plane.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static const uint32_t kFirstDeviceHost = 10;           // devices start at .0.10
+static const uint32_t kMaxDevices = 65000;
+static const uint8_t kDeviceOui[3] = { 0x02, 0x53, 0x00 };
+static const uint8_t kGatewayMac[6] = { 0x02, 0x53, 0xff, 0xff, 0xff, 0x01 };
+static const uint8_t kOurMac[6] = { 0x02, 0x53, 0xff, 0xff, 0xff, 0x02 };
+static const uint8_t kBroadcastMac[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+static const uint8_t kMdnsMac[6] = { 0x01, 0x00, 0x5e, 0x00, 0x00, 0xfb };
+static const uint8_t kMdnsIp[4] = { 224, 0, 0, 251 };
+static const uint8_t kAnyIp[4] = { 0, 0, 0, 0 };
+static const uint8_t kBroadcastIp[4] = { 255, 255, 255, 255 };
+static const size_t kTrafficFrameSize = 1514;
+static const size_t kEthernetHeaderSize = 14;
+static const size_t kIpv4HeaderSize = 20;
+static const size_t kUdpHeaderSize = 8;
+
+// Deterministic per-device randomness: splitmix64 over (seed, device, salt)
+static uint64_t Mix(uint64_t seed, uint64_t device, uint64_t salt) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ULL + device * 0xBF58476D1CE4E5B9ULL + salt;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static double Unit(uint64_t seed, uint64_t device, uint64_t salt) {
+    return static_cast<double>(Mix(seed, device, salt) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void KeyToMac(uint64_t key, uint8_t* mac) {
+    for (int i = 5; i >= 0; --i) {
+        mac[i] = static_cast<uint8_t>(key & 0xFF);
+        key >>= 8;
+    }
+}
+
+static inline uint16_t ReadBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static inline void WriteBe16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+static inline void WriteBe32(uint8_t* p, uint32_t value) {
+    WriteBe16(p, static_cast<uint16_t>(value >> 16));
+    WriteBe16(p + 2, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+static void WriteEthernet(uint8_t* p, const uint8_t* dst, const uint8_t* src, uint16_t ethertype) {
+    memcpy(p, dst, 6);
+    memcpy(p + 6, src, 6);
+    WriteBe16(p + 12, ethertype);
+}
+
+// IPv4 header without options, checksum filled in
+static void WriteIpv4(uint8_t* p, size_t total_length, uint8_t ttl, uint8_t protocol,
+                      const uint8_t* src, const uint8_t* dst) {
+    p[0] = 0x45;
+    p[1] = 0;
+    WriteBe16(p + 2, static_cast<uint16_t>(total_length));
+    WriteBe16(p + 4, 0);
+    WriteBe16(p + 6, 0x4000);   // DF
+    p[8] = ttl;
+    p[9] = protocol;
+    WriteBe16(p + 10, 0);
+    memcpy(p + 12, src, 4);
+    memcpy(p + 16, dst, 4);
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < kIpv4HeaderSize; i += 2) sum += ReadBe16(p + i);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    WriteBe16(p + 10, static_cast<uint16_t>(~sum & 0xFFFF));
+}
+
+// UDP header; checksum left at zero (optional for IPv4)
+static void WriteUdp(uint8_t* p, uint16_t src_port, uint16_t dst_port, size_t length) {
+    WriteBe16(p, src_port);
+    WriteBe16(p + 2, dst_port);
+    WriteBe16(p + 4, static_cast<uint16_t>(length));
+    WriteBe16(p + 6, 0);
+}
+
+// Wrap a UDP payload already written at p + 42 in Ethernet/IPv4/UDP headers
+static size_t FinishUdp(uint8_t* p, size_t payload_length, const uint8_t* dst_mac, const uint8_t* src_mac,
+                        const uint8_t* src_ip, const uint8_t* dst_ip, uint8_t ttl,
+                        uint16_t src_port, uint16_t dst_port) {
+    size_t udp_length = kUdpHeaderSize + payload_length;
+    WriteEthernet(p, dst_mac, src_mac, 0x0800);
+    WriteIpv4(p + kEthernetHeaderSize, kIpv4HeaderSize + udp_length, ttl, 17, src_ip, dst_ip);
+    WriteUdp(p + kEthernetHeaderSize + kIpv4HeaderSize, src_port, dst_port, udp_length);
+    return kEthernetHeaderSize + kIpv4HeaderSize + udp_length;
+}
+
+SimulatedNetwork::SimulatedNetwork(const Config& config, const Clock& clock)
+    : config_(config), clock_(clock), sequence_(0) {
+    config_.device_count = std::min(config_.device_count, kMaxDevices);
+    memcpy(our_mac_, kOurMac, 6);
+    memcpy(gateway_mac_, kGatewayMac, 6);
+    memcpy(gateway_ip_, config_.network, 4);
+    gateway_ip_[2] = 0;
+    gateway_ip_[3] = 1;
+    memcpy(our_ip_, gateway_ip_, 4);
+    our_ip_[3] = 2;
+    our_key_ = MacKey(our_mac_);
+    gateway_key_ = MacKey(gateway_mac_);
+    traffic_interval_ns_ = config_.traffic_mbps > 0
+        ? static_cast<uint64_t>(kTrafficFrameSize * 8 * 1000.0 / config_.traffic_mbps)
+        : 0;
+    memset(&stats_, 0, sizeof(stats_));
+
+    // Every cache starts out correct, with ages spread over the timeout so
+    // expiries do not all land at once
+    uint64_t now = clock_.nowNs();
+    uint64_t timeout = config_.arp_cache_timeout_ns;
+    devices_.resize(config_.device_count);
+    for (uint32_t i = 0; i < config_.device_count; ++i) {
+        Device& device = devices_[i];
+        memset(&device, 0, sizeof(device));
+        device.responds = Unit(config_.seed, i, 1) < config_.response_rate;
+        device.reply_delay_ns = config_.arp_reply_delay_ns +
+            static_cast<uint64_t>(Unit(config_.seed, i, 2) * static_cast<double>(config_.arp_reply_delay_ns));
+
+        if (timeout > 0) {
+            uint64_t age = static_cast<uint64_t>(Unit(config_.seed, i, 3) * static_cast<double>(timeout));
+            device.gateway_entry = CacheEntry{ gateway_key_, now - std::min(age, now), true };
+            schedule(device.gateway_entry.learned_ns + timeout, i, kEventDeviceExpiry);
+            age = static_cast<uint64_t>(Unit(config_.seed, i, 4) * static_cast<double>(timeout));
+            device.gateway_view = CacheEntry{ deviceKey(i), now - std::min(age, now), true };
+            schedule(device.gateway_view.learned_ns + timeout, i, kEventGatewayExpiry);
+        } else {
+            device.gateway_entry = CacheEntry{ gateway_key_, now, false };
+            device.gateway_view = CacheEntry{ deviceKey(i), now, false };
+        }
+
+        if (config_.dhcp_interval_ns > 0) {
+            schedule(now + static_cast<uint64_t>(Unit(config_.seed, i, 5) * static_cast<double>(config_.dhcp_interval_ns)),
+                     i, kEventDhcp);
+        }
+        if (config_.mdns_interval_ns > 0) {
+            schedule(now + static_cast<uint64_t>(Unit(config_.seed, i, 6) * static_cast<double>(config_.mdns_interval_ns)),
+                     i, kEventMdns);
+        }
+        if (traffic_interval_ns_ > 0) {
+            schedule(now + static_cast<uint64_t>(Unit(config_.seed, i, 7) * static_cast<double>(traffic_interval_ns_)),
+                     i, kEventTrafficUp);
+            schedule(now + static_cast<uint64_t>(Unit(config_.seed, i, 8) * static_cast<double>(traffic_interval_ns_)),
+                     i, kEventTrafficDown);
+        }
+    }
+}
+
+uint64_t SimulatedNetwork::deviceKey(uint32_t index) const {
+    return (static_cast<uint64_t>(kDeviceOui[0]) << 40) | (static_cast<uint64_t>(kDeviceOui[1]) << 32) |
+           (static_cast<uint64_t>(kDeviceOui[2]) << 24) | index;
+}
+
+bool SimulatedNetwork::deviceIndexForKey(uint64_t mac_key, uint32_t& index) const {
+    if ((mac_key >> 24) != (deviceKey(0) >> 24)) return false;
+    index = static_cast<uint32_t>(mac_key & 0xFFFFFF);
+    return index < config_.device_count;
+}
+
+bool SimulatedNetwork::deviceIndexForIp(const uint8_t* ip, uint32_t& index) const {
+    if (ip[0] != config_.network[0] || ip[1] != config_.network[1]) return false;
+    uint32_t host = (static_cast<uint32_t>(ip[2]) << 8) | ip[3];
+    if (host < kFirstDeviceHost) return false;
+    index = host - kFirstDeviceHost;
+    return index < config_.device_count;
+}
+
+void SimulatedNetwork::deviceMac(uint32_t index, uint8_t* mac) const {
+    KeyToMac(deviceKey(index), mac);
+}
+
+void SimulatedNetwork::deviceIp(uint32_t index, uint8_t* ip) const {
+    uint32_t host = kFirstDeviceHost + index;
+    ip[0] = config_.network[0];
+    ip[1] = config_.network[1];
+    ip[2] = static_cast<uint8_t>(host >> 8);
+    ip[3] = static_cast<uint8_t>(host & 0xFF);
+}
+
+void SimulatedNetwork::schedule(uint64_t time_ns, uint32_t device, EventKind kind) {
+    events_.push(Event{ time_ns, sequence_++, device, kind });
+}
+
+void SimulatedNetwork::enqueueRx(uint64_t time_ns, uint32_t device, RxKind kind) {
+    if (rx_queue_.size() >= config_.rx_queue_limit) {
+        ++stats_.rx_dropped;
+        return;
+    }
+    rx_queue_.push_back(RxFrame{ time_ns, device, kind });
+}
+
+void SimulatedNetwork::learn(CacheEntry& entry, uint64_t mac_key, uint64_t real_key, uint32_t device,
+                             EventKind expiry_kind, uint64_t now_ns) {
+    if (mac_key == our_key_ && entry.mac_key != our_key_) {
+        ++stats_.poison_updates;
+    } else if (mac_key == real_key && entry.mac_key != real_key) {
+        ++stats_.restore_updates;
+    }
+    entry.mac_key = mac_key;
+    entry.learned_ns = now_ns;
+
+    // One pending expiry per entry; it re-arms itself if the entry was
+    // refreshed in the meantime
+    if (config_.arp_cache_timeout_ns > 0 && !entry.expiry_pending) {
+        entry.expiry_pending = true;
+        schedule(now_ns + config_.arp_cache_timeout_ns, device, expiry_kind);
+    }
+}
+
+void SimulatedNetwork::runEvents(uint64_t now_ns) {
+    while (!events_.empty() && events_.top().time_ns <= now_ns) {
+        Event event = events_.top();
+        events_.pop();
+        handleEvent(event);
+    }
+}
+
+void SimulatedNetwork::handleEvent(const Event& event) {
+    uint64_t now = event.time_ns;
+
+    switch (event.kind) {
+        case kEventDeviceArpReply:
+            ++stats_.arp_replies;
+            enqueueRx(now, event.device, kRxDeviceArpReply);
+            break;
+
+        case kEventGatewayArpReply:
+            ++stats_.arp_replies;
+            enqueueRx(now, event.device, kRxGatewayArpReply);
+            break;
+
+        case kEventDeviceExpiry:
+        case kEventGatewayExpiry: {
+            bool device_side = event.kind == kEventDeviceExpiry;
+            Device& device = devices_[event.device];
+            CacheEntry& entry = device_side ? device.gateway_entry : device.gateway_view;
+            uint64_t expires = entry.learned_ns + config_.arp_cache_timeout_ns;
+            if (expires > now) {
+                schedule(expires, event.device, event.kind);
+                break;
+            }
+
+            // Aged out: the host broadcasts a request and the real owner
+            // answers, which undoes poisoning that was not refreshed in time
+            ++stats_.cache_expiries;
+            if (entry.mac_key == our_key_) ++stats_.poison_lapses;
+            enqueueRx(now, event.device, device_side ? kRxDeviceArpRequest : kRxGatewayArpRequest);
+            uint64_t real_key = device_side ? gateway_key_ : deviceKey(event.device);
+            if (entry.mac_key != real_key) ++stats_.restore_updates;
+            entry.mac_key = real_key;
+            entry.learned_ns = now;
+            schedule(now + config_.arp_cache_timeout_ns, event.device, event.kind);
+            break;
+        }
+
+        case kEventDhcp:
+            ++stats_.chatter_frames;
+            enqueueRx(now, event.device, kRxDhcp);
+            schedule(now + config_.dhcp_interval_ns, event.device, kEventDhcp);
+            break;
+
+        case kEventMdns:
+            ++stats_.chatter_frames;
+            enqueueRx(now, event.device, kRxMdns);
+            schedule(now + config_.mdns_interval_ns, event.device, kEventMdns);
+            break;
+
+        case kEventTrafficUp:
+        case kEventTrafficDown: {
+            // Sent to whatever MAC the sender currently has cached; on a
+            // switched LAN we only see it if that MAC is ours
+            bool up = event.kind == kEventTrafficUp;
+            const Device& device = devices_[event.device];
+            const CacheEntry& entry = up ? device.gateway_entry : device.gateway_view;
+            ++stats_.traffic_generated;
+            if (entry.mac_key == our_key_) {
+                ++stats_.traffic_intercepted;
+                enqueueRx(now, event.device, up ? kRxTrafficUp : kRxTrafficDown);
+            }
+            schedule(now + traffic_interval_ns_, event.device, event.kind);
+            break;
+        }
+    }
+}
+
+void SimulatedNetwork::handleArp(const uint8_t* frame, size_t length, uint64_t now_ns) {
+    if (length < sizeof(ArpFrame)) {
+        ++stats_.frames_unroutable;
+        return;
+    }
+    const ArpPacket* arp = reinterpret_cast<const ArpPacket*>(frame + sizeof(EthernetHeader));
+    uint16_t operation = ReadBe16(frame + 20);
+    uint32_t index = 0;
+
+    if (operation == 1) {
+        ++stats_.arp_requests;
+        if (memcmp(arp->target_ip, gateway_ip_, 4) == 0) {
+            schedule(now_ns + config_.arp_reply_delay_ns, 0, kEventGatewayArpReply);
+        } else if (deviceIndexForIp(arp->target_ip, index) && devices_[index].responds) {
+            schedule(now_ns + devices_[index].reply_delay_ns, index, kEventDeviceArpReply);
+        }
+        return;
+    }
+    if (operation != 2) {
+        ++stats_.frames_unroutable;
+        return;
+    }
+
+    // Replies update the cache of the host they are addressed to
+    uint64_t dst_key = MacKey(frame);
+    uint64_t sender_key = MacKey(arp->sender_mac);
+    if (deviceIndexForKey(dst_key, index)) {
+        if (memcmp(arp->sender_ip, gateway_ip_, 4) == 0) {
+            learn(devices_[index].gateway_entry, sender_key, gateway_key_, index, kEventDeviceExpiry, now_ns);
+        }
+    } else if (dst_key == gateway_key_) {
+        if (deviceIndexForIp(arp->sender_ip, index)) {
+            learn(devices_[index].gateway_view, sender_key, deviceKey(index), index, kEventGatewayExpiry, now_ns);
+        }
+    } else {
+        ++stats_.frames_unroutable;
+    }
+}
+
+void SimulatedNetwork::handleIpv4(const uint8_t* frame, size_t length) {
+    uint32_t index = 0;
+    uint64_t dst_key = MacKey(frame);
+    if (deviceIndexForKey(dst_key, index)) {
+        devices_[index].delivered_bytes[kTrafficDown] += length;
+    } else if (dst_key == gateway_key_ && length >= kEthernetHeaderSize + kIpv4HeaderSize &&
+               deviceIndexForIp(frame + kEthernetHeaderSize + 12, index)) {
+        devices_[index].delivered_bytes[kTrafficUp] += length;
+    } else {
+        ++stats_.frames_unroutable;
+        return;
+    }
+    ++stats_.frames_delivered;
+    stats_.bytes_delivered += length;
+}
+
+bool SimulatedNetwork::send(const uint8_t* frame, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (length < kEthernetHeaderSize) {
+        last_error_ = "Frame shorter than an Ethernet header";
+        return false;
+    }
+
+    uint64_t now = clock_.nowNs();
+    runEvents(now);
+
+    uint16_t ethertype = ReadBe16(frame + 12);
+    if (ethertype == 0x0806) {
+        handleArp(frame, length, now);
+    } else if (ethertype == 0x0800) {
+        handleIpv4(frame, length);
+    } else {
+        ++stats_.frames_unroutable;
+    }
+    return true;
+}
+
+size_t SimulatedNetwork::receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    runEvents(clock_.nowNs());
+    if (rx_queue_.empty()) return 0;
+
+    RxFrame rx = rx_queue_.front();
+    rx_queue_.pop_front();
+    timestamp_ns = rx.time_ns;
+    return render(rx, buffer, capacity);
+}
+
+std::string SimulatedNetwork::lastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_error_;
+}
+
+void SimulatedNetwork::poll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    runEvents(clock_.nowNs());
+}
+
+size_t SimulatedNetwork::render(const RxFrame& rx, uint8_t* buffer, size_t capacity) const {
+    uint8_t frame[kTrafficFrameSize];
+    size_t length = 0;
+    uint8_t mac[6];
+    uint8_t ip[4];
+    deviceMac(rx.device, mac);
+    deviceIp(rx.device, ip);
+    ArpFrame& arp = *reinterpret_cast<ArpFrame*>(frame);
+
+    switch (rx.kind) {
+        case kRxDeviceArpReply:
+            BuildArpReply(arp, mac, ip, our_mac_, our_ip_);
+            length = sizeof(ArpFrame);
+            break;
+
+        case kRxGatewayArpReply:
+            BuildArpReply(arp, gateway_mac_, gateway_ip_, our_mac_, our_ip_);
+            length = sizeof(ArpFrame);
+            break;
+
+        case kRxDeviceArpRequest:
+            BuildArpRequest(arp, mac, ip, gateway_ip_);
+            length = sizeof(ArpFrame);
+            break;
+
+        case kRxGatewayArpRequest:
+            BuildArpRequest(arp, gateway_mac_, gateway_ip_, ip);
+            length = sizeof(ArpFrame);
+            break;
+
+        case kRxDhcp: {
+            // BOOTREQUEST carrying DHCPREQUEST, requested address and host name
+            uint8_t* bootp = frame + kEthernetHeaderSize + kIpv4HeaderSize + kUdpHeaderSize;
+            memset(bootp, 0, 236);
+            bootp[0] = 1;                   // op: request
+            bootp[1] = 1;                   // htype: Ethernet
+            bootp[2] = 6;                   // hlen
+            WriteBe32(bootp + 4, static_cast<uint32_t>(Mix(config_.seed, rx.device, rx.time_ns)));
+            WriteBe16(bootp + 10, 0x8000);  // broadcast flag
+            memcpy(bootp + 28, mac, 6);
+            uint8_t* options = bootp + 236;
+            const uint8_t cookie[4] = { 0x63, 0x82, 0x53, 0x63 };
+            memcpy(options, cookie, 4);
+            size_t o = 4;
+            options[o++] = 53; options[o++] = 1; options[o++] = 3;     // DHCPREQUEST
+            options[o++] = 50; options[o++] = 4;                        // requested address
+            memcpy(options + o, ip, 4);
+            o += 4;
+            char name[32];
+            int name_length = snprintf(name, sizeof(name), "sim-device-%u", rx.device);
+            options[o++] = 12;                                          // host name
+            options[o++] = static_cast<uint8_t>(name_length);
+            memcpy(options + o, name, name_length);
+            o += name_length;
+            options[o++] = 255;
+            length = FinishUdp(frame, 236 + o, kBroadcastMac, mac, kAnyIp, kBroadcastIp, 64, 68, 67);
+            break;
+        }
+
+        case kRxMdns: {
+            // Unsolicited response announcing <name>.local A <ip>
+            uint8_t* dns = frame + kEthernetHeaderSize + kIpv4HeaderSize + kUdpHeaderSize;
+            memset(dns, 0, 12);
+            WriteBe16(dns + 2, 0x8400);     // response, authoritative
+            WriteBe16(dns + 6, 1);          // one answer
+            size_t o = 12;
+            char name[32];
+            int name_length = snprintf(name, sizeof(name), "sim-device-%u", rx.device);
+            dns[o++] = static_cast<uint8_t>(name_length);
+            memcpy(dns + o, name, name_length);
+            o += name_length;
+            dns[o++] = 5;
+            memcpy(dns + o, "local", 5);
+            o += 5;
+            dns[o++] = 0;
+            WriteBe16(dns + o, 1);          // A
+            WriteBe16(dns + o + 2, 0x8001); // IN, cache flush
+            WriteBe32(dns + o + 4, 120);
+            WriteBe16(dns + o + 8, 4);
+            memcpy(dns + o + 10, ip, 4);
+            o += 14;
+            length = FinishUdp(frame, o, kMdnsMac, mac, ip, kMdnsIp, 255, 5353, 5353);
+            break;
+        }
+
+        case kRxTrafficUp:
+        case kRxTrafficDown: {
+            // Full-size UDP frame between the device and a host past the
+            // gateway, addressed to us because the sender is poisoned
+            const uint8_t remote[4] = { 198, 51, 100, static_cast<uint8_t>(1 + rx.device % 250) };
+            size_t payload = kTrafficFrameSize - kEthernetHeaderSize - kIpv4HeaderSize - kUdpHeaderSize;
+            memset(frame + kTrafficFrameSize - payload, 0, payload);
+            if (rx.kind == kRxTrafficUp) {
+                length = FinishUdp(frame, payload, our_mac_, mac, ip, remote, 64, 50000, 443);
+            } else {
+                length = FinishUdp(frame, payload, our_mac_, gateway_mac_, remote, ip, 57, 443, 50000);
+            }
+            break;
+        }
+    }
+
+    size_t copied = std::min(length, capacity);
+    memcpy(buffer, frame, copied);
+    return copied;
+}
+
+bool SimulatedNetwork::isPoisoned(uint32_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= devices_.size()) return false;
+    const Device& device = devices_[index];
+    return device.gateway_entry.mac_key == our_key_ && device.gateway_view.mac_key == our_key_;
+}
+
+bool SimulatedNetwork::isRestored(uint32_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= devices_.size()) return false;
+    const Device& device = devices_[index];
+    return device.gateway_entry.mac_key == gateway_key_ && device.gateway_view.mac_key == deviceKey(index);
+}
+
+uint32_t SimulatedNetwork::poisonedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t count = 0;
+    for (const Device& device : devices_) {
+        if (device.gateway_entry.mac_key == our_key_ && device.gateway_view.mac_key == our_key_) ++count;
+    }
+    return count;
+}
+
+uint32_t SimulatedNetwork::restoredCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < devices_.size(); ++i) {
+        const Device& device = devices_[i];
+        if (device.gateway_entry.mac_key == gateway_key_ && device.gateway_view.mac_key == deviceKey(i)) ++count;
+    }
+    return count;
+}
+
+bool SimulatedNetwork::respondsToArp(uint32_t index) const {
+    return index < devices_.size() && devices_[index].responds;
+}
+
+uint64_t SimulatedNetwork::deliveredBytes(uint32_t index, TrafficDirection direction) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index < devices_.size() ? devices_[index].delivered_bytes[direction] : 0;
+}
+
+SimulatedNetwork::Stats SimulatedNetwork::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
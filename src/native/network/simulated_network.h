@@ -0,0 +1,192 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "cycle_clock.h"
+#include "packet_io.h"
+#include "traffic_counters.h"
+
+// In-process LAN for load testing the send/receive paths
+//
+// A SimulatedNetwork stands in for the adapter: it hosts N virtual devices
+// and a virtual gateway on a /16, and is used as the PacketIO of ArpManager
+// or DataPlane. Frames sent to it are interpreted the way the hosts would:
+//
+//   ARP request     devices (and the gateway) answer after a per-device
+//                   delay; a configurable fraction of devices stays silent
+//   ARP reply       updates the receiver's cache: devices learn the gateway
+//                   IP, the gateway learns device IPs. This is how poisoning
+//                   and restore show up (isPoisoned / isRestored).
+//   IPv4            counted as delivered to the device or gateway it is
+//                   addressed to
+//
+// On their own, devices re-ARP for the gateway when their cache entry ages
+// out (the real gateway answers, undoing any poisoning that was not
+// refreshed), broadcast DHCP requests and mDNS announcements, and generate
+// up/down traffic. receive() returns only what a host on the LAN would see:
+// broadcasts, multicast and frames addressed to our MAC, i.e. traffic from
+// poisoned devices.
+//
+// All behaviour is driven by the Clock and a seed, so with a VirtualClock a
+// run is fully deterministic at any device count. Thread safe: the
+// poisoning worker may send while another thread reads stats.
+class SimulatedNetwork : public PacketIO {
+public:
+    struct Config {
+        uint32_t device_count = 254;
+        uint32_t seed = 1;
+        uint8_t network[4] = { 10, 20, 0, 0 };   // /16: gateway .0.1, us .0.2, devices from .0.10
+        double response_rate = 1.0;              // fraction of devices answering ARP requests
+        uint64_t arp_reply_delay_ns = 500000;    // base delay; each device adds up to as much again
+        uint64_t arp_cache_timeout_ns = 60000000000ULL;
+        uint64_t dhcp_interval_ns = 0;           // per device, 0 = off
+        uint64_t mdns_interval_ns = 0;           // per device, 0 = off
+        double traffic_mbps = 0;                 // per device and direction, 0 = off
+        size_t rx_queue_limit = 1 << 20;         // frames held for receive()
+    };
+
+    struct Stats {
+        uint64_t arp_requests;          // requests received from us
+        uint64_t arp_replies;           // replies generated by hosts
+        uint64_t poison_updates;        // cache entries pointed at our MAC
+        uint64_t restore_updates;       // cache entries pointed back at the real MAC
+        uint64_t cache_expiries;        // entries aged out and re-resolved
+        uint64_t poison_lapses;         // ... of which were poisoned at the time
+        uint64_t chatter_frames;        // DHCP and mDNS
+        uint64_t traffic_generated;     // frames generated by devices and gateway
+        uint64_t traffic_intercepted;   // ... of which were addressed to us
+        uint64_t frames_delivered;      // IPv4 frames from us reaching a host
+        uint64_t bytes_delivered;
+        uint64_t frames_unroutable;     // frames from us nobody accepts
+        uint64_t rx_dropped;            // rx queue full
+    };
+
+    SimulatedNetwork(const Config& config, const Clock& clock);
+
+    SimulatedNetwork(const SimulatedNetwork&) = delete;
+    SimulatedNetwork& operator=(const SimulatedNetwork&) = delete;
+
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) override;
+    std::string lastError() const override;
+
+    // Run host behaviour up to the clock's current time without receiving
+    void poll();
+
+    // Addresses (raw bytes)
+    uint32_t deviceCount() const { return config_.device_count; }
+    void deviceMac(uint32_t index, uint8_t* mac) const;
+    void deviceIp(uint32_t index, uint8_t* ip) const;
+    const uint8_t* ourMac() const { return our_mac_; }
+    const uint8_t* ourIp() const { return our_ip_; }
+    const uint8_t* gatewayMac() const { return gateway_mac_; }
+    const uint8_t* gatewayIp() const { return gateway_ip_; }
+
+    // Cache state. A device is poisoned when both its own entry for the
+    // gateway and the gateway's entry for it point at our MAC, restored when
+    // both point at the real MACs.
+    bool isPoisoned(uint32_t index) const;
+    bool isRestored(uint32_t index) const;
+    uint32_t poisonedCount() const;
+    uint32_t restoredCount() const;
+    bool respondsToArp(uint32_t index) const;
+
+    // Bytes we delivered to a device (down) or to the gateway on its behalf (up)
+    uint64_t deliveredBytes(uint32_t index, TrafficDirection direction) const;
+
+    Stats stats() const;
+
+private:
+    enum EventKind : uint8_t {
+        kEventDeviceArpReply,     // device answers our request
+        kEventGatewayArpReply,    // gateway answers our request
+        kEventDeviceExpiry,       // device's entry for the gateway ages out
+        kEventGatewayExpiry,      // gateway's entry for a device ages out
+        kEventDhcp,
+        kEventMdns,
+        kEventTrafficUp,
+        kEventTrafficDown
+    };
+
+    struct Event {
+        uint64_t time_ns;
+        uint64_t sequence;        // FIFO among equal times
+        uint32_t device;
+        EventKind kind;
+
+        bool operator>(const Event& other) const {
+            return time_ns != other.time_ns ? time_ns > other.time_ns : sequence > other.sequence;
+        }
+    };
+
+    // Frames waiting for receive() are kept as descriptors and rendered
+    // into the caller's buffer
+    enum RxKind : uint8_t {
+        kRxDeviceArpReply,
+        kRxGatewayArpReply,
+        kRxDeviceArpRequest,      // device re-resolving the gateway (broadcast)
+        kRxGatewayArpRequest,     // gateway re-resolving a device (broadcast)
+        kRxDhcp,
+        kRxMdns,
+        kRxTrafficUp,
+        kRxTrafficDown
+    };
+
+    struct RxFrame {
+        uint64_t time_ns;
+        uint32_t device;
+        RxKind kind;
+    };
+
+    // What a host currently believes the other side's MAC is
+    struct CacheEntry {
+        uint64_t mac_key;
+        uint64_t learned_ns;
+        bool expiry_pending;
+    };
+
+    struct Device {
+        CacheEntry gateway_entry;   // device's view of the gateway
+        CacheEntry gateway_view;    // gateway's view of the device
+        uint64_t delivered_bytes[2];
+        uint64_t reply_delay_ns;
+        bool responds;
+    };
+
+    Config config_;
+    const Clock& clock_;
+    uint8_t our_mac_[6];
+    uint8_t our_ip_[4];
+    uint8_t gateway_mac_[6];
+    uint8_t gateway_ip_[4];
+    uint64_t our_key_;
+    uint64_t gateway_key_;
+    uint64_t traffic_interval_ns_;
+
+    mutable std::mutex mutex_;
+    std::vector<Device> devices_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+    std::deque<RxFrame> rx_queue_;
+    uint64_t sequence_;
+    Stats stats_;
+    std::string last_error_;
+
+    uint64_t deviceKey(uint32_t index) const;
+    bool deviceIndexForKey(uint64_t mac_key, uint32_t& index) const;
+    bool deviceIndexForIp(const uint8_t* ip, uint32_t& index) const;
+    void schedule(uint64_t time_ns, uint32_t device, EventKind kind);
+    void enqueueRx(uint64_t time_ns, uint32_t device, RxKind kind);
+    void learn(CacheEntry& entry, uint64_t mac_key, uint64_t real_key, uint32_t device,
+               EventKind expiry_kind, uint64_t now_ns);
+    void runEvents(uint64_t now_ns);
+    void handleEvent(const Event& event);
+    void handleArp(const uint8_t* frame, size_t length, uint64_t now_ns);
+    void handleIpv4(const uint8_t* frame, size_t length);
+    size_t render(const RxFrame& rx, uint8_t* buffer, size_t capacity) const;
+};
@@ -0,0 +1,96 @@
+#include "tcp_window.h"
+#include "priority_mark.h"
+
+static const size_t kTcpMinHeaderSize = 20;
+static const size_t kWindowOffset = 14;
+static const size_t kChecksumOffset = 16;
+static const uint8_t kOptionEnd = 0;
+static const uint8_t kOptionNop = 1;
+static const uint8_t kOptionMss = 2;
+static const uint8_t kOptionWindowScale = 3;
+static const uint8_t kOptionTimestamps = 8;
+static const uint8_t kFlagAck = 0x10;
+static const uint8_t kFlagsNotPureAck = 0x27;       // URG, RST, SYN, FIN
+static const uint8_t kFlagsEcn = 0xC0;              // CWR, ECE
+
+static inline uint16_t ReadBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static inline void WriteBe16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+// Replace the 16-bit value at offset and patch the checksum. Options are
+// not word aligned: a value at an odd offset straddles two checksum words,
+// where it counts byte-swapped.
+static void RewriteValue(uint8_t* tcp, size_t offset, uint16_t value) {
+    uint16_t old_value = ReadBe16(tcp + offset);
+    WriteBe16(tcp + offset, value);
+    if (offset & 1) {
+        old_value = static_cast<uint16_t>((old_value << 8) | (old_value >> 8));
+        value = static_cast<uint16_t>((value << 8) | (value >> 8));
+    }
+    WriteBe16(tcp + kChecksumOffset, AdjustChecksum(ReadBe16(tcp + kChecksumOffset), old_value, value));
+}
+
+bool ParseTcpSynOptions(const uint8_t* tcp, size_t header_length, TcpSynOptions& options) {
+    options.mss_offset = 0;
+    options.window_scale = -1;
+    size_t offset = kTcpMinHeaderSize;
+    while (offset < header_length) {
+        uint8_t kind = tcp[offset];
+        if (kind == kOptionEnd) break;
+        if (kind == kOptionNop) {
+            ++offset;
+            continue;
+        }
+        if (offset + 1 >= header_length) return false;
+        uint8_t length = tcp[offset + 1];
+        if (length < 2 || offset + length > header_length) return false;
+        if (kind == kOptionMss && length == 4) {
+            options.mss_offset = offset + 2;
+        } else if (kind == kOptionWindowScale && length == 3) {
+            options.window_scale = tcp[offset + 2];
+        }
+        offset += length;
+    }
+    return true;
+}
+
+bool ClampTcpMss(uint8_t* tcp, size_t mss_offset, uint16_t mss) {
+    if (ReadBe16(tcp + mss_offset) <= mss) return false;
+    RewriteValue(tcp, mss_offset, mss);
+    return true;
+}
+
+bool ClampTcpWindow(uint8_t* tcp, uint32_t window_bytes, uint8_t shift) {
+    uint64_t units = (static_cast<uint64_t>(window_bytes) + (1u << shift) - 1) >> shift;
+    if (units == 0) units = 1;
+    if (ReadBe16(tcp + kWindowOffset) <= units) return false;
+    RewriteValue(tcp, kWindowOffset, static_cast<uint16_t>(units));
+    return true;
+}
+
+TcpAckKind ClassifyTcpAck(const uint8_t* tcp, size_t header_length, size_t payload_length) {
+    uint8_t flags = tcp[13];
+    if (payload_length != 0 || !(flags & kFlagAck) || (flags & kFlagsNotPureAck)) return kTcpNotPureAck;
+    if (flags & kFlagsEcn) return kTcpPureAck;
+
+    // SACK blocks and anything unknown make the ACK worth keeping
+    size_t offset = kTcpMinHeaderSize;
+    while (offset < header_length) {
+        uint8_t kind = tcp[offset];
+        if (kind == kOptionEnd) break;
+        if (kind == kOptionNop) {
+            ++offset;
+            continue;
+        }
+        if (kind != kOptionTimestamps || offset + 1 >= header_length) return kTcpPureAck;
+        uint8_t length = tcp[offset + 1];
+        if (length != 10 || offset + length > header_length) return kTcpPureAck;
+        offset += length;
+    }
+    return kTcpPlainAck;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// TCP header rewrites for window shaping, and the pure-ACK test of ACK
+// prioritization and filtering (see DataPlane). Every rewrite patches the
+// TCP checksum incrementally (RFC 1624), so payloads are never read.
+
+// What window shaping needs from a SYN's options
+struct TcpSynOptions {
+    size_t mss_offset;     // of the MSS value from the TCP header, 0 = no MSS option
+    int window_scale;      // shift announced by the sender, -1 = no window scale option
+};
+
+// Walk the options of the TCP header at tcp (header_length bytes, data
+// offset included). False when they run past the header.
+bool ParseTcpSynOptions(const uint8_t* tcp, size_t header_length, TcpSynOptions& options);
+
+// Lower the MSS value at mss_offset to mss; false when it is already at or
+// below
+bool ClampTcpMss(uint8_t* tcp, size_t mss_offset, uint16_t mss);
+
+// Lower the advertised window so that, scaled by shift, it is no more than
+// window_bytes (rounded up to one scaled unit, never 0). False when it
+// already is.
+bool ClampTcpWindow(uint8_t* tcp, uint32_t window_bytes, uint8_t shift);
+
+// Window scale per direction as kept in FlowEntry::window_scale: 0 until
+// the direction's SYN has been seen, then kWindowScaleSeen, plus
+// kWindowScaleOption and the shift when the SYN carried the option
+enum WindowScaleBits : uint8_t {
+    kWindowScaleSeen = 0x80,
+    kWindowScaleOption = 0x40,
+    kWindowScaleShift = 0x0F
+};
+
+// Record the window scale of a SYN in state (one FlowEntry::window_scale
+// slot)
+inline void RecordWindowScale(uint8_t& state, int window_scale) {
+    state = window_scale < 0
+        ? static_cast<uint8_t>(kWindowScaleSeen)
+        : static_cast<uint8_t>(kWindowScaleSeen | kWindowScaleOption | (window_scale > 14 ? 14 : window_scale));
+}
+
+// Shift that applies to the windows of a direction whose own state is
+// sender and whose peer's is peer; -1 while either SYN is missing. Scaling
+// is on only when both SYNs carried the option (RFC 7323).
+inline int EffectiveWindowShift(uint8_t sender, uint8_t peer) {
+    if (!(sender & kWindowScaleSeen) || !(peer & kWindowScaleSeen)) return -1;
+    if (!(sender & kWindowScaleOption) || !(peer & kWindowScaleOption)) return 0;
+    return sender & kWindowScaleShift;
+}
+
+// What a segment is to ACK prioritization and filtering
+enum TcpAckKind : uint8_t {
+    kTcpNotPureAck = 0,   // carries data or SYN/FIN/RST/URG, or no ACK
+    kTcpPureAck,          // ACK flag and nothing else to deliver
+    kTcpPlainAck          // pure ACK that a later cumulative ACK replaces
+                          // entirely: no options but timestamps, no ECN flags
+};
+
+// Classify the TCP header at tcp (header_length bytes, options included)
+// of a segment with payload_length bytes of data
+TcpAckKind ClassifyTcpAck(const uint8_t* tcp, size_t header_length, size_t payload_length);
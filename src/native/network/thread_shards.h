@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+// One instance of T per writer thread
+//
+// local() hands each thread its own shard, allocated on first use. Writers
+// only touch their own shard, so hot counters never share a cache line
+// between cores; readers visit every shard through forEach() and merge. A
+// shard whose thread has exited is handed to the next new thread rather
+// than freed, so whatever it accumulated keeps counting toward the totals.
+//
+// Shards are never freed and thread exit touches the owning object, so
+// instances must outlive every writer thread (in practice: leaked
+// singletons). A thread is expected to write to one instance per T.
+template <typename T>
+class ThreadShards {
+public:
+    ThreadShards() = default;
+    ThreadShards(const ThreadShards&) = delete;
+    ThreadShards& operator=(const ThreadShards&) = delete;
+
+    // Fast path: two thread-local loads and a compare
+    T& local() {
+        T* shard = tls_shard_;
+        if (tls_owner_ != this || !shard) {
+            shard = attach();
+        }
+        return *shard;
+    }
+
+    template <typename F>
+    void forEach(F&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : entries_) {
+            fn(static_cast<const T&>(entry->value));
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+private:
+    struct Entry {
+        T value{};
+        std::atomic<bool> in_use{false};
+    };
+
+    // Returns the shard to the pool when its thread exits; kept apart from
+    // the trivially destructible fast-path pointers
+    struct Release {
+        std::atomic<bool>* in_use = nullptr;
+        ~Release() {
+            if (in_use) in_use->store(false, std::memory_order_release);
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+
+    static thread_local ThreadShards* tls_owner_;
+    static thread_local T* tls_shard_;
+    static thread_local Release tls_release_;
+
+    T* attach() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Entry* entry = nullptr;
+        for (auto& candidate : entries_) {
+            bool expected = false;
+            if (candidate->in_use.compare_exchange_strong(expected, true)) {
+                entry = candidate.get();
+                break;
+            }
+        }
+        if (!entry) {
+            entries_.emplace_back(new Entry());
+            entry = entries_.back().get();
+            entry->in_use.store(true);
+        }
+
+        if (tls_release_.in_use && tls_owner_ != this) {
+            tls_release_.in_use->store(false, std::memory_order_release);
+        }
+        tls_release_.in_use = &entry->in_use;
+        tls_owner_ = this;
+        tls_shard_ = &entry->value;
+        return tls_shard_;
+    }
+};
+
+template <typename T>
+thread_local ThreadShards<T>* ThreadShards<T>::tls_owner_ = nullptr;
+template <typename T>
+thread_local T* ThreadShards<T>::tls_shard_ = nullptr;
+template <typename T>
+thread_local typename ThreadShards<T>::Release ThreadShards<T>::tls_release_;
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""
+Compare two netshaper_bench JSON reports (see bench/bench_main.cpp).
+
+Usage:
+    python tools/compare_bench.py base.json new.json
+    python tools/compare_bench.py base.json new.json --threshold 10
+
+Prints the median ns/op of every benchmark in both runs and the change.
+Exits with status 1 when any benchmark is slower than --threshold percent
+(default: never fail).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding='utf-8') as f:
+        report = json.load(f)
+    return {r['name']: r for r in report['results']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('base')
+    parser.add_argument('new')
+    parser.add_argument('--threshold', type=float, default=None,
+                        help='fail if any benchmark regresses by more than this percent')
+    args = parser.parse_args()
+
+    base = load(args.base)
+    new = load(args.new)
+    regressions = []
+
+    print(f"{'benchmark':32} {'base ns/op':>12} {'new ns/op':>12} {'change':>9}")
+    for name in sorted(set(base) | set(new)):
+        if name not in base or name not in new:
+            side = 'new only' if name not in base else 'base only'
+            print(f'{name:32} {side:>35}')
+            continue
+        before = base[name]['ns_per_op']
+        after = new[name]['ns_per_op']
+        change = (after - before) / before * 100.0 if before > 0 else 0.0
+        print(f'{name:32} {before:12.1f} {after:12.1f} {change:+8.1f}%')
+        if args.threshold is not None and change > args.threshold:
+            regressions.append(name)
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) regressed more than {args.threshold}%: {', '.join(regressions)}")
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
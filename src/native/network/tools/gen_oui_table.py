@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Generate oui_table.inc - the IEEE MA-L/MA-M/MA-S registries compiled into
+sorted C arrays plus an interned vendor-name pool (see oui_db.cpp).
+
+Usage:
+    python tools/gen_oui_table.py                 # regenerate from data/*.csv
+    python tools/gen_oui_table.py --download      # fetch IEEE registries first
+    python tools/gen_oui_table.py --out X.inc a.csv b.csv
+
+Input files use the IEEE CSV layout:
+    Registry,Assignment,Organization Name,Organization Address
+Later files win when the same assignment appears twice. By default the
+hand-written data/oui_seed.csv is read first, so the downloaded registries
+override it and it only fills in when they are missing.
+
+Only --download touches the network. The module build (binding.gyp) runs
+this without it, so the table depends on nothing but the checked-in CSVs;
+fetched registries are meant to be committed along with oui_table.inc.
+"""
+
+import argparse
+import csv
+import glob
+import io
+import os
+import sys
+import urllib.request
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+NATIVE_DIR = os.path.dirname(HERE)
+DATA_DIR = os.path.join(NATIVE_DIR, 'data')
+DEFAULT_OUT = os.path.join(NATIVE_DIR, 'oui_table.inc')
+SEED_FILE = 'oui_seed.csv'
+
+IEEE_REGISTRIES = {
+    'ieee_ma_l.csv': 'https://standards-oui.ieee.org/oui/oui.csv',
+    'ieee_ma_m.csv': 'https://standards-oui.ieee.org/oui28/mam.csv',
+    'ieee_ma_s.csv': 'https://standards-oui.ieee.org/oui36/oui36.csv',
+}
+
+# Assignment length (hex digits) per registry -> prefix width in bits
+PREFIX_BITS = {6: 24, 7: 28, 9: 36}
+
+
+def download(data_dir):
+    for filename, url in IEEE_REGISTRIES.items():
+        path = os.path.join(data_dir, filename)
+        print('Downloading', url)
+        request = urllib.request.Request(url, headers={'User-Agent': 'netshaper-gen-oui'})
+        with urllib.request.urlopen(request, timeout=60) as response:
+            data = response.read()
+        # Written under a temporary name so an interrupted download is not
+        # taken for a complete registry next time
+        with open(path + '.part', 'wb') as f:
+            f.write(data)
+        os.replace(path + '.part', path)
+
+
+def default_inputs(data_dir):
+    paths = sorted(glob.glob(os.path.join(data_dir, '*.csv')))
+    seed = [p for p in paths if os.path.basename(p) == SEED_FILE]
+    return seed + [p for p in paths if os.path.basename(p) != SEED_FILE]
+
+
+def clean_vendor(name):
+    # Registry names carry stray whitespace and occasional embedded newlines
+    return ' '.join(name.replace('\r', ' ').replace('\n', ' ').split())
+
+
+def load(paths):
+    tables = {24: {}, 28: {}, 36: {}}
+    for path in paths:
+        with io.open(path, 'r', encoding='utf-8-sig', newline='') as f:
+            for row in csv.DictReader(f):
+                assignment = (row.get('Assignment') or '').strip().upper()
+                vendor = clean_vendor(row.get('Organization Name') or '')
+                bits = PREFIX_BITS.get(len(assignment))
+                if not bits or not vendor:
+                    continue
+                try:
+                    prefix = int(assignment, 16)
+                except ValueError:
+                    continue
+                tables[bits][prefix] = vendor
+    return tables
+
+
+def c_string(value):
+    out = []
+    for ch in value.encode('utf-8'):
+        if ch in (0x22, 0x5C):          # " and \
+            out.append('\\' + chr(ch))
+        elif 0x20 <= ch < 0x7F and ch != 0x3F:  # avoid ?? trigraphs
+            out.append(chr(ch))
+        else:
+            out.append('\\%03o' % ch)
+    return '"' + ''.join(out) + '"'
+
+
+def emit(tables, out_path, sources):
+    vendors = sorted(set(v for table in tables.values() for v in table.values()))
+    vendor_index = {v: i for i, v in enumerate(vendors)}
+
+    lines = []
+    lines.append('// Generated by tools/gen_oui_table.py - do not edit by hand.')
+    lines.append('// Sources: ' + ', '.join(os.path.basename(s) for s in sources))
+    lines.append('// MA-L: %d, MA-M: %d, MA-S: %d, vendors: %d' % (
+        len(tables[24]), len(tables[28]), len(tables[36]), len(vendors)))
+    lines.append('')
+    lines.append('static const char* const kOuiVendors[] = {')
+    for vendor in vendors or ['']:
+        lines.append('    %s,' % c_string(vendor))
+    lines.append('};')
+    lines.append('')
+
+    for bits, name in ((24, 'kOuiMaL'), (28, 'kOuiMaM'), (36, 'kOuiMaS')):
+        entries = sorted(tables[bits].items())
+        ctype = 'OuiEntry64' if bits > 32 else 'OuiEntry32'
+        lines.append('static const size_t %sCount = %d;' % (name, len(entries)))
+        lines.append('static const %s %s[] = {' % (ctype, name))
+        if not entries:
+            lines.append('    { 0, 0 }, // placeholder, arrays may not be empty')
+        for prefix, vendor in entries:
+            lines.append('    { 0x%XULL, %d },' % (prefix, vendor_index[vendor]) if bits > 32
+                         else '    { 0x%07X, %d },' % (prefix, vendor_index[vendor]))
+        lines.append('};')
+        lines.append('')
+
+    with io.open(out_path, 'w', encoding='ascii', newline='\n') as f:
+        f.write('\n'.join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the compiled OUI vendor table')
+    parser.add_argument('--download', action='store_true', help='fetch the IEEE registries into data/ first')
+    parser.add_argument('--out', default=DEFAULT_OUT, help='output .inc path')
+    parser.add_argument('inputs', nargs='*', help='registry CSV files (default: data/*.csv)')
+    args = parser.parse_args()
+
+    if args.download:
+        download(DATA_DIR)
+
+    inputs = args.inputs or default_inputs(DATA_DIR)
+    if not inputs:
+        print('No registry CSV files found', file=sys.stderr)
+        return 1
+
+    tables = load(inputs)
+    emit(tables, args.out, inputs)
+    print('Wrote %s (MA-L %d, MA-M %d, MA-S %d)' % (
+        args.out, len(tables[24]), len(tables[28]), len(tables[36])))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
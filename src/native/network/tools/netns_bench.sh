@@ -0,0 +1,217 @@
+#!/usr/bin/env bash
+#
+# End-to-end relay bench over network namespaces (Linux, needs root)
+#
+# Usage:
+#   sudo tools/netns_bench.sh [BUILD_DIR] [OUT_DIR]
+#
+#   BUILD_DIR  cmake build of src/native/network/bench (default build/bench)
+#   OUT_DIR    where reports go (default netns-bench-<timestamp>)
+#
+# Environment:
+#   DEVICES="1 16 256"   device counts to run
+#   SECONDS_PER_RUN=5    length of each throughput run
+#   LIMIT=5/5            per-device DOWN/UP Mbps for the shaped runs
+#   FRAME_SIZE=1400
+#   LATENCY_RATE_MBPS=2  total paced load of the latency runs, kept under
+#                        LIMIT so shaping does not drop the probes
+#   BACKEND=packet       relay sockets: packet (AF_PACKET), uring (AF_PACKET
+#                        through io_uring), xdp or xdp-generic (AF_XDP,
+#                        generic mode works on veth)
+#   CLASSIFY=frame       relay classification: frame (DataPlane::process per
+#                        frame) or burst (DataPlane::processBurst)
+#
+# Topology, one namespace each:
+#
+#   ns-client  c0 ---- s0  ns-shaper  s1 ---- g0  ns-gw
+#              cd ------------------------------ gd       (direct baseline)
+#
+# s0 and s1 share one MAC, the relay's "our MAC". netshaper_rig runs as
+# client (synthetic devices), relay (the DataPlane) and gateway (echo). For
+# every device count three paths are measured, each with a latency run
+# (light paced load) and a throughput run (unpaced):
+#
+#   direct    client -> gateway, no relay: the baseline
+#   relay     through the DataPlane with shaping off
+#   shaped    through the DataPlane with LIMIT per device
+#
+# Every run writes its client and relay JSON reports; summary.json collects
+# them with added RTT and jitter against the direct baseline.
+
+set -euo pipefail
+
+BUILD_DIR=${1:-build/bench}
+OUT_DIR=${2:-netns-bench-$(date +%Y%m%d-%H%M%S)}
+DEVICES=${DEVICES:-"1 16 256"}
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-5}
+LIMIT=${LIMIT:-5/5}
+FRAME_SIZE=${FRAME_SIZE:-1400}
+LATENCY_RATE_MBPS=${LATENCY_RATE_MBPS:-2}
+BACKEND=${BACKEND:-packet}
+CLASSIFY=${CLASSIFY:-frame}
+
+RIG="$BUILD_DIR/netshaper_rig"
+OUR_MAC=02:00:00:00:00:01
+GATEWAY_MAC=02:00:00:00:00:fe
+NAMESPACES="ns-client ns-shaper ns-gw"
+
+if [[ $EUID -ne 0 ]]; then
+    echo "netns_bench.sh needs root (network namespaces, raw sockets)" >&2
+    exit 1
+fi
+if [[ ! -x "$RIG" ]]; then
+    echo "$RIG not found - build it first: cmake -S src/native/network/bench -B $BUILD_DIR && cmake --build $BUILD_DIR" >&2
+    exit 1
+fi
+RIG=$(realpath "$RIG")
+mkdir -p "$OUT_DIR"
+OUT_DIR=$(realpath "$OUT_DIR")
+
+BACKGROUND_PIDS=()
+
+cleanup() {
+    for pid in "${BACKGROUND_PIDS[@]:-}"; do
+        [[ -n "$pid" ]] && kill "$pid" 2>/dev/null || true
+    done
+    wait 2>/dev/null || true
+    for ns in $NAMESPACES; do
+        ip netns del "$ns" 2>/dev/null || true
+    done
+}
+trap cleanup EXIT
+
+# Interfaces carry no IP addresses and IPv6 is off, so the kernel stays
+# quiet and only the rig's frames are on the wire
+setup_topology() {
+    cleanup
+    for ns in $NAMESPACES; do
+        ip netns add "$ns"
+        ip netns exec "$ns" sysctl -qw net.ipv6.conf.all.disable_ipv6=1 net.ipv6.conf.default.disable_ipv6=1
+        ip -n "$ns" link set lo up
+    done
+
+    ip link add c0 netns ns-client type veth peer name s0 netns ns-shaper
+    ip link add s1 netns ns-shaper type veth peer name g0 netns ns-gw
+    ip link add cd netns ns-client type veth peer name gd netns ns-gw
+
+    ip -n ns-shaper link set s0 address $OUR_MAC
+    ip -n ns-shaper link set s1 address $OUR_MAC
+    ip -n ns-gw link set g0 address $GATEWAY_MAC
+    ip -n ns-gw link set gd address $GATEWAY_MAC
+
+    for link in "ns-client c0" "ns-client cd" "ns-shaper s0" "ns-shaper s1" "ns-gw g0" "ns-gw gd"; do
+        set -- $link
+        ip netns exec "$1" sysctl -qw "net.ipv6.conf.$2.disable_ipv6=1"
+        ip -n "$1" link set "$2" up
+    done
+}
+
+start_background() {
+    local ns=$1
+    shift
+    ip netns exec "$ns" "$@" &
+    BACKGROUND_PIDS+=($!)
+    LAST_PID=$!
+}
+
+stop_background() {
+    kill -INT "$1" 2>/dev/null || true
+    wait "$1" 2>/dev/null || true
+}
+
+# run_path NAME DEVICES: one latency and one throughput client run
+run_path() {
+    local path=$1 devices=$2
+    local client_if=c0 gateway_if=g0 dst_mac=$OUR_MAC relay_pid="" gateway_pid
+    local prefix="$OUT_DIR/${path}_${devices}"
+
+    if [[ $path == direct ]]; then
+        client_if=cd
+        gateway_if=gd
+        dst_mac=$GATEWAY_MAC
+    fi
+
+    start_background ns-gw "$RIG" gateway --if $gateway_if
+    gateway_pid=$LAST_PID
+    if [[ $path != direct ]]; then
+        local limit_args=()
+        [[ $path == shaped ]] && limit_args=(--default-limit "$LIMIT")
+        start_background ns-shaper "$RIG" relay --down s0 --up s1 --gateway-mac $GATEWAY_MAC \
+            --backend "$BACKEND" --classify "$CLASSIFY" --devices "$devices" "${limit_args[@]}" --out "${prefix}_relay.json"
+        relay_pid=$LAST_PID
+    fi
+    sleep 0.5
+
+    ip netns exec ns-client "$RIG" client --if $client_if --dst-mac $dst_mac --devices "$devices" \
+        --seconds 2 --rate-mbps "$LATENCY_RATE_MBPS" --size "$FRAME_SIZE" \
+        --label "${path}/${devices}/latency" --out "${prefix}_latency.json"
+    ip netns exec ns-client "$RIG" client --if $client_if --dst-mac $dst_mac --devices "$devices" \
+        --seconds "$SECONDS_PER_RUN" --size "$FRAME_SIZE" \
+        --label "${path}/${devices}/throughput" --out "${prefix}_throughput.json"
+
+    [[ -n $relay_pid ]] && stop_background "$relay_pid"
+    stop_background "$gateway_pid"
+}
+
+setup_topology
+for devices in $DEVICES; do
+    for path in direct relay shaped; do
+        run_path $path "$devices"
+    done
+done
+
+python3 - "$OUT_DIR" "$DEVICES" "$LIMIT" <<'EOF'
+import json
+import os
+import sys
+
+out_dir, device_counts, limit = sys.argv[1], sys.argv[2].split(), sys.argv[3]
+
+
+def load(name):
+    path = os.path.join(out_dir, name)
+    if not os.path.exists(path):
+        return None
+    with open(path, encoding='utf-8') as f:
+        return json.load(f)
+
+
+runs = []
+for devices in device_counts:
+    baseline = load(f'direct_{devices}_latency.json')
+    for path in ('direct', 'relay', 'shaped'):
+        latency = load(f'{path}_{devices}_latency.json')
+        throughput = load(f'{path}_{devices}_throughput.json')
+        relay = load(f'{path}_{devices}_relay.json')
+        if not latency or not throughput:
+            continue
+        run = {
+            'path': path,
+            'devices': int(devices),
+            'throughput_mbps': throughput['achieved_mbps'],
+            'throughput_loss': throughput['loss'],
+            'per_device_mbps': throughput['per_device_mbps'],
+            'rtt_us': latency['rtt_us'],
+            'jitter_us': latency['jitter_us'],
+            'loaded_rtt_us': throughput['rtt_us'],
+        }
+        if baseline:
+            run['added_rtt_p50_us'] = latency['rtt_us']['p50'] - baseline['rtt_us']['p50']
+            run['added_rtt_p99_us'] = latency['rtt_us']['p99'] - baseline['rtt_us']['p99']
+            run['added_jitter_us'] = latency['jitter_us'] - baseline['jitter_us']
+        if relay:
+            run['relay'] = {k: relay[k] for k in ('backend', 'packets', 'forwarded', 'drops', 'stage_ns_per_packet')}
+        runs.append(run)
+
+summary = {'suite': 'netns_bench', 'schema': 1, 'limit': limit, 'runs': runs}
+with open(os.path.join(out_dir, 'summary.json'), 'w', encoding='utf-8') as f:
+    json.dump(summary, f, indent=2)
+
+print(f"{'path':8} {'devices':>7} {'Mbps':>9} {'loss':>7} {'p50 us':>8} {'p99 us':>8} {'+p50 us':>8} {'jitter':>7}")
+for run in runs:
+    print(f"{run['path']:8} {run['devices']:>7} {run['throughput_mbps']:>9.1f} {run['throughput_loss']:>7.3f} "
+          f"{run['rtt_us']['p50']:>8.1f} {run['rtt_us']['p99']:>8.1f} {run.get('added_rtt_p50_us', 0):>8.1f} "
+          f"{run['jitter_us']:>7.1f}")
+EOF
+
+echo "Reports written to $OUT_DIR"
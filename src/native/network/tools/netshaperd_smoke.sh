@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# Control protocol smoke test for netshaperd (run by ctest)
+#
+# Usage:
+#   tools/netshaperd_smoke.sh NETSHAPERD NETSHAPERCTL [WORK_DIR]
+#
+# Starts the daemon on a private socket, drives the traffic control commands
+# through netshaperctl, checks error reporting and a clean shutdown (the
+# socket file must be gone afterwards).
+
+set -eu
+
+DAEMON=$1
+CTL=$2
+WORK_DIR=${3:-$(mktemp -d)}
+SOCKET="$WORK_DIR/netshaperd-smoke.sock"
+MAC=02:10:00:00:00:01
+
+mkdir -p "$WORK_DIR"
+"$DAEMON" --endpoint "$SOCKET" 2> "$WORK_DIR/netshaperd-smoke.log" &
+DAEMON_PID=$!
+trap 'kill $DAEMON_PID 2>/dev/null || true' EXIT
+
+ctl() {
+    "$CTL" --endpoint "$SOCKET" "$@"
+}
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+expect() {
+    local_expected=$1
+    shift
+    local_actual=$(ctl "$@") || fail "$* exited with $?"
+    case "$local_actual" in
+        *"$local_expected"*) echo "ok: $* -> $local_actual" ;;
+        *) fail "$* returned '$local_actual', expected '$local_expected'" ;;
+    esac
+}
+
+"$CTL" --endpoint "$SOCKET" --wait 5 ping > /dev/null || fail "daemon did not come up"
+
+expect '"pong"' ping
+expect '"activeControls":0' status
+expect 'true' setBandwidthLimit $MAC 5 2.5
+expect '"downloadLimit":5,"uploadLimit":2.5,"isBlocked":false,"isActive":true' getActiveControls
+expect 'true' setDeviceBlocked $MAC true
+expect '"isBlocked":true' getActiveControls
+expect '"activeControls":1' status
+expect 'true' removeTrafficControl $MAC
+expect '[]' getActiveControls
+
+# Errors come back as ok:false with a message, and the daemon keeps serving
+ctl setBandwidthLimit $MAC 5000 1 2> /dev/null && fail "out of range limit accepted"
+ctl setDeviceBlocked $MAC maybe 2> /dev/null && fail "bad flag accepted"
+ctl noSuchCommand 2> /dev/null && fail "unknown command accepted"
+expect '"pong"' ping
+
+expect 'true' shutdown
+wait $DAEMON_PID || fail "daemon exited with $?"
+trap - EXIT
+[ ! -e "$SOCKET" ] || fail "socket file left behind"
+echo "netshaperd smoke test passed"
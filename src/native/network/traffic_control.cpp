@@ -0,0 +1,84 @@
+#include "traffic_control.h"
+
+// Find or create the control entry for a device, giving new entries a
+// traffic counter slot. Caller holds mutex_.
+TrafficControl& TrafficControlTable::getOrCreate(const std::string& mac) {
+    auto it = controls_.find(mac);
+    if (it != controls_.end()) {
+        return it->second;
+    }
+
+    TrafficControl control;
+    control.deviceMac = mac;
+    control.downloadLimit = 0;
+    control.uploadLimit = 0;
+    control.isBlocked = false;
+    control.isActive = false;
+    control.counterSlot = GetTrafficCounters().acquireSlot();
+    return controls_.emplace(mac, control).first->second;
+}
+
+bool TrafficControlTable::setLimit(const std::string& mac, double downloadLimit, double uploadLimit) {
+    if (!(downloadLimit >= 0 && downloadLimit <= kMaxLimitMbps && uploadLimit >= 0 && uploadLimit <= kMaxLimitMbps)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    TrafficControl& control = getOrCreate(mac);
+    control.downloadLimit = downloadLimit;
+    control.uploadLimit = uploadLimit;
+    control.isBlocked = false;
+    control.isActive = true;
+    return true;
+}
+
+void TrafficControlTable::setBlocked(const std::string& mac, bool blocked) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TrafficControl& control = getOrCreate(mac);
+    control.isBlocked = blocked;
+    control.isActive = blocked || (control.downloadLimit > 0 || control.uploadLimit > 0);
+}
+
+bool TrafficControlTable::remove(const std::string& mac, TrafficCounters::Totals& finalTotals) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = controls_.find(mac);
+    if (it == controls_.end()) {
+        return false;
+    }
+
+    uint32_t counterSlot = it->second.counterSlot;
+    finalTotals = GetTrafficCounters().read(counterSlot);
+    GetTrafficCounters().releaseSlot(counterSlot);
+    controls_.erase(it);
+    return true;
+}
+
+bool TrafficControlTable::find(const std::string& mac, TrafficControl& control) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = controls_.find(mac);
+    if (it == controls_.end()) {
+        return false;
+    }
+    control = it->second;
+    return true;
+}
+
+std::vector<TrafficControl> TrafficControlTable::list() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TrafficControl> result;
+    result.reserve(controls_.size());
+    for (const auto& pair : controls_) {
+        result.push_back(pair.second);
+    }
+    return result;
+}
+
+size_t TrafficControlTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return controls_.size();
+}
+
+TrafficControlTable& GetTrafficControls() {
+    static TrafficControlTable table;
+    return table;
+}
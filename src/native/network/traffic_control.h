@@ -0,0 +1,47 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "traffic_counters.h"
+
+// Traffic control settings for one device
+struct TrafficControl {
+    std::string deviceMac;
+    double downloadLimit; // Mbps
+    double uploadLimit;   // Mbps
+    bool isBlocked;
+    bool isActive;
+    uint32_t counterSlot; // TrafficCounters slot, kInvalidSlot if none free
+};
+
+// Per-device limits and blocks, keyed by MAC string
+//
+// Shared by the N-API layer and netshaperd, so both front ends see the same
+// entries. A device gets a GetTrafficCounters() slot when its entry is
+// created; remove() hands back the final totals before the slot is recycled
+// so the caller can keep them (e.g. in the device inventory).
+class TrafficControlTable {
+public:
+    static constexpr double kMaxLimitMbps = 1000.0;
+
+    // Limits outside 0..kMaxLimitMbps are rejected. Setting a limit clears a block.
+    bool setLimit(const std::string& mac, double downloadLimit, double uploadLimit);
+    void setBlocked(const std::string& mac, bool blocked);
+    bool remove(const std::string& mac, TrafficCounters::Totals& finalTotals);
+
+    bool find(const std::string& mac, TrafficControl& control) const;
+    std::vector<TrafficControl> list() const;
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, TrafficControl> controls_;
+
+    TrafficControl& getOrCreate(const std::string& mac);
+};
+
+// Shared table used by the N-API layer and netshaperd
+TrafficControlTable& GetTrafficControls();
@@ -0,0 +1,69 @@
+#include "traffic_counters.h"
+#include <cstring>
+
+TrafficCounters::TrafficCounters() : baselines_(kMaxSlots) {
+    memset(baselines_.data(), 0, baselines_.size() * sizeof(Totals));
+    free_slots_.reserve(kMaxSlots);
+    for (uint32_t slot = kMaxSlots; slot > 0; --slot) {
+        free_slots_.push_back(slot - 1);
+    }
+}
+
+TrafficCounters::~TrafficCounters() = default;
+
+TrafficCounters::Totals TrafficCounters::sum(uint32_t slot) const {
+    Totals totals;
+    memset(&totals, 0, sizeof(totals));
+    shards_.forEach([&](const Shard& shard) {
+        const SlotCounters& counters = shard.slots[slot];
+        for (int d = 0; d < 2; ++d) {
+            totals.bytes[d] += counters.bytes[d].load(std::memory_order_relaxed);
+            totals.packets[d] += counters.packets[d].load(std::memory_order_relaxed);
+            totals.drops[d] += counters.drops[d].load(std::memory_order_relaxed);
+        }
+    });
+    return totals;
+}
+
+uint32_t TrafficCounters::acquireSlot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_slots_.empty()) return kInvalidSlot;
+
+    uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    baselines_[slot] = sum(slot);
+    return slot;
+}
+
+void TrafficCounters::releaseSlot(uint32_t slot) {
+    if (slot >= kMaxSlots) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_slots_.push_back(slot);
+}
+
+TrafficCounters::Totals TrafficCounters::read(uint32_t slot) const {
+    Totals totals;
+    memset(&totals, 0, sizeof(totals));
+    if (slot >= kMaxSlots) return totals;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    totals = sum(slot);
+    const Totals& baseline = baselines_[slot];
+    for (int d = 0; d < 2; ++d) {
+        totals.bytes[d] -= baseline.bytes[d];
+        totals.packets[d] -= baseline.packets[d];
+        totals.drops[d] -= baseline.drops[d];
+    }
+    return totals;
+}
+
+size_t TrafficCounters::shardCount() const {
+    return shards_.size();
+}
+
+TrafficCounters& GetTrafficCounters() {
+    // Intentionally leaked: data path threads may still count while the
+    // module unloads
+    static TrafficCounters* counters = new TrafficCounters();
+    return *counters;
+}
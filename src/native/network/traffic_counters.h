@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "thread_shards.h"
+
+enum TrafficDirection {
+    kTrafficDown = 0,   // gateway -> device
+    kTrafficUp = 1      // device -> gateway
+};
+
+// Per-device traffic counters
+//
+// Every thread that counts packets gets its own shard: a private, cache-line
+// aligned array with one 64-byte counter block per device slot. The data path
+// only ever touches its own shard with relaxed load/store pairs (plain moves,
+// no locked instructions), so counting causes no cross-core cache traffic.
+// Shards are summed only when someone reads the totals.
+//
+// A device gets a slot when traffic control is enabled for it and carries
+// the slot index with its control entry, so the data path never does a
+// lookup. Released slots are reused; a baseline taken when a slot is acquired
+// keeps counts from its previous owner out of the totals.
+class TrafficCounters {
+public:
+    static const uint32_t kMaxSlots = 1024;
+    static const uint32_t kInvalidSlot = 0xFFFFFFFF;
+
+    struct Totals {
+        uint64_t bytes[2];      // indexed by TrafficDirection
+        uint64_t packets[2];
+        uint64_t drops[2];      // packets dropped by the shaper or a block
+    };
+
+    TrafficCounters();
+    ~TrafficCounters();
+
+    TrafficCounters(const TrafficCounters&) = delete;
+    TrafficCounters& operator=(const TrafficCounters&) = delete;
+
+    // Control path (takes a lock)
+    uint32_t acquireSlot();
+    void releaseSlot(uint32_t slot);
+    Totals read(uint32_t slot) const;
+    size_t shardCount() const;
+
+    // Data path: lock-free, single writer per shard
+    inline void count(uint32_t slot, TrafficDirection direction, uint32_t bytes);
+    inline void countDrop(uint32_t slot, TrafficDirection direction);
+
+private:
+    struct alignas(64) SlotCounters {
+        std::atomic<uint64_t> bytes[2];
+        std::atomic<uint64_t> packets[2];
+        std::atomic<uint64_t> drops[2];
+    };
+    static_assert(sizeof(SlotCounters) == 64, "SlotCounters must fill exactly one cache line");
+
+    struct Shard {
+        SlotCounters slots[kMaxSlots];
+    };
+
+    ThreadShards<Shard> shards_;
+    mutable std::mutex mutex_;         // guards slot allocation and baselines
+    std::vector<uint32_t> free_slots_;
+    std::vector<Totals> baselines_;
+
+    Totals sum(uint32_t slot) const;
+
+    static inline void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        // Only the owning thread writes a shard, so load + store is exact
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+inline void TrafficCounters::count(uint32_t slot, TrafficDirection direction, uint32_t bytes) {
+    if (slot >= kMaxSlots) return;
+    SlotCounters& counters = shards_.local().slots[slot];
+    add(counters.bytes[direction], bytes);
+    add(counters.packets[direction], 1);
+}
+
+inline void TrafficCounters::countDrop(uint32_t slot, TrafficDirection direction) {
+    if (slot >= kMaxSlots) return;
+    add(shards_.local().slots[slot].drops[direction], 1);
+}
+
+// Shared counters used by the data path and the N-API layer
+TrafficCounters& GetTrafficCounters();
@@ -0,0 +1,305 @@
+#include "uring_packet_io.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const uint16_t kBufferGroup = 0;
+static const uint32_t kQueueEntries = 256;
+static const uint32_t kCompletionEntries = 4096;
+
+// user_data: receive, provide, or send | send buffer index
+static const uint64_t kReceiveTag = 1ULL << 32;
+static const uint64_t kSendTag = 2ULL << 32;
+static const uint64_t kProvideTag = 3ULL << 32;
+
+static uint32_t LoadAcquire(const uint32_t* index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+static void StoreRelease(uint32_t* index, uint32_t value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+UringPacketIO::UringPacketIO()
+    : ring_fd_(-1), sq_map_(nullptr), sq_map_length_(0), cq_map_(nullptr), cq_map_length_(0), sqes_(nullptr),
+      sqes_length_(0), sq_head_(nullptr), sq_tail_(nullptr), sq_flags_(nullptr), sq_array_(nullptr), sq_mask_(0),
+      sq_entries_(0), sq_local_tail_(0), cq_head_(nullptr), cq_tail_(nullptr), cqes_(nullptr), cq_mask_(0),
+      receive_buffers_(nullptr), recycle_start_(0), recycle_count_(0), recycled_unsubmitted_(0), receive_armed_(false), received_next_(0), send_buffers_(nullptr), unsubmitted_(0), syscalls_(0) {}
+
+bool UringPacketIO::fail(const std::string& what) {
+    last_error_ = what + ": " + std::string(strerror(errno));
+    close();
+    return false;
+}
+
+bool UringPacketIO::open(const std::string& interface_name, bool promiscuous) {
+    close();
+    if (!socket_.open(interface_name, promiscuous)) return false;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |
+                   IORING_SETUP_TASKRUN_FLAG;
+    params.cq_entries = kCompletionEntries;
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, kQueueEntries, &params));
+    if (ring_fd_ < 0) return fail("io_uring_setup failed");
+
+    sq_map_length_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_map_length_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map) sq_map_length_ = cq_map_length_ = std::max(sq_map_length_, cq_map_length_);
+    sq_map_ = mmap(nullptr, sq_map_length_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                   IORING_OFF_SQ_RING);
+    if (sq_map_ == MAP_FAILED) {
+        sq_map_ = nullptr;
+        return fail("Mapping the submission queue failed");
+    }
+    if (single_map) {
+        cq_map_ = sq_map_;
+    } else {
+        cq_map_ = mmap(nullptr, cq_map_length_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                       IORING_OFF_CQ_RING);
+        if (cq_map_ == MAP_FAILED) {
+            cq_map_ = nullptr;
+            return fail("Mapping the completion queue failed");
+        }
+    }
+    sqes_length_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_length_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return fail("Mapping the SQEs failed");
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    uint8_t* sq = static_cast<uint8_t*>(sq_map_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sq_flags_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.flags);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+    uint8_t* cq = static_cast<uint8_t*>(cq_map_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+
+    size_t pool = static_cast<size_t>(kReceiveBuffers + kSendBuffers) * kBufferSize;
+    void* buffers = mmap(nullptr, pool, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) return fail("Allocating packet buffers failed");
+    receive_buffers_ = static_cast<uint8_t*>(buffers);
+    send_buffers_ = receive_buffers_ + static_cast<size_t>(kReceiveBuffers) * kBufferSize;
+
+    // Classic provided buffers rather than a registered buffer ring: the
+    // ring needs 5.19 and has been seen to report ENOBUFS while full
+    provideBuffers(0, kReceiveBuffers);
+    free_send_buffers_.clear();
+    for (uint16_t i = kSendBuffers; i-- > 0;) free_send_buffers_.push_back(i);
+    received_.reserve(kCompletionEntries);
+
+    armReceive();
+    if (enter(unsubmitted_, 0, 0) < 0) return fail("Submitting the receive failed");
+    unsubmitted_ = 0;
+    recycled_unsubmitted_ = 0;
+    return true;
+}
+
+void UringPacketIO::close() {
+    // Closing the ring cancels the receive and any sends still in flight
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if (sqes_) munmap(sqes_, sqes_length_);
+    if (cq_map_ && cq_map_ != sq_map_) munmap(cq_map_, cq_map_length_);
+    if (sq_map_) munmap(sq_map_, sq_map_length_);
+    if (receive_buffers_) munmap(receive_buffers_, static_cast<size_t>(kReceiveBuffers + kSendBuffers) * kBufferSize);
+    sqes_ = nullptr;
+    sq_map_ = cq_map_ = nullptr;
+    receive_buffers_ = send_buffers_ = nullptr;
+    recycle_count_ = 0;
+    recycled_unsubmitted_ = 0;
+    receive_armed_ = false;
+    received_.clear();
+    received_next_ = 0;
+    free_send_buffers_.clear();
+    unsubmitted_ = 0;
+    socket_.close();
+}
+
+int UringPacketIO::enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    ++syscalls_;
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0));
+}
+
+struct io_uring_sqe* UringPacketIO::nextSqe() {
+    if (sq_local_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+        // Full: hand what we have to the kernel first
+        flush();
+        if (sq_local_tail_ - LoadAcquire(sq_head_) >= sq_entries_) return nullptr;
+    }
+    uint32_t index = sq_local_tail_ & sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sq_local_tail_;
+    ++unsubmitted_;
+    return sqe;
+}
+
+void UringPacketIO::armReceive() {
+    struct io_uring_sqe* sqe = nextSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket_.fd();
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = kReceiveTag;
+    StoreRelease(sq_tail_, sq_local_tail_);
+    receive_armed_ = true;
+}
+
+void UringPacketIO::provideBuffers(uint16_t first, uint16_t count) {
+    struct io_uring_sqe* sqe = nextSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = count;
+    sqe->addr = reinterpret_cast<uint64_t>(receive_buffers_ + static_cast<size_t>(first) * kBufferSize);
+    sqe->len = kBufferSize;
+    sqe->off = first;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = kProvideTag;
+    StoreRelease(sq_tail_, sq_local_tail_);
+    recycled_unsubmitted_ += count;
+}
+
+void UringPacketIO::recycleBuffer(uint16_t buffer) {
+    // The kernel hands buffers out in the order they were provided, so
+    // consecutive frames usually extend the current run
+    if (recycle_count_ > 0 && buffer == recycle_start_ + recycle_count_) {
+        ++recycle_count_;
+        return;
+    }
+    if (recycle_count_ > 0) provideBuffers(recycle_start_, recycle_count_);
+    recycle_start_ = buffer;
+    recycle_count_ = 1;
+}
+
+void UringPacketIO::reapCompletions() {
+    uint32_t head = *cq_head_;
+    uint32_t tail = LoadAcquire(cq_tail_);
+    if (head == tail && (LoadAcquire(sq_flags_) & IORING_SQ_TASKRUN)) {
+        // Completions are waiting on task work; let the kernel post them
+        enter(0, 0, IORING_ENTER_GETEVENTS);
+        tail = LoadAcquire(cq_tail_);
+    }
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        if (cqe.user_data == kReceiveTag) {
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                Received frame;
+                frame.buffer = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                frame.length = static_cast<uint32_t>(cqe.res);
+                received_.push_back(frame);
+            } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+                last_error_ = "receive failed: " + std::string(strerror(-cqe.res));
+            }
+            // Out of buffers or an error ends the multishot; re-armed below
+            if (!(cqe.flags & IORING_CQE_F_MORE)) receive_armed_ = false;
+        } else if (cqe.user_data == kProvideTag) {
+            if (cqe.res < 0) last_error_ = "providing buffers failed: " + std::string(strerror(-cqe.res));
+        } else {
+            free_send_buffers_.push_back(static_cast<uint16_t>(cqe.user_data & 0xFFFF));
+            if (cqe.res < 0) last_error_ = "send failed: " + std::string(strerror(-cqe.res));
+        }
+    }
+    StoreRelease(cq_head_, head);
+}
+
+size_t UringPacketIO::receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) {
+    if (ring_fd_ < 0) return 0;
+    if (received_next_ == received_.size()) {
+        received_.clear();
+        received_next_ = 0;
+        reapCompletions();
+        // Give buffers back a quarter of the group at a time, or all of
+        // them when the receive ran dry, so they cost no extra syscall
+        if (!receive_armed_ || recycled_unsubmitted_ + recycle_count_ >= kReceiveBuffers / 4) {
+            if (recycle_count_ > 0) provideBuffers(recycle_start_, recycle_count_);
+            recycle_count_ = 0;
+            if (!receive_armed_) armReceive();
+            flush();
+        }
+        if (received_.empty()) return 0;
+    }
+
+    const Received& frame = received_[received_next_++];
+    size_t copied = std::min(static_cast<size_t>(frame.length), capacity);
+    memcpy(buffer, receive_buffers_ + static_cast<size_t>(frame.buffer) * kBufferSize, copied);
+    recycleBuffer(frame.buffer);
+    timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    return copied;
+}
+
+bool UringPacketIO::send(const uint8_t* frame, size_t length) {
+    if (ring_fd_ < 0) {
+        last_error_ = "Socket not open";
+        return false;
+    }
+    if (length > kBufferSize) {
+        last_error_ = "Frame larger than a send buffer";
+        return false;
+    }
+    if (free_send_buffers_.empty()) {
+        // Every buffer is in flight: submit and wait for one to come back
+        flush();
+        reapCompletions();
+        if (free_send_buffers_.empty()) {
+            enter(0, 1, IORING_ENTER_GETEVENTS);
+            reapCompletions();
+        }
+        if (free_send_buffers_.empty()) {
+            last_error_ = "No free send buffer";
+            return false;
+        }
+    }
+    struct io_uring_sqe* sqe = nextSqe();
+    if (!sqe) {
+        last_error_ = "Submission queue full";
+        return false;
+    }
+
+    uint16_t slot = free_send_buffers_.back();
+    free_send_buffers_.pop_back();
+    uint8_t* data = send_buffers_ + static_cast<size_t>(slot) * kBufferSize;
+    memcpy(data, frame, length);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = socket_.fd();
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->user_data = kSendTag | slot;
+    StoreRelease(sq_tail_, sq_local_tail_);
+    if (unsubmitted_ >= kBatch) flush();
+    return true;
+}
+
+void UringPacketIO::flush() {
+    if (ring_fd_ < 0 || unsubmitted_ == 0) return;
+    if (enter(unsubmitted_, 0, 0) < 0) {
+        // Left in the queue and retried by the next flush
+        last_error_ = "io_uring_enter failed: " + std::string(strerror(errno));
+        return;
+    }
+    unsubmitted_ = 0;
+    recycled_unsubmitted_ = 0;
+}
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "packet_io.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef __linux__
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// AF_PACKET socket driven through io_uring, for hosts without AF_XDP
+//
+// One multishot receive stays armed on the socket and picks from a group
+// of provided buffers, so frames arrive as completions without a syscall
+// each. Buffers go back to the group in contiguous runs, one SQE per run,
+// riding on the next submission. Sends are queued as SQEs and submitted kBatch at a time
+// (or by flush()), and their completions return the send buffers. Both
+// kinds of completion come off one completion queue, so control-plane
+// frames (ARP sweeps, refresh, restores) and relayed traffic share one
+// loop. The ring is set up with cooperative task running: the kernel
+// only posts completions when we enter it, and says when that is needed,
+// so an idle poll of receive() costs no syscall. Sends are not linked:
+// one the kernel has to retry (socket buffer full) can be overtaken.
+//
+// Single-threaded, like the socket it wraps. Needs Linux 6.0 (multishot
+// receive); open() fails on older kernels.
+class UringPacketIO : public PacketIO {
+public:
+    static const uint32_t kBatch = 32;
+    static const uint32_t kReceiveBuffers = 1024;
+    static const uint32_t kSendBuffers = 512;
+    static const uint32_t kBufferSize = 2048;
+
+    UringPacketIO();
+    ~UringPacketIO() override { close(); }
+
+    UringPacketIO(const UringPacketIO&) = delete;
+    UringPacketIO& operator=(const UringPacketIO&) = delete;
+
+    // promiscuous: also receive frames addressed to other MACs
+    bool open(const std::string& interface_name, bool promiscuous = false);
+    void close();
+
+    // Submit queued sends. send() does this every kBatch frames; call it
+    // after each burst so no frame waits for the next one.
+    void flush();
+
+    // Ring fd: readable while completions are pending
+    int fd() const { return ring_fd_; }
+    const uint8_t* interfaceMac() const { return socket_.interfaceMac(); }
+    // io_uring_enter calls so far, to compare against per-frame syscalls
+    uint64_t syscalls() const { return syscalls_; }
+
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) override;
+    bool setFilter(const std::vector<BpfInstruction>& program) override { return socket_.setFilter(program); }
+    bool captureStats(CaptureStats& stats) override { return socket_.captureStats(stats); }
+    std::string lastError() const override { return last_error_.empty() ? socket_.lastError() : last_error_; }
+
+private:
+    struct Received {
+        uint16_t buffer;
+        uint32_t length;
+    };
+
+    PacketSocketIO socket_;
+    int ring_fd_;
+
+    // Submission and completion queues (shared with the kernel)
+    void* sq_map_;
+    size_t sq_map_length_;
+    void* cq_map_;
+    size_t cq_map_length_;
+    struct io_uring_sqe* sqes_;
+    size_t sqes_length_;
+    uint32_t* sq_head_;
+    uint32_t* sq_tail_;
+    uint32_t* sq_flags_;
+    uint32_t* sq_array_;
+    uint32_t sq_mask_;
+    uint32_t sq_entries_;
+    uint32_t sq_local_tail_;
+    uint32_t* cq_head_;
+    uint32_t* cq_tail_;
+    struct io_uring_cqe* cqes_;
+    uint32_t cq_mask_;
+
+    // Provided buffers for the multishot receive
+    uint8_t* receive_buffers_;
+    uint16_t recycle_start_;                // run of buffers not yet given back
+    uint16_t recycle_count_;
+    uint32_t recycled_unsubmitted_;         // given back, SQE not yet submitted
+    bool receive_armed_;
+    std::vector<Received> received_;        // completed, not yet handed out
+    size_t received_next_;
+
+    uint8_t* send_buffers_;
+    std::vector<uint16_t> free_send_buffers_;
+    uint32_t unsubmitted_;
+
+    uint64_t syscalls_;
+    std::string last_error_;
+
+    struct io_uring_sqe* nextSqe();
+    int enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+    void armReceive();
+    void provideBuffers(uint16_t first, uint16_t count);
+    void recycleBuffer(uint16_t buffer);
+    void reapCompletions();
+    bool fail(const std::string& what);
+};
+#endif
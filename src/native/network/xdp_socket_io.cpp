@@ -0,0 +1,541 @@
+#include "xdp_socket_io.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+static long Bpf(int command, union bpf_attr& attr) {
+    return syscall(__NR_bpf, command, &attr, sizeof(attr));
+}
+
+static struct bpf_insn Insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+    struct bpf_insn insn;
+    memset(&insn, 0, sizeof(insn));
+    insn.code = code;
+    insn.dst_reg = dst;
+    insn.src_reg = src;
+    insn.off = off;
+    insn.imm = imm;
+    return insn;
+}
+
+// 64-bit immediate load of a map (two instruction slots)
+static void LoadMap(std::vector<struct bpf_insn>& program, uint8_t dst, int map_fd) {
+    program.push_back(Insn(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    program.push_back(Insn(0, 0, 0, 0, 0));
+}
+
+static void StoreRelease(uint32_t* index, uint32_t value) {
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+static uint32_t LoadAcquire(const uint32_t* index) {
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+// MacKey() to the 8-byte map key: MAC in wire order, two zero bytes
+static void MacMapKey(uint64_t mac, uint8_t* key) {
+    for (int b = 0; b < 6; ++b) key[b] = static_cast<uint8_t>(mac >> (40 - 8 * b));
+    key[6] = 0;
+    key[7] = 0;
+}
+
+XdpSocketIO::XdpSocketIO()
+    : fd_(-1), ifindex_(0), program_fd_(-1), link_fd_(-1), macs_map_fd_(-1), xsks_map_fd_(-1),
+      zero_copy_(false), generic_(false), umem_(nullptr), umem_length_(0), tx_pending_(0), tx_in_flight_(0),
+      rx_batch_count_(0), rx_batch_next_(0), received_(0) {}
+
+bool XdpSocketIO::fail(const std::string& what) {
+    last_error_ = what + ": " + std::string(strerror(errno));
+    close();
+    return false;
+}
+
+bool XdpSocketIO::open(const std::string& interface_name, const XdpSocketOptions& options) {
+    close();
+    options_ = options;
+    if ((options.frame_size != 2048 && options.frame_size != 4096) || options.ring_size == 0 ||
+        (options.ring_size & (options.ring_size - 1)) != 0 || options.frame_count < 2 * options.ring_size) {
+        last_error_ = "frame_size must be 2048 or 4096, ring_size a power of two and frame_count >= 2 * ring_size";
+        return false;
+    }
+
+    ifindex_ = static_cast<int>(if_nametoindex(interface_name.c_str()));
+    if (ifindex_ == 0) {
+        last_error_ = "Unknown interface " + interface_name;
+        return false;
+    }
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    if (probe >= 0) {
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, interface_name.c_str(), IFNAMSIZ - 1);
+        if (ioctl(probe, SIOCGIFHWADDR, &ifr) == 0) {
+            memcpy(mac_, ifr.ifr_hwaddr.sa_data, 6);
+        }
+        ::close(probe);
+    }
+
+    fd_ = socket(AF_XDP, SOCK_RAW, 0);
+    if (fd_ < 0) return fail("socket(AF_XDP) failed");
+    if (!setupUmem() || !loadProgram()) return false;
+
+    // Native first (unless generic is asked for); zero copy needs native
+    bool attached = false;
+    if (options.mode != kXdpAttachGeneric) {
+        attached = attachProgram(XDP_FLAGS_DRV_MODE);
+        if (!attached && options.mode == kXdpAttachNative) return fail("Native XDP attach failed");
+    }
+    if (!attached) {
+        generic_ = true;
+        if (!attachProgram(XDP_FLAGS_SKB_MODE)) return fail("XDP attach failed (needs Linux 5.9+)");
+    }
+
+    struct sockaddr_xdp address;
+    memset(&address, 0, sizeof(address));
+    address.sxdp_family = AF_XDP;
+    address.sxdp_ifindex = static_cast<uint32_t>(ifindex_);
+    address.sxdp_queue_id = options.queue;
+    address.sxdp_flags = XDP_USE_NEED_WAKEUP | XDP_ZEROCOPY;
+    zero_copy_ = !generic_ && options.zero_copy &&
+                 bind(fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+    if (!zero_copy_) {
+        address.sxdp_flags = XDP_USE_NEED_WAKEUP | XDP_COPY;
+        if (bind(fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+            return fail("bind to " + interface_name + " queue " + std::to_string(options.queue) + " failed");
+        }
+    }
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    uint32_t queue = options.queue;
+    uint32_t socket_fd = static_cast<uint32_t>(fd_);
+    attr.map_fd = static_cast<uint32_t>(xsks_map_fd_);
+    attr.key = reinterpret_cast<uint64_t>(&queue);
+    attr.value = reinterpret_cast<uint64_t>(&socket_fd);
+    attr.flags = BPF_ANY;
+    if (Bpf(BPF_MAP_UPDATE_ELEM, attr) != 0) return fail("Adding the socket to the XSKMAP failed");
+
+    // Managed MACs set before open() go into the fresh map now
+    std::vector<uint64_t> macs;
+    macs.swap(managed_macs_);
+    if (!setManagedMacs(macs)) {
+        close();
+        return false;
+    }
+
+    refillFillRing();
+    return true;
+}
+
+bool XdpSocketIO::setupUmem() {
+    umem_length_ = static_cast<size_t>(options_.frame_count) * options_.frame_size;
+    void* memory = mmap(nullptr, umem_length_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        umem_length_ = 0;
+        return fail("UMEM allocation failed");
+    }
+    umem_ = static_cast<uint8_t*>(memory);
+
+    struct xdp_umem_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.addr = reinterpret_cast<uint64_t>(umem_);
+    registration.len = umem_length_;
+    registration.chunk_size = options_.frame_size;
+    if (setsockopt(fd_, SOL_XDP, XDP_UMEM_REG, &registration, sizeof(registration)) != 0) {
+        return fail("XDP_UMEM_REG failed");
+    }
+
+    uint32_t size = options_.ring_size;
+    if (setsockopt(fd_, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) != 0 ||
+        setsockopt(fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) != 0 ||
+        setsockopt(fd_, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) != 0 ||
+        setsockopt(fd_, SOL_XDP, XDP_TX_RING, &size, sizeof(size)) != 0) {
+        return fail("Sizing the XDP rings failed");
+    }
+
+    struct xdp_mmap_offsets offsets;
+    socklen_t length = sizeof(offsets);
+    if (getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length) != 0) {
+        return fail("XDP_MMAP_OFFSETS failed");
+    }
+    if (!mapRing(fill_, size, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING, offsets.fr) ||
+        !mapRing(completion_, size, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING, offsets.cr) ||
+        !mapRing(rx_, size, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING, offsets.rx) ||
+        !mapRing(tx_, size, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING, offsets.tx)) {
+        return false;
+    }
+
+    free_frames_.clear();
+    free_frames_.reserve(options_.frame_count);
+    for (uint32_t i = options_.frame_count; i-- > 0;) {
+        free_frames_.push_back(static_cast<uint64_t>(i) * options_.frame_size);
+    }
+    return true;
+}
+
+bool XdpSocketIO::mapRing(Ring& ring, uint32_t size, size_t descriptor_size, uint64_t page_offset,
+                          const struct xdp_ring_offset& offsets) {
+    size_t length = offsets.desc + size * descriptor_size;
+    void* map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                     static_cast<off_t>(page_offset));
+    if (map == MAP_FAILED) return fail("Mapping an XDP ring failed");
+
+    uint8_t* base = static_cast<uint8_t*>(map);
+    ring.map = map;
+    ring.map_length = length;
+    ring.producer = reinterpret_cast<uint32_t*>(base + offsets.producer);
+    ring.consumer = reinterpret_cast<uint32_t*>(base + offsets.consumer);
+    ring.flags = reinterpret_cast<uint32_t*>(base + offsets.flags);
+    ring.descriptors = base + offsets.desc;
+    ring.mask = size - 1;
+    ring.cached_producer = LoadAcquire(ring.producer);
+    ring.cached_consumer = LoadAcquire(ring.consumer);
+    return true;
+}
+
+// The XDP program, by hand (no clang/libbpf at build time):
+//
+//   if frame shorter than 14 bytes       -> pass
+//   if ethertype == ARP                  -> redirect
+//   if source MAC in macs map            -> redirect
+//   pass
+//   redirect: bpf_redirect_map(xsks, rx_queue_index, XDP_PASS)
+//
+// The XDP_PASS flag makes the redirect fall back to the stack when no
+// socket is bound to the frame's queue.
+bool XdpSocketIO::loadProgram() {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_HASH;
+    attr.key_size = 8;
+    attr.value_size = 1;
+    attr.max_entries = kMaxManagedMacs;
+    strncpy(attr.map_name, "ns_macs", sizeof(attr.map_name) - 1);
+    macs_map_fd_ = static_cast<int>(Bpf(BPF_MAP_CREATE, attr));
+    if (macs_map_fd_ < 0) return fail("Creating the managed MAC map failed");
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = 4;
+    attr.value_size = 4;
+    attr.max_entries = options_.queue + 1;
+    strncpy(attr.map_name, "ns_xsks", sizeof(attr.map_name) - 1);
+    xsks_map_fd_ = static_cast<int>(Bpf(BPF_MAP_CREATE, attr));
+    if (xsks_map_fd_ < 0) return fail("Creating the XSKMAP failed");
+
+    const uint8_t r0 = BPF_REG_0, r1 = BPF_REG_1, r2 = BPF_REG_2, r3 = BPF_REG_3, r4 = BPF_REG_4,
+                  r5 = BPF_REG_5, r6 = BPF_REG_6, fp = BPF_REG_10;
+    std::vector<struct bpf_insn> program;
+    program.push_back(Insn(BPF_ALU64 | BPF_MOV | BPF_X, r6, r1, 0, 0));
+    program.push_back(Insn(BPF_LDX | BPF_MEM | BPF_W, r2, r6, offsetof(struct xdp_md, data), 0));
+    program.push_back(Insn(BPF_LDX | BPF_MEM | BPF_W, r3, r6, offsetof(struct xdp_md, data_end), 0));
+    program.push_back(Insn(BPF_ALU64 | BPF_MOV | BPF_X, r4, r2, 0, 0));
+    program.push_back(Insn(BPF_ALU64 | BPF_ADD | BPF_K, r4, 0, 0, 14));
+    size_t jump_short = program.size();
+    program.push_back(Insn(BPF_JMP | BPF_JGT | BPF_X, r4, r3, 0, 0));                   // -> pass
+    program.push_back(Insn(BPF_LDX | BPF_MEM | BPF_H, r5, r2, 12, 0));
+    size_t jump_arp = program.size();
+    program.push_back(Insn(BPF_JMP | BPF_JEQ | BPF_K, r5, 0, 0, htons(0x0806)));      // -> redirect
+
+    // key = source MAC + two zero bytes, at fp - 8
+    program.push_back(Insn(BPF_LDX | BPF_MEM | BPF_W, r5, r2, 6, 0));
+    program.push_back(Insn(BPF_STX | BPF_MEM | BPF_W, fp, r5, -8, 0));
+    program.push_back(Insn(BPF_LDX | BPF_MEM | BPF_H, r5, r2, 10, 0));
+    program.push_back(Insn(BPF_STX | BPF_MEM | BPF_H, fp, r5, -4, 0));
+    program.push_back(Insn(BPF_ST | BPF_MEM | BPF_H, fp, 0, -2, 0));
+    LoadMap(program, r1, macs_map_fd_);
+    program.push_back(Insn(BPF_ALU64 | BPF_MOV | BPF_X, r2, fp, 0, 0));
+    program.push_back(Insn(BPF_ALU64 | BPF_ADD | BPF_K, r2, 0, 0, -8));
+    program.push_back(Insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem));
+    size_t jump_unmanaged = program.size();
+    program.push_back(Insn(BPF_JMP | BPF_JEQ | BPF_K, r0, 0, 0, 0));                   // -> pass
+
+    size_t redirect = program.size();
+    LoadMap(program, r1, xsks_map_fd_);
+    program.push_back(Insn(BPF_LDX | BPF_MEM | BPF_W, r2, r6, offsetof(struct xdp_md, rx_queue_index), 0));
+    program.push_back(Insn(BPF_ALU64 | BPF_MOV | BPF_K, r3, 0, 0, XDP_PASS));
+    program.push_back(Insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    program.push_back(Insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    size_t pass = program.size();
+    program.push_back(Insn(BPF_ALU64 | BPF_MOV | BPF_K, r0, 0, 0, XDP_PASS));
+    program.push_back(Insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    program[jump_short].off = static_cast<int16_t>(pass - jump_short - 1);
+    program[jump_arp].off = static_cast<int16_t>(redirect - jump_arp - 1);
+    program[jump_unmanaged].off = static_cast<int16_t>(pass - jump_unmanaged - 1);
+
+    static const char kLicense[] = "Dual MIT/GPL";
+    std::vector<char> log(1 << 16);
+    for (int attempt = 0; attempt < 2 && program_fd_ < 0; ++attempt) {
+        memset(&attr, 0, sizeof(attr));
+        attr.prog_type = BPF_PROG_TYPE_XDP;
+        attr.expected_attach_type = BPF_XDP;
+        attr.insns = reinterpret_cast<uint64_t>(program.data());
+        attr.insn_cnt = static_cast<uint32_t>(program.size());
+        attr.license = reinterpret_cast<uint64_t>(kLicense);
+        strncpy(attr.prog_name, "ns_xdp_relay", sizeof(attr.prog_name) - 1);
+        if (attempt == 1) {
+            // Retry with the verifier log for the error message
+            attr.log_level = 1;
+            attr.log_buf = reinterpret_cast<uint64_t>(log.data());
+            attr.log_size = static_cast<uint32_t>(log.size());
+        }
+        program_fd_ = static_cast<int>(Bpf(BPF_PROG_LOAD, attr));
+    }
+    if (program_fd_ < 0) {
+        std::string verifier(log.data());
+        return fail("Loading the XDP program failed" + (verifier.empty() ? "" : " (" + verifier + ")"));
+    }
+    return true;
+}
+
+bool XdpSocketIO::attachProgram(uint32_t flags) {
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = static_cast<uint32_t>(program_fd_);
+    attr.link_create.target_ifindex = static_cast<uint32_t>(ifindex_);
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = flags;
+    link_fd_ = static_cast<int>(Bpf(BPF_LINK_CREATE, attr));
+    return link_fd_ >= 0;
+}
+
+void XdpSocketIO::close() {
+    if (link_fd_ >= 0) ::close(link_fd_);
+    if (program_fd_ >= 0) ::close(program_fd_);
+    if (macs_map_fd_ >= 0) ::close(macs_map_fd_);
+    if (xsks_map_fd_ >= 0) ::close(xsks_map_fd_);
+    link_fd_ = program_fd_ = macs_map_fd_ = xsks_map_fd_ = -1;
+
+    for (Ring* ring : { &fill_, &completion_, &rx_, &tx_ }) {
+        if (ring->map) munmap(ring->map, ring->map_length);
+        *ring = Ring();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (umem_) {
+        munmap(umem_, umem_length_);
+        umem_ = nullptr;
+        umem_length_ = 0;
+    }
+    free_frames_.clear();
+    zero_copy_ = generic_ = false;
+    tx_pending_ = tx_in_flight_ = 0;
+    rx_batch_count_ = rx_batch_next_ = 0;
+    received_ = 0;
+}
+
+bool XdpSocketIO::setManagedMacs(const std::vector<uint64_t>& macs) {
+    std::vector<uint64_t> sorted(macs);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    if (sorted.size() > kMaxManagedMacs) {
+        last_error_ = "More than " + std::to_string(kMaxManagedMacs) + " managed MACs";
+        return false;
+    }
+    if (macs_map_fd_ < 0) {
+        // Not open yet: applied by open()
+        managed_macs_.swap(sorted);
+        return true;
+    }
+
+    // Apply the difference, so unchanged MACs never miss
+    std::vector<uint64_t> removed, added;
+    std::set_difference(managed_macs_.begin(), managed_macs_.end(), sorted.begin(), sorted.end(),
+                        std::back_inserter(removed));
+    std::set_difference(sorted.begin(), sorted.end(), managed_macs_.begin(), managed_macs_.end(),
+                        std::back_inserter(added));
+    uint8_t key[8];
+    uint8_t value = 1;
+    union bpf_attr attr;
+    for (uint64_t mac : added) {
+        MacMapKey(mac, key);
+        memset(&attr, 0, sizeof(attr));
+        attr.map_fd = static_cast<uint32_t>(macs_map_fd_);
+        attr.key = reinterpret_cast<uint64_t>(key);
+        attr.value = reinterpret_cast<uint64_t>(&value);
+        attr.flags = BPF_ANY;
+        if (Bpf(BPF_MAP_UPDATE_ELEM, attr) != 0) {
+            last_error_ = "Updating the managed MAC map failed: " + std::string(strerror(errno));
+            return false;
+        }
+    }
+    for (uint64_t mac : removed) {
+        MacMapKey(mac, key);
+        memset(&attr, 0, sizeof(attr));
+        attr.map_fd = static_cast<uint32_t>(macs_map_fd_);
+        attr.key = reinterpret_cast<uint64_t>(key);
+        Bpf(BPF_MAP_DELETE_ELEM, attr);
+    }
+    managed_macs_.swap(sorted);
+    return true;
+}
+
+void XdpSocketIO::refillFillRing() {
+    // Keep a quarter of the UMEM for sends
+    size_t reserve = options_.frame_count / 4;
+    if (free_frames_.size() <= reserve) return;
+
+    uint32_t size = fill_.mask + 1;
+    uint32_t space = size - (fill_.cached_producer - fill_.cached_consumer);
+    if (space < kBatch) {
+        fill_.cached_consumer = LoadAcquire(fill_.consumer);
+        space = size - (fill_.cached_producer - fill_.cached_consumer);
+    }
+    uint32_t count = static_cast<uint32_t>(std::min<size_t>(space, free_frames_.size() - reserve));
+    if (count == 0) return;
+
+    uint64_t* addresses = static_cast<uint64_t*>(fill_.descriptors);
+    for (uint32_t i = 0; i < count; ++i) {
+        addresses[(fill_.cached_producer + i) & fill_.mask] = free_frames_.back();
+        free_frames_.pop_back();
+    }
+    fill_.cached_producer += count;
+    StoreRelease(fill_.producer, fill_.cached_producer);
+}
+
+void XdpSocketIO::reclaimCompletions() {
+    uint32_t count = completion_.cached_producer - completion_.cached_consumer;
+    if (count == 0) {
+        completion_.cached_producer = LoadAcquire(completion_.producer);
+        count = completion_.cached_producer - completion_.cached_consumer;
+        if (count == 0) return;
+    }
+    const uint64_t* addresses = static_cast<const uint64_t*>(completion_.descriptors);
+    uint64_t frame_mask = ~static_cast<uint64_t>(options_.frame_size - 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        free_frames_.push_back(addresses[(completion_.cached_consumer + i) & completion_.mask] & frame_mask);
+    }
+    completion_.cached_consumer += count;
+    StoreRelease(completion_.consumer, completion_.cached_consumer);
+    tx_in_flight_ -= std::min(tx_in_flight_, count);
+}
+
+size_t XdpSocketIO::receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) {
+    if (fd_ < 0) return 0;
+    if (rx_batch_next_ == rx_batch_count_) {
+        refillFillRing();
+        if (LoadAcquire(fill_.flags) & XDP_RING_NEED_WAKEUP) {
+            recvfrom(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+        }
+
+        uint32_t available = rx_.cached_producer - rx_.cached_consumer;
+        if (available == 0) {
+            rx_.cached_producer = LoadAcquire(rx_.producer);
+            available = rx_.cached_producer - rx_.cached_consumer;
+            if (available == 0) return 0;
+        }
+        uint32_t count = std::min(available, kBatch);
+        const struct xdp_desc* descriptors = static_cast<const struct xdp_desc*>(rx_.descriptors);
+        for (uint32_t i = 0; i < count; ++i) {
+            const struct xdp_desc& descriptor = descriptors[(rx_.cached_consumer + i) & rx_.mask];
+            rx_batch_[i].address = descriptor.addr;
+            rx_batch_[i].length = descriptor.len;
+        }
+        rx_.cached_consumer += count;
+        StoreRelease(rx_.consumer, rx_.cached_consumer);
+        rx_batch_count_ = count;
+        rx_batch_next_ = 0;
+        received_ += count;
+    }
+
+    const RxFrame& frame = rx_batch_[rx_batch_next_++];
+    size_t copied = std::min(static_cast<size_t>(frame.length), capacity);
+    memcpy(buffer, umem_ + frame.address, copied);
+    free_frames_.push_back(frame.address & ~static_cast<uint64_t>(options_.frame_size - 1));
+    timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    return copied;
+}
+
+bool XdpSocketIO::send(const uint8_t* frame, size_t length) {
+    if (fd_ < 0) {
+        last_error_ = "Socket not open";
+        return false;
+    }
+    if (length > options_.frame_size) {
+        last_error_ = "Frame larger than a UMEM frame";
+        return false;
+    }
+    if (free_frames_.empty()) {
+        flush();
+        if (free_frames_.empty()) {
+            last_error_ = "No free UMEM frame";
+            return false;
+        }
+    }
+    uint32_t size = tx_.mask + 1;
+    if (tx_.cached_producer - tx_.cached_consumer == size) {
+        tx_.cached_consumer = LoadAcquire(tx_.consumer);
+        if (tx_.cached_producer - tx_.cached_consumer == size) {
+            flush();
+            last_error_ = "TX ring full";
+            return false;
+        }
+    }
+
+    uint64_t address = free_frames_.back();
+    free_frames_.pop_back();
+    memcpy(umem_ + address, frame, length);
+    struct xdp_desc& descriptor = static_cast<struct xdp_desc*>(tx_.descriptors)[tx_.cached_producer & tx_.mask];
+    descriptor.addr = address;
+    descriptor.len = static_cast<uint32_t>(length);
+    descriptor.options = 0;
+    ++tx_.cached_producer;
+    if (++tx_pending_ >= kBatch) flush();
+    return true;
+}
+
+void XdpSocketIO::flush() {
+    if (fd_ < 0) return;
+    if (tx_pending_) {
+        StoreRelease(tx_.producer, tx_.cached_producer);
+        tx_in_flight_ += tx_pending_;
+        tx_pending_ = 0;
+    }
+    // Copy mode transmits from the syscall, a bounded batch per call, and
+    // says EAGAIN when descriptors are left
+    for (int kick = 0; kick < 16 && tx_in_flight_ && (LoadAcquire(tx_.flags) & XDP_RING_NEED_WAKEUP); ++kick) {
+        if (sendto(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, 0) >= 0 || (errno != EAGAIN && errno != EBUSY)) break;
+        reclaimCompletions();
+    }
+    reclaimCompletions();
+}
+
+bool XdpSocketIO::captureStats(CaptureStats& stats) {
+    struct xdp_statistics raw;
+    socklen_t length = sizeof(raw);
+    if (fd_ < 0 || getsockopt(fd_, SOL_XDP, XDP_STATISTICS, &raw, &length) != 0) {
+        last_error_ = "XDP_STATISTICS failed: " + std::string(strerror(errno));
+        return false;
+    }
+    stats.received = received_;
+    stats.dropped = raw.rx_dropped + raw.rx_ring_full + raw.rx_fill_ring_empty_descs;
+    stats.interface_dropped = 0;
+    return true;
+}
+#endif
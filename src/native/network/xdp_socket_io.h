@@ -0,0 +1,129 @@
+#pragma once
+
+#include "packet_io.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef __linux__
+struct xdp_ring_offset;
+
+// Where the XDP program runs. Generic (skb) mode works on any interface,
+// veth included, at the cost of an skb per frame; native mode needs driver
+// support and is required for zero copy.
+enum XdpAttachMode {
+    kXdpAttachAuto = 0,   // native, falling back to generic
+    kXdpAttachNative,
+    kXdpAttachGeneric
+};
+
+struct XdpSocketOptions {
+    uint32_t queue = 0;            // NIC receive queue to bind
+    uint32_t frame_count = 4096;   // UMEM frames, shared by RX and TX
+    uint32_t frame_size = 2048;    // 2048 or 4096
+    uint32_t ring_size = 2048;     // fill, completion, RX and TX; power of two
+    XdpAttachMode mode = kXdpAttachAuto;
+    bool zero_copy = true;         // native mode only; falls back to copy
+};
+
+// AF_XDP socket with its own XDP program, for Linux relay hosts
+//
+// The program redirects ARP and frames whose source MAC is managed (see
+// setManagedMacs) into the socket; everything else, and everything on
+// other queues, goes on to the kernel stack. The UMEM is one pool of
+// frames: the fill ring is topped up from it in batches, received frames
+// return to it once copied out, and send() takes frames from it and gets
+// them back from the completion ring. Ring indices are published and the
+// kernel woken (only when it asks to be) once per batch, not per frame.
+//
+// Single-threaded: one thread calls receive(), send() and flush(). The
+// XDP program is attached through a BPF link owned by the socket, so it
+// is detached by close() or when the process exits.
+class XdpSocketIO : public PacketIO {
+public:
+    static const uint32_t kBatch = 64;
+    static const size_t kMaxManagedMacs = 65536;
+
+    XdpSocketIO();
+    ~XdpSocketIO() override { close(); }
+
+    XdpSocketIO(const XdpSocketIO&) = delete;
+    XdpSocketIO& operator=(const XdpSocketIO&) = delete;
+
+    bool open(const std::string& interface_name, const XdpSocketOptions& options = XdpSocketOptions());
+    void close();
+
+    // Replace the managed MAC set (MacKey() values, device_table.h)
+    bool setManagedMacs(const std::vector<uint64_t>& macs);
+
+    // Push queued sends to the kernel. send() does this every kBatch
+    // frames; call it after each burst so no frame waits for the next one.
+    void flush();
+
+    int fd() const { return fd_; }
+    const uint8_t* interfaceMac() const { return mac_; }
+    bool zeroCopy() const { return zero_copy_; }
+    bool genericMode() const { return generic_; }
+
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t capacity, uint64_t& timestamp_ns) override;
+    bool captureStats(CaptureStats& stats) override;
+    std::string lastError() const override { return last_error_; }
+
+private:
+    // One of the four shared rings. Producer and consumer indices run
+    // freely and are masked on access; cached_* are this side's view.
+    struct Ring {
+        uint32_t* producer = nullptr;
+        uint32_t* consumer = nullptr;
+        uint32_t* flags = nullptr;
+        void* descriptors = nullptr;
+        uint32_t mask = 0;
+        uint32_t cached_producer = 0;
+        uint32_t cached_consumer = 0;
+        void* map = nullptr;
+        size_t map_length = 0;
+    };
+
+    int fd_;
+    int ifindex_;
+    int program_fd_;
+    int link_fd_;
+    int macs_map_fd_;
+    int xsks_map_fd_;
+    uint8_t mac_[6] = {};
+    bool zero_copy_;
+    bool generic_;
+    XdpSocketOptions options_;
+
+    uint8_t* umem_;
+    size_t umem_length_;
+    std::vector<uint64_t> free_frames_;     // UMEM offsets not in any ring
+    Ring fill_, completion_, rx_, tx_;
+    uint32_t tx_pending_;                   // written but not yet published
+    uint32_t tx_in_flight_;                 // published, completion not seen
+
+    // RX descriptors taken from the ring, handed out one per receive()
+    struct RxFrame {
+        uint64_t address;
+        uint32_t length;
+    };
+    RxFrame rx_batch_[kBatch];
+    uint32_t rx_batch_count_;
+    uint32_t rx_batch_next_;
+
+    std::vector<uint64_t> managed_macs_;
+    uint64_t received_;
+    std::string last_error_;
+
+    bool setupUmem();
+    bool mapRing(Ring& ring, uint32_t size, size_t descriptor_size, uint64_t page_offset,
+                 const struct xdp_ring_offset& offsets);
+    bool loadProgram();
+    bool attachProgram(uint32_t flags);
+    void refillFillRing();
+    void reclaimCompletions();
+    bool fail(const std::string& what);
+};
+#endif
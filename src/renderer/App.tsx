@@ -44,14 +44,27 @@ const AppContent: React.FC = () => {
   
   // Set up event listeners for streaming
   React.useEffect(() => {
+    // Show devices remembered from previous sessions straight away
+    window.electronAPI.getKnownDevices().then(known => {
+      if (known.length > 0) {
+        setDevices(prev => (prev.length > 0 ? prev : known));
+      }
+    }).catch(err => console.error('Failed to load known devices:', err));
+    
     // Listen for individual devices
     const removeDeviceListener = window.electronAPI.onDeviceFound((device: DeviceInfo) => {
       setDevices(prev => {
-        // Check for duplicates based on MAC address
-        const exists = prev.some(existingDevice => existingDevice.mac === device.mac);
-        if (exists) {
-          console.log('Duplicate device skipped:', device.mac);
-          return prev;
+        // Known devices (by MAC address) are refreshed in place
+        const index = prev.findIndex(existingDevice => existingDevice.mac === device.mac);
+        if (index >= 0) {
+          const existing = prev[index];
+          const next = [...prev];
+          next[index] = {
+            ...existing,
+            ...device,
+            name: device.name !== device.ip || existing.name === existing.ip ? device.name : existing.name
+          };
+          return next;
         }
         console.log('Device found:', device);
         return [...prev, device];
@@ -164,7 +177,8 @@ const AppContent: React.FC = () => {
     setScanning(true);
     setResolvingNames(true); // DNS resolution will happen automatically
     setError(null);
-    setDevices([]); // Clear previous results
+    // Keep known devices listed (as offline) while the refresh scan runs
+    setDevices(prev => prev.map(device => ({ ...device, isOnline: false })));
     setFoundCount(0);
     
     try {
@@ -303,6 +303,9 @@ const AdapterSelector: React.FC = () => {
                 <Typography variant="body2"><strong>Receive Errors:</strong> {performanceStats.receiveErrors}</Typography>
                 <Typography variant="body2"><strong>Avg Send Time:</strong> {performanceStats.avgSendTimeMs.toFixed(2)}ms</Typography>
                 <Typography variant="body2"><strong>Avg Receive Time:</strong> {performanceStats.avgReceiveTimeMs.toFixed(2)}ms</Typography>
+                {performanceStats.sendLatency && (
+                  <Typography variant="body2"><strong>Send p50 / p99 / max:</strong> {performanceStats.sendLatency.p50Ms.toFixed(2)} / {performanceStats.sendLatency.p99Ms.toFixed(2)} / {performanceStats.sendLatency.maxMs.toFixed(2)}ms</Typography>
+                )}
               </Box>
             </Box>
           </CardContent>
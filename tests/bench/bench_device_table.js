@@ -0,0 +1,93 @@
+/**
+ * Device table transfer benchmark
+ * Compares the object-per-device N-API path (scanDevicesFast/scanDevices)
+ * against the packed ArrayBuffer path (scanDevicesPacked) on a synthetic table.
+ *
+ * Does not need Npcap or a live LAN - only the built native module.
+ * Run with: node tests/bench/bench_device_table.js [deviceCount] [iterations]
+ */
+
+const path = require('path');
+const fs = require('fs');
+
+const DEVICE_COUNT = parseInt(process.argv[2] || '10000', 10);
+const ITERATIONS = parseInt(process.argv[3] || '10', 10);
+
+function loadNetworkModule() {
+    const possiblePaths = [
+        path.join(__dirname, '../../build/Release/network.node'),
+        path.join(__dirname, '../../src/native/network/build/Release/network.node'),
+        path.resolve('./build/Release/network.node')
+    ];
+
+    for (const modulePath of possiblePaths) {
+        if (fs.existsSync(modulePath)) {
+            console.log('✅ Network module loaded from:', modulePath);
+            return require(modulePath);
+        }
+    }
+
+    console.log('❌ Could not find network.node - build it first: cd src/native/network && npx node-gyp rebuild');
+    process.exit(1);
+}
+
+// The app's own decoder (src/common/deviceTable.ts), transpiled on load with
+// the typescript dev dependency, so the bench measures the real format reader
+function loadDeviceTableDecoder() {
+    const ts = require('typescript');
+    const Module = require('module');
+    const file = path.join(__dirname, '../../src/common/deviceTable.ts');
+    const { outputText } = ts.transpileModule(fs.readFileSync(file, 'utf8'), {
+        compilerOptions: { module: ts.ModuleKind.CommonJS, target: ts.ScriptTarget.ES2020 },
+        fileName: file
+    });
+    const decoderModule = new Module(file, module);
+    decoderModule.filename = file;
+    decoderModule.paths = Module._nodeModulePaths(path.dirname(file));
+    decoderModule._compile(outputText, file);
+    return decoderModule.exports.decodeDeviceTable;
+}
+
+function main() {
+    console.log('🚀 NetShaper device table transfer benchmark');
+    console.log('============================================================');
+    const network = loadNetworkModule();
+    const decodeDeviceTable = loadDeviceTableDecoder();
+
+    // Warm up both paths
+    network.benchmarkDeviceTableTransfer(DEVICE_COUNT, 2);
+
+    const result = network.benchmarkDeviceTableTransfer(DEVICE_COUNT, ITERATIONS);
+
+    const decodeStart = process.hrtime.bigint();
+    let decoded = null;
+    for (let i = 0; i < ITERATIONS; i++) {
+        decoded = decodeDeviceTable(result.packed);
+    }
+    const decodeMs = Number(process.hrtime.bigint() - decodeStart) / 1e6 / ITERATIONS;
+
+    if (decoded.length !== DEVICE_COUNT) {
+        console.log(`❌ Decoded ${decoded.length} devices, expected ${DEVICE_COUNT}`);
+        process.exit(1);
+    }
+
+    const packedTotalMs = result.packedPathMs + decodeMs;
+    console.log(`📊 Devices: ${result.count}, iterations: ${result.iterations}`);
+    console.log(`   Object-per-device (native):  ${result.objectPathMs.toFixed(3)} ms`);
+    console.log(`   Packed buffer (native):      ${result.packedPathMs.toFixed(3)} ms (${(result.packedBytes / 1024).toFixed(1)} KiB)`);
+    console.log(`   Packed decode (JS):          ${decodeMs.toFixed(3)} ms`);
+    console.log(`   Packed end-to-end:           ${packedTotalMs.toFixed(3)} ms`);
+    console.log(`   Native-side speedup:         ${(result.objectPathMs / result.packedPathMs).toFixed(1)}x`);
+
+    console.log(JSON.stringify({
+        benchmark: 'device_table_transfer',
+        count: result.count,
+        iterations: result.iterations,
+        objectPathMs: result.objectPathMs,
+        packedPathMs: result.packedPathMs,
+        packedDecodeMs: decodeMs,
+        packedBytes: result.packedBytes
+    }));
+}
+
+main();
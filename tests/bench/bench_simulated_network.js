@@ -0,0 +1,104 @@
+/**
+ * Simulated LAN load test for the N-API ARP/poisoning layer
+ * Drives sweep, poisoning and restore through the exported functions against
+ * the in-process simulated network (initializeSimulatedNetwork), so the
+ * N-API and worker paths can be loaded with thousands of devices.
+ *
+ * Does not need Npcap or a live LAN - only the built native module.
+ * Run with: node tests/bench/bench_simulated_network.js [deviceCount] [seed]
+ */
+
+const path = require('path');
+const fs = require('fs');
+
+const DEVICE_COUNT = parseInt(process.argv[2] || '5000', 10);
+const SEED = parseInt(process.argv[3] || '1', 10);
+const REFRESH_WAIT_MS = 2500; // one PoisoningWorker cycle (2000ms) plus margin
+
+function loadNetworkModule() {
+    const possiblePaths = [
+        path.join(__dirname, '../../build/Release/network.node'),
+        path.join(__dirname, '../../src/native/network/build/Release/network.node'),
+        path.resolve('./build/Release/network.node')
+    ];
+
+    for (const modulePath of possiblePaths) {
+        if (fs.existsSync(modulePath)) {
+            console.log('✅ Network module loaded from:', modulePath);
+            return require(modulePath);
+        }
+    }
+
+    console.log('❌ Could not find network.node - build it first: cd src/native/network && npx node-gyp rebuild');
+    process.exit(1);
+}
+
+function timeMs(fn) {
+    const start = process.hrtime.bigint();
+    fn();
+    return Number(process.hrtime.bigint() - start) / 1e6;
+}
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+async function main() {
+    console.log('🚀 NetShaper simulated network load test');
+    console.log('============================================================');
+    const network = loadNetworkModule();
+    let failures = 0;
+    const check = (ok, message) => {
+        console.log(`${ok ? '✅' : '❌'} ${message}`);
+        if (!ok) failures++;
+    };
+
+    check(network.initializeSimulatedNetwork({ deviceCount: DEVICE_COUNT, seed: SEED, responseRate: 0.95 }),
+          `Simulated network with ${DEVICE_COUNT} devices initialized`);
+    const topology = network.getNetworkTopology();
+    console.log(`📊 Topology: ${topology.localIp} via ${topology.gatewayIp} (${topology.gatewayMac})`);
+
+    const devices = network.getSimulatedDevices();
+    const responding = devices.filter(device => device.respondsToArp);
+    check(devices.length === DEVICE_COUNT, `getSimulatedDevices returned ${devices.length} devices`);
+
+    // Sweep through the N-API layer
+    const sweepMs = timeMs(() => {
+        for (const device of devices) network.sendArpRequest(device.ip);
+    });
+    await sleep(50);
+    let stats = network.getSimulatedNetworkStats();
+    check(stats.arpRequests === DEVICE_COUNT && stats.arpReplies === responding.length,
+          `Sweep: ${stats.arpRequests} requests, ${stats.arpReplies} replies in ${sweepMs.toFixed(1)} ms`);
+
+    // Poison every responding device and let the worker run one cycle
+    const startMs = timeMs(() => {
+        for (const device of responding) network.startArpPoisoning(device.ip, device.mac);
+    });
+    await sleep(REFRESH_WAIT_MS);
+    stats = network.getSimulatedNetworkStats();
+    check(stats.poisonedDevices === responding.length,
+          `Poisoning: ${stats.poisonedDevices}/${responding.length} devices poisoned (start calls took ${startMs.toFixed(1)} ms)`);
+
+    // Restore everything through cleanup (PoisoningWorker::stopAll)
+    const cleanupMs = timeMs(() => network.cleanupArp());
+    stats = network.getSimulatedNetworkStats();
+    check(stats.restoredDevices === DEVICE_COUNT && stats.poisonedDevices === 0,
+          `Restore: ${stats.restoredDevices}/${DEVICE_COUNT} devices restored in ${cleanupMs.toFixed(1)} ms`);
+
+    const perf = network.getArpPerformanceStats();
+    console.log(JSON.stringify({
+        benchmark: 'simulated_network',
+        devices: DEVICE_COUNT,
+        responding: responding.length,
+        sweepMs,
+        startPoisoningMs: startMs,
+        cleanupMs,
+        sendLatency: perf.sendLatency,
+        network: stats
+    }));
+
+    process.exit(failures ? 1 : 0);
+}
+
+main();